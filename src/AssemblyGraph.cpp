@@ -0,0 +1,337 @@
+// AssemblyGraph.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "AssemblyGraph.h"
+#include <libcrispr/Exception.h>
+#include <algorithm>
+
+void AssemblyGraph::loadAssembly(xercesc::DOMElement * groupElement, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * assembly = groupElement->getFirstElementChild(); 
+         assembly != NULL; 
+         assembly = assembly->getNextElementSibling()) {
+        if (xercesc::XMLString::equals(assembly->getTagName(), xmlParser.tag_Assembly())) {
+            parseAssembly(assembly, xmlParser);
+        }
+    }
+    finalise();
+}
+
+void AssemblyGraph::parseAssembly(xercesc::DOMElement * assemblyElement, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * contig = assemblyElement->getFirstElementChild();
+         contig != NULL;
+         contig = contig->getNextElementSibling()) {
+        if (xercesc::XMLString::equals(contig->getTagName(), xmlParser.tag_Contig())) {
+            parseContig(contig, xmlParser);
+        }
+    }
+}
+
+void AssemblyGraph::parseContig(xercesc::DOMElement * contigElement, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * cspacer = contigElement->getFirstElementChild(); 
+         cspacer != NULL; 
+         cspacer = cspacer->getNextElementSibling()) {
+        if (!xercesc::XMLString::equals(cspacer->getTagName(), xmlParser.tag_Cspacer())) {
+            continue;
+        }
+        char * c_spid = tc(cspacer->getAttribute(xmlParser.attr_Spid()));
+        int current_node = internNode(c_spid, SPACER);
+        xr(&c_spid);
+
+        for (xercesc::DOMElement * links = cspacer->getFirstElementChild(); 
+             links != NULL; 
+             links = links->getNextElementSibling()) {
+            const XMLCh * tag = links->getTagName();
+            if (xercesc::XMLString::equals(tag, xmlParser.tag_Fspacers())) {
+                parseLinks(links, xmlParser, current_node, SPACER, true);
+            } else if (xercesc::XMLString::equals(tag, xmlParser.tag_Bspacers())) {
+                parseLinks(links, xmlParser, current_node, SPACER, false);
+            } else if (xercesc::XMLString::equals(tag, xmlParser.tag_Fflankers())) {
+                parseLinks(links, xmlParser, current_node, FLANKER, true);
+            } else if (xercesc::XMLString::equals(tag, xmlParser.tag_Bflankers())) {
+                parseLinks(links, xmlParser, current_node, FLANKER, false);
+            }
+        }
+    }
+}
+
+void AssemblyGraph::parseLinks(xercesc::DOMElement * parentNode, 
+                               crispr::xml::base& xmlParser, 
+                               int currentNode, 
+                               NODE_TYPE type, 
+                               bool forward)
+{
+    const XMLCh * id_attr = (type == SPACER) ? xmlParser.attr_Spid() : xmlParser.attr_Flid();
+    for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
+         currentElement != NULL; 
+         currentElement = currentElement->getNextElementSibling()) {
+        char * c_id = tc(currentElement->getAttribute(id_attr));
+        int linked_node = internNode(c_id, type);
+        xr(&c_id);
+        if (forward) {
+            addEdge(currentNode, linked_node);
+        } else {
+            addEdge(linked_node, currentNode);
+        }
+    }
+}
+
+int AssemblyGraph::internNode(const std::string& name, NODE_TYPE type)
+{
+    std::map<std::string, int>::iterator iter = AG_Index.find(name);
+    if (iter != AG_Index.end()) {
+        return iter->second;
+    }
+    if (AG_Finalised) {
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "cannot add nodes to a finalised graph");
+    }
+    int id = static_cast<int>(AG_Names.size());
+    AG_Names.push_back(name);
+    AG_Types.push_back(static_cast<char>(type));
+    AG_Index[name] = id;
+    return id;
+}
+
+int AssemblyGraph::nodeWithName(const std::string& name) const
+{
+    std::map<std::string, int>::const_iterator iter = AG_Index.find(name);
+    if (iter != AG_Index.end()) {
+        return iter->second;
+    }
+    return -1;
+}
+
+void AssemblyGraph::addEdge(int tail, int head)
+{
+    if (AG_Finalised) {
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "cannot add edges to a finalised graph");
+    }
+    AG_EdgeList.push_back(std::pair<int, int>(tail, head));
+}
+
+void AssemblyGraph::finalise(void)
+{
+    //-----
+    // the same link is normally listed from both ends (fspacers on one
+    // spacer and bspacers on the other) so sorting also gets rid of those
+    //
+    std::sort(AG_EdgeList.begin(), AG_EdgeList.end());
+    AG_EdgeList.erase(std::unique(AG_EdgeList.begin(), AG_EdgeList.end()), AG_EdgeList.end());
+
+    int num_nodes = nodeCount();
+    int num_edges = static_cast<int>(AG_EdgeList.size());
+    AG_OutOffsets.assign(num_nodes + 1, 0);
+    AG_InOffsets.assign(num_nodes + 1, 0);
+    AG_Targets.resize(num_edges);
+    AG_Sources.resize(num_edges);
+
+    std::vector<std::pair<int, int> >::iterator iter;
+    for (iter = AG_EdgeList.begin(); iter != AG_EdgeList.end(); ++iter) {
+        ++AG_OutOffsets[iter->first + 1];
+        ++AG_InOffsets[iter->second + 1];
+    }
+    for (int i = 0; i < num_nodes; ++i) {
+        AG_OutOffsets[i + 1] += AG_OutOffsets[i];
+        AG_InOffsets[i + 1] += AG_InOffsets[i];
+    }
+
+    // the edge list is sorted by tail so the targets can be copied straight
+    // over, the sources need a counting sort by head
+    std::vector<int> in_position(AG_InOffsets.begin(), AG_InOffsets.end() - 1);
+    for (int e = 0; e < num_edges; ++e) {
+        AG_Targets[e] = AG_EdgeList[e].second;
+        AG_Sources[in_position[AG_EdgeList[e].second]++] = AG_EdgeList[e].first;
+    }
+
+    std::vector<std::pair<int, int> >().swap(AG_EdgeList);
+    AG_Finalised = true;
+}
+
+int AssemblyGraph::countComponents(void) const
+{
+    int num_nodes = nodeCount();
+    std::vector<char> seen(num_nodes, 0);
+    std::vector<int> stack;
+    int components = 0;
+    for (int start = 0; start < num_nodes; ++start) {
+        if (seen[start]) {
+            continue;
+        }
+        ++components;
+        seen[start] = 1;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            int current = stack.back();
+            stack.pop_back();
+            for (const int * w = outBegin(current); w != outEnd(current); ++w) {
+                if (!seen[*w]) {
+                    seen[*w] = 1;
+                    stack.push_back(*w);
+                }
+            }
+            for (const int * w = inBegin(current); w != inEnd(current); ++w) {
+                if (!seen[*w]) {
+                    seen[*w] = 1;
+                    stack.push_back(*w);
+                }
+            }
+        }
+    }
+    return components;
+}
+
+int AssemblyGraph::countBranchPoints(void) const
+{
+    int branch_points = 0;
+    for (int i = 0; i < nodeCount(); ++i) {
+        if (outDegree(i) > 1 || inDegree(i) > 1) {
+            ++branch_points;
+        }
+    }
+    return branch_points;
+}
+
+int AssemblyGraph::stronglyConnectedComponents(std::vector<int>& component) const
+{
+    //-----
+    // Tarjan's algorithm with an explicit stack so that long chains of
+    // spacers can't overflow the call stack
+    //
+    int num_nodes = nodeCount();
+    std::vector<int> index(num_nodes, -1);
+    std::vector<int> low(num_nodes, 0);
+    std::vector<char> on_stack(num_nodes, 0);
+    std::vector<int> scc_stack;
+    std::vector<std::pair<int, const int *> > call_stack;
+    component.assign(num_nodes, -1);
+    int counter = 0;
+    int num_components = 0;
+
+    for (int start = 0; start < num_nodes; ++start) {
+        if (index[start] != -1) {
+            continue;
+        }
+        index[start] = low[start] = counter++;
+        scc_stack.push_back(start);
+        on_stack[start] = 1;
+        call_stack.push_back(std::pair<int, const int *>(start, outBegin(start)));
+
+        while (!call_stack.empty()) {
+            int v = call_stack.back().first;
+            if (call_stack.back().second != outEnd(v)) {
+                int w = *(call_stack.back().second++);
+                if (index[w] == -1) {
+                    index[w] = low[w] = counter++;
+                    scc_stack.push_back(w);
+                    on_stack[w] = 1;
+                    call_stack.push_back(std::pair<int, const int *>(w, outBegin(w)));
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+            } else {
+                call_stack.pop_back();
+                if (!call_stack.empty()) {
+                    int u = call_stack.back().first;
+                    low[u] = std::min(low[u], low[v]);
+                }
+                if (low[v] == index[v]) {
+                    int w;
+                    do {
+                        w = scc_stack.back();
+                        scc_stack.pop_back();
+                        on_stack[w] = 0;
+                        component[w] = num_components;
+                    } while (w != v);
+                    ++num_components;
+                }
+            }
+        }
+    }
+    return num_components;
+}
+
+int AssemblyGraph::longestSpacerPath(void) const
+{
+    std::vector<int> component;
+    int num_components = stronglyConnectedComponents(component);
+    int num_nodes = nodeCount();
+
+    // group the nodes by component with a counting sort
+    std::vector<int> offsets(num_components + 1, 0);
+    std::vector<int> weight(num_components, 0);
+    for (int i = 0; i < num_nodes; ++i) {
+        ++offsets[component[i] + 1];
+        if (nodeType(i) == SPACER) {
+            ++weight[component[i]];
+        }
+    }
+    for (int c = 0; c < num_components; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+    std::vector<int> members(num_nodes);
+    std::vector<int> position(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < num_nodes; ++i) {
+        members[position[component[i]]++] = i;
+    }
+
+    // components come out of Tarjan's algorithm sinks first, so everything
+    // reachable from a component has already been done when we get to it
+    std::vector<int> best(num_components, 0);
+    int longest = 0;
+    for (int c = 0; c < num_components; ++c) {
+        int best_successor = 0;
+        for (int m = offsets[c]; m < offsets[c + 1]; ++m) {
+            int v = members[m];
+            for (const int * w = outBegin(v); w != outEnd(v); ++w) {
+                if (component[*w] != c) {
+                    best_successor = std::max(best_successor, best[component[*w]]);
+                }
+            }
+        }
+        best[c] = weight[c] + best_successor;
+        longest = std::max(longest, best[c]);
+    }
+    return longest;
+}
+
+int AssemblyGraph::countCycles(void) const
+{
+    std::vector<int> component;
+    int num_components = stronglyConnectedComponents(component);
+    std::vector<int> size(num_components, 0);
+    std::vector<char> cyclic(num_components, 0);
+    for (int i = 0; i < nodeCount(); ++i) {
+        if (++size[component[i]] > 1) {
+            cyclic[component[i]] = 1;
+        }
+        // a spacer linked to itself is a cycle on its own
+        for (const int * w = outBegin(i); w != outEnd(i); ++w) {
+            if (*w == i) {
+                cyclic[component[i]] = 1;
+            }
+        }
+    }
+    return static_cast<int>(std::count(cyclic.begin(), cyclic.end(), 1));
+}
@@ -0,0 +1,128 @@
+/*
+ * AssemblyGraph.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_AssemblyGraph_h
+#define crisprtools_AssemblyGraph_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <libcrispr/base.h>
+
+// The spacer graph described by the <assembly> section of a group, stored
+// in compressed sparse row form.  Nodes are interned as the file is read,
+// then finalise() sorts the edges into the CSR arrays.  After that the
+// graph can't be changed, but it is cheap to walk and safe to read from
+// several threads at once
+class AssemblyGraph {
+public:
+    enum NODE_TYPE {
+        SPACER = 0,
+        FLANKER = 1
+    };
+
+    AssemblyGraph(std::string name)
+    {
+        AG_Name = name;
+        AG_Finalised = false;
+    }
+
+    inline std::string getName(void) const {return AG_Name;}
+
+    // read the contigs of a group element, the graph is finalised afterwards
+    void loadAssembly(xercesc::DOMElement * groupElement, crispr::xml::base& xmlParser);
+
+    // add the contigs of one <assembly> element without finalising, so that
+    // nodes from other parts of the group can be interned as well
+    void parseAssembly(xercesc::DOMElement * assemblyElement, crispr::xml::base& xmlParser);
+
+    // returns the id of the node, creating it if it hasn't been seen before
+    int internNode(const std::string& name, NODE_TYPE type);
+    void addEdge(int tail, int head);
+
+    // id of a node or -1 if there is no node with that name
+    int nodeWithName(const std::string& name) const;
+
+    // build the CSR arrays, duplicate edges are removed
+    void finalise(void);
+
+    inline int nodeCount(void) const {return static_cast<int>(AG_Names.size());}
+    inline int edgeCount(void) const {return static_cast<int>(AG_Targets.size());}
+    inline const std::string& nodeName(int id) const {return AG_Names[id];}
+    inline NODE_TYPE nodeType(int id) const {return static_cast<NODE_TYPE>(AG_Types[id]);}
+
+    inline int outDegree(int id) const {return AG_OutOffsets[id + 1] - AG_OutOffsets[id];}
+    inline int inDegree(int id) const {return AG_InOffsets[id + 1] - AG_InOffsets[id];}
+
+    // successors of id are outBegin(id) up to outEnd(id)
+    inline const int * outBegin(int id) const {return edgeArray(AG_Targets) + AG_OutOffsets[id];}
+    inline const int * outEnd(int id) const {return edgeArray(AG_Targets) + AG_OutOffsets[id + 1];}
+    inline const int * inBegin(int id) const {return edgeArray(AG_Sources) + AG_InOffsets[id];}
+    inline const int * inEnd(int id) const {return edgeArray(AG_Sources) + AG_InOffsets[id + 1];}
+
+    //
+    // analysis, everything is linear in nodes + edges
+    //
+
+    // number of weakly connected components
+    int countComponents(void) const;
+
+    // nodes where the graph splits or joins
+    int countBranchPoints(void) const;
+
+    // strongly connected components, component[i] is the component of node
+    // i.  Components are numbered in reverse topological order
+    int stronglyConnectedComponents(std::vector<int>& component) const;
+
+    // the most spacers on any path through the graph.  Cycles are
+    // collapsed first so the spacers in a cycle are only counted once
+    int longestSpacerPath(void) const;
+
+    // number of strongly connected components that contain a cycle
+    int countCycles(void) const;
+
+private:
+    static inline const int * edgeArray(const std::vector<int>& edges)
+    {
+        return (edges.empty()) ? NULL : &edges[0];
+    }
+
+    void parseContig(xercesc::DOMElement * contigElement, crispr::xml::base& xmlParser);
+    void parseLinks(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, int currentNode, NODE_TYPE type, bool forward);
+
+    std::string AG_Name;
+    bool AG_Finalised;
+
+    // node data, indexed by id
+    std::vector<std::string> AG_Names;
+    std::vector<char> AG_Types;
+    std::map<std::string, int> AG_Index;
+
+    // edges as they are added, emptied by finalise
+    std::vector<std::pair<int, int> > AG_EdgeList;
+
+    // CSR in both directions
+    std::vector<int> AG_OutOffsets;
+    std::vector<int> AG_Targets;
+    std::vector<int> AG_InOffsets;
+    std::vector<int> AG_Sources;
+};
+
+#endif
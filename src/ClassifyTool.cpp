@@ -0,0 +1,275 @@
+// ClassifyTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "ClassifyTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/parser.h>
+#include <libcrispr/StlExt.h>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <getopt.h>
+
+int ClassifyTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups", required_argument, NULL, 'g'},
+        {"edits", required_argument, NULL, 'e'},
+        {"kmer", required_argument, NULL, 'k'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"repeats", required_argument, NULL, 'r'},
+        {"threads", required_argument, NULL, 't'},
+        {"xml", required_argument, NULL, 'x'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hg:e:k:o:r:t:x:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                classifyUsage();
+                exit(1);
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(CL_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, CL_Groups);
+                }
+                CL_Subset = true;
+                break;
+            }
+            case 'e':
+            {
+                if (!from_string<int>(CL_MaxEdits, optarg, std::dec) || CL_MaxEdits < 0 || CL_MaxEdits > CL_MAX_EDITS) {
+                    throw crispr::input_exception("The number of edits must be between 0 and 32");
+                }
+                break;
+            }
+            case 'k':
+            {
+                if (!from_string<int>(CL_K, optarg, std::dec) || CL_K < RC_MIN_K || CL_K > RC_MAX_K) {
+                    throw crispr::input_exception("The k-mer length must be between 4 and 16");
+                }
+                break;
+            }
+            case 'o':
+            {
+                CL_OutputFile = optarg;
+                break;
+            }
+            case 'r':
+            {
+                CL_RepeatFile = optarg;
+                break;
+            }
+            case 't':
+            {
+                CL_NumThreads = parseThreadCount(optarg);
+                break;
+            }
+            case 'x':
+            {
+                CL_XmlFile = optarg;
+                break;
+            }
+            default:
+            {
+                classifyUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    if (CL_RepeatFile.empty()) {
+        throw crispr::input_exception("Please give a FASTA file of known repeats with -r");
+    }
+    return optind;
+}
+
+void ClassifyTool::classifyChunk(int chunk)
+{
+    RepeatSearch search;
+    size_t first = static_cast<size_t>(chunk) * CL_CHUNK_SIZE;
+    size_t last = std::min(first + CL_CHUNK_SIZE, CL_Repeats.size());
+    for (size_t i = first; i < last; ++i) {
+        CL_Classifier->classify(CL_Repeats[i], CL_MaxEdits, search, CL_Matches[i]);
+    }
+}
+
+static void classifyChunkTask(int index, void * arg)
+{
+    static_cast<ClassifyTool *>(arg)->classifyChunk(index);
+}
+
+void ClassifyTool::writeTable(void)
+{
+    FastaSink out;
+    if (CL_OutputFile.empty()) {
+        out.openStdout();
+    } else {
+        out.open(CL_OutputFile);
+    }
+    std::string line;
+    char buffer[16];
+    for (size_t i = 0; i < CL_GroupIds.size(); ++i) {
+        const RepeatMatch& match = CL_Matches[i];
+        line = CL_GroupIds[i];
+        line += '\t';
+        if (match.Reference == -1) {
+            line += "unclassified\t-\t.\n";
+        } else {
+            line += CL_Classifier->referenceName(match.Reference);
+            line += '\t';
+            line.append(buffer, sprintf(buffer, "%d", match.Edits));
+            line += '\t';
+            line += match.Strand;
+            line += '\n';
+        }
+        out.write(line);
+    }
+    out.close();
+}
+
+int ClassifyTool::processInputFile(const char * inputFile)
+{
+    try {
+        RepeatClassifier classifier(CL_K);
+        classifier.load(CL_RepeatFile);
+        CL_Classifier = &classifier;
+
+        crispr::xml::parser xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        std::vector<xercesc::DOMElement *> group_elements;
+        int num_groups_to_process = static_cast<int>(CL_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (CL_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (CL_Subset) {
+                if (CL_Groups.find(group_id.substr(1)) == CL_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+            char * c_drseq = tc(currentElement->getAttribute(xml_parser.attr_Drseq()));
+            CL_GroupIds.push_back(group_id);
+            CL_Repeats.push_back(c_drseq);
+            xr(&c_drseq);
+            group_elements.push_back(currentElement);
+        }
+
+        // each thread has its own RepeatSearch and the matches go into
+        // their own slots, so the table is the same with any number of threads
+        CL_Matches.resize(CL_Repeats.size());
+        int num_chunks = static_cast<int>((CL_Repeats.size() + CL_CHUNK_SIZE - 1) / CL_CHUNK_SIZE);
+        parallelFor(num_chunks, CL_NumThreads, classifyChunkTask, this);
+        writeTable();
+
+        if (!CL_XmlFile.empty()) {
+            XMLCh * x_attribute = tc(CL_ATTRIBUTE);
+            for (size_t i = 0; i < group_elements.size(); ++i) {
+                if (CL_Matches[i].Reference == -1) {
+                    // don't leave a family from an earlier run behind
+                    group_elements[i]->removeAttribute(x_attribute);
+                } else {
+                    XMLCh * x_family = tc(classifier.referenceName(CL_Matches[i].Reference).c_str());
+                    group_elements[i]->setAttribute(x_attribute, x_family);
+                    xr(&x_family);
+                }
+            }
+            xr(&x_attribute);
+            profiledWrite(xml_parser, CL_XmlFile, input_doc_obj);
+        }
+        CL_Classifier = NULL;
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int classifyMain(int argc, char ** argv)
+{
+    try {
+        ClassifyTool ct;
+        int opt_index = ct.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        } else {
+            return ct.processInputFile(argv[opt_index]);
+        }
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        classifyUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void classifyUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" classify [-h] -r FILE [-g INT[,n]] [-e INT] [-k INT] [-o FILE] [-x FILE] [-t INT] file.crispr"<<std::endl;
+    std::cout<<"Assign the direct repeat of each group to the closest family in a FASTA file of known repeats."<<std::endl;
+    std::cout<<"Prints the group, family, edit distance and strand of each group"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-r FILE             FASTA file of known repeats, the name of each record is its family"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to classify"<<std::endl;
+    std::cout<<"-e INT              most edits between a repeat and its family [default: "<<CL_DEFAULT_EDITS<<"]"<<std::endl;
+    std::cout<<"-k INT              length of the k-mers used to find candidate families, between "<<RC_MIN_K<<" and "<<RC_MAX_K<<" [default: "<<RC_DEFAULT_K<<"]"<<std::endl;
+    std::cout<<"-o FILE             output file name for the table [default: print to screen]"<<std::endl;
+    std::cout<<"-x FILE             also write a copy of the input with a "<<CL_ATTRIBUTE<<" attribute on each classified group"<<std::endl;
+    std::cout<<"-t INT              number of threads, 0 uses every processor [default: "<<PL_DEFAULT_THREADS<<"]"<<std::endl;
+}
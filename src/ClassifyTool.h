@@ -0,0 +1,77 @@
+/*
+ * ClassifyTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_ClassifyTool_h
+#define crisprtools_ClassifyTool_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <libcrispr/base.h>
+#include "RepeatClassifier.h"
+#include "FastaSink.h"
+#include "Parallel.h"
+
+#define CL_DEFAULT_EDITS 6          // furthest a repeat can be from its family
+#define CL_MAX_EDITS 32
+#define CL_CHUNK_SIZE 1024          // groups classified by a thread at a time
+#define CL_ATTRIBUTE "family"       // group attribute written with -x
+
+// Assigns the direct repeat consensus of each group to the closest family
+// in a FASTA file of known repeats.  The groups are classified on all of
+// the threads and written in file order as a table, and optionally as an
+// attribute of each group in a copy of the input
+class ClassifyTool {
+public:
+    ClassifyTool()
+    {
+        CL_Subset = false;
+        CL_NumThreads = PL_DEFAULT_THREADS;
+        CL_K = RC_DEFAULT_K;
+        CL_MaxEdits = CL_DEFAULT_EDITS;
+        CL_Classifier = NULL;
+    }
+
+    int processOptions(int argc, char ** argv);
+    int processInputFile(const char * inputFile);
+
+    // called from the worker threads
+    void classifyChunk(int chunk);
+
+private:
+    void writeTable(void);
+
+    std::set<std::string> CL_Groups;
+    bool CL_Subset;
+    std::string CL_RepeatFile;
+    std::string CL_OutputFile;
+    std::string CL_XmlFile;
+    int CL_NumThreads;
+    int CL_K;
+    int CL_MaxEdits;
+
+    RepeatClassifier * CL_Classifier;
+    std::vector<std::string> CL_GroupIds;
+    std::vector<std::string> CL_Repeats;
+    std::vector<RepeatMatch> CL_Matches;
+};
+
+int classifyMain(int argc, char ** argv);
+void classifyUsage(void);
+#endif
@@ -0,0 +1,537 @@
+// ClusterTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "ClusterTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "SeqKernels.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/reader.h>
+#include <libcrispr/StlExt.h>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <getopt.h>
+
+int ClusterTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups", required_argument, NULL, 'g'},
+        {"edits", required_argument, NULL, 'e'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"threads", required_argument, NULL, 't'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hg:e:o:t:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                clusterUsage();
+                exit(1);
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(CU_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, CU_Groups);
+                }
+                CU_Subset = true;
+                break;
+            }
+            case 'e':
+            {
+                if (!from_string<int>(CU_MaxEdits, optarg, std::dec) || CU_MaxEdits < 0 || CU_MaxEdits > CU_MAX_EDITS) {
+                    throw crispr::input_exception("The number of edits must be between 0 and 8");
+                }
+                break;
+            }
+            case 'o':
+            {
+                CU_OutputFile = optarg;
+                break;
+            }
+            case 't':
+            {
+                CU_NumThreads = parseThreadCount(optarg);
+                break;
+            }
+            default:
+            {
+                clusterUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    return optind;
+}
+
+int ClusterTool::processInputFile(const char * inputFile, bool prefixNames)
+{
+    try {
+        crispr::xml::reader xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        int num_groups_to_process = static_cast<int>(CU_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (CU_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (CU_Subset) {
+                if (CU_Groups.find(group_id.substr(1)) == CU_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+
+            char * c_drseq = tc(currentElement->getAttribute(xml_parser.attr_Drseq()));
+            std::string repeat = c_drseq;
+            xr(&c_drseq);
+            for (size_t i = 0; i < repeat.length(); ++i) {
+                repeat[i] = static_cast<char>(toupper(repeat[i]));
+            }
+            std::string reverse = reverseComplement(repeat);
+            CU_GroupNames.push_back((prefixNames) ? std::string(inputFile) + ':' + group_id : group_id);
+            CU_GroupReversed.push_back(reverse < repeat);
+            CU_GroupRepeats.push_back((reverse < repeat) ? reverse : repeat);
+        }
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+class RepeatOrder {
+public:
+    RepeatOrder(const std::vector<std::string>& repeats) : RO_Repeats(repeats) {}
+    inline bool operator()(int a, int b) const
+    {
+        int order = RO_Repeats[a].compare(RO_Repeats[b]);
+        return (order != 0) ? order < 0 : a < b;
+    }
+private:
+    const std::vector<std::string>& RO_Repeats;
+};
+
+void ClusterTool::collapseRepeats(void)
+{
+    //-----
+    // Sorting puts the groups with the same repeat together, the first
+    // group of each run is the first to have that repeat.  The repeats are
+    // then numbered in the order they were first seen so that the clusters
+    // are numbered in file order
+    //
+    int num_groups = static_cast<int>(CU_GroupRepeats.size());
+    std::vector<int> order(num_groups);
+    for (int i = 0; i < num_groups; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), RepeatOrder(CU_GroupRepeats));
+
+    CU_GroupRepeat.assign(num_groups, -1);
+    std::vector<int> first_groups;
+    for (int i = 0; i < num_groups; ++i) {
+        int group = order[i];
+        if (CU_GroupRepeats[group].empty()) {
+            continue;
+        }
+        if (i == 0 || CU_GroupRepeats[group] != CU_GroupRepeats[order[i - 1]]) {
+            first_groups.push_back(group);
+        }
+        CU_GroupRepeat[group] = static_cast<int>(first_groups.size()) - 1;
+    }
+    std::vector<int> numbers(first_groups.size());
+    std::vector< std::pair<int, int> > firsts(first_groups.size());
+    for (size_t r = 0; r < first_groups.size(); ++r) {
+        firsts[r] = std::make_pair(first_groups[r], static_cast<int>(r));
+    }
+    std::sort(firsts.begin(), firsts.end());
+    for (size_t n = 0; n < firsts.size(); ++n) {
+        numbers[firsts[n].second] = static_cast<int>(n);
+    }
+
+    CU_RepeatStarts.assign(1, 0);
+    for (size_t n = 0; n < firsts.size(); ++n) {
+        const std::string& repeat = CU_GroupRepeats[firsts[n].first];
+        size_t start = CU_Codes.size();
+        CU_Codes.resize(start + repeat.length());
+        encodeBases(repeat.data(), repeat.length(), &CU_Codes[start]);
+        CU_RepeatStarts.push_back(CU_Codes.size());
+    }
+    for (int i = 0; i < num_groups; ++i) {
+        if (CU_GroupRepeat[i] != -1) {
+            CU_GroupRepeat[i] = numbers[CU_GroupRepeat[i]];
+        }
+    }
+    std::vector<std::string>().swap(CU_GroupRepeats);
+}
+
+// the substring hash mixed with the length of the repeat and which of its
+// segments it is, so that only the same segment of repeats of the same
+// length share a key
+static inline uint64_t segmentKey(uint64_t hash, size_t repeatLength, int segment)
+{
+    uint64_t key = hash ^ (static_cast<uint64_t>(repeatLength) << 40) ^ (static_cast<uint64_t>(segment) << 32);
+    key ^= key >> 29;
+    key *= CU_HASH_BASE;
+    key ^= key >> 32;
+    return key;
+}
+
+// polynomial hashes of every prefix of codes, so that the hash of any
+// substring takes two multiplications
+static void prefixHashes(const unsigned char * codes, size_t length, std::vector<uint64_t>& prefix)
+{
+    prefix.resize(length + 1);
+    prefix[0] = 0;
+    for (size_t i = 0; i < length; ++i) {
+        prefix[i + 1] = prefix[i] * CU_HASH_BASE + codes[i] + 1;
+    }
+}
+
+inline uint64_t ClusterTool::substringHash(const std::vector<uint64_t>& prefix, size_t start, size_t length) const
+{
+    return prefix[start + length] - prefix[start] * CU_Powers[length];
+}
+
+void ClusterTool::indexSegments(void)
+{
+    size_t num_repeats = CU_RepeatStarts.size() - 1;
+    size_t max_length = 0;
+    for (size_t r = 0; r < num_repeats; ++r) {
+        max_length = std::max(max_length, CU_RepeatStarts[r + 1] - CU_RepeatStarts[r]);
+    }
+    CU_Powers.resize(max_length + 1);
+    CU_Powers[0] = 1;
+    for (size_t i = 1; i <= max_length; ++i) {
+        CU_Powers[i] = CU_Powers[i - 1] * CU_HASH_BASE;
+    }
+
+    int num_segments = CU_MaxEdits + 1;
+    std::vector< std::pair<uint64_t, int> > segments;
+    segments.reserve(num_repeats * num_segments);
+    std::vector<uint64_t> prefix;
+    for (size_t r = 0; r < num_repeats; ++r) {
+        size_t length = CU_RepeatStarts[r + 1] - CU_RepeatStarts[r];
+        prefixHashes(&CU_Codes[CU_RepeatStarts[r]], length, prefix);
+        for (int i = 0; i < num_segments; ++i) {
+            size_t start = i * length / num_segments;
+            size_t end = (i + 1) * length / num_segments;
+            segments.push_back(std::make_pair(segmentKey(substringHash(prefix, start, end - start), length, i), static_cast<int>(r)));
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    CU_SegmentRepeats.resize(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        CU_SegmentRepeats[i] = segments[i].second;
+    }
+
+    // the keys are already mixed so the low bits make a good slot.  At
+    // least a quarter of the slots are left empty to keep the probes short
+    size_t slots = 1;
+    while (slots < segments.size() + segments.size() / 3 + 1) {
+        slots <<= 1;
+    }
+    SegmentSlot empty = {0, 0, 0};
+    CU_SegmentTable.assign(slots, empty);
+    CU_SegmentMask = slots - 1;
+    for (size_t start = 0; start < segments.size(); ) {
+        size_t end = start + 1;
+        while (end < segments.size() && segments[end].first == segments[start].first) {
+            ++end;
+        }
+        size_t slot = segments[start].first & CU_SegmentMask;
+        while (CU_SegmentTable[slot].Count) {
+            slot = (slot + 1) & CU_SegmentMask;
+        }
+        CU_SegmentTable[slot].Key = segments[start].first;
+        CU_SegmentTable[slot].Start = static_cast<unsigned int>(start);
+        CU_SegmentTable[slot].Count = static_cast<unsigned int>(end - start);
+        start = end;
+    }
+}
+
+void ClusterTool::lookupNeighbours(int repeat, const unsigned char * codes, const std::vector<uint64_t>& prefix, int reverse, std::vector<ClusterEdge>& edges) const
+{
+    //-----
+    // A repeat of length L within e edits of this one has one of its e + 1
+    // segments somewhere in this one unchanged, shifted by no more than e
+    // bases.  Only repeats before this one are looked for, each pair is
+    // found from its second repeat
+    //
+    long length = static_cast<long>(prefix.size()) - 1;
+    int num_segments = CU_MaxEdits + 1;
+    std::vector<int> candidates;
+    for (long other_length = std::max(1L, length - CU_MaxEdits); other_length <= length + CU_MaxEdits; ++other_length) {
+        for (int i = 0; i < num_segments; ++i) {
+            long segment_start = i * other_length / num_segments;
+            long segment_length = (i + 1) * other_length / num_segments - segment_start;
+            for (long start = segment_start - CU_MaxEdits; start <= segment_start + CU_MaxEdits; ++start) {
+                if (start < 0 || start + segment_length > length) {
+                    continue;
+                }
+                uint64_t key = segmentKey(substringHash(prefix, start, segment_length), other_length, i);
+                size_t slot = key & CU_SegmentMask;
+                while (CU_SegmentTable[slot].Count && CU_SegmentTable[slot].Key != key) {
+                    slot = (slot + 1) & CU_SegmentMask;
+                }
+                const SegmentSlot& found = CU_SegmentTable[slot];
+                for (unsigned int k = found.Start; k < found.Start + found.Count; ++k) {
+                    int other = CU_SegmentRepeats[k];
+                    // already joined by an earlier batch
+                    if (other < repeat && CU_Parents[other] != CU_Parents[repeat]) {
+                        candidates.push_back(other);
+                    }
+                }
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (size_t c = 0; c < candidates.size(); ++c) {
+        int other = candidates[c];
+        size_t other_start = CU_RepeatStarts[other];
+        size_t other_length = CU_RepeatStarts[other + 1] - other_start;
+        if (editDistance(&CU_Codes[other_start], other_length, codes, length, CU_MaxEdits) <= CU_MaxEdits) {
+            ClusterEdge edge;
+            edge.First = other;
+            edge.Second = repeat;
+            edge.Reverse = reverse;
+            edges.push_back(edge);
+        }
+    }
+}
+
+void ClusterTool::findNeighbours(int chunk)
+{
+    std::vector<ClusterEdge>& edges = CU_ChunkEdges[chunk];
+    edges.clear();
+    size_t num_repeats = CU_RepeatStarts.size() - 1;
+    size_t first = CU_BatchStart + static_cast<size_t>(chunk) * CU_CHUNK_SIZE;
+    size_t last = std::min(first + CU_CHUNK_SIZE, num_repeats);
+    std::vector<uint64_t> prefix;
+    std::vector<unsigned char> reverse;
+    for (size_t r = first; r < last; ++r) {
+        const unsigned char * codes = &CU_Codes[CU_RepeatStarts[r]];
+        size_t length = CU_RepeatStarts[r + 1] - CU_RepeatStarts[r];
+        prefixHashes(codes, length, prefix);
+        lookupNeighbours(static_cast<int>(r), codes, prefix, 0, edges);
+
+        // N is its own complement
+        reverse.resize(length);
+        for (size_t i = 0; i < length; ++i) {
+            unsigned char code = codes[length - 1 - i];
+            reverse[i] = (code < SK_OTHER) ? static_cast<unsigned char>(3 - code) : code;
+        }
+        prefixHashes(&reverse[0], length, prefix);
+        lookupNeighbours(static_cast<int>(r), &reverse[0], prefix, 1, edges);
+    }
+}
+
+static void findNeighboursTask(int index, void * arg)
+{
+    static_cast<ClusterTool *>(arg)->findNeighbours(index);
+}
+
+int ClusterTool::findRoot(int repeat, int& reverse)
+{
+    // path compression, keeping track of whether each repeat is reversed
+    // relative to its new parent
+    int root = repeat;
+    reverse = 0;
+    while (CU_Parents[root] != root) {
+        reverse ^= CU_ParentReversed[root];
+        root = CU_Parents[root];
+    }
+    int relative = reverse;
+    while (CU_Parents[repeat] != root && CU_Parents[repeat] != repeat) {
+        int parent = CU_Parents[repeat];
+        int parent_reversed = CU_ParentReversed[repeat];
+        CU_Parents[repeat] = root;
+        CU_ParentReversed[repeat] = relative;
+        relative ^= parent_reversed;
+        repeat = parent;
+    }
+    return root;
+}
+
+void ClusterTool::cluster(void)
+{
+    collapseRepeats();
+    indexSegments();
+
+    int num_repeats = static_cast<int>(CU_RepeatStarts.size()) - 1;
+    CU_Parents.resize(num_repeats);
+    CU_ParentReversed.assign(num_repeats, 0);
+    for (int r = 0; r < num_repeats; ++r) {
+        CU_Parents[r] = r;
+    }
+
+    //-----
+    // The repeats are compared a batch at a time and the pairs joined
+    // before the next batch, with every repeat pointing straight at its
+    // root, so the pairs that are already in the same cluster aren't
+    // aligned.  The batches are the same size for any number of threads,
+    // which keeps the output the same
+    //
+    int batch_repeats = CU_CHUNK_SIZE * CU_BATCH_CHUNKS;
+    CU_ChunkEdges.resize(CU_BATCH_CHUNKS);
+    for (CU_BatchStart = 0; CU_BatchStart < static_cast<size_t>(num_repeats); CU_BatchStart += batch_repeats) {
+        int num_chunks = static_cast<int>((std::min(CU_BatchStart + batch_repeats, static_cast<size_t>(num_repeats)) - CU_BatchStart + CU_CHUNK_SIZE - 1) / CU_CHUNK_SIZE);
+        parallelFor(num_chunks, CU_NumThreads, findNeighboursTask, this);
+        for (int chunk = 0; chunk < num_chunks; ++chunk) {
+            std::vector<ClusterEdge>& edges = CU_ChunkEdges[chunk];
+            for (size_t e = 0; e < edges.size(); ++e) {
+                int first_reversed;
+                int second_reversed;
+                int first_root = findRoot(edges[e].First, first_reversed);
+                int second_root = findRoot(edges[e].Second, second_reversed);
+                if (first_root == second_root) {
+                    continue;
+                }
+                // the cluster keeps the root that was seen first
+                if (second_root < first_root) {
+                    std::swap(first_root, second_root);
+                }
+                CU_Parents[second_root] = first_root;
+                CU_ParentReversed[second_root] = first_reversed ^ second_reversed ^ edges[e].Reverse;
+            }
+            std::vector<ClusterEdge>().swap(edges);
+        }
+        for (int r = 0; r < num_repeats; ++r) {
+            int reversed;
+            findRoot(r, reversed);
+        }
+    }
+    writeClusters();
+}
+
+void ClusterTool::writeClusters(void)
+{
+    FastaSink out;
+    if (CU_OutputFile.empty()) {
+        out.openStdout();
+    } else {
+        out.open(CU_OutputFile);
+    }
+
+    // clusters are numbered in the order their first group was read, the
+    // strand says whether the repeat of a group is the reverse complement
+    // of the repeat of that first group
+    std::vector<int> cluster_numbers(CU_Parents.size(), 0);
+    std::vector<bool> first_reversed(CU_Parents.size(), false);
+    int next_cluster = 1;
+    std::string line;
+    char buffer[24];
+    for (size_t g = 0; g < CU_GroupNames.size(); ++g) {
+        line = CU_GroupNames[g];
+        if (CU_GroupRepeat[g] == -1) {
+            line += "\t-\t.\n";
+            out.write(line);
+            continue;
+        }
+        int reversed;
+        int root = findRoot(CU_GroupRepeat[g], reversed);
+        // against the repeat at the root of the cluster
+        bool group_reversed = ((reversed != 0) != CU_GroupReversed[g]);
+        if (!cluster_numbers[root]) {
+            cluster_numbers[root] = next_cluster++;
+            first_reversed[root] = group_reversed;
+        }
+        line.append(buffer, sprintf(buffer, "\tC%d\t", cluster_numbers[root]));
+        line += (group_reversed != first_reversed[root]) ? '-' : '+';
+        line += '\n';
+        out.write(line);
+    }
+    out.close();
+}
+
+int clusterMain(int argc, char ** argv)
+{
+    try {
+        ClusterTool ct;
+        int opt_index = ct.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        }
+        bool prefix_names = (argc - opt_index > 1);
+        for (int i = opt_index; i < argc; ++i) {
+            int ret = ct.processInputFile(argv[i], prefix_names);
+            if (ret) {
+                return ret;
+            }
+        }
+        ct.cluster();
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        clusterUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void clusterUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" cluster [-h] [-g INT[,n]] [-e INT] [-o FILE] [-t INT] file.crispr [...]"<<std::endl;
+    std::cout<<"Cluster the groups by their direct repeat consensus, joining repeats within a few edits of each other"<<std::endl;
+    std::cout<<"in either orientation.  Prints the group, its cluster and the strand of its repeat relative to the"<<std::endl;
+    std::cout<<"first group of the cluster"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to cluster"<<std::endl;
+    std::cout<<"-e INT              most edits between two repeats in a cluster, between 0 and "<<CU_MAX_EDITS<<" [default: "<<CU_DEFAULT_EDITS<<"]"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: print to screen]"<<std::endl;
+    std::cout<<"-t INT              number of threads, 0 uses every processor [default: "<<PL_DEFAULT_THREADS<<"]"<<std::endl;
+}
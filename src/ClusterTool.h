@@ -0,0 +1,129 @@
+/*
+ * ClusterTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_ClusterTool_h
+#define crisprtools_ClusterTool_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <stdint.h>
+#include <libcrispr/base.h>
+#include "FastaSink.h"
+#include "Parallel.h"
+
+#define CU_DEFAULT_EDITS 2          // most edits between repeats joined together
+#define CU_MAX_EDITS 8
+#define CU_CHUNK_SIZE 1024          // repeats compared by a thread at a time
+#define CU_BATCH_CHUNKS 64          // chunks compared before the pairs they found are joined
+// odd multiplier of the substring hashes, built from 32 bit halves since
+// long long literals aren't allowed in C++98
+#define CU_HASH_BASE ((static_cast<uint64_t>(0x00000100) << 32) | 0x000001b3)
+
+// the repeats with one segment key, which are from Start to Start + Count
+// in CU_SegmentRepeats.  A Count of 0 is an empty slot
+typedef struct __SegmentSlot {
+    uint64_t Key;
+    unsigned int Start;
+    unsigned int Count;
+} SegmentSlot;
+
+// an edit distance match between two distinct repeats.  Reverse is set
+// when the second repeat matched the reverse complement of the first
+typedef struct __ClusterEdge {
+    int First;
+    int Second;
+    int Reverse;
+} ClusterEdge;
+
+// Clusters the direct repeat consensus of every group in one or more
+// .crispr files, joining repeats that are within a few edits of each
+// other in either orientation.  Each repeat is stored once, as the smaller
+// of itself and its reverse complement.  To find every pair within e
+// edits each repeat is cut into e + 1 segments, at least one of which has
+// to be in the other repeat unchanged and no more than e bases from where
+// it was, so looking up the substrings of the right lengths near the
+// right places of each repeat finds all of its neighbours without comparing
+// the rest.  The pairs found are checked with the edit distance kernel and
+// joined with a union-find that keeps track of which ones are reversed
+class ClusterTool {
+public:
+    ClusterTool()
+    {
+        CU_Subset = false;
+        CU_NumThreads = PL_DEFAULT_THREADS;
+        CU_MaxEdits = CU_DEFAULT_EDITS;
+        CU_BatchStart = 0;
+        CU_SegmentMask = 0;
+    }
+
+    int processOptions(int argc, char ** argv);
+
+    // prefixNames puts the file name in front of the group IDs, for
+    // clustering groups from more than one file
+    int processInputFile(const char * inputFile, bool prefixNames);
+    void cluster(void);
+
+    // called from the worker threads
+    void findNeighbours(int chunk);
+
+private:
+    void collapseRepeats(void);
+    void indexSegments(void);
+    uint64_t substringHash(const std::vector<uint64_t>& prefix, size_t start, size_t length) const;
+    void lookupNeighbours(int repeat, const unsigned char * codes, const std::vector<uint64_t>& prefix, int reverse, std::vector<ClusterEdge>& edges) const;
+    int findRoot(int repeat, int& reverse);
+    void writeClusters(void);
+
+    std::set<std::string> CU_Groups;
+    bool CU_Subset;
+    std::string CU_OutputFile;
+    int CU_NumThreads;
+    int CU_MaxEdits;
+
+    // every group, with its repeat in the canonical orientation and
+    // whether that meant reversing it
+    std::vector<std::string> CU_GroupNames;
+    std::vector<std::string> CU_GroupRepeats;
+    std::vector<bool> CU_GroupReversed;
+    std::vector<int> CU_GroupRepeat;
+
+    // the distinct repeats, the codes of repeat i are from
+    // CU_RepeatStarts[i] to CU_RepeatStarts[i + 1]
+    std::vector<size_t> CU_RepeatStarts;
+    std::vector<unsigned char> CU_Codes;
+
+    // the segments of every repeat in an open addressing table of keys
+    std::vector<SegmentSlot> CU_SegmentTable;
+    uint64_t CU_SegmentMask;
+    std::vector<int> CU_SegmentRepeats;
+    std::vector<uint64_t> CU_Powers;
+
+    // the batch being compared and the pairs found in each of its chunks
+    size_t CU_BatchStart;
+    std::vector< std::vector<ClusterEdge> > CU_ChunkEdges;
+
+    // union-find of the repeats, the root of a cluster is its first repeat
+    std::vector<int> CU_Parents;
+    std::vector<int> CU_ParentReversed;
+};
+
+int clusterMain(int argc, char ** argv);
+void clusterUsage(void);
+#endif
@@ -0,0 +1,407 @@
+// CompareTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "CompareTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/reader.h>
+#include <libcrispr/StlExt.h>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <getopt.h>
+
+int CompareTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups", required_argument, NULL, 'g'},
+        {"bands", required_argument, NULL, 'b'},
+        {"jaccard", required_argument, NULL, 'j'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"sketch-size", required_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 't'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hg:b:j:o:s:t:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                compareUsage();
+                exit(1);
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(CP_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, CP_Groups);
+                }
+                CP_Subset = true;
+                break;
+            }
+            case 'b':
+            {
+                if (!from_string<int>(CP_Bands, optarg, std::dec) || CP_Bands < 1) {
+                    throw crispr::input_exception("The number of bands must be a positive number");
+                }
+                break;
+            }
+            case 'j':
+            {
+                if (!from_string<double>(CP_Threshold, optarg, std::dec) || CP_Threshold <= 0 || CP_Threshold > 1) {
+                    throw crispr::input_exception("The Jaccard index must be above 0 and no more than 1");
+                }
+                break;
+            }
+            case 'o':
+            {
+                CP_OutputFile = optarg;
+                break;
+            }
+            case 's':
+            {
+                if (!from_string<int>(CP_SketchSize, optarg, std::dec) || CP_SketchSize < 1 || CP_SketchSize > MH_MAX_SKETCH_SIZE) {
+                    throw crispr::input_exception("The sketch size must be between 1 and 4096");
+                }
+                break;
+            }
+            case 't':
+            {
+                CP_NumThreads = parseThreadCount(optarg);
+                break;
+            }
+            default:
+            {
+                compareUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    if (CP_Bands > CP_SketchSize) {
+        throw crispr::input_exception("There can't be more bands than minimums in the sketch");
+    }
+    return optind;
+}
+
+int CompareTool::processInputFile(const char * inputFile, bool prefixNames)
+{
+    try {
+        crispr::xml::reader xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        // only the hashes are kept, the document is let go before the
+        // next file is read
+        std::vector<uint64_t> hashes;
+        int num_groups_to_process = static_cast<int>(CP_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (CP_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (CP_Subset) {
+                if (CP_Groups.find(group_id.substr(1)) == CP_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+
+            hashes.clear();
+            parseGroup(currentElement, xml_parser, hashes);
+            if (hashes.empty()) {
+                continue;
+            }
+            std::sort(hashes.begin(), hashes.end());
+            hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+            CP_Names.push_back((prefixNames) ? std::string(inputFile) + ':' + group_id : group_id);
+            CP_Hashes.insert(CP_Hashes.end(), hashes.begin(), hashes.end());
+            CP_SetStarts.push_back(CP_Hashes.size());
+        }
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void CompareTool::parseGroup(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, std::vector<uint64_t>& hashes)
+{
+    for (xercesc::DOMElement * dataElement = parentNode->getFirstElementChild();
+         dataElement != NULL;
+         dataElement = dataElement->getNextElementSibling()) {
+        if (!xercesc::XMLString::equals(dataElement->getTagName(), xmlParser.tag_Data())) {
+            continue;
+        }
+        for (xercesc::DOMElement * spacers = dataElement->getFirstElementChild();
+             spacers != NULL;
+             spacers = spacers->getNextElementSibling()) {
+            if (!xercesc::XMLString::equals(spacers->getTagName(), xmlParser.tag_Spacers())) {
+                continue;
+            }
+            for (xercesc::DOMElement * currentElement = spacers->getFirstElementChild();
+                 currentElement != NULL;
+                 currentElement = currentElement->getNextElementSibling()) {
+                if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacer())) {
+                    char * c_seq = tc(currentElement->getAttribute(xmlParser.attr_Seq()));
+                    hashes.push_back(canonicalSequenceHash(c_seq, strlen(c_seq)));
+                    xr(&c_seq);
+                }
+            }
+        }
+    }
+}
+
+void CompareTool::sketchGroups(int chunk)
+{
+    size_t first = static_cast<size_t>(chunk) * CP_SKETCH_CHUNK;
+    size_t last = std::min(first + CP_SKETCH_CHUNK, CP_Names.size());
+    for (size_t i = first; i < last; ++i) {
+        minHashSketch(&CP_Hashes[CP_SetStarts[i]],
+                      CP_SetStarts[i + 1] - CP_SetStarts[i],
+                      CP_SketchSize,
+                      &CP_Sketches[i * CP_SketchSize]);
+    }
+}
+
+// a band of one group, and the group, so that sorting puts the groups
+// with the same band next to each other
+typedef struct __BandKey {
+    uint64_t Key;
+    unsigned int Group;
+} BandKey;
+
+static bool compareBandKeys(const BandKey& a, const BandKey& b)
+{
+    return (a.Key != b.Key) ? a.Key < b.Key : a.Group < b.Group;
+}
+
+void CompareTool::bandCandidates(int band)
+{
+    size_t num_groups = CP_Names.size();
+    std::vector<BandKey> keys(num_groups);
+    for (size_t i = 0; i < num_groups; ++i) {
+        const uint64_t * minimums = &CP_Sketches[i * CP_SketchSize + static_cast<size_t>(band) * CP_Rows];
+        uint64_t key = MH_FNV_OFFSET;
+        for (int r = 0; r < CP_Rows; ++r) {
+            key = (key ^ minimums[r]) * MH_FNV_PRIME;
+        }
+        keys[i].Key = key;
+        keys[i].Group = static_cast<unsigned int>(i);
+    }
+    std::sort(keys.begin(), keys.end(), compareBandKeys);
+
+    // every pair in a run of the same key is a candidate.  The minimums
+    // are compared as well so that a collision of the band hashes can't
+    // make one
+    std::vector<uint64_t>& pairs = CP_BandPairs[band];
+    pairs.clear();
+    for (size_t start = 0; start < num_groups; ) {
+        size_t end = start + 1;
+        while (end < num_groups && keys[end].Key == keys[start].Key) {
+            ++end;
+        }
+        for (size_t a = start; a < end; ++a) {
+            const uint64_t * first = &CP_Sketches[keys[a].Group * static_cast<size_t>(CP_SketchSize) + static_cast<size_t>(band) * CP_Rows];
+            for (size_t b = a + 1; b < end; ++b) {
+                const uint64_t * second = &CP_Sketches[keys[b].Group * static_cast<size_t>(CP_SketchSize) + static_cast<size_t>(band) * CP_Rows];
+                if (std::equal(first, first + CP_Rows, second)) {
+                    pairs.push_back((static_cast<uint64_t>(keys[a].Group) << 32) | keys[b].Group);
+                }
+            }
+        }
+        start = end;
+    }
+}
+
+void CompareTool::verifyCandidates(int chunk)
+{
+    size_t first = static_cast<size_t>(chunk) * CP_VERIFY_CHUNK;
+    size_t last = std::min(first + CP_VERIFY_CHUNK, CP_Candidates.size());
+    for (size_t i = first; i < last; ++i) {
+        size_t a = static_cast<size_t>(CP_Candidates[i] >> 32);
+        size_t b = static_cast<size_t>(CP_Candidates[i] & 0xffffffff);
+        size_t a_count = CP_SetStarts[a + 1] - CP_SetStarts[a];
+        size_t b_count = CP_SetStarts[b + 1] - CP_SetStarts[b];
+        size_t shared = sortedIntersectionSize(&CP_Hashes[CP_SetStarts[a]], a_count, &CP_Hashes[CP_SetStarts[b]], b_count);
+        CP_Shared[i] = static_cast<unsigned int>(shared);
+        CP_Similarity[i] = static_cast<double>(shared) / static_cast<double>(a_count + b_count - shared);
+    }
+}
+
+static void sketchGroupsTask(int index, void * arg)
+{
+    static_cast<CompareTool *>(arg)->sketchGroups(index);
+}
+
+static void bandCandidatesTask(int index, void * arg)
+{
+    static_cast<CompareTool *>(arg)->bandCandidates(index);
+}
+
+static void verifyCandidatesTask(int index, void * arg)
+{
+    static_cast<CompareTool *>(arg)->verifyCandidates(index);
+}
+
+static inline int chunkCount(size_t items, size_t chunkSize)
+{
+    return static_cast<int>((items + chunkSize - 1) / chunkSize);
+}
+
+void CompareTool::compare(void)
+{
+    if (CP_Bands) {
+        CP_Rows = CP_SketchSize / CP_Bands;
+    } else {
+        CP_Rows = lshRowsForThreshold(CP_SketchSize, CP_Threshold);
+        CP_Bands = CP_SketchSize / CP_Rows;
+    }
+
+    CP_Sketches.resize(CP_Names.size() * CP_SketchSize);
+    parallelFor(chunkCount(CP_Names.size(), CP_SKETCH_CHUNK), CP_NumThreads, sketchGroupsTask, this);
+
+    CP_BandPairs.resize(CP_Bands);
+    parallelFor(CP_Bands, CP_NumThreads, bandCandidatesTask, this);
+    for (int band = 0; band < CP_Bands; ++band) {
+        CP_Candidates.insert(CP_Candidates.end(), CP_BandPairs[band].begin(), CP_BandPairs[band].end());
+        std::vector<uint64_t>().swap(CP_BandPairs[band]);
+    }
+    std::sort(CP_Candidates.begin(), CP_Candidates.end());
+    CP_Candidates.erase(std::unique(CP_Candidates.begin(), CP_Candidates.end()), CP_Candidates.end());
+
+    CP_Shared.resize(CP_Candidates.size());
+    CP_Similarity.resize(CP_Candidates.size());
+    parallelFor(chunkCount(CP_Candidates.size(), CP_VERIFY_CHUNK), CP_NumThreads, verifyCandidatesTask, this);
+    writeEdges();
+}
+
+static inline void appendNumber(std::string& out, unsigned long value)
+{
+    char buffer[24];
+    int length = sprintf(buffer, "%lu", value);
+    out.append(buffer, length);
+}
+
+void CompareTool::writeEdges(void)
+{
+    if (CP_OutputFile.empty()) {
+        CP_Output.openStdout();
+    } else {
+        CP_Output.open(CP_OutputFile);
+    }
+
+    // candidates are sorted by the first group and then the second, which
+    // is the order the groups were read in
+    std::string line;
+    char buffer[16];
+    for (size_t i = 0; i < CP_Candidates.size(); ++i) {
+        if (CP_Similarity[i] < CP_Threshold) {
+            continue;
+        }
+        size_t a = static_cast<size_t>(CP_Candidates[i] >> 32);
+        size_t b = static_cast<size_t>(CP_Candidates[i] & 0xffffffff);
+        line = CP_Names[a];
+        line += '\t';
+        line += CP_Names[b];
+        line += '\t';
+        line.append(buffer, sprintf(buffer, "%.4f", CP_Similarity[i]));
+        line += '\t';
+        appendNumber(line, CP_Shared[i]);
+        line += '\t';
+        appendNumber(line, CP_SetStarts[a + 1] - CP_SetStarts[a]);
+        line += '\t';
+        appendNumber(line, CP_SetStarts[b + 1] - CP_SetStarts[b]);
+        line += '\n';
+        CP_Output.write(line);
+    }
+    CP_Output.close();
+}
+
+int compareMain(int argc, char ** argv)
+{
+    try {
+        CompareTool ct;
+        int opt_index = ct.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        }
+        bool prefix_names = (argc - opt_index > 1);
+        for (int i = opt_index; i < argc; ++i) {
+            int ret = ct.processInputFile(argv[i], prefix_names);
+            if (ret) {
+                return ret;
+            }
+        }
+        ct.compare();
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        compareUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void compareUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" compare [-h] [-g INT[,n]] [-j FLOAT] [-s INT] [-b INT] [-o FILE] [-t INT] file.crispr [...]"<<std::endl;
+    std::cout<<"List the pairs of groups that share spacers, as tab separated lines of the two groups,"<<std::endl;
+    std::cout<<"their Jaccard index, the number of spacers they share and the number in each group"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to compare"<<std::endl;
+    std::cout<<"-j FLOAT            smallest Jaccard index of the pairs reported [default: "<<CP_DEFAULT_THRESHOLD<<"]"<<std::endl;
+    std::cout<<"-s INT              minimums in the sketch of each group [default: "<<MH_DEFAULT_SKETCH_SIZE<<"]"<<std::endl;
+    std::cout<<"-b INT              number of LSH bands, more bands find more pairs close to the threshold"<<std::endl;
+    std::cout<<"                    but check more that are below it [default: chosen from -j and -s]"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: print to screen]"<<std::endl;
+    std::cout<<"-t INT              number of threads, 0 uses every processor [default: "<<PL_DEFAULT_THREADS<<"]"<<std::endl;
+}
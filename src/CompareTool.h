@@ -0,0 +1,101 @@
+/*
+ * CompareTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_CompareTool_h
+#define crisprtools_CompareTool_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <stdint.h>
+#include <libcrispr/base.h>
+#include "MinHash.h"
+#include "FastaSink.h"
+#include "Parallel.h"
+
+#define CP_DEFAULT_THRESHOLD 0.5    // smallest Jaccard index reported
+#define CP_SKETCH_CHUNK 256         // groups sketched by a thread at a time
+#define CP_VERIFY_CHUNK 4096        // candidate pairs checked by a thread at a time
+
+// Finds the pairs of groups, in one or more .crispr files, that share a
+// large part of their spacers.  Each group becomes the set of hashes of
+// its canonical spacers as the files are read, the sets are sketched with
+// MinHash and cut into LSH bands to find candidate pairs without comparing
+// every group with every other one, and the candidates are checked by
+// counting the spacers they really share
+class CompareTool {
+public:
+    CompareTool()
+    {
+        CP_Subset = false;
+        CP_NumThreads = PL_DEFAULT_THREADS;
+        CP_Threshold = CP_DEFAULT_THRESHOLD;
+        CP_SketchSize = MH_DEFAULT_SKETCH_SIZE;
+        CP_Bands = 0;
+        CP_Rows = 1;
+        CP_SetStarts.push_back(0);
+    }
+
+    int processOptions(int argc, char ** argv);
+
+    // prefixNames puts the file name in front of the group IDs, for
+    // comparing groups from more than one file
+    int processInputFile(const char * inputFile, bool prefixNames);
+    void compare(void);
+
+    // called from the worker threads
+    void sketchGroups(int chunk);
+    void bandCandidates(int band);
+    void verifyCandidates(int chunk);
+
+private:
+    void parseGroup(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, std::vector<uint64_t>& hashes);
+    void writeEdges(void);
+
+    std::set<std::string> CP_Groups;
+    bool CP_Subset;
+    std::string CP_OutputFile;
+    int CP_NumThreads;
+    double CP_Threshold;
+    int CP_SketchSize;
+    int CP_Bands;
+    int CP_Rows;
+
+    // name and sorted spacer hashes of every group with spacers, the
+    // hashes of group i are from CP_SetStarts[i] to CP_SetStarts[i + 1]
+    std::vector<std::string> CP_Names;
+    std::vector<size_t> CP_SetStarts;
+    std::vector<uint64_t> CP_Hashes;
+
+    // CP_SketchSize minimums for each group
+    std::vector<uint64_t> CP_Sketches;
+
+    // pairs with the first group in the top 32 bits, found by each band
+    // and then merged, and the Jaccard index of each one
+    std::vector< std::vector<uint64_t> > CP_BandPairs;
+    std::vector<uint64_t> CP_Candidates;
+    std::vector<double> CP_Similarity;
+    std::vector<unsigned int> CP_Shared;
+
+    FastaSink CP_Output;
+};
+
+int compareMain(int argc, char ** argv);
+void compareUsage(void);
+#endif
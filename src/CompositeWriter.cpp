@@ -0,0 +1,295 @@
+// CompositeWriter.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "CompositeWriter.h"
+#include <libcrispr/Exception.h>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <algorithm>
+
+static std::string escapeXml(const std::string& str)
+{
+    std::string escaped;
+    escaped.reserve(str.length());
+    for (size_t i = 0; i < str.length(); ++i) {
+        switch (str[i]) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += str[i]; break;
+        }
+    }
+    return escaped;
+}
+
+static bool hasExtension(const std::string& fileName, const char * extension)
+{
+    size_t length = strlen(extension);
+    if (fileName.length() < length) {
+        return false;
+    }
+    std::string end = fileName.substr(fileName.length() - length);
+    std::transform(end.begin(), end.end(), end.begin(), ::tolower);
+    return end == extension;
+}
+
+CompositeWriter * CompositeWriter::create(const std::string& fileName)
+{
+    if (hasExtension(fileName, ".pdf")) {
+        return new PdfComposite(fileName);
+    } else if (hasExtension(fileName, ".svg")) {
+        return new SvgComposite(fileName);
+    }
+    return new ArchiveComposite(fileName);
+}
+
+CompositeWriter::CompositeWriter(const std::string& fileName)
+{
+    CW_FileName = fileName;
+    CW_Out.open(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!CW_Out) {
+        std::stringstream msg;
+        msg << "failed to open output file: " << fileName;
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+}
+
+void CompositeWriter::abort(void)
+{
+    CW_Out.close();
+    remove(CW_FileName.c_str());
+}
+
+void CompositeWriter::addRenderedData(const std::string& name,
+                                      const char * data,
+                                      size_t length)
+{
+    std::stringstream msg;
+    msg << CW_FileName << " can only hold groups drawn with the native layout";
+    throw crispr::runtime_exception(__FILE__,
+                                    __LINE__,
+                                    __PRETTY_FUNCTION__,
+                                    msg);
+}
+
+//
+// SVG, every group is a nested svg element, stacked top to bottom.  The
+// overall size isn't known until the end so space is left for it in the
+// header and it is filled in when the file is closed
+//
+SvgComposite::SvgComposite(const std::string& fileName) : CompositeWriter(fileName)
+{
+    SC_Width = 0;
+    SC_Height = 0;
+    CW_Out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+    CW_Out << "<svg xmlns=\"http://www.w3.org/2000/svg\" ";
+    SC_SizePosition = CW_Out.tellp();
+    writeSize(0, 0);
+    CW_Out << ">\n";
+    SC_HaveDefs = false;
+}
+
+void SvgComposite::writeSize(double width, double height)
+{
+    char size[128];
+    int w = static_cast<int>(width + 0.999);
+    int h = static_cast<int>(height + 0.999);
+    sprintf(size, "width=\"%0*d\" height=\"%0*d\" viewBox=\"0 0 %0*d %0*d\"",
+            CW_SIZE_DIGITS, w, CW_SIZE_DIGITS, h, CW_SIZE_DIGITS, w, CW_SIZE_DIGITS, h);
+    CW_Out << size;
+}
+
+void SvgComposite::addGroup(const std::string& name,
+                            const SpacerGraph& graph,
+                            const LayeredLayout& layout,
+                            NativeRenderer& renderer,
+                            const char * format)
+{
+    if (!SC_HaveDefs) {
+        renderer.renderSvgDefs(CW_Out);
+        SC_HaveDefs = true;
+    }
+    double width = layout.getWidth();
+    double height = layout.getHeight();
+    CW_Out << "<text x=\"4\" y=\"" << SC_Height + CW_SVG_TITLE - 4 << "\" font-family=\"Helvetica,Arial,sans-serif\" font-size=\"12\">";
+    CW_Out << escapeXml(name) << "</text>\n";
+    CW_Out << "<svg x=\"0\" y=\"" << SC_Height + CW_SVG_TITLE << "\" width=\"" << width << "\" height=\"" << height;
+    CW_Out << "\" viewBox=\"0 0 " << width << ' ' << height << "\">\n";
+    renderer.renderSvgBody(graph, layout, CW_Out);
+    CW_Out << "</svg>\n";
+    SC_Height += CW_SVG_TITLE + height + CW_SVG_GAP;
+    SC_Width = std::max(SC_Width, width);
+}
+
+void SvgComposite::close(void)
+{
+    CW_Out << "</svg>\n";
+    CW_Out.seekp(SC_SizePosition);
+    writeSize(SC_Width, SC_Height);
+    CW_Out.close();
+}
+
+//
+// PDF, one page per group.  Object 1 is the catalog, 2 the page tree and
+// 3 the font, then each page is a content stream followed by the page
+// itself.  The page tree and the cross reference table go at the end
+//
+PdfComposite::PdfComposite(const std::string& fileName) : CompositeWriter(fileName)
+{
+    PC_Offsets.push_back(0);
+    CW_Out << "%PDF-1.4\n%\xe2\xe3\xcf\xd3\n";
+    beginObject(1);
+    CW_Out << "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+    // the page tree is written at the end
+    PC_Offsets.push_back(0);
+    beginObject(3);
+    CW_Out << "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>\nendobj\n";
+}
+
+void PdfComposite::beginObject(int id)
+{
+    if (static_cast<int>(PC_Offsets.size()) <= id) {
+        PC_Offsets.resize(id + 1, 0);
+    }
+    PC_Offsets[id] = static_cast<long>(CW_Out.tellp());
+    CW_Out << id << " 0 obj\n";
+}
+
+void PdfComposite::addGroup(const std::string& name,
+                            const SpacerGraph& graph,
+                            const LayeredLayout& layout,
+                            NativeRenderer& renderer,
+                            const char * format)
+{
+    // the stream length has to come first so each page is built in memory
+    std::stringstream content;
+    renderer.renderPdfPage(graph, layout, content);
+    std::string stream = content.str();
+
+    int content_id = static_cast<int>(PC_Offsets.size());
+    beginObject(content_id);
+    CW_Out << "<< /Length " << stream.length() << " >>\nstream\n" << stream << "\nendstream\nendobj\n";
+
+    double scale = NativeRenderer::getPdfScale(layout);
+    int page_id = content_id + 1;
+    beginObject(page_id);
+    CW_Out << "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " << layout.getWidth() * scale << ' ' << layout.getHeight() * scale;
+    CW_Out << "] /Resources << /Font << /F1 3 0 R >> >> /Contents " << content_id << " 0 R >>\nendobj\n";
+    PC_Pages.push_back(page_id);
+}
+
+void PdfComposite::close(void)
+{
+    beginObject(2);
+    CW_Out << "<< /Type /Pages /Count " << PC_Pages.size() << " /Kids [";
+    std::vector<int>::iterator iter;
+    for (iter = PC_Pages.begin(); iter != PC_Pages.end(); ++iter) {
+        CW_Out << ' ' << *iter << " 0 R";
+    }
+    CW_Out << " ] >>\nendobj\n";
+
+    long xref = static_cast<long>(CW_Out.tellp());
+    CW_Out << "xref\n0 " << PC_Offsets.size() << "\n";
+    char entry[32];
+    sprintf(entry, "%010d %05d f \n", 0, 65535);
+    CW_Out << entry;
+    for (size_t i = 1; i < PC_Offsets.size(); ++i) {
+        sprintf(entry, "%010ld %05d n \n", PC_Offsets[i], 0);
+        CW_Out << entry;
+    }
+    CW_Out << "trailer\n<< /Size " << PC_Offsets.size() << " /Root 1 0 R >>\nstartxref\n" << xref << "\n%%EOF\n";
+    CW_Out.close();
+}
+
+//
+// tar archive, one member per group and a tab separated table of contents
+// giving the name, the byte offset of the data and its length as the last
+// member, so a single group can be pulled out without reading the rest
+//
+ArchiveComposite::ArchiveComposite(const std::string& fileName) : CompositeWriter(fileName)
+{
+    AC_Index << "name\toffset\tlength\n";
+}
+
+void ArchiveComposite::writeMember(const std::string& name, const char * data, size_t length)
+{
+    char header[CW_TAR_BLOCK];
+    memset(header, 0, CW_TAR_BLOCK);
+    strncpy(header, name.c_str(), 99);
+    sprintf(header + 100, "%07o", 0644);
+    sprintf(header + 108, "%07o", 0);
+    sprintf(header + 116, "%07o", 0);
+    sprintf(header + 124, "%011lo", static_cast<unsigned long>(length));
+    sprintf(header + 136, "%011lo", static_cast<unsigned long>(time(NULL)));
+    header[156] = '0';
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+
+    // the checksum is worked out with its own field set to spaces
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (int i = 0; i < CW_TAR_BLOCK; ++i) {
+        checksum += static_cast<unsigned char>(header[i]);
+    }
+    sprintf(header + 148, "%06o", checksum);
+    header[155] = ' ';
+
+    CW_Out.write(header, CW_TAR_BLOCK);
+    long offset = static_cast<long>(CW_Out.tellp());
+    CW_Out.write(data, length);
+    size_t padding = (CW_TAR_BLOCK - length % CW_TAR_BLOCK) % CW_TAR_BLOCK;
+    char zeros[CW_TAR_BLOCK];
+    memset(zeros, 0, CW_TAR_BLOCK);
+    CW_Out.write(zeros, padding);
+
+    AC_Index << name << '\t' << offset << '\t' << length << '\n';
+}
+
+void ArchiveComposite::addGroup(const std::string& name,
+                                const SpacerGraph& graph,
+                                const LayeredLayout& layout,
+                                NativeRenderer& renderer,
+                                const char * format)
+{
+    std::stringstream image;
+    renderer.render(graph, layout, format, image);
+    std::string data = image.str();
+    writeMember(name + "." + format, data.data(), data.length());
+}
+
+void ArchiveComposite::addRenderedData(const std::string& name,
+                                       const char * data,
+                                       size_t length)
+{
+    writeMember(name, data, length);
+}
+
+void ArchiveComposite::close(void)
+{
+    std::string index = AC_Index.str();
+    writeMember(CW_INDEX_NAME, index.data(), index.length());
+    // a tar file ends with two empty blocks
+    char zeros[2 * CW_TAR_BLOCK];
+    memset(zeros, 0, 2 * CW_TAR_BLOCK);
+    CW_Out.write(zeros, 2 * CW_TAR_BLOCK);
+    CW_Out.close();
+}
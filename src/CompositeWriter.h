@@ -0,0 +1,134 @@
+/*
+ * CompositeWriter.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_CompositeWriter_h
+#define crisprtools_CompositeWriter_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include "SpacerGraph.h"
+#include "LayeredLayout.h"
+#include "NativeRenderer.h"
+
+#define CW_SVG_GAP 20.0             // space between groups in a tiled SVG
+#define CW_SVG_TITLE 16.0           // height of the group name above each tile
+#define CW_SIZE_DIGITS 10           // digits reserved for the SVG size so it can be patched at the end
+#define CW_TAR_BLOCK 512            // size of a tar header and the unit data is padded to
+#define CW_INDEX_NAME "index.tsv"   // table of contents in an archive
+
+// Writes every group drawn in a run into a single file rather than one
+// file per group.  Groups are written as soon as they are drawn so only
+// the current group is ever held in memory
+class CompositeWriter {
+public:
+    CompositeWriter(const std::string& fileName);
+    virtual ~CompositeWriter() {}
+
+    // makes the right kind of writer for the extension of fileName:
+    // .pdf is a multipage PDF, .svg a tiled SVG and anything else a tar
+    // archive with a table of contents
+    static CompositeWriter * create(const std::string& fileName);
+
+    // can this writer take images that have already been rendered,
+    // which is the only way of getting Graphviz output in
+    virtual bool acceptsRenderedData(void) {return false;}
+
+    virtual void addGroup(const std::string& name,
+                          const SpacerGraph& graph,
+                          const LayeredLayout& layout,
+                          NativeRenderer& renderer,
+                          const char * format) = 0;
+    virtual void addRenderedData(const std::string& name,
+                                 const char * data,
+                                 size_t length);
+
+    // finish off the file, nothing is valid until this is called
+    virtual void close(void) = 0;
+
+    // give up on the file and remove what has been written of it
+    void abort(void);
+
+protected:
+    std::string CW_FileName;
+    std::ofstream CW_Out;
+};
+
+class SvgComposite : public CompositeWriter {
+public:
+    SvgComposite(const std::string& fileName);
+
+    void addGroup(const std::string& name,
+                  const SpacerGraph& graph,
+                  const LayeredLayout& layout,
+                  NativeRenderer& renderer,
+                  const char * format);
+    void close(void);
+
+private:
+    void writeSize(double width, double height);
+
+    std::streampos SC_SizePosition;
+    double SC_Width;
+    double SC_Height;
+    bool SC_HaveDefs;
+};
+
+class PdfComposite : public CompositeWriter {
+public:
+    PdfComposite(const std::string& fileName);
+
+    void addGroup(const std::string& name,
+                  const SpacerGraph& graph,
+                  const LayeredLayout& layout,
+                  NativeRenderer& renderer,
+                  const char * format);
+    void close(void);
+
+private:
+    // start object number id, remembering where it is for the xref table
+    void beginObject(int id);
+
+    std::vector<long> PC_Offsets;
+    std::vector<int> PC_Pages;
+};
+
+class ArchiveComposite : public CompositeWriter {
+public:
+    ArchiveComposite(const std::string& fileName);
+
+    bool acceptsRenderedData(void) {return true;}
+    void addGroup(const std::string& name,
+                  const SpacerGraph& graph,
+                  const LayeredLayout& layout,
+                  NativeRenderer& renderer,
+                  const char * format);
+    void addRenderedData(const std::string& name,
+                         const char * data,
+                         size_t length);
+    void close(void);
+
+private:
+    void writeMember(const std::string& name, const char * data, size_t length);
+
+    std::stringstream AC_Index;
+};
+
+#endif
@@ -0,0 +1,187 @@
+// ContigArrays.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "ContigArrays.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/StlExt.h>
+#include <sstream>
+
+void ContigArrays::parseSpacers(xercesc::DOMElement * spacersElement, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * currentElement = spacersElement->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        if (!xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacer())) {
+            continue;
+        }
+        char * c_spid = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
+        char * c_seq = tc(currentElement->getAttribute(xmlParser.attr_Seq()));
+        std::map<std::string, int>::iterator iter = CA_Index.find(c_spid);
+        if (iter == CA_Index.end()) {
+            CA_Index[c_spid] = static_cast<int>(CA_Sequences.size());
+            CA_Sequences.push_back(c_seq);
+        } else {
+            CA_Sequences[iter->second] = c_seq;
+        }
+        xr(&c_spid);
+        xr(&c_seq);
+    }
+}
+
+void ContigArrays::parseAssembly(xercesc::DOMElement * assemblyElement, crispr::xml::base& xmlParser)
+{
+    if (CA_ContigOffsets.empty()) {
+        CA_ContigOffsets.push_back(0);
+        CA_LinkOffsets.push_back(0);
+    }
+    for (xercesc::DOMElement * contig = assemblyElement->getFirstElementChild();
+         contig != NULL;
+         contig = contig->getNextElementSibling()) {
+        if (xercesc::XMLString::equals(contig->getTagName(), xmlParser.tag_Contig())) {
+            parseContig(contig, xmlParser);
+        }
+    }
+}
+
+int ContigArrays::spacerWithName(const char * spid, const std::string& cid)
+{
+    std::map<std::string, int>::iterator iter = CA_Index.find(spid);
+    if (iter == CA_Index.end()) {
+        std::stringstream msg;
+        msg<<"Spacer "<<spid<<" in contig "<<cid<<" of group "<<CA_Gid<<" is not in the data section";
+        throw crispr::xml_exception(__FILE__,
+                                    __LINE__,
+                                    __PRETTY_FUNCTION__,
+                                    msg.str().c_str());
+    }
+    return iter->second;
+}
+
+void ContigArrays::parseContig(xercesc::DOMElement * contigElement, crispr::xml::base& xmlParser)
+{
+    char * c_cid = tc(contigElement->getAttribute(xmlParser.attr_Cid()));
+    std::string cid = c_cid;
+    xr(&c_cid);
+
+    // the whole contig is read before anything is added so that an unknown
+    // spacer throws with the arrays as they were
+    std::vector<int> spacers;
+    std::vector<int> contig_links;
+    std::vector<int> link_ends;
+    for (xercesc::DOMElement * cspacer = contigElement->getFirstElementChild();
+         cspacer != NULL;
+         cspacer = cspacer->getNextElementSibling()) {
+        if (!xercesc::XMLString::equals(cspacer->getTagName(), xmlParser.tag_Cspacer())) {
+            continue;
+        }
+        char * c_spid = tc(cspacer->getAttribute(xmlParser.attr_Spid()));
+        std::string spid = c_spid;
+        xr(&c_spid);
+        spacers.push_back(spacerWithName(spid.c_str(), cid));
+
+        // only the forward spacer links are needed to put the contig in order
+        for (xercesc::DOMElement * links = cspacer->getFirstElementChild();
+             links != NULL;
+             links = links->getNextElementSibling()) {
+            if (!xercesc::XMLString::equals(links->getTagName(), xmlParser.tag_Fspacers())) {
+                continue;
+            }
+            for (xercesc::DOMElement * link = links->getFirstElementChild();
+                 link != NULL;
+                 link = link->getNextElementSibling()) {
+                char * c_link = tc(link->getAttribute(xmlParser.attr_Spid()));
+                std::map<std::string, int>::iterator iter = CA_Index.find(c_link);
+                if (iter != CA_Index.end()) {
+                    contig_links.push_back(iter->second);
+                }
+                xr(&c_link);
+            }
+        }
+        link_ends.push_back(static_cast<int>(contig_links.size()));
+    }
+
+    int link_base = static_cast<int>(CA_Links.size());
+    CA_Spacers.insert(CA_Spacers.end(), spacers.begin(), spacers.end());
+    CA_Links.insert(CA_Links.end(), contig_links.begin(), contig_links.end());
+    for (size_t i = 0; i < link_ends.size(); ++i) {
+        CA_LinkOffsets.push_back(link_base + link_ends[i]);
+    }
+    CA_ContigIds.push_back(cid);
+    CA_ContigOffsets.push_back(static_cast<int>(CA_Spacers.size()));
+}
+
+void ContigArrays::build(void)
+{
+    // position of each spacer in the contig being built, only the entries
+    // for that contig are touched so the whole build is linear
+    std::vector<int> position(CA_Sequences.size(), -1);
+    std::vector<int> next;
+    std::vector<char> has_predecessor;
+    std::vector<char> visited;
+
+    int num_contigs = static_cast<int>(CA_ContigIds.size());
+    for (int c = 0; c < num_contigs; ++c) {
+        int begin = CA_ContigOffsets[c];
+        int num_spacers = CA_ContigOffsets[c + 1] - begin;
+        for (int i = 0; i < num_spacers; ++i) {
+            position[CA_Spacers[begin + i]] = i;
+        }
+
+        // the next spacer is the first forward link that stays in the contig
+        next.assign(num_spacers, -1);
+        has_predecessor.assign(num_spacers, 0);
+        for (int i = 0; i < num_spacers; ++i) {
+            for (int l = CA_LinkOffsets[begin + i]; l < CA_LinkOffsets[begin + i + 1]; ++l) {
+                int j = position[CA_Links[l]];
+                if (j != -1 && j != i) {
+                    next[i] = j;
+                    has_predecessor[j] = 1;
+                    break;
+                }
+            }
+        }
+
+        // walk from every spacer without a predecessor, then from whatever
+        // is left, which can only be part of a cycle
+        visited.assign(num_spacers, 0);
+        int walks = 0;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int start = 0; start < num_spacers; ++start) {
+                if (visited[start] || (pass == 0 && has_predecessor[start])) {
+                    continue;
+                }
+                std::string record = CA_Repeat;
+                for (int current = start; current != -1 && !visited[current]; current = next[current]) {
+                    visited[current] = 1;
+                    record += CA_Sequences[CA_Spacers[begin + current]];
+                    record += CA_Repeat;
+                }
+                ++walks;
+                std::string header = CA_Gid + CA_ContigIds[c];
+                if (walks > 1) {
+                    header += '_' + to_string(walks);
+                }
+                CA_Headers.push_back(header);
+                CA_Records.push_back(record);
+            }
+        }
+
+        for (int i = 0; i < num_spacers; ++i) {
+            position[CA_Spacers[begin + i]] = -1;
+        }
+    }
+}
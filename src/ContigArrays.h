@@ -0,0 +1,81 @@
+/*
+ * ContigArrays.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_ContigArrays_h
+#define crisprtools_ContigArrays_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <libcrispr/base.h>
+
+// Rebuilds the repeat-spacer-repeat sequence of every contig in a group.
+// The spacer sequences from <data> and the contigs from <assembly> are
+// copied out of the DOM by the parse functions, then build() can be run
+// on any thread to walk each contig along its forward links
+class ContigArrays {
+public:
+    ContigArrays(std::string gid, std::string repeat)
+    {
+        CA_Gid = gid;
+        CA_Repeat = repeat;
+    }
+
+    // must be called before parseAssembly for the same group
+    void parseSpacers(xercesc::DOMElement * spacersElement, crispr::xml::base& xmlParser);
+
+    // throws crispr::xml_exception if a cspacer isn't one of the spacers,
+    // the contig it is in is left out of the arrays
+    void parseAssembly(xercesc::DOMElement * assemblyElement, crispr::xml::base& xmlParser);
+
+    // make one record per walk through each contig.  A contig normally
+    // gives a single record named gid + cid, if its links break it into
+    // several walks the later ones get a _2, _3 ... suffix
+    void build(void);
+
+    inline std::string getGid(void) const {return CA_Gid;}
+    inline int recordCount(void) const {return static_cast<int>(CA_Headers.size());}
+    inline int spacerCount(void) const {return static_cast<int>(CA_Spacers.size());}
+    inline const std::string& header(int i) const {return CA_Headers[i];}
+    inline const std::string& sequence(int i) const {return CA_Records[i];}
+
+private:
+    void parseContig(xercesc::DOMElement * contigElement, crispr::xml::base& xmlParser);
+    int spacerWithName(const char * spid, const std::string& cid);
+
+    std::string CA_Gid;
+    std::string CA_Repeat;
+
+    // spacer sequences by interned id
+    std::map<std::string, int> CA_Index;
+    std::vector<std::string> CA_Sequences;
+
+    // the cspacers of each contig in document order and the forward
+    // links of each cspacer, both stored as offsets into flat arrays
+    std::vector<std::string> CA_ContigIds;
+    std::vector<int> CA_ContigOffsets;
+    std::vector<int> CA_Spacers;
+    std::vector<int> CA_LinkOffsets;
+    std::vector<int> CA_Links;
+
+    std::vector<std::string> CA_Headers;
+    std::vector<std::string> CA_Records;
+};
+
+#endif
@@ -37,27 +37,35 @@
 
 namespace crispr {
 
+    // default value for attributes set by name, graphviz copies it
+    static char empty_default[] = "";
+
+    graph::attribute graph::declareNodeAttribute(const char * attrName, const char * defaultValue)
+    {
+        return agnodeattr(G_graph, const_cast<char *>(attrName), const_cast<char *>(defaultValue));
+    }
+
+    graph::attribute graph::declareEdgeAttribute(const char * attrName, const char * defaultValue)
+    {
+        return agedgeattr(G_graph, const_cast<char *>(attrName), const_cast<char *>(defaultValue));
+    }
+
+    graph::attribute graph::declareGraphAttribute(const char * attrName, const char * defaultValue)
+    {
+        return agraphattr(G_graph, const_cast<char *>(attrName), const_cast<char *>(defaultValue));
+    }
         
-    int graph::setNodeAttribute(Agnode_t * node ,char * attrName, char * attrValue)
+    int graph::setNodeAttribute(Agnode_t * node ,const char * attrName, const char * attrValue)
     {
-        char * dummy = strdup("");
-        int ret = agsafeset(node, attrName, attrValue, dummy);
-        delete dummy;
-        return ret;
+        return agsafeset(node, const_cast<char *>(attrName), const_cast<char *>(attrValue), empty_default);
     }  
-    int graph::setGraphAttribute(char * attrName, char * attrValue)
+    int graph::setGraphAttribute(const char * attrName, const char * attrValue)
     {
-        char * dummy = strdup("");
-        int ret = agsafeset(G_graph, attrName, attrValue, dummy);
-        delete dummy;
-        return ret;
+        return agsafeset(G_graph, const_cast<char *>(attrName), const_cast<char *>(attrValue), empty_default);
     }
-    int graph::setEdgeAttribute(Agedge_t * edge ,char * attrName, char * attrValue)
+    int graph::setEdgeAttribute(Agedge_t * edge ,const char * attrName, const char * attrValue)
     {
-        char * dummy = strdup("");
-        int ret = agsafeset(edge, attrName, attrValue, dummy);
-        delete dummy;
-        return ret;
+        return agsafeset(edge, const_cast<char *>(attrName), const_cast<char *>(attrValue), empty_default);
     }
     
 
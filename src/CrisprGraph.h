@@ -46,9 +46,15 @@ namespace crispr {
         Agraph_t * G_graph;
         
     public:
-        graph(char * name )
+        // handle to an attribute that has been declared on the graph, setting
+        // an attribute through one of these is an index lookup rather than a
+        // search by name, and graphviz interns the value so nothing is copied
+        // when the same value (a shape name for instance) is used over and over
+        typedef Agsym_t * attribute;
+
+        graph(const char * name )
         {
-            G_graph = agopen(name, AGDIGRAPH );
+            G_graph = agopen(const_cast<char *>(name), AGDIGRAPH );
         }
         
         ~graph()
@@ -59,9 +65,9 @@ namespace crispr {
         inline Agraph_t * getGraph(void){return G_graph;}
         
         
-        inline Agnode_t * addNode(char * name)
+        inline Agnode_t * addNode(const char * name)
         {
-            Agnode_t * n = agnode(G_graph, name);
+            Agnode_t * n = agnode(G_graph, const_cast<char *>(name));
             return n;
         }       
         
@@ -70,25 +76,47 @@ namespace crispr {
             return agedge(G_graph, tail, head);
         } 
         
-        inline Agnode_t * nodeWithName(char * name)
+        inline Agnode_t * nodeWithName(const char * name)
         {
-            return agfindnode(G_graph, name);
+            return agfindnode(G_graph, const_cast<char *>(name));
         }      
         
         inline Agedge_t * findEdge(Agnode_t * tail, Agnode_t * head)
         {
             return agfindedge(G_graph, tail, head);
         }
-        
-        int setNodeAttribute(Agnode_t * node ,char * attrName, char * attrValue);
 
-        int setGraphAttribute(char * attrName, char * attrValue);
+        // declare an attribute once per graph, returns NULL on failure
+        attribute declareNodeAttribute(const char * attrName, const char * defaultValue = "");
+        attribute declareEdgeAttribute(const char * attrName, const char * defaultValue = "");
+        attribute declareGraphAttribute(const char * attrName, const char * defaultValue = "");
+
+        inline int setNodeAttribute(Agnode_t * node, attribute attr, const char * attrValue)
+        {
+            return agxset(node, attr->index, const_cast<char *>(attrValue));
+        }
+
+        inline int setEdgeAttribute(Agedge_t * edge, attribute attr, const char * attrValue)
+        {
+            return agxset(edge, attr->index, const_cast<char *>(attrValue));
+        }
+
+        inline int setGraphAttribute(attribute attr, const char * attrValue)
+        {
+            return agxset(G_graph, attr->index, const_cast<char *>(attrValue));
+        }
+
+        // set an attribute by name, which declares it if needed.  Fine for
+        // one off settings but use the attribute versions above in loops
+        int setNodeAttribute(Agnode_t * node ,const char * attrName, const char * attrValue);
+
+        int setGraphAttribute(const char * attrName, const char * attrValue);
  
-        int setEdgeAttribute(Agedge_t * edge ,char * attrName, char * attrValue);
+        int setEdgeAttribute(Agedge_t * edge ,const char * attrName, const char * attrValue);
    
-        inline int setNodeAttribute(char * nodeName ,char * attrName, char * attrValue)
+        inline int setNodeAttribute(const char * nodeName ,const char * attrName, const char * attrValue)
         {
-            Agnode_t * node = agfindnode(G_graph, nodeName);
+            Agnode_t * node = nodeWithName(nodeName);
             if (node != NULL) {
                 return setNodeAttribute(node, attrName, attrValue);
             } else {
@@ -0,0 +1,193 @@
+// DrawCache.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "DrawCache.h"
+#include "Utils.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <sys/stat.h>
+
+void ContentHash::add(const char * data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        addByte(static_cast<unsigned char>(data[i]));
+    }
+    addByte(0xff);
+}
+
+void ContentHash::add(const std::string& str)
+{
+    add(str.data(), str.length());
+}
+
+void ContentHash::add(int i)
+{
+    for (size_t b = 0; b < sizeof(int); ++b) {
+        addByte(static_cast<unsigned char>((i >> (8 * b)) & 0xff));
+    }
+    addByte(0xff);
+}
+
+void ContentHash::add(const ContentHash& other)
+{
+    uint64_t v = other.value();
+    for (int b = 0; b < 8; ++b) {
+        addByte(static_cast<unsigned char>((v >> (8 * b)) & 0xff));
+    }
+    addByte(0xff);
+}
+
+std::string ContentHash::hex(void) const
+{
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << CH_Hash;
+    return ss.str();
+}
+
+DrawCache::DrawCache(std::string directory)
+{
+    DC_Directory = directory;
+    if (DC_Directory[DC_Directory.length() - 1] != '/') {
+        DC_Directory += '/';
+    }
+    struct stat file_stats;
+    if (0 != stat(DC_Directory.c_str(), &file_stats)) {
+        recursiveMkdir(DC_Directory);
+    }
+    DC_Hits = 0;
+    DC_Misses = 0;
+}
+
+std::string DrawCache::pathFor(const std::string& key, const char * extension)
+{
+    return DC_Directory + key + "." + extension;
+}
+
+std::string DrawCache::layoutKey(const SpacerGraph& graph, const char * algorithm)
+{
+    ContentHash h;
+    h.add(algorithm);
+    h.add(graph.getName());
+    h.add(graph.nodeCount());
+    for (int i = 0; i < graph.nodeCount(); ++i) {
+        const SpacerGraph::SGNode& node = graph.node(i);
+        h.add(node.name);
+        h.add(node.lastName);
+        h.add(static_cast<int>(node.type));
+        h.add(node.length);
+        const SpacerGraph::adjacencyList& out_edges = graph.successors(i);
+        h.add(static_cast<int>(out_edges.size()));
+        SpacerGraph::adjacencyList::const_iterator iter;
+        for (iter = out_edges.begin(); iter != out_edges.end(); ++iter) {
+            h.add(*iter);
+        }
+    }
+    return h.hex();
+}
+
+std::string DrawCache::renderKey(const std::string& layoutKey,
+                                 const SpacerGraph& graph,
+                                 const std::vector<int>& colours,
+                                 const char * format)
+{
+    // the colours only show which bin the coverage falls in, collapsed
+    // chains also print their coverage range in a label or tooltip so
+    // that text goes in as well, formatted the way the renderers do it
+    ContentHash h;
+    h.add(layoutKey);
+    h.add(format);
+    std::vector<int>::const_iterator iter;
+    for (iter = colours.begin(); iter != colours.end(); ++iter) {
+        h.add(*iter);
+    }
+    for (int i = 0; i < graph.nodeCount(); ++i) {
+        const SpacerGraph::SGNode& node = graph.node(i);
+        if (node.hasCoverage) {
+            std::stringstream coverage;
+            coverage << node.minCoverage << '-' << node.maxCoverage;
+            h.add(coverage.str());
+        } else {
+            h.add(-1);
+        }
+    }
+    return h.hex();
+}
+
+static bool copyFile(const std::string& from, const std::string& to)
+{
+    std::ifstream in(from.c_str(), std::ios::in | std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ofstream out(to.c_str(), std::ios::out | std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    out << in.rdbuf();
+    return out.good();
+}
+
+bool DrawCache::fetchOutput(const std::string& key, const char * format, const std::string& fileName)
+{
+    if (copyFile(pathFor(key, format), fileName)) {
+        ++DC_Hits;
+        return true;
+    }
+    ++DC_Misses;
+    return false;
+}
+
+void DrawCache::storeOutput(const std::string& key, const char * format, const std::string& fileName)
+{
+    // write to a temporary name first so that an interrupted run can
+    // never leave a half written image in the cache
+    std::string path = pathFor(key, format);
+    std::string tmp_path = path + ".tmp";
+    if (copyFile(fileName, tmp_path)) {
+        rename(tmp_path.c_str(), path.c_str());
+    } else {
+        remove(tmp_path.c_str());
+    }
+}
+
+bool DrawCache::fetchLayout(const std::string& key, LayeredLayout& layout, int nodeCount)
+{
+    std::ifstream in(pathFor(key, DC_LAYOUT_EXTENSION).c_str());
+    if (!in) {
+        return false;
+    }
+    return layout.read(in, nodeCount);
+}
+
+void DrawCache::storeLayout(const std::string& key, const LayeredLayout& layout, int nodeCount)
+{
+    std::string path = pathFor(key, DC_LAYOUT_EXTENSION);
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path.c_str());
+    if (!out) {
+        return;
+    }
+    layout.write(out, nodeCount);
+    out.close();
+    if (out.good()) {
+        rename(tmp_path.c_str(), path.c_str());
+    } else {
+        remove(tmp_path.c_str());
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * DrawCache.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_DrawCache_h
+#define crisprtools_DrawCache_h
+
+#include <string>
+#include <stdint.h>
+#include "SpacerGraph.h"
+#include "LayeredLayout.h"
+
+// the 64 bit FNV constants are built from 32 bit halves since long long
+// literals aren't allowed in C++98
+#define DC_FNV_OFFSET ((static_cast<uint64_t>(0xcbf29ce4) << 32) | 0x84222325)
+#define DC_FNV_PRIME ((static_cast<uint64_t>(0x00000100) << 32) | 0x000001b3)
+#define DC_LAYOUT_EXTENSION "layout"
+
+// 64 bit FNV-1a hash.  Every value is followed by a separator so that
+// "ab","c" and "a","bc" don't hash to the same thing
+class ContentHash {
+public:
+    ContentHash()
+    {
+        CH_Hash = DC_FNV_OFFSET;
+    }
+
+    void add(const char * data, size_t length);
+    void add(const std::string& str);
+    void add(int i);
+    void add(const ContentHash& other);
+
+    inline uint64_t value(void) const {return CH_Hash;}
+    std::string hex(void) const;
+
+private:
+    void addByte(unsigned char byte)
+    {
+        CH_Hash ^= byte;
+        CH_Hash *= DC_FNV_PRIME;
+    }
+
+    uint64_t CH_Hash;
+};
+
+// A directory of previously drawn groups.  Outputs are stored by the hash
+// of everything that goes into the picture so an unchanged group can be
+// copied straight out of the cache.  Native layouts are stored separately
+// by a hash of the graph structure only, so changing the colours or the
+// format of a group only needs it to be rendered again
+class DrawCache {
+public:
+    DrawCache(std::string directory);
+
+    // hash of the graph topology and the layout algorithm
+    std::string layoutKey(const SpacerGraph& graph, const char * algorithm);
+
+    // hash of the layout key plus the packed node colours, the coverage
+    // printed in the labels and the image format
+    std::string renderKey(const std::string& layoutKey,
+                          const SpacerGraph& graph,
+                          const std::vector<int>& colours,
+                          const char * format);
+
+    // copy a cached image to fileName, returns false on a cache miss
+    bool fetchOutput(const std::string& key, const char * format, const std::string& fileName);
+    void storeOutput(const std::string& key, const char * format, const std::string& fileName);
+
+    bool fetchLayout(const std::string& key, LayeredLayout& layout, int nodeCount);
+    void storeLayout(const std::string& key, const LayeredLayout& layout, int nodeCount);
+
+    inline int getHits(void){return DC_Hits;}
+    inline int getMisses(void){return DC_Misses;}
+
+private:
+    std::string pathFor(const std::string& key, const char * extension);
+
+    std::string DC_Directory;
+    int DC_Hits;
+    int DC_Misses;
+};
+
+#endif
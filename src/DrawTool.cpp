@@ -17,27 +17,26 @@
 
 #include "DrawTool.h"
 #include <libcrispr/Exception.h>
-#include "CrisprGraph.h"
 #include "Utils.h"
 #include "config.h"
+#include "Profile.h"
 #include <libcrispr/StlExt.h>
 #include <string.h>
+#include <stdlib.h>
 #include <sys/stat.h>
-#include <graphviz/gvc.h>
 #include <getopt.h>
 
 DrawTool::~DrawTool()
 {
-    graphVector::iterator iter = DT_Graphs.begin();
-    while (iter != DT_Graphs.end()) {
-        if ((*iter) != NULL) {
-            delete *iter;
-            *iter = NULL;
-        }
-        iter++;
+    if (DT_Cache != NULL) {
+        delete DT_Cache;
+    }
+    if (DT_Composite != NULL) {
+        delete DT_Composite;
     }
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
     gvFreeContext(DT_Gvc);
-
+#endif
 }
 
 int DrawTool::processOptions (int argc, char ** argv)
@@ -53,11 +52,15 @@ int DrawTool::processOptions (int argc, char ** argv)
             {"format", required_argument, NULL, 'f'},
             {"algorithm", required_argument, NULL, 'a'},
             {"groups", required_argument, NULL, 'g'},
+            {"expand-chains", no_argument, NULL, 'e'},
+            {"cache", required_argument, NULL, 'C'},
+            {"global-scale", no_argument, NULL, 'G'},
+            {"composite", required_argument, NULL, 'p'},
             {0,0,0,0}
         };
         
-        bool algo = false, outformat = false;
-        while((c = getopt_long(argc, argv, "hg:c:a:f:o:b:", long_options, &index)) != -1)
+        bool outformat = false;
+        while((c = getopt_long(argc, argv, "heGg:c:a:f:o:b:C:p:", long_options, &index)) != -1)
         {
             switch(c)
             {
@@ -99,6 +102,10 @@ int DrawTool::processOptions (int argc, char ** argv)
                         DT_ColourType = BLUE_RED;
                     } else if (!strcmp(optarg, "green-blue-red")) {
                         DT_ColourType = GREEN_BLUE_RED;
+                    } else if (!strcmp(optarg, "viridis")) {
+                        DT_ColourType = VIRIDIS;
+                    } else if (!strcmp(optarg, "cividis")) {
+                        DT_ColourType = CIVIDIS;
                     } else {
                         throw crispr::input_exception("Not a known color type");
                     }
@@ -112,17 +119,45 @@ int DrawTool::processOptions (int argc, char ** argv)
                 }
                 case 'a':
                 {
-                    if (!strcmp(optarg, "dot") || 
+                    if (!strcmp(optarg, DT_NATIVE_ALGORITHM)) {
+                        DT_RenderingAlgorithm = optarg;
+                        DT_Native = true;
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
+                    } else if (!strcmp(optarg, "dot") || 
                         !strcmp(optarg, "neato") || 
                         !strcmp(optarg, "fdp") || 
                         !strcmp(optarg, "sfdp") ||
                         !strcmp(optarg, "twopi") || 
                         !strcmp(optarg, "circo")) {
                         DT_RenderingAlgorithm = optarg;       
+                        DT_Native = false;
+#endif
                     } else {
-                        throw crispr::input_exception("Not a known Graphviz rendering algorithm");
+                        throw crispr::input_exception("Not a known rendering algorithm");
+                    }
+                    break;
+                }
+                case 'C':
+                {
+                    if (DT_Cache != NULL) {
+                        delete DT_Cache;
                     }
-                    algo = true;
+                    DT_Cache = new DrawCache(optarg);
+                    break;
+                }
+                case 'p':
+                {
+                    DT_CompositeFile = optarg;
+                    break;
+                }
+                case 'G':
+                {
+                    DT_GlobalScale = true;
+                    break;
+                }
+                case 'e':
+                {
+                    DT_ExpandChains = true;
                     break;
                 }
                 case 'b':
@@ -147,8 +182,25 @@ int DrawTool::processOptions (int argc, char ** argv)
                 }
             }
         }
-        if (!(algo & outformat) ) {
-            throw crispr::input_exception("You must specify both -a and -f on the command line");
+        if (DT_Native) {
+            // the native renderer has sensible defaults so neither -a or -f are needed
+            if (!outformat) {
+                static char default_format[] = "svg";
+                DT_OutputFormat = default_format;
+            } else if (!NativeRenderer::isSupportedFormat(DT_OutputFormat)) {
+                throw crispr::input_exception("The native renderer can only create svg or png images");
+            }
+        } else if (!outformat) {
+            throw crispr::input_exception("You must specify -f when using a Graphviz layout algorithm");
+        }
+        if (!DT_CompositeFile.empty()) {
+            if (DT_Cache != NULL) {
+                throw crispr::input_exception("A cache can not be used when writing a composite file");
+            }
+            DT_Composite = CompositeWriter::create(DT_CompositeFile);
+            if (!DT_Native && !DT_Composite->acceptsRenderedData()) {
+                throw crispr::input_exception("Graphviz layouts can only be written to an archive, not a PDF or SVG composite");
+            }
         }
 
     } catch (crispr::input_exception& e) {
@@ -174,7 +226,7 @@ int DrawTool::processInputFile(const char * inputFile)
 {
     try {
         crispr::xml::parser xml_parser;
-        xercesc::DOMDocument * input_doc_obj = xml_parser.setFileParser(inputFile);
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
         xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
         
         if( !root_elem ) throw(crispr::xml_exception(__FILE__, 
@@ -182,83 +234,296 @@ int DrawTool::processInputFile(const char * inputFile)
                                                      __PRETTY_FUNCTION__, 
                                                      "empty XML document" ));
 
+        ProfileTimer walk_timer(PF_WALK);
+
+        if (DT_GlobalScale) {
+            // fix a single colour scale for the whole file before drawing
+            // anything so that colours can be compared between groups
+            prescanCoverage(root_elem, xml_parser);
+        }
+
         // get the children
         for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild(); 
              currentElement != NULL; 
              currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
                 
             // is this a group element
-            if (xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
-                char * c_group_id = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
-                std::string group_id = c_group_id;
-                if (DT_Subset) {
-                    
-                    // we only want some of the groups look at DT_Groups
-                    if (DT_Groups.find(group_id.substr(1)) != DT_Groups.end() ) {
-                        parseGroup(currentElement, xml_parser);
-                        
-                    }
-                } else {
-                    parseGroup(currentElement, xml_parser);   
-                }
-                xr(&c_group_id);
+            if (wantGroup(currentElement, xml_parser)) {
+                parseGroup(currentElement, xml_parser);
             }
             
         }
+        if (DT_Composite != NULL) {
+            DT_Composite->close();
+        }
     } catch (crispr::xml_exception& e) {
         std::cerr<<e.what()<<std::endl;
+        if (DT_Composite != NULL) {
+            DT_Composite->abort();
+        }
         return 1;
     } catch (crispr::runtime_exception& e) {
         std::cerr<<e.what()<<std::endl;
+        if (DT_Composite != NULL) {
+            DT_Composite->abort();
+        }
+        return 1;
     }
     
     return 0;
 }
+bool DrawTool::wantGroup(xercesc::DOMElement * groupElement, crispr::xml::parser& xmlParser)
+{
+    if (!xercesc::XMLString::equals(groupElement->getTagName(), xmlParser.tag_Group())) {
+        return false;
+    }
+    if (!DT_Subset) {
+        return true;
+    }
+    // we only want some of the groups look at DT_Groups
+    char * c_group_id = tc(groupElement->getAttribute(xmlParser.attr_Gid()));
+    std::string group_id = c_group_id;
+    xr(&c_group_id);
+    return DT_Groups.find(group_id.substr(1)) != DT_Groups.end();
+}
+
+void DrawTool::prescanCoverage(xercesc::DOMElement * rootElement, crispr::xml::parser& xmlParser)
+{
+    //-----
+    // Only looks at the cov attribute of each spacer in the groups that
+    // will be drawn, nothing is built so this is cheap next to the drawing
+    //
+    resetInitialLimits();
+    for (xercesc::DOMElement * group = rootElement->getFirstElementChild(); 
+         group != NULL; 
+         group = group->getNextElementSibling()) {
+        if (!wantGroup(group, xmlParser)) {
+            continue;
+        }
+        for (xercesc::DOMElement * data = group->getFirstElementChild(); 
+             data != NULL; 
+             data = data->getNextElementSibling()) {
+            if (!xercesc::XMLString::equals(data->getTagName(), xmlParser.tag_Data())) {
+                continue;
+            }
+            for (xercesc::DOMElement * spacers = data->getFirstElementChild(); 
+                 spacers != NULL; 
+                 spacers = spacers->getNextElementSibling()) {
+                if (!xercesc::XMLString::equals(spacers->getTagName(), xmlParser.tag_Spacers())) {
+                    continue;
+                }
+                for (xercesc::DOMElement * spacer = spacers->getFirstElementChild(); 
+                     spacer != NULL; 
+                     spacer = spacer->getNextElementSibling()) {
+                    if (!spacer->hasAttribute(xmlParser.attr_Cov())) {
+                        continue;
+                    }
+                    char * c_cov = tc(spacer->getAttribute(xmlParser.attr_Cov()));
+                    double current_cov;
+                    if (from_string<double>(current_cov, c_cov, std::dec)) {
+                        recalculateLimits(current_cov);
+                    }
+                    xr(&c_cov);
+                }
+            }
+        }
+    }
+    setColours();
+}
+
 void DrawTool::parseGroup(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser)
 {
 
     
     // create a new graph object
     char * c_gid = tc(parentNode->getAttribute(xmlParser.attr_Gid()));
-    crispr::graph * current_graph = new crispr::graph(c_gid);
+    SpacerGraph current_graph(c_gid);
     xr(&c_gid);
     // change the max and min coverages back to their original values
-    resetInitialLimits();
+    // unless there is one scale for the whole file
+    if (!DT_GlobalScale) {
+        resetInitialLimits();
+    }
     
-    DT_Graphs.push_back(current_graph);
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
          currentElement != NULL; 
          currentElement = currentElement->getNextElementSibling()) {
         
         if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Data())) {
-            parseData(currentElement, xmlParser, current_graph);
-            setColours();
+            parseData(currentElement, xmlParser, &current_graph);
+            if (!DT_GlobalScale) {
+                setColours();
+            }
         } else if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Assembly())) {
-            parseAssembly(currentElement, xmlParser, current_graph);
+            parseAssembly(currentElement, xmlParser, &current_graph);
         }
         
     }
     
-    char * c_file_prefix = tc(parentNode->getAttribute(xmlParser.attr_Gid()));
-    std::string file_prefix = c_file_prefix;
-    std::string file_name = file_prefix + "." + DT_OutputFormat;
-    xr(&c_file_prefix);
-    char * file_name_c = strdup(file_name.c_str());
+    std::string file_name = DT_OutputFile + current_graph.getName() + "." + DT_OutputFormat;
+    if (DT_ExpandChains) {
+        renderGroup(&current_graph, file_name);
+    } else {
+        // long runs of spacers without any branches are drawn as a single
+        // node so that layout time depends on the number of branch points
+        SpacerGraph compacted_graph(current_graph.getName());
+        current_graph.compactChains(compacted_graph);
+        renderGroup(&compacted_graph, file_name);
+    }
+}
+
+void DrawTool::nodeColours(SpacerGraph * spacerGraph, std::vector<int>& colours)
+{
+    // colour all of the nodes in one go, uncovered nodes are marked with -1
+    std::vector<double> coverages(spacerGraph->nodeCount());
+    for (int i = 0; i < spacerGraph->nodeCount(); ++i) {
+        coverages[i] = spacerGraph->node(i).coverage;
+    }
+    DT_Rainbow.getRGB(coverages, colours);
+    for (int i = 0; i < spacerGraph->nodeCount(); ++i) {
+        if (!spacerGraph->node(i).hasCoverage) {
+            colours[i] = -1;
+        }
+    }
+}
 
+void DrawTool::addToComposite(SpacerGraph * spacerGraph)
+{
+    if (DT_Native) {
+        LayeredLayout layout;
+        {
+            ProfileTimer layout_timer(PF_LAYOUT);
+            layout.layout(*spacerGraph);
+        }
+        NativeRenderer renderer(&DT_Rainbow);
+        ProfileTimer render_timer(PF_RENDER);
+        DT_Composite->addGroup(spacerGraph->getName(), *spacerGraph, layout, renderer, DT_OutputFormat);
+        return;
+    }
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
+    crispr::graph * current_graph = buildGraphvizGraph(spacerGraph);
+    char * data = NULL;
+    unsigned int length = 0;
     layoutGraph(current_graph->getGraph(), DT_RenderingAlgorithm);
-    renderGraphToFile(current_graph->getGraph(), DT_OutputFormat, file_name_c);
+    renderGraphToData(current_graph->getGraph(), DT_OutputFormat, &data, &length);
     freeLayout(current_graph->getGraph());
-    // free the duplicated string
-    try {
-        delete file_name_c;
-    } catch (std::exception& e) {
-        std::cerr<<e.what()<<std::endl;
+    if (data != NULL) {
+        DT_Composite->addRenderedData(spacerGraph->getName() + "." + DT_OutputFormat, data, length);
+        gvFreeRenderData(data);
     }
+    delete current_graph;
+#endif
 }
 
+void DrawTool::renderGroup(SpacerGraph * spacerGraph, std::string& fileName)
+{
+    if (DT_Composite != NULL) {
+        // everything goes into the one file
+        addToComposite(spacerGraph);
+        return;
+    }
+    const char * algorithm = (DT_Native) ? DT_NATIVE_ALGORITHM : DT_RenderingAlgorithm;
+    std::string layout_key, render_key;
+    if (DT_Cache != NULL) {
+        // skip the whole layout and render if nothing about the picture changed
+        std::vector<int> colours;
+        nodeColours(spacerGraph, colours);
+        layout_key = DT_Cache->layoutKey(*spacerGraph, algorithm);
+        render_key = DT_Cache->renderKey(layout_key, *spacerGraph, colours, DT_OutputFormat);
+        if (DT_Cache->fetchOutput(render_key, DT_OutputFormat, fileName)) {
+            return;
+        }
+    }
+
+    if (DT_Native) {
+        LayeredLayout layout;
+        {
+            ProfileTimer layout_timer(PF_LAYOUT);
+            if (DT_Cache == NULL) {
+                layout.layout(*spacerGraph);
+            } else if (!DT_Cache->fetchLayout(layout_key, layout, spacerGraph->nodeCount())) {
+                layout.layout(*spacerGraph);
+                DT_Cache->storeLayout(layout_key, layout, spacerGraph->nodeCount());
+            }
+        }
+        NativeRenderer renderer(&DT_Rainbow);
+        ProfileTimer render_timer(PF_RENDER);
+        renderer.renderToFile(*spacerGraph, layout, DT_OutputFormat, fileName);
+    } else {
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
+        crispr::graph * current_graph = buildGraphvizGraph(spacerGraph);
+        char * file_name_c = strdup(fileName.c_str());
+
+        layoutGraph(current_graph->getGraph(), DT_RenderingAlgorithm);
+        renderGraphToFile(current_graph->getGraph(), DT_OutputFormat, file_name_c);
+        freeLayout(current_graph->getGraph());
+        // free the duplicated string
+        free(file_name_c);
+        delete current_graph;
+#endif
+    }
+
+    if (DT_Cache != NULL) {
+        DT_Cache->storeOutput(render_key, DT_OutputFormat, fileName);
+    }
+}
+
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
+crispr::graph * DrawTool::buildGraphvizGraph(SpacerGraph * spacerGraph)
+{
+    crispr::graph * current_graph = new crispr::graph(spacerGraph->getName().c_str());
+
+    // declare the attributes once, spacers are circles by default so only
+    // flankers and collapsed chains need their shape set
+    crispr::graph::attribute shape = current_graph->declareNodeAttribute("shape", "circle");
+    crispr::graph::attribute label = current_graph->declareNodeAttribute("label", "\\N");
+    crispr::graph::attribute style = current_graph->declareNodeAttribute("style", "");
+    crispr::graph::attribute fillcolour = current_graph->declareNodeAttribute("fillcolor", "");
+
+    char colour_for_graphviz[RB_COLOUR_LENGTH + 1];
+    colour_for_graphviz[0] = '#';
+
+    std::vector<Agnode_t *> graphviz_nodes(spacerGraph->nodeCount());
+    for (int i = 0; i < spacerGraph->nodeCount(); ++i) {
+        const SpacerGraph::SGNode& node = spacerGraph->node(i);
+        graphviz_nodes[i] = current_graph->addNode(node.name.c_str());
+
+        if (node.type == SpacerGraph::FLANKER) {
+            current_graph->setNodeAttribute(graphviz_nodes[i], shape, "diamond");
+        } else if (node.length > 1) {
+            // a collapsed chain, show where it starts and ends and how long it is
+            std::string chain_label = spacerGraph->label(i) + "\\n" + to_string(node.length) + " spacers";
+            if (node.hasCoverage) {
+                chain_label += "\\ncov " + to_string(node.minCoverage) + "-" + to_string(node.maxCoverage);
+            }
+            current_graph->setNodeAttribute(graphviz_nodes[i], shape, "box");
+            current_graph->setNodeAttribute(graphviz_nodes[i], label, chain_label.c_str());
+        }
+
+        if (node.hasCoverage) {
+            // fix things up for Graphviz
+            DT_Rainbow.getColour(node.coverage, colour_for_graphviz + 1);
+
+            // add in the colour attributes
+            current_graph->setNodeAttribute(graphviz_nodes[i], style, "filled");
+            current_graph->setNodeAttribute(graphviz_nodes[i], fillcolour, colour_for_graphviz);
+        }
+    }
+    for (int i = 0; i < spacerGraph->nodeCount(); ++i) {
+        const SpacerGraph::adjacencyList& out_edges = spacerGraph->successors(i);
+        SpacerGraph::adjacencyList::const_iterator iter;
+        for (iter = out_edges.begin(); iter != out_edges.end(); ++iter) {
+            current_graph->addEdge(graphviz_nodes[i], graphviz_nodes[*iter]);
+        }
+    }
+    return current_graph;
+}
+#endif
+
 void DrawTool::parseData(xercesc::DOMElement * parentNode, 
                          crispr::xml::parser& xmlParser, 
-                         crispr::graph * currentGraph)
+                         SpacerGraph * currentGraph)
 {
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
          currentElement != NULL; 
@@ -298,33 +563,25 @@ void DrawTool::parseData(xercesc::DOMElement * parentNode,
 //}
 void DrawTool::parseSpacers(xercesc::DOMElement * parentNode, 
                             crispr::xml::parser& xmlParser, 
-                            crispr::graph * currentGraph)
+                            SpacerGraph * currentGraph)
 {
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
          currentElement != NULL; 
          currentElement = currentElement->getNextElementSibling()) {
 
         if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacer())) {
-            char * node_name = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
-            
-            Agnode_t * current_graphviz_node = currentGraph->addNode(node_name);
-            
-            char * shape = strdup("shape");
-            char * circle = strdup("circle");
-            currentGraph->setNodeAttribute(current_graphviz_node, shape, circle);
-            delete shape;
-            delete circle;
-            
-            
             char * c_spid = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
             std::string spid = c_spid;
+            
+            int current_node = currentGraph->addNode(spid, SpacerGraph::SPACER);
+            
 
             if (currentElement->hasAttribute(xmlParser.attr_Cov())) {
                 char * c_cov = tc(currentElement->getAttribute(xmlParser.attr_Cov()));
                 double current_cov;
                 if (from_string<double>(current_cov, c_cov, std::dec)) {
                     recalculateLimits(current_cov);
-                    DT_SpacerCoverage[spid] = std::pair<bool, double>(true,current_cov);
+                    currentGraph->setCoverage(current_node, current_cov);
                 } else {
                     throw crispr::runtime_exception(__FILE__, 
                                                     __LINE__, 
@@ -334,12 +591,9 @@ void DrawTool::parseSpacers(xercesc::DOMElement * parentNode,
                 
                 xr(&c_cov);
                 
-            } else {
-                DT_SpacerCoverage[spid] = std::pair<bool, double>(false,0);
             }
             
             xr(&c_spid);
-            xr(&node_name);
         }
         
     }
@@ -347,7 +601,7 @@ void DrawTool::parseSpacers(xercesc::DOMElement * parentNode,
 
 void DrawTool::parseFlankers(xercesc::DOMElement * parentNode, 
                              crispr::xml::parser& xmlParser, 
-                             crispr::graph * currentGraph)
+                             SpacerGraph * currentGraph)
 {
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
          currentElement != NULL; 
@@ -355,15 +609,7 @@ void DrawTool::parseFlankers(xercesc::DOMElement * parentNode,
 
         if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Flanker())) {
             char * c_flid = tc(currentElement->getAttribute(xmlParser.attr_Flid()));
-            Agnode_t * current_graphviz_node = currentGraph->addNode(c_flid);
-            
-            char * shape = strdup("shape");
-            char * shape_val = strdup("diamond");
-            
-            currentGraph->setNodeAttribute(current_graphviz_node, shape, shape_val);
-            
-            delete shape;
-            delete shape_val;
+            currentGraph->addNode(c_flid, SpacerGraph::FLANKER);
             xr(&c_flid);
         }
     }
@@ -371,7 +617,7 @@ void DrawTool::parseFlankers(xercesc::DOMElement * parentNode,
 
 void DrawTool::parseAssembly(xercesc::DOMElement * parentNode, 
                              crispr::xml::parser& xmlParser, 
-                             crispr::graph * currentGraph)
+                             SpacerGraph * currentGraph)
 {
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
          currentElement != NULL; 
@@ -391,7 +637,7 @@ void DrawTool::parseAssembly(xercesc::DOMElement * parentNode,
 
 void DrawTool::parseContig(xercesc::DOMElement * parentNode, 
                            crispr::xml::parser& xmlParser, 
-                           crispr::graph * currentGraph, 
+                           SpacerGraph * currentGraph, 
                            std::string& contigId)
 {
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
@@ -401,41 +647,20 @@ void DrawTool::parseContig(xercesc::DOMElement * parentNode,
         if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Cspacer())) {
             // get the node
             char * c_spid = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
-            Agnode_t * current_graphviz_node = currentGraph->addNode(c_spid);
-
-            // find the coverage for this guy if it was set
-
             std::string cov_spid = c_spid;
 			xr(&c_spid);
-            if (DT_SpacerCoverage[cov_spid].first) {
-                std::string color = DT_Rainbow.getColour(DT_SpacerCoverage[cov_spid].second);
-
-                // fix things up for Graphviz
-                char * color_for_graphviz = strdup(('#' + color).c_str());
-
-                // add in the colour attributes
-                char * style = strdup("style");
-                char * filled = strdup("filled");
-                char * fillcolour = strdup("fillcolor");
-                
-                currentGraph->setNodeAttribute(current_graphviz_node, style, filled);
-                currentGraph->setNodeAttribute(current_graphviz_node, fillcolour, color_for_graphviz );
-                
-                delete style;
-                delete filled;
-                delete fillcolour;
-                delete color_for_graphviz;
-            }
+            // the coverage was set on the node when the spacers were parsed
+            int current_node = currentGraph->addNode(cov_spid, SpacerGraph::SPACER);
 
-            parseCSpacer(currentElement, xmlParser,currentGraph,current_graphviz_node,contigId);
+            parseCSpacer(currentElement, xmlParser,currentGraph,current_node,contigId);
         }
     }
 }
 
 void DrawTool::parseCSpacer(xercesc::DOMElement * parentNode, 
                             crispr::xml::parser& xmlParser, 
-                            crispr::graph * currentGraph, 
-                            Agnode_t * currentGraphvizNode, 
+                            SpacerGraph * currentGraph, 
+                            int currentNode, 
                             std::string& contigId)
 {
     for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild(); 
@@ -444,13 +669,13 @@ void DrawTool::parseCSpacer(xercesc::DOMElement * parentNode,
 
                     
        /* if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.getBspacers())) {
-                parseLinkSpacers(currentElement, xmlParser,currentGraph,currentGraphvizNode, REVERSE,contigId);
+                parseLinkSpacers(currentElement, xmlParser,currentGraph,currentNode, REVERSE,contigId);
         } else*/ if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Fspacers())) {
-                parseLinkSpacers(currentElement, xmlParser,currentGraph,currentGraphvizNode, FORWARD,contigId);
+                parseLinkSpacers(currentElement, xmlParser,currentGraph,currentNode, FORWARD,contigId);
         /*} else if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.getBflankers())) {
-                parseLinkFlankers(currentElement, xmlParser,currentGraph,currentGraphvizNode, REVERSE,contigId);
+                parseLinkFlankers(currentElement, xmlParser,currentGraph,currentNode, REVERSE,contigId);
         */} else if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Fflankers())) {
-                parseLinkFlankers(currentElement, xmlParser,currentGraph,currentGraphvizNode, FORWARD,contigId);
+                parseLinkFlankers(currentElement, xmlParser,currentGraph,currentNode, FORWARD,contigId);
         }
         
     }
@@ -458,8 +683,8 @@ void DrawTool::parseCSpacer(xercesc::DOMElement * parentNode,
 
 void DrawTool::parseLinkSpacers(xercesc::DOMElement * parentNode, 
                                 crispr::xml::parser& xmlParser, 
-                                crispr::graph * currentGraph, 
-                                Agnode_t * currentGraphvizNode, 
+                                SpacerGraph * currentGraph, 
+                                int currentNode, 
                                 EDGE_DIRECTION edgeDirection, 
                                 std::string& contigId)
 {
@@ -468,20 +693,20 @@ void DrawTool::parseLinkSpacers(xercesc::DOMElement * parentNode,
          currentElement = currentElement->getNextElementSibling()) {
             
         char * c_spid = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
-        Agnode_t * edge_node = currentGraph->addNode(c_spid);
+        int edge_node = currentGraph->addNode(c_spid, SpacerGraph::SPACER);
         xr(&c_spid);
         if (edgeDirection == FORWARD) {
-            currentGraph->addEdge(currentGraphvizNode, edge_node);
+            currentGraph->addEdge(currentNode, edge_node);
         } else {
-            currentGraph->addEdge(edge_node, currentGraphvizNode);
+            currentGraph->addEdge(edge_node, currentNode);
         }
     }
 }
 
 void DrawTool::parseLinkFlankers(xercesc::DOMElement * parentNode, 
                                  crispr::xml::parser& xmlParser, 
-                                 crispr::graph * currentGraph, 
-                                 Agnode_t * currentGraphvizNode, 
+                                 SpacerGraph * currentGraph, 
+                                 int currentNode, 
                                  EDGE_DIRECTION edgeDirection, 
                                  std::string& contigId)
 {
@@ -491,12 +716,12 @@ void DrawTool::parseLinkFlankers(xercesc::DOMElement * parentNode,
 
         char * c_flid = tc( currentElement->getAttribute(xmlParser.attr_Flid()));
 
-        Agnode_t * edge_node = currentGraph->addNode(c_flid);
+        int edge_node = currentGraph->addNode(c_flid, SpacerGraph::FLANKER);
         xr(&c_flid);
         if (edgeDirection == FORWARD) {
-            currentGraph->addEdge(currentGraphvizNode, edge_node);
+            currentGraph->addEdge(currentNode, edge_node);
         } else {
-            currentGraph->addEdge(edge_node, currentGraphvizNode);
+            currentGraph->addEdge(edge_node, currentNode);
         }        
     }
 }
@@ -526,19 +751,32 @@ int drawMain (int argc, char ** argv)
 
 void drawUsage(void)
 {
-    std::cout<<PACKAGE_NAME<<" draw [-ghyo] -a ALGORITHM -f FORMAT file.crispr"<<std::endl;
+    std::cout<<PACKAGE_NAME<<" draw [-gheoG] [-C DIR] [-p FILE] [-a ALGORITHM] [-f FORMAT] file.crispr"<<std::endl;
 	std::cout<<"Options:"<<std::endl;
 	std::cout<<"-h					print this handy help message"<<std::endl;
     std::cout<<"-o DIR              output file directory  [default: .]" <<std::endl; 
 	std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to extract data from."<<std::endl;
 	std::cout<<"					Note that only the group number is needed, do not use prefixes like 'Group' or 'G', which"<<std::endl;
 	std::cout<<"					are sometimes used in file names or in a .crispr file"<<std::endl;
-	std::cout<<"-a STRING           The Graphviz layout algorithm to use [default: dot ]"<<std::endl;
-    std::cout<<"-f STRING           The output format for the image, equivelent to the -T parameter of Graphviz executables [default: eps]"<<std::endl;
+	std::cout<<"-a STRING           The layout algorithm to use, either 'native' for the built in layered layout"<<std::endl;
+	std::cout<<"                    or one of the Graphviz layouts (dot, neato, fdp, sfdp, twopi, circo) [default: native ]"<<std::endl;
+    std::cout<<"-f STRING           The output format for the image, equivelent to the -T parameter of Graphviz executables."<<std::endl;
+    std::cout<<"                    The native layout can only create svg or png [default: svg]"<<std::endl;
+    std::cout<<"-e                  Expand chains.  By default runs of spacers without any branches are"<<std::endl;
+    std::cout<<"                    collapsed into a single node, use this to draw every spacer"<<std::endl;
+    std::cout<<"-C DIR              Cache directory.  Groups that have not changed since they were last drawn"<<std::endl;
+    std::cout<<"                    with the same options are copied from here instead of being drawn again"<<std::endl;
+    std::cout<<"-p FILE             Write every group into this one file instead of a file per group."<<std::endl;
+    std::cout<<"                    A name ending in .pdf gives a PDF with a page per group, .svg gives one"<<std::endl;
+    std::cout<<"                    SVG with the groups stacked on top of each other and anything else is a"<<std::endl;
+    std::cout<<"                    tar archive of images in the -f format with a table of contents (index.tsv)"<<std::endl;
     std::cout<<"-b INT              Number of colour bins"<<std::endl;
     std::cout<<"-c COLOUR           The colour scale to use for coverage information.  The available choices are:"<<std::endl;
     std::cout<<"                        red-blue"<<std::endl;
     std::cout<<"                        blue-red"<<std::endl;
     std::cout<<"                        red-blue-green"<<std::endl;
     std::cout<<"                        green-blue-red"<<std::endl;
+    std::cout<<"                        viridis"<<std::endl;
+    std::cout<<"                        cividis"<<std::endl;
+    std::cout<<"-G                  Use one colour scale for all groups in the file rather than one per group"<<std::endl;
 }
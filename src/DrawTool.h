@@ -17,17 +17,29 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef DRAWTOOL_H
+#define DRAWTOOL_H
+
+#include "config.h"
 #include <libcrispr/parser.h>
-#include "CrisprGraph.h"
+#include "SpacerGraph.h"
+#include "LayeredLayout.h"
+#include "NativeRenderer.h"
+#include "DrawCache.h"
+#include "CompositeWriter.h"
 #include "Rainbow.h"
+#include "Profile.h"
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
+#include "CrisprGraph.h"
 #include <graphviz/gvc.h>
+#endif
 #include <set>
 #include <string>
 #include <map>
 
-#ifndef DRAWTOOL_H
-#define DRAWTOOLS_H 
-typedef std::vector<crispr::graph * > graphVector;
+// the built in layered layout, which does not need Graphviz at all
+#define DT_NATIVE_ALGORITHM "native"
+
 class DrawTool {
     
     enum EDGE_DIRECTION {
@@ -35,14 +47,20 @@ class DrawTool {
         REVERSE = 1
     };
     
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
     GVC_t * DT_Gvc;
+#endif
     std::string DT_OutputFile;
     char * DT_RenderingAlgorithm;
     char * DT_OutputFormat;
     std::set<std::string> DT_Groups;
-    std::map<std::string, std::pair<bool, double> > DT_SpacerCoverage;
     bool DT_Subset;
-    graphVector DT_Graphs;
+    bool DT_Native;
+    bool DT_ExpandChains;
+    bool DT_GlobalScale;
+    DrawCache * DT_Cache;
+    std::string DT_CompositeFile;
+    CompositeWriter * DT_Composite;
     Rainbow DT_Rainbow;
     RB_TYPE DT_ColourType;
     int DT_Bins;
@@ -84,7 +102,16 @@ class DrawTool {
 public:
     DrawTool()
     {
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
         DT_Gvc = gvContext();
+#endif
+        DT_Native = true;
+        DT_ExpandChains = false;
+        DT_GlobalScale = false;
+        DT_Cache = NULL;
+        DT_Composite = NULL;
+        DT_RenderingAlgorithm = NULL;
+        DT_OutputFormat = NULL;
         DT_Subset = false;
         DT_LowerLimit = 10000000;
         DT_UpperLimit = 0;
@@ -96,26 +123,35 @@ public:
     ~DrawTool();
     
     
+#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
     inline GVC_t * getContext(void){return DT_Gvc;}
     
-    void layoutGraph(Agraph_t * g, char * a){gvLayout(DT_Gvc, g, a);}
-    void renderGraphToFile(Agraph_t * g, char * t, char * f){gvRenderFilename(DT_Gvc, g, t, f);}
+    void layoutGraph(Agraph_t * g, char * a){ProfileTimer timer(PF_LAYOUT); gvLayout(DT_Gvc, g, a);}
+    void renderGraphToFile(Agraph_t * g, char * t, char * f){ProfileTimer timer(PF_RENDER); gvRenderFilename(DT_Gvc, g, t, f);}
+    void renderGraphToData(Agraph_t * g, char * t, char ** d, unsigned int * l){ProfileTimer timer(PF_RENDER); gvRenderData(DT_Gvc, g, t, d, l);}
     void freeLayout(Agraph_t * g){gvFreeLayout(DT_Gvc, g);}
+    crispr::graph * buildGraphvizGraph(SpacerGraph * spacerGraph);
+#endif
+    void renderGroup(SpacerGraph * spacerGraph, std::string& fileName);
+    void addToComposite(SpacerGraph * spacerGraph);
+    void nodeColours(SpacerGraph * spacerGraph, std::vector<int>& colours);
     
     int processOptions(int argc, char ** argv);
     void generateGroupsFromString ( std::string str);
     int processInputFile(const char * inputFile);
+    bool wantGroup(xercesc::DOMElement * groupElement, crispr::xml::parser& xmlParser);
+    void prescanCoverage(xercesc::DOMElement * rootElement, crispr::xml::parser& xmlParser);
     void parseGroup(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser);
-    void parseData(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * current_graph);
-    void parseDrs(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * current_graph);
-    void parseSpacers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * current_graph);
-    void parseFlankers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * current_graph);
+    void parseData(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph);
+    void parseDrs(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph);
+    void parseSpacers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph);
+    void parseFlankers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph);
     
-    void parseAssembly(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * currentGraph);
-    void parseContig(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * currentGraph, std::string& contigId);
-    void parseCSpacer(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * currentGraph, Agnode_t * currentGraphvizNode, std::string& contigId);
-    void parseLinkSpacers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * currentGraph, Agnode_t * currentGraphvizNode, EDGE_DIRECTION edgeDirection, std::string& contigId);
-    void parseLinkFlankers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, crispr::graph * currentGraph, Agnode_t * currentGraphvizNode, EDGE_DIRECTION edgeDirection, std::string& contigId);
+    void parseAssembly(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph);
+    void parseContig(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph, std::string& contigId);
+    void parseCSpacer(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph, int currentNode, std::string& contigId);
+    void parseLinkSpacers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph, int currentNode, EDGE_DIRECTION edgeDirection, std::string& contigId);
+    void parseLinkFlankers(xercesc::DOMElement * parentNode, crispr::xml::parser& xmlParser, SpacerGraph * currentGraph, int currentNode, EDGE_DIRECTION edgeDirection, std::string& contigId);
 
 };
 
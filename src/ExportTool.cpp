@@ -0,0 +1,422 @@
+// ExportTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "ExportTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/reader.h>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <getopt.h>
+
+void ExportGroup::parseData(xercesc::DOMElement * dataElement, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * currentElement = dataElement->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacers())) {
+            parseSpacers(currentElement, xmlParser);
+        } else if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Flankers())) {
+            parseFlankers(currentElement, xmlParser);
+        }
+    }
+}
+
+void ExportGroup::parseSpacers(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacer())) {
+            char * c_spid = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
+            char * c_seq = tc(currentElement->getAttribute(xmlParser.attr_Seq()));
+            char * c_cov = tc(currentElement->getAttribute(xmlParser.attr_Cov()));
+            setNodeData(EG_Graph.internNode(c_spid, AssemblyGraph::SPACER), c_seq, c_cov);
+            xr(&c_spid);
+            xr(&c_seq);
+            xr(&c_cov);
+        }
+    }
+}
+
+void ExportGroup::parseFlankers(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser)
+{
+    for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Flanker())) {
+            char * c_flid = tc(currentElement->getAttribute(xmlParser.attr_Flid()));
+            char * c_seq = tc(currentElement->getAttribute(xmlParser.attr_Seq()));
+            setNodeData(EG_Graph.internNode(c_flid, AssemblyGraph::FLANKER), c_seq, NULL);
+            xr(&c_flid);
+            xr(&c_seq);
+        }
+    }
+}
+
+void ExportGroup::setNodeData(int id, char * sequence, char * coverage)
+{
+    // nodes from <data> are interned first so their ids are dense
+    if (id >= static_cast<int>(EG_Sequences.size())) {
+        EG_Sequences.resize(id + 1);
+        EG_Coverages.resize(id + 1);
+    }
+    EG_Sequences[id] = sequence;
+    if (coverage != NULL) {
+        EG_Coverages[id] = coverage;
+    }
+}
+
+ExportTool::~ExportTool()
+{
+    std::vector<ExportGroup *>::iterator iter;
+    for (iter = EX_Batch.begin(); iter != EX_Batch.end(); ++iter) {
+        delete *iter;
+    }
+}
+
+int ExportTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups", required_argument, NULL, 'g'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"threads", required_argument, NULL, 't'},
+        {"gfa", no_argument, NULL, 0},
+        {"gfa2", no_argument, NULL, 0},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hg:o:t:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                exportUsage();
+                exit(1);
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(EX_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, EX_Groups);
+                }
+                EX_Subset = true;
+                break;
+            }
+            case 'o':
+            {
+                EX_OutputFile = optarg;
+                break;
+            }
+            case 't':
+            {
+                EX_NumThreads = parseThreadCount(optarg);
+                break;
+            }
+            case 0:
+            {
+                if (!strcmp("gfa", long_options[index].name)) {
+                    EX_Format = GFA1;
+                } else if (!strcmp("gfa2", long_options[index].name)) {
+                    EX_Format = GFA2;
+                }
+                break;
+            }
+            default:
+            {
+                exportUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    if (EX_Format == NONE) {
+        throw crispr::input_exception("Please choose an output format");
+    }
+    return optind;
+}
+
+static inline void appendInt(std::string& out, int value)
+{
+    char buffer[16];
+    int length = sprintf(buffer, "%d", value);
+    out.append(buffer, length);
+}
+
+static inline void appendSegmentName(std::string& out, const ExportGroup& group, int id)
+{
+    out += group.graph().getName();
+    out += '_';
+    out += group.graph().nodeName(id);
+}
+
+void ExportTool::formatGfa1(const ExportGroup& group, std::string& out)
+{
+    const AssemblyGraph& graph = group.graph();
+    int num_nodes = graph.nodeCount();
+    for (int i = 0; i < num_nodes; ++i) {
+        const std::string& seq = group.sequence(i);
+        out += "S\t";
+        appendSegmentName(out, group, i);
+        out += '\t';
+        if (seq.empty()) {
+            out += '*';
+        } else {
+            out += seq;
+            out += "\tLN:i:";
+            appendInt(out, static_cast<int>(seq.length()));
+        }
+        if (!group.coverage(i).empty()) {
+            out += "\tDP:f:";
+            out += group.coverage(i);
+        }
+        out += '\n';
+    }
+
+    // spacers are separated by a repeat rather than overlapping
+    for (int i = 0; i < num_nodes; ++i) {
+        for (const int * iter = graph.outBegin(i); iter != graph.outEnd(i); ++iter) {
+            out += "L\t";
+            appendSegmentName(out, group, i);
+            out += "\t+\t";
+            appendSegmentName(out, group, *iter);
+            out += "\t+\t0M\n";
+        }
+    }
+}
+
+void ExportTool::formatGfa2(const ExportGroup& group, std::string& out)
+{
+    const AssemblyGraph& graph = group.graph();
+    int num_nodes = graph.nodeCount();
+    for (int i = 0; i < num_nodes; ++i) {
+        const std::string& seq = group.sequence(i);
+        out += "S\t";
+        appendSegmentName(out, group, i);
+        out += '\t';
+        appendInt(out, static_cast<int>(seq.length()));
+        out += '\t';
+        out += (seq.empty()) ? "*" : seq;
+        if (!group.coverage(i).empty()) {
+            out += "\tDP:f:";
+            out += group.coverage(i);
+        }
+        out += '\n';
+    }
+
+    // a zero length overlap at the end of the tail and the start of the head
+    for (int i = 0; i < num_nodes; ++i) {
+        int tail_length = static_cast<int>(group.sequence(i).length());
+        for (const int * iter = graph.outBegin(i); iter != graph.outEnd(i); ++iter) {
+            out += "E\t*\t";
+            appendSegmentName(out, group, i);
+            out += "+\t";
+            appendSegmentName(out, group, *iter);
+            out += "+\t";
+            appendInt(out, tail_length);
+            out += "$\t";
+            appendInt(out, tail_length);
+            out += "$\t0\t0\t*\n";
+        }
+    }
+
+    // keep the segments of each group together
+    if (num_nodes) {
+        out += "U\t";
+        out += graph.getName();
+        out += '\t';
+        for (int i = 0; i < num_nodes; ++i) {
+            if (i) {
+                out += ' ';
+            }
+            appendSegmentName(out, group, i);
+        }
+        out += '\n';
+    }
+}
+
+// the groups, the format and a buffer for each group's text
+typedef struct __ExportBatch {
+    std::vector<ExportGroup *> * groups;
+    std::vector<std::string> * buffers;
+    ExportTool::EXPORT_FORMAT format;
+} ExportBatch;
+
+static void formatBatchItem(int index, void * arg)
+{
+    ExportBatch * batch = static_cast<ExportBatch *>(arg);
+    ExportGroup * group = (*batch->groups)[index];
+    std::string& buffer = (*batch->buffers)[index];
+    TraceSpan span;
+    if (TR_Enabled) {
+        span.startGroup("format", group->graph().getName(), group->graph().nodeCount());
+    }
+    group->graph().finalise();
+    if (batch->format == ExportTool::GFA2) {
+        ExportTool::formatGfa2(*group, buffer);
+    } else {
+        ExportTool::formatGfa1(*group, buffer);
+    }
+}
+
+void ExportTool::flushBatch(std::ostream& out)
+{
+    std::vector<std::string> buffers(EX_Batch.size());
+    ExportBatch batch;
+    batch.groups = &EX_Batch;
+    batch.buffers = &buffers;
+    batch.format = EX_Format;
+    parallelFor(static_cast<int>(EX_Batch.size()), EX_NumThreads, formatBatchItem, &batch);
+
+    // write in the order the groups appear in the file
+    for (size_t i = 0; i < EX_Batch.size(); ++i) {
+        out.write(buffers[i].data(), buffers[i].length());
+        delete EX_Batch[i];
+    }
+    EX_Batch.clear();
+}
+
+void ExportTool::printHeader(std::ostream& out)
+{
+    out<<"H\tVN:Z:"<<((EX_Format == GFA2) ? "2.0" : "1.0")<<"\n";
+}
+
+int ExportTool::processInputFile(const char * inputFile)
+{
+    try {
+        crispr::xml::reader xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        std::vector<char> file_buffer;
+        std::ofstream out_file_stream;
+        if (!EX_OutputFile.empty()) {
+            file_buffer.resize(EX_BUFFER_SIZE);
+            out_file_stream.rdbuf()->pubsetbuf(&file_buffer[0], file_buffer.size());
+            out_file_stream.open(EX_OutputFile.c_str(), std::ios::binary);
+            if (!out_file_stream.good()) {
+                throw crispr::input_exception("cannot open output file");
+            }
+        }
+        std::ostream& out = (EX_OutputFile.empty()) ? std::cout : out_file_stream;
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        printHeader(out);
+
+        //-----
+        // One pass over each group copies the sequences from <data> and the
+        // links from <assembly> out of the DOM.  Formatting the text is
+        // done a batch at a time on all of the threads
+        //
+        int num_groups_to_process = static_cast<int>(EX_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (EX_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (EX_Subset) {
+                if (EX_Groups.find(group_id.substr(1)) == EX_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+
+            ExportGroup * group = new ExportGroup(group_id);
+            EX_Batch.push_back(group);
+            for (xercesc::DOMElement * groupChild = currentElement->getFirstElementChild();
+                 groupChild != NULL;
+                 groupChild = groupChild->getNextElementSibling()) {
+                if (xercesc::XMLString::equals(groupChild->getTagName(), xml_parser.tag_Data())) {
+                    group->parseData(groupChild, xml_parser);
+                } else if (xercesc::XMLString::equals(groupChild->getTagName(), xml_parser.tag_Assembly())) {
+                    group->graph().parseAssembly(groupChild, xml_parser);
+                }
+            }
+            if (EX_Batch.size() >= EX_BATCH_SIZE) {
+                flushBatch(out);
+            }
+        }
+        flushBatch(out);
+        out.flush();
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int exportMain(int argc, char ** argv)
+{
+    try {
+        ExportTool et;
+        int opt_index = et.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        } else {
+            return et.processInputFile(argv[opt_index]);
+        }
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        exportUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void exportUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" export [-h] [-g INT[,n]] [-o FILE] [-t INT] --gfa|--gfa2 file.crispr"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to export"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: print to screen]"<<std::endl;
+    std::cout<<"-t INT              number of threads, 0 uses every processor [default: "<<PL_DEFAULT_THREADS<<"]"<<std::endl;
+    std::cout<<"--gfa               write the spacer graphs in GFA 1.0"<<std::endl;
+    std::cout<<"--gfa2              write the spacer graphs in GFA 2.0"<<std::endl;
+}
@@ -0,0 +1,101 @@
+/*
+ * ExportTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_ExportTool_h
+#define crisprtools_ExportTool_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <iostream>
+#include <libcrispr/base.h>
+#include "AssemblyGraph.h"
+#include "Parallel.h"
+
+#define EX_BATCH_SIZE 1024          // groups held in memory before they are formatted and written
+#define EX_BUFFER_SIZE 1048576      // size of the output file buffer
+
+// everything needed to write one group, copied out of the DOM so that
+// groups can be formatted on any thread
+class ExportGroup {
+public:
+    ExportGroup(std::string gid) : EG_Graph(gid) {}
+
+    inline AssemblyGraph& graph(void) {return EG_Graph;}
+    inline const AssemblyGraph& graph(void) const {return EG_Graph;}
+
+    // sequence and coverage of a node, empty if <data> didn't give one
+    inline const std::string& sequence(int id) const {return (id < static_cast<int>(EG_Sequences.size())) ? EG_Sequences[id] : EG_Empty;}
+    inline const std::string& coverage(int id) const {return (id < static_cast<int>(EG_Coverages.size())) ? EG_Coverages[id] : EG_Empty;}
+
+    void parseData(xercesc::DOMElement * dataElement, crispr::xml::base& xmlParser);
+
+private:
+    void parseSpacers(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser);
+    void parseFlankers(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser);
+    void setNodeData(int id, char * sequence, char * coverage);
+
+    AssemblyGraph EG_Graph;
+    std::vector<std::string> EG_Sequences;
+    std::vector<std::string> EG_Coverages;
+    std::string EG_Empty;
+};
+
+class ExportTool {
+public:
+    enum EXPORT_FORMAT {
+        NONE,
+        GFA1,
+        GFA2
+    };
+
+    ExportTool()
+    {
+        EX_Subset = false;
+        EX_Format = NONE;
+        EX_NumThreads = PL_DEFAULT_THREADS;
+    }
+    ~ExportTool();
+
+    int processOptions(int argc, char ** argv);
+    int processInputFile(const char * inputFile);
+
+    // append one group in GFA to out.  Segment names are prefixed with
+    // the group id so that several groups can share a file
+    static void formatGfa1(const ExportGroup& group, std::string& out);
+    static void formatGfa2(const ExportGroup& group, std::string& out);
+
+    inline EXPORT_FORMAT getFormat(void) const {return EX_Format;}
+
+private:
+    void flushBatch(std::ostream& out);
+    void printHeader(std::ostream& out);
+
+    std::set<std::string> EX_Groups;
+    bool EX_Subset;
+    std::string EX_OutputFile;
+    EXPORT_FORMAT EX_Format;
+    int EX_NumThreads;
+
+    std::vector<ExportGroup *> EX_Batch;
+};
+
+int exportMain(int argc, char ** argv);
+void exportUsage(void);
+#endif
@@ -17,10 +17,12 @@
 #include "ExtractTool.h"
 #include "Utils.h"
 #include "config.h"
+#include "Profile.h"
 #include <libcrispr/Exception.h>
 #include <libcrispr/StlExt.h>
 #include <libcrispr/reader.h>
 #include <getopt.h>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -36,10 +38,18 @@ ExtractTool::ExtractTool (void)
     ET_OutputPrefix = "./";
     ET_OutputNamePrefix = "";
     ET_OutputHeaderPrefix = "";
+    ET_NumThreads = PL_DEFAULT_THREADS;
+    ET_NumShards = 0;
+    ET_UniqueSpacers = false;
 }
 
 ExtractTool::~ExtractTool (void)
-{}
+{
+    std::vector<ContigArrays *>::iterator iter;
+    for (iter = ET_ArrayBatch.begin(); iter != ET_ArrayBatch.end(); ++iter) {
+        delete *iter;
+    }
+}
 
 //void ExtractTool::generateGroupsFromString ( std::string str)
 //{
@@ -49,13 +59,14 @@ ExtractTool::~ExtractTool (void)
 //	// set the 'do subset' bit
 //    ET_BitMask.set(0);
 //}
-void ExtractTool::setOutputBuffer(std::ofstream& out, const char * file) {
+void ExtractTool::setOutputBuffer(FastaSink& out, const char * file) {
     if (NULL != file) {
         // has argument
         // open output buffer
         std::string filename = ET_OutputPrefix + ET_OutputHeaderPrefix + file;
-        out.open(filename.c_str());
-        if (!out) {
+        try {
+            out.open(filename);
+        } catch (crispr::runtime_exception& e) {
             std::stringstream msg;
             msg << "failed to open output file: " << filename <<"\n";
             msg << "Make sure that the path exists and remember ";
@@ -68,17 +79,20 @@ void ExtractTool::setOutputBuffer(std::ofstream& out, const char * file) {
         }
     } else {
         //default stream
-        out.std::basic_ios<char>::rdbuf(std::cout.rdbuf());
+        if (!ET_StdoutSink.isOpen()) {
+            ET_StdoutSink.openStdout();
+        }
     }
 }
 int ExtractTool::processOptions (int argc, char ** argv)
 {
-	char * dr_file; char * spacer_file; char * flanker_file;
-    dr_file = NULL; spacer_file = NULL; flanker_file = NULL;
-    bool dr, flanker, spacer;
-    dr = flanker = spacer = false;
+	char * dr_file; char * spacer_file; char * flanker_file; char * array_file;
+    dr_file = NULL; spacer_file = NULL; flanker_file = NULL; array_file = NULL;
+    bool dr, flanker, spacer, array;
+    dr = flanker = spacer = array = false;
     int c;
     int index;
+    int max_open = FP_DEFAULT_MAX_OPEN;
     static struct option long_options [] = {       
         {"help", no_argument, NULL, 'h'},
         {"header-prefix", required_argument, NULL, 'H'},
@@ -86,15 +100,35 @@ int ExtractTool::processOptions (int argc, char ** argv)
         {"spacer",optional_argument,NULL,'s'},
         {"direct-repeat", optional_argument, NULL, 'd'},
         {"flanker", optional_argument, NULL, 'f'},
+        {"array", optional_argument, NULL, 'a'},
+        {"threads", required_argument, NULL, 't'},
         {"split-group", no_argument, NULL, 'x'},
+        {"shards", required_argument, NULL, 0},
+        {"max-open", required_argument, NULL, 0},
+        {"unique", no_argument, NULL, 0},
         {"outfile-prefix",required_argument,NULL, 'o'},
         {"outfile-dir",required_argument,NULL,'O'},
         {0,0,0,0}
     };
-	while((c = getopt_long(argc, argv, "hH:g:Cs::d::f::xyo:O:", long_options, &index)) != -1)
+	while((c = getopt_long(argc, argv, "hH:g:Cs::d::f::a::t:xyo:O:", long_options, &index)) != -1)
 	{
         switch(c)
 		{
+            case 0:
+            {
+                if (!strcmp("shards", long_options[index].name)) {
+                    if (!from_string<int>(ET_NumShards, optarg, std::dec) || ET_NumShards < 1) {
+                        throw crispr::input_exception("The number of shards must be a positive number");
+                    }
+                } else if (!strcmp("max-open", long_options[index].name)) {
+                    if (!from_string<int>(max_open, optarg, std::dec) || max_open < 1 || max_open > FP_MAX_OPEN) {
+                        throw crispr::input_exception("The number of open files must be between 1 and 1024");
+                    }
+                } else if (!strcmp("unique", long_options[index].name)) {
+                    ET_UniqueSpacers = true;
+                }
+                break;
+            }
 			case 'C':
             {
                 ET_BitMask.reset(6);
@@ -142,6 +176,18 @@ int ExtractTool::processOptions (int argc, char ** argv)
                 flanker = true;
                 flanker_file = optarg;
                 ET_BitMask.set(3);
+                break;
+			}
+			case 'a':
+			{
+                array = true;
+                array_file = optarg;
+                ET_BitMask.set(7);
+                break;
+			}
+			case 't':
+			{
+                ET_NumThreads = parseThreadCount(optarg);
                 break;
 			}
 			case 'x':
@@ -179,10 +225,20 @@ int ExtractTool::processOptions (int argc, char ** argv)
             }
 		}
 	}
-    if (!(ET_BitMask[3] | ET_BitMask[4] | ET_BitMask[5])) {
-        throw crispr::input_exception("Please specify at least one of -s -d -f");
+    if (!(ET_BitMask[3] | ET_BitMask[4] | ET_BitMask[5] | ET_BitMask[7])) {
+        throw crispr::input_exception("Please specify at least one of -s -d -f -a");
     }
-    if (! ET_BitMask[2]) {
+    if (ET_NumShards && ! ET_BitMask[2]) {
+        throw crispr::input_exception("--shards can only be used with -x");
+    }
+    if (ET_UniqueSpacers && (! ET_BitMask[4] || ET_BitMask[2])) {
+        throw crispr::input_exception("--unique needs -s and can't be used with -x");
+    }
+    ET_FilePool.setMaxOpen(max_open);
+    ET_SpacerSet.setNumThreads(ET_NumThreads);
+    if (ET_NumShards) {
+        ET_IndexSink.open(ET_OutputPrefix + ET_OutputNamePrefix + "index.tsv");
+    } else if (! ET_BitMask[2]) {
         if (dr) {
             setOutputBuffer(ET_RepeatStream, dr_file);
         }
@@ -192,6 +248,9 @@ int ExtractTool::processOptions (int argc, char ** argv)
         if (flanker) {
             setOutputBuffer(ET_FlankerStream, flanker_file);
         }
+        if (array) {
+            setOutputBuffer(ET_ArrayStream, array_file);
+        }
     }
 	return optind;
 }
@@ -201,7 +260,7 @@ int ExtractTool::processInputFile(const char * inputFile)
     // open the file
     crispr::xml::reader xml_obj;
     try {
-        xercesc::DOMDocument * xml_doc = xml_obj.setFileParser(inputFile);
+        xercesc::DOMDocument * xml_doc = profiledParse(xml_obj, inputFile);
         
         xercesc::DOMElement * root_elem = xml_doc->getDocumentElement();
         
@@ -209,8 +268,22 @@ int ExtractTool::processInputFile(const char * inputFile)
                                                      __LINE__, 
                                                      __PRETTY_FUNCTION__, 
                                                      "empty XML document" ));
+
+        ProfileTimer walk_timer(PF_WALK);
         
         parseWantedGroups(xml_obj, root_elem);
+        if (ET_UniqueSpacers) {
+            ET_SpacerSet.write(sinkFor(ET_SpacerStream), ET_OutputHeaderPrefix);
+        }
+
+        // nothing is written until the buffers fill up or the sinks are closed
+        ET_RepeatStream.close();
+        ET_SpacerStream.close();
+        ET_FlankerStream.close();
+        ET_ArrayStream.close();
+        ET_StdoutSink.close();
+        ET_FilePool.closeAll();
+        ET_IndexSink.close();
         
     } catch( xercesc::XMLException& e ) {
         char* message = xercesc::XMLString::transcode( e.getMessage() );
@@ -229,30 +302,52 @@ int ExtractTool::processInputFile(const char * inputFile)
 
     return 0;
 }
-void ExtractTool::closeStream()
+FastaSink& ExtractTool::outputFor(FastaSink& sink, const std::string& gid, const char * typeName)
 {
-    if (ET_BitMask[4]) {
-        ET_SpacerStream.close();
-    }
-    if (ET_BitMask[5]) {
-        ET_RepeatStream.close();
+    if (! ET_BitMask[2]) {
+        return sinkFor(sink);
     }
-    if (ET_BitMask[3]) {
-        ET_FlankerStream.close();
+    if (ET_NumShards) {
+        return ET_FilePool.get(ET_OutputPrefix + shardName(gid));
     }
+    return ET_FilePool.get(ET_OutputPrefix + ET_OutputNamePrefix + gid + "_" + typeName + ".fa");
 }
-void ExtractTool::openStream(std::string& groupId)
+
+std::string ExtractTool::shardName(const std::string& gid)
 {
-    if (ET_BitMask[4]) {
-        ET_SpacerStream.open((ET_OutputPrefix +ET_OutputNamePrefix+ groupId + "_spacers.fa").c_str());
-    }
-    if (ET_BitMask[5]) {
-        ET_RepeatStream.open((ET_OutputPrefix +ET_OutputNamePrefix+ groupId + "_direct_repeats.fa").c_str());
+    // 32 bit FNV-1a of the group id
+    unsigned int hash = 2166136261u;
+    for (std::string::const_iterator iter = gid.begin(); iter != gid.end(); ++iter) {
+        hash ^= static_cast<unsigned char>(*iter);
+        hash *= 16777619u;
     }
-    if (ET_BitMask[3]) {
-        ET_FlankerStream.open((ET_OutputPrefix +ET_OutputNamePrefix+ groupId + "_flankers.fa").c_str());
+    return ET_OutputNamePrefix + "shard_" + to_string(hash % static_cast<unsigned int>(ET_NumShards)) + ".fa";
+}
+
+void ExtractTool::indexRange(const std::string& gid, const char * typeName, FastaSink& out, off_t start)
+{
+    off_t end = out.offset();
+    if (! ET_NumShards || end == start) {
+        return;
     }
+    std::stringstream line;
+    line<<gid<<'\t'<<typeName<<'\t'<<shardName(gid)<<'\t'<<start<<'\t'<<(end - start)<<'\n';
+    ET_IndexSink.write(line.str());
 }
+
+void ExtractTool::extractType(crispr::xml::base& xmlDoc,
+                              xercesc::DOMElement * currentType,
+                              ELEMENT_TYPE wantedType,
+                              const std::string& gid,
+                              FastaSink& sink,
+                              const char * typeName)
+{
+    FastaSink& out_stream = outputFor(sink, gid, typeName);
+    off_t start = out_stream.offset();
+    processData(xmlDoc, currentType, wantedType, gid, out_stream);
+    indexRange(gid, typeName, out_stream, start);
+}
+
 void ExtractTool::parseWantedGroups(crispr::xml::base& xmlObj, 
                                     xercesc::DOMElement * rootElement)
 {
@@ -262,6 +357,7 @@ void ExtractTool::parseWantedGroups(crispr::xml::base& xmlObj,
         for (xercesc::DOMElement * currentElement = rootElement->getFirstElementChild(); 
              currentElement != NULL; 
              currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
             // break if we have processed all of the wanted groups
             if(ET_BitMask[0] && num_groups_to_process == 0) {
                 break;
@@ -276,21 +372,17 @@ void ExtractTool::parseWantedGroups(crispr::xml::base& xmlObj,
                     continue;
                 }
                 
-                if (ET_BitMask[2]) openStream(group_id);
-                
                 extractDataFromGroup(xmlObj, currentElement);
                 
                 if(ET_BitMask[0]) num_groups_to_process--;
-                
-                if(ET_BitMask[2]) closeStream();
             } else {
-                if (ET_BitMask[2]) openStream(group_id);
-                
                 extractDataFromGroup(xmlObj, currentElement);
-                
-                if(ET_BitMask[2]) closeStream();
+            }
+            if (ET_ArrayBatch.size() >= ET_ARRAY_BATCH_SIZE) {
+                flushArrays();
             }
         }
+        flushArrays();
     } catch( xercesc::XMLException& e ) {
         char* message = xercesc::XMLString::transcode( e.getMessage() );
         std::stringstream errBuf;
@@ -303,6 +395,9 @@ void ExtractTool::parseWantedGroups(crispr::xml::base& xmlObj,
     } catch (crispr::xml_exception& xe) {
         std::cerr<< xe.what()<<std::endl;
         return;
+    } catch (crispr::runtime_exception&) {
+        // an output file that can't be opened or written fails the run
+        throw;
     } catch (std::exception& e) {
         std::cerr<<e.what()<<std::endl;
     }
@@ -314,6 +409,15 @@ void ExtractTool::extractDataFromGroup(crispr::xml::base& xmlDoc,
     // get the first child - the data element
     try {
 		char * c_gid = tc(currentGroup->getAttribute(xmlDoc.attr_Gid()));
+		std::string gid = c_gid;
+		xr(&c_gid);
+		ContigArrays * arrays = NULL;
+		if (ET_BitMask[7]) {
+			char * c_drseq = tc(currentGroup->getAttribute(xmlDoc.attr_Drseq()));
+			arrays = new ContigArrays(gid, c_drseq);
+			ET_ArrayBatch.push_back(arrays);
+			xr(&c_drseq);
+		}
 		for (xercesc::DOMElement * current_element = currentGroup->getFirstElementChild();
 		     current_element != NULL;
 		     current_element = current_element->getNextElementSibling()) {
@@ -327,23 +431,40 @@ void ExtractTool::extractDataFromGroup(crispr::xml::base& xmlDoc,
 							  if (xercesc::XMLString::equals(data_child->getTagName(), xmlDoc.tag_Drs())) {
 								  if (ET_BitMask[5]) {
 									  // get direct repeats
-									  processData(xmlDoc, data_child, REPEAT, c_gid, ET_RepeatStream);
+									  extractType(xmlDoc, data_child, REPEAT, gid, ET_RepeatStream, "direct_repeats");
 								  }
 							  } else if (xercesc::XMLString::equals(data_child->getTagName(), xmlDoc.tag_Spacers())) {
-								  if (ET_BitMask[4]) {
+								  if (ET_UniqueSpacers) {
+									  addUniqueSpacers(xmlDoc, data_child, gid);
+								  } else if (ET_BitMask[4]) {
 									  // get spacers
-									  processData(xmlDoc, data_child, SPACER, c_gid, ET_SpacerStream);
+									  extractType(xmlDoc, data_child, SPACER, gid, ET_SpacerStream, "spacers");
+								  }
+								  if (arrays != NULL) {
+									  // remember the spacer sequences for the contigs
+									  arrays->parseSpacers(data_child, xmlDoc);
 								  }
 							  } else if (xercesc::XMLString::equals(data_child->getTagName(), xmlDoc.tag_Flankers())) {
 								  if (ET_BitMask[3]) {
 									  // get flankers
-									  processData(xmlDoc, data_child, FLANKER, c_gid, ET_FlankerStream);
+									  extractType(xmlDoc, data_child, FLANKER, gid, ET_FlankerStream, "flankers");
 								  }
 							  }
 						  }
+				 } else if (arrays != NULL && xercesc::XMLString::equals(current_element->getTagName(), xmlDoc.tag_Assembly())) {
+					 try {
+						 arrays->parseAssembly(current_element, xmlDoc);
+					 } catch (crispr::xml_exception& xe) {
+						 // the rest of the group is still extracted, only
+						 // its arrays are left out.  It was the last one added
+						 std::cerr<<xe.what()<<std::endl;
+						 std::cerr<<"Not writing the arrays of group "<<gid<<std::endl;
+						 ET_ArrayBatch.pop_back();
+						 delete arrays;
+						 arrays = NULL;
+					 }
 				 }
 			 }
-		xr(&c_gid);
     } catch( xercesc::XMLException& e ) {
         char* message = xercesc::XMLString::transcode( e.getMessage() );
         std::ostringstream errBuf;
@@ -355,11 +476,59 @@ void ExtractTool::extractDataFromGroup(crispr::xml::base& xmlDoc,
     }
 }
 
+void ExtractTool::addUniqueSpacers(crispr::xml::base& xmlDoc,
+                                   xercesc::DOMElement * currentType,
+                                   const std::string& gid)
+{
+    for (xercesc::DOMElement * currentElement = currentType->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        char * c_seq = tc(currentElement->getAttribute(xmlDoc.attr_Seq()));
+        char * c_id = tc(currentElement->getAttribute(xmlDoc.attr_Spid()));
+        ET_SpacerSet.add(gid, c_id, c_seq);
+        xr(&c_id);
+        xr(&c_seq);
+    }
+}
+
+// the array sequences are built for a batch of groups at once
+static void buildArraysItem(int index, void * arg)
+{
+    std::vector<ContigArrays *> * batch = static_cast<std::vector<ContigArrays *> *>(arg);
+    TraceSpan span;
+    if (TR_Enabled) {
+        span.startGroup("build_arrays", (*batch)[index]->getGid(), (*batch)[index]->spacerCount());
+    }
+    (*batch)[index]->build();
+}
+
+void ExtractTool::flushArrays()
+{
+    parallelFor(static_cast<int>(ET_ArrayBatch.size()), ET_NumThreads, buildArraysItem, &ET_ArrayBatch);
+
+    std::vector<ContigArrays *>::iterator iter;
+    for (iter = ET_ArrayBatch.begin(); iter != ET_ArrayBatch.end(); ++iter) {
+        FastaSink& out_stream = outputFor(ET_ArrayStream, (*iter)->getGid(), "arrays");
+        off_t start = out_stream.offset();
+        for (int i = 0; i < (*iter)->recordCount(); ++i) {
+            out_stream.put('>');
+            out_stream.write(ET_OutputHeaderPrefix);
+            out_stream.write((*iter)->header(i));
+            out_stream.put('\n');
+            out_stream.write((*iter)->sequence(i));
+            out_stream.put('\n');
+        }
+        indexRange((*iter)->getGid(), "arrays", out_stream, start);
+        delete *iter;
+    }
+    ET_ArrayBatch.clear();
+}
+
 void ExtractTool::processData(crispr::xml::base& xmlDoc, 
                               xercesc::DOMElement * currentType, 
                               ELEMENT_TYPE wantedType, 
                               std::string gid, 
-                              std::ostream& outStream)
+                              FastaSink& outStream)
 {
     try {
         for (xercesc::DOMElement * currentElement = currentType->getFirstElementChild(); 
@@ -408,7 +577,7 @@ void ExtractTool::processData(crispr::xml::base& xmlDoc,
                     break;
                 }
             }
-            outStream<<'>'<<ET_OutputHeaderPrefix<<gid<<id<<std::endl<<c_seq<<std::endl;
+            outStream.writeRecord(ET_OutputHeaderPrefix, gid, id, c_seq);
             xr(&c_seq);
         }
     } catch( xercesc::XMLException& e ) {
@@ -423,9 +592,6 @@ void ExtractTool::processData(crispr::xml::base& xmlDoc,
     } catch (crispr::xml_exception& xe) {
         std::cerr<< xe.what()<<std::endl;
         return;
-    } catch (crispr::runtime_exception& re) {
-        std::cerr<<re.what()<<std::endl;
-        return;
     }
 }
 
@@ -473,11 +639,22 @@ void extractUsage (void)
     std::cout<<"                                 prints to stdout however an output file can also be given as an optional arguement\n";
 	std::cout<<"-f[FILE] --flanker[=FILE]        Extract the flanking sequences of the listed group. By default\n";
     std::cout<<"                                 prints to stdout however an output file can also be given as an optional arguement\n";
+    std::cout<<"-a[FILE] --array[=FILE]          Extract the sequence of the CRISPR array in each contig, made by joining the\n";
+    std::cout<<"                                 spacers of the contig and the consensus repeat in the order of their links\n";
+    std::cout<<"--unique                         With -s, write each distinct spacer once.  A spacer and its reverse complement\n";
+    std::cout<<"                                 are the same spacer, the header gives the first occurrence, the number of\n";
+    std::cout<<"                                 occurrences and the groups it was found in\n";
+    std::cout<<"-t INT --threads INT             Number of threads used to build the arrays or find the unique spacers,\n";
+    std::cout<<"                                 0 uses every processor [default: 1]\n";
     std::cout<<"-C                               Supress coverage information when printing spacers"<<std::endl;
     std::cout<<"-H STRING --header-prefix STRING Print a prefix to each of the headers [default: ""]"<<std::endl;
     std::cout<<"-x --split-group                 Split the results into different files for each group.  File names"<<std::endl;
     std::cout<<"                                 specified with -s -d -f will not be used in this mode but instead\n";
     std::cout<<"                                 output files will take the form of PREFIX_GROUP_[type].fa"<<std::endl;
+    std::cout<<"--shards INT                     With -x, write the groups into INT files named PREFIXshard_N.fa instead of a\n";
+    std::cout<<"                                 set of files for each group.  PREFIXindex.tsv gives the group, type, shard file,\n";
+    std::cout<<"                                 byte offset and length of each block of records\n";
+    std::cout<<"--max-open INT                   Number of output files kept open at once with -x [default: 64]"<<std::endl;
 }
 				
 				
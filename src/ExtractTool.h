@@ -24,7 +24,15 @@
 #include <iostream>
 #include <fstream>
 #include <bitset>
+#include <vector>
 #include <libcrispr/base.h>
+#include "ContigArrays.h"
+#include "FastaSink.h"
+#include "FilePool.h"
+#include "SpacerSet.h"
+#include "Parallel.h"
+
+#define ET_ARRAY_BATCH_SIZE 1024    // groups held in memory before their arrays are built and written
 
 
 
@@ -41,39 +49,68 @@ public:
     // option processing
     //void generateGroupsFromString( std::string groupString);
     int processOptions(int argc, char ** argv);
-    void setOutputBuffer(std::ofstream& out, const char * file);
+    void setOutputBuffer(FastaSink& out, const char * file);
     // process the input
     int processInputFile(const char * inputFile);
     void parseWantedGroups(crispr::xml::base& xmlObj, xercesc::DOMElement * rootElement);
     void extractDataFromGroup(crispr::xml::base& xmlDoc, xercesc::DOMElement * currentGroup);
-    void processData(crispr::xml::base& xmlDoc, xercesc::DOMElement * currentType, ELEMENT_TYPE wantedType, std::string gid, std::ostream& outStream);
+    void processData(crispr::xml::base& xmlDoc, xercesc::DOMElement * currentType, ELEMENT_TYPE wantedType, std::string gid, FastaSink& outStream);
 private:
-        
-    void closeStream();
-    void openStream(std::string& groupId);
+    // build the arrays of the groups read so far on all of the threads and write them out
+    void flushArrays();
+
+    // write one type of element from a group to wherever it belongs
+    void extractType(crispr::xml::base& xmlDoc, xercesc::DOMElement * currentType, ELEMENT_TYPE wantedType, const std::string& gid, FastaSink& sink, const char * typeName);
+
+    // add the spacers of a group to the set of distinct spacers
+    void addUniqueSpacers(crispr::xml::base& xmlDoc, xercesc::DOMElement * currentType, const std::string& gid);
+
+    // types without a file of their own share the one stdout sink so
+    // that records from different types don't get mixed mid-record
+    inline FastaSink& sinkFor(FastaSink& sink){return (sink.isOpen()) ? sink : ET_StdoutSink;}
+
+    // the sink for a type of data from a group.  In split group mode this
+    // is the group's own file or its shard, taken from the file pool
+    FastaSink& outputFor(FastaSink& sink, const std::string& gid, const char * typeName);
+
+    // name of the shard file that a group is written to, relative to the output directory
+    std::string shardName(const std::string& gid);
+
+    // add the bytes written to out since start to the shard index
+    void indexRange(const std::string& gid, const char * typeName, FastaSink& out, off_t start);
     
         std::set<std::string> ET_Group;             // holds a comma separated list of groups that need to be extracted
-        std::ofstream ET_RepeatStream;
-        std::ofstream ET_FlankerStream;
-        std::ofstream ET_SpacerStream;
+        FastaSink ET_RepeatStream;
+        FastaSink ET_FlankerStream;
+        FastaSink ET_ArrayStream;
+        FastaSink ET_SpacerStream;
+        FastaSink ET_StdoutSink;
+        FastaSink ET_IndexSink;
+        FilePool ET_FilePool;                       // per group or shard files in split group mode
+        int ET_NumShards;                           // 0 gives every group its own files
+        bool ET_UniqueSpacers;                      // only write each distinct spacer once, after reading every group
+        SpacerSet ET_SpacerSet;
         std::ofstream ET_OneStream;
         std::ofstream ET_GroupStream;
         std::string ET_OutputPrefix;
         std::string ET_OutputHeaderPrefix;
         std::string ET_OutputNamePrefix;
-        std::bitset<7> ET_BitMask;
+        int ET_NumThreads;
+        std::vector<ContigArrays *> ET_ArrayBatch;
+        std::bitset<8> ET_BitMask;
 /*
         each bit is for a different option:
-bit pos:  6543210
-          0000000
-          |||||||
-          ||||||------- a subset of the groups is wanted
-          |||||-------- print different types of data (spacers, dr, flanker) into separate files
-          ||||--------- print results from a different group into separate files
-          |||---------- extract flanking sequences
-          ||----------- extract spacer sequences
-          |------------ extract direct repeat sequences
-          ------------- print coverage information if extracting spacers
+bit pos: 76543210
+         00000000
+         ||||||||
+         |||||||------- a subset of the groups is wanted
+         ||||||-------- print different types of data (spacers, dr, flanker) into separate files
+         |||||--------- print results from a different group into separate files
+         ||||---------- extract flanking sequences
+         |||----------- extract spacer sequences
+         ||------------ extract direct repeat sequences
+         |------------- print coverage information if extracting spacers
+         -------------- extract the array sequence of each contig
  */
 };
 
@@ -0,0 +1,302 @@
+// FastaSink.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FastaSink.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+FastaSink::FastaSink(size_t bufferSize)
+{
+    FS_BufferSize = bufferSize;
+    FS_Fd = -1;
+    FS_OwnFd = false;
+    for (int i = 0; i < FS_BUFFER_COUNT; ++i) {
+        FS_Buffers[i] = NULL;
+        FS_Used[i] = 0;
+    }
+    FS_Cursor = NULL;
+    FS_Space = 0;
+    FS_Flushed = 0;
+    FS_Opened = 0;
+    FS_Submitted = 0;
+    FS_Written = 0;
+    FS_Error = 0;
+#if HAVE_PTHREAD
+    pthread_mutex_init(&FS_Lock, NULL);
+    pthread_cond_init(&FS_Changed, NULL);
+    FS_ThreadRunning = false;
+    FS_Stop = false;
+#endif
+}
+
+FastaSink::~FastaSink()
+{
+    try {
+        close();
+    } catch (crispr::exception& e) {
+        std::cerr<<e.what()<<std::endl;
+    }
+    for (int i = 0; i < FS_BUFFER_COUNT; ++i) {
+        free(FS_Buffers[i]);
+    }
+#if HAVE_PTHREAD
+    pthread_mutex_destroy(&FS_Lock);
+    pthread_cond_destroy(&FS_Changed);
+#endif
+}
+
+void FastaSink::open(const std::string& fileName, bool append)
+{
+    close();
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | ((append) ? O_APPEND : O_TRUNC), 0644);
+    if (fd == -1) {
+        std::stringstream msg;
+        msg<<"failed to open output file: "<<fileName<<": "<<strerror(errno);
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+    attach(fd, fileName, true);
+    if (append) {
+        off_t end = lseek(fd, 0, SEEK_END);
+        FS_Flushed = (end < 0) ? 0 : end;
+        FS_Opened = FS_Flushed;
+    }
+}
+
+void FastaSink::openStdout(void)
+{
+    close();
+    // anything already written through iostreams has to come first
+    std::cout.flush();
+    attach(STDOUT_FILENO, "stdout", false);
+}
+
+void FastaSink::attach(int fd, const std::string& fileName, bool ownFd)
+{
+    for (int i = 0; i < FS_BUFFER_COUNT; ++i) {
+        if (FS_Buffers[i] == NULL) {
+            void * buffer;
+            if (0 != posix_memalign(&buffer, FS_ALIGNMENT, FS_BufferSize)) {
+                if (ownFd) {
+                    ::close(fd);
+                }
+                throw crispr::runtime_exception(__FILE__,
+                                                __LINE__,
+                                                __PRETTY_FUNCTION__,
+                                                "cannot allocate output buffer");
+            }
+            FS_Buffers[i] = static_cast<char *>(buffer);
+        }
+    }
+    FS_Fd = fd;
+    FS_OwnFd = ownFd;
+    FS_FileName = fileName;
+    FS_Submitted = 0;
+    FS_Written = 0;
+    FS_Error = 0;
+    FS_Cursor = FS_Buffers[0];
+    FS_Space = FS_BufferSize;
+    FS_Flushed = 0;
+    FS_Opened = 0;
+}
+
+void FastaSink::close(void)
+{
+    if (!isOpen()) {
+        return;
+    }
+    profileCount(PF_BYTES_WRITTEN, static_cast<uint64_t>(offset() - FS_Opened));
+    int index = static_cast<int>(FS_Submitted % FS_BUFFER_COUNT);
+    FS_Used[index] = FS_BufferSize - FS_Space;
+#if HAVE_PTHREAD
+    if (FS_ThreadRunning) {
+        pthread_mutex_lock(&FS_Lock);
+        ++FS_Submitted;
+        FS_Stop = true;
+        pthread_cond_broadcast(&FS_Changed);
+        pthread_mutex_unlock(&FS_Lock);
+        pthread_join(FS_Thread, NULL);
+        FS_ThreadRunning = false;
+    } else
+#endif
+    {
+        if (!FS_Error) {
+            FS_Error = writeBuffers(FS_Submitted, FS_Submitted + 1);
+        }
+        FS_Written = ++FS_Submitted;
+    }
+
+    if (FS_OwnFd && ::close(FS_Fd) != 0 && !FS_Error) {
+        FS_Error = errno;
+    }
+    FS_Fd = -1;
+    FS_Cursor = NULL;
+    FS_Space = 0;
+    FS_Flushed = 0;
+    checkError();
+}
+
+void FastaSink::writeSlow(const char * data, size_t length)
+{
+    while (length) {
+        if (!FS_Space) {
+            submitBuffer();
+        }
+        size_t chunk = (length < FS_Space) ? length : FS_Space;
+        memcpy(FS_Cursor, data, chunk);
+        FS_Cursor += chunk;
+        FS_Space -= chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void FastaSink::submitBuffer(void)
+{
+    if (!isOpen()) {
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "write to an output file that is not open");
+    }
+    int index = static_cast<int>(FS_Submitted % FS_BUFFER_COUNT);
+    FS_Used[index] = FS_BufferSize - FS_Space;
+    FS_Flushed += static_cast<off_t>(FS_Used[index]);
+
+#if HAVE_PTHREAD
+    if (!FS_ThreadRunning) {
+        FS_Stop = false;
+        FS_ThreadRunning = (0 == pthread_create(&FS_Thread, NULL, writerThread, this));
+    }
+    if (FS_ThreadRunning) {
+        // hand the buffer over and wait until the next one in the ring is free
+        pthread_mutex_lock(&FS_Lock);
+        ++FS_Submitted;
+        pthread_cond_broadcast(&FS_Changed);
+        if (FS_Submitted - FS_Written >= FS_BUFFER_COUNT) {
+            // the writer has fallen behind, show up in a trace as a stall
+            TraceSpan stall("fasta_stall");
+            while (FS_Submitted - FS_Written >= FS_BUFFER_COUNT) {
+                pthread_cond_wait(&FS_Changed, &FS_Lock);
+            }
+        }
+        pthread_mutex_unlock(&FS_Lock);
+    } else
+#endif
+    {
+        if (!FS_Error) {
+            FS_Error = writeBuffers(FS_Submitted, FS_Submitted + 1);
+        }
+        FS_Written = ++FS_Submitted;
+    }
+
+    FS_Cursor = FS_Buffers[FS_Submitted % FS_BUFFER_COUNT];
+    FS_Space = FS_BufferSize;
+}
+
+int FastaSink::writeBuffers(unsigned long first, unsigned long last)
+{
+    struct iovec iov[FS_BUFFER_COUNT];
+    int count = 0;
+    for (unsigned long i = first; i < last; ++i) {
+        int index = static_cast<int>(i % FS_BUFFER_COUNT);
+        iov[count].iov_base = FS_Buffers[index];
+        iov[count].iov_len = FS_Used[index];
+        ++count;
+    }
+    TraceSpan span("fasta_write", "buffers", count);
+
+    int start = 0;
+    while (start < count) {
+        ssize_t written = writev(FS_Fd, iov + start, count - start);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        // step over whatever made it out, a short write can stop part way through a buffer
+        size_t remaining = static_cast<size_t>(written);
+        while (start < count && remaining >= iov[start].iov_len) {
+            remaining -= iov[start].iov_len;
+            ++start;
+        }
+        if (start < count) {
+            iov[start].iov_base = static_cast<char *>(iov[start].iov_base) + remaining;
+            iov[start].iov_len -= remaining;
+        }
+    }
+    return 0;
+}
+
+void FastaSink::checkError(void)
+{
+    // only called once the writer thread has finished
+    int error = FS_Error;
+    FS_Error = 0;
+    if (error) {
+        std::stringstream msg;
+        msg<<"failed to write to "<<FS_FileName<<": "<<strerror(error);
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+}
+
+#if HAVE_PTHREAD
+void * FastaSink::writerThread(void * sink)
+{
+    static_cast<FastaSink *>(sink)->writerLoop();
+    return NULL;
+}
+
+void FastaSink::writerLoop(void)
+{
+    pthread_mutex_lock(&FS_Lock);
+    while (true) {
+        while (FS_Written == FS_Submitted && !FS_Stop) {
+            pthread_cond_wait(&FS_Changed, &FS_Lock);
+        }
+        if (FS_Written == FS_Submitted) {
+            break;
+        }
+        // everything queued so far goes out in one writev
+        unsigned long first = FS_Written;
+        unsigned long last = FS_Submitted;
+        bool failed = (FS_Error != 0);
+        pthread_mutex_unlock(&FS_Lock);
+        int error = (failed) ? 0 : writeBuffers(first, last);
+        pthread_mutex_lock(&FS_Lock);
+        if (error && !FS_Error) {
+            FS_Error = error;
+        }
+        FS_Written = last;
+        pthread_cond_broadcast(&FS_Changed);
+    }
+    pthread_mutex_unlock(&FS_Lock);
+}
+#endif
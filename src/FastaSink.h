@@ -0,0 +1,147 @@
+/*
+ * FastaSink.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_FastaSink_h
+#define crisprtools_FastaSink_h
+
+#include "config.h"
+#include <string>
+#include <cstring>
+#include <sys/types.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#define FS_BUFFER_SIZE 1048576      // default bytes in each output buffer
+#define FS_BUFFER_COUNT 4           // buffers that can be filled while others are written
+#define FS_ALIGNMENT 4096           // buffers start on a page boundary
+
+// Buffered output for large amounts of FASTA.  Records are copied into big
+// page aligned buffers that are never flushed early.  Full buffers are
+// handed to a writer thread that writes everything queued with a single
+// writev, so parsing and writing overlap.  The thread is only started once
+// the first buffer fills, small files are written in one go on close.
+// Without pthreads full buffers are written straight away
+class FastaSink {
+public:
+    FastaSink(size_t bufferSize = FS_BUFFER_SIZE);
+    ~FastaSink();
+
+    // throws crispr::runtime_exception if the file can't be created.
+    // When appending, offset() carries on from the end of the file
+    void open(const std::string& fileName, bool append = false);
+    void openStdout(void);
+
+    // write out everything and release the file, throws
+    // crispr::runtime_exception if any of the writes failed.  Once a write
+    // fails the rest of the output is thrown away, the error is only
+    // reported here so that it isn't raised part way through a record
+    void close(void);
+
+    inline bool isOpen(void) const {return FS_Fd != -1;}
+    inline const std::string& getFileName(void) const {return FS_FileName;}
+
+    // position in the file that the next byte will be written to
+    inline off_t offset(void) const {return FS_Flushed + static_cast<off_t>(FS_BufferSize - FS_Space);}
+
+    inline void write(const char * data, size_t length)
+    {
+        if (length <= FS_Space) {
+            memcpy(FS_Cursor, data, length);
+            FS_Cursor += length;
+            FS_Space -= length;
+        } else {
+            writeSlow(data, length);
+        }
+    }
+    inline void write(const std::string& str) {write(str.data(), str.length());}
+    inline void put(char c)
+    {
+        if (!FS_Space) {
+            submitBuffer();
+        }
+        *FS_Cursor++ = c;
+        --FS_Space;
+    }
+
+    // '>' headerPrefix gid id '\n' sequence '\n'
+    inline void writeRecord(const std::string& headerPrefix, const std::string& gid, const std::string& id, const char * sequence)
+    {
+        put('>');
+        write(headerPrefix);
+        write(gid);
+        write(id);
+        put('\n');
+        write(sequence, strlen(sequence));
+        put('\n');
+    }
+
+private:
+    // not copyable, the writer thread holds a pointer to the sink
+    FastaSink(const FastaSink&);
+    FastaSink& operator=(const FastaSink&);
+
+    void attach(int fd, const std::string& fileName, bool ownFd);
+    void writeSlow(const char * data, size_t length);
+
+    // queue the current buffer and move on to the next free one
+    void submitBuffer(void);
+
+    // write buffers [first, last) in ring order, returns 0 or an errno
+    int writeBuffers(unsigned long first, unsigned long last);
+    void checkError(void);
+
+#if HAVE_PTHREAD
+    static void * writerThread(void * sink);
+    void writerLoop(void);
+#endif
+
+    int FS_Fd;
+    bool FS_OwnFd;
+    std::string FS_FileName;
+    size_t FS_BufferSize;
+    char * FS_Buffers[FS_BUFFER_COUNT];
+    size_t FS_Used[FS_BUFFER_COUNT];
+
+    // the buffer being filled
+    char * FS_Cursor;
+    size_t FS_Space;
+
+    // bytes of the file before the buffer being filled, and where the
+    // file was when it was opened
+    off_t FS_Flushed;
+    off_t FS_Opened;
+
+    // buffers are filled in ring order.  Submitted counts the buffers
+    // handed over for writing and written counts those that are done,
+    // the buffer being filled is number FS_Submitted
+    unsigned long FS_Submitted;
+    unsigned long FS_Written;
+    int FS_Error;
+
+#if HAVE_PTHREAD
+    pthread_t FS_Thread;
+    pthread_mutex_t FS_Lock;
+    pthread_cond_t FS_Changed;
+    bool FS_ThreadRunning;
+    bool FS_Stop;
+#endif
+};
+
+#endif
@@ -0,0 +1,97 @@
+// FilePool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FilePool.h"
+#include <libcrispr/Exception.h>
+#include <iostream>
+
+FilePool::FilePool(int maxOpen, size_t bufferSize)
+{
+    setMaxOpen(maxOpen);
+    FP_BufferSize = bufferSize;
+}
+
+FilePool::~FilePool()
+{
+    try {
+        closeAll();
+    } catch (crispr::exception& e) {
+        std::cerr<<e.what()<<std::endl;
+    }
+    std::vector<FastaSink *>::iterator iter;
+    for (iter = FP_Free.begin(); iter != FP_Free.end(); ++iter) {
+        delete *iter;
+    }
+}
+
+FastaSink& FilePool::get(const std::string& fileName)
+{
+    std::map<std::string, LruList::iterator>::iterator open_iter = FP_Open.find(fileName);
+    if (open_iter != FP_Open.end()) {
+        FP_Lru.splice(FP_Lru.begin(), FP_Lru, open_iter->second);
+        return *FP_Lru.front();
+    }
+
+    while (static_cast<int>(FP_Lru.size()) >= FP_MaxOpen) {
+        closeOldest();
+    }
+
+    FastaSink * sink;
+    if (FP_Free.empty()) {
+        sink = new FastaSink(FP_BufferSize);
+    } else {
+        sink = FP_Free.back();
+        FP_Free.pop_back();
+    }
+    try {
+        sink->open(fileName, FP_Created.find(fileName) != FP_Created.end());
+    } catch (crispr::runtime_exception&) {
+        FP_Free.push_back(sink);
+        throw;
+    }
+    FP_Created.insert(fileName);
+    FP_Lru.push_front(sink);
+    FP_Open[fileName] = FP_Lru.begin();
+    return *sink;
+}
+
+void FilePool::closeOldest(void)
+{
+    // taken out of the pool before closing so that a failed write
+    // doesn't leave it behind
+    FastaSink * sink = FP_Lru.back();
+    FP_Lru.pop_back();
+    FP_Open.erase(sink->getFileName());
+    FP_Free.push_back(sink);
+    sink->close();
+}
+
+void FilePool::closeAll(void)
+{
+    while (!FP_Lru.empty()) {
+        try {
+            closeOldest();
+        } catch (crispr::runtime_exception&) {
+            try {
+                closeAll();
+            } catch (crispr::runtime_exception& e) {
+                std::cerr<<e.what()<<std::endl;
+            }
+            throw;
+        }
+    }
+}
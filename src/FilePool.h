@@ -0,0 +1,76 @@
+/*
+ * FilePool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_FilePool_h
+#define crisprtools_FilePool_h
+
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include "FastaSink.h"
+
+#define FP_DEFAULT_MAX_OPEN 64      // files kept open at once
+#define FP_MAX_OPEN 1024            // upper limit for --max-open
+#define FP_BUFFER_SIZE 65536        // smaller buffers than a lone sink, there are many of them
+
+// A bounded set of open output files.  get() hands out the sink for a file
+// name, opening it if needed and closing the least recently used file once
+// the pool is full.  A file is truncated the first time it is opened and
+// appended to when it is opened again, so output can go to any number of
+// files in any order without holding a descriptor for each of them
+class FilePool {
+public:
+    FilePool(int maxOpen = FP_DEFAULT_MAX_OPEN, size_t bufferSize = FP_BUFFER_SIZE);
+    ~FilePool();
+
+    inline void setMaxOpen(int maxOpen) {FP_MaxOpen = (maxOpen < 1) ? 1 : maxOpen;}
+
+    // throws crispr::runtime_exception if the file can't be opened or if
+    // a file that had to be closed to make room could not be written
+    FastaSink& get(const std::string& fileName);
+
+    // close every open file, the first write error is thrown once they
+    // have all been closed
+    void closeAll(void);
+
+private:
+    FilePool(const FilePool&);
+    FilePool& operator=(const FilePool&);
+
+    void closeOldest(void);
+
+    typedef std::list<FastaSink *> LruList;
+
+    int FP_MaxOpen;
+    size_t FP_BufferSize;
+
+    // open sinks, most recently used first
+    LruList FP_Lru;
+    std::map<std::string, LruList::iterator> FP_Open;
+
+    // every file opened so far, these are appended to when reopened
+    std::set<std::string> FP_Created;
+
+    // closed sinks kept for their buffers
+    std::vector<FastaSink *> FP_Free;
+};
+
+#endif
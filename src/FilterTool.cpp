@@ -24,6 +24,7 @@
 #include <iostream>
 #include <getopt.h>
 #include "Utils.h"
+#include "Profile.h"
 
 #define exists(container,searchThing )  container.find(searchThing) != container.end()
 
@@ -116,7 +117,7 @@ int FilterTool::processInputFile(const char * inputFile)
         }
         
         crispr::xml::parser xml_parser;
-        xercesc::DOMDocument * input_doc_obj = xml_parser.setFileParser(inputFile);
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
         xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
         if (!root_elem) {
             throw crispr::xml_exception(__FILE__, 
@@ -124,6 +125,8 @@ int FilterTool::processInputFile(const char * inputFile)
                                         __PRETTY_FUNCTION__, 
                                         "problem when parsing xml file");
         }
+
+        ProfileTimer walk_timer(PF_WALK);
         if (FT_OutputFile.empty()) {
             FT_OutputFile = inputFile;
         }
@@ -133,6 +136,7 @@ int FilterTool::processInputFile(const char * inputFile)
         for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild(); 
              currentElement != NULL; 
              currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
                 
             // the user wants to change any of these 
             if (FT_Spacers || FT_Repeats || FT_Flank || FT_Coverage) {
@@ -143,12 +147,15 @@ int FilterTool::processInputFile(const char * inputFile)
         }
         std::vector<xercesc::DOMElement * >::iterator iter = good_children.begin();
         xercesc::DOMDocument * output_document = output_xml.getDocumentObj();
-        while (iter != good_children.end()) {
-            output_root_elem->appendChild(output_document->importNode(*iter, true));
-            iter++;
+        {
+            ProfileTimer import_timer(PF_IMPORT);
+            while (iter != good_children.end()) {
+                output_root_elem->appendChild(output_document->importNode(*iter, true));
+                iter++;
+            }
         }
 
-        output_xml.printDOMToFile(FT_OutputFile, output_document);
+        profiledWrite(output_xml, FT_OutputFile, output_document);
     } catch (crispr::xml_exception& e) {
         std::cerr<<e.what()<<std::endl;
         return 1;
@@ -0,0 +1,148 @@
+// FindTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "FindTool.h"
+#include "config.h"
+#include "SeqKernels.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/StlExt.h>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <cstring>
+#include <getopt.h>
+
+static const char * FT_TypeNames[] = {"spacer", "direct_repeat", "flanker", "unknown"};
+
+int FindTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups-only", no_argument, NULL, 'l'},
+        {"mismatches", required_argument, NULL, 'm'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hlm:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                findUsage();
+                exit(1);
+                break;
+            }
+            case 'l':
+            {
+                FT_GroupsOnly = true;
+                break;
+            }
+            case 'm':
+            {
+                if (!from_string<int>(FT_Mismatches, optarg, std::dec) || FT_Mismatches < 0 || FT_Mismatches > FT_MAX_MISMATCHES) {
+                    throw crispr::input_exception("The number of mismatches must be between 0 and 8");
+                }
+                break;
+            }
+            default:
+            {
+                findUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    return optind;
+}
+
+void FindTool::openIndex(const char * indexFile)
+{
+    FT_Index.open(indexFile);
+}
+
+void FindTool::findSequence(const char * query)
+{
+    size_t length = strlen(query);
+    if (length == 0 || validateBases(query, length, SK_ACGT) != length) {
+        throw crispr::input_exception("Sequences can only contain A, C, G and T");
+    }
+    std::vector<IndexHit> hits;
+    FT_Index.find(query, FT_Mismatches, hits);
+
+    // each hit is in a distinct sequence, which can be in many groups
+    std::set<uint32_t> groups;
+    std::vector<IndexHit>::iterator iter;
+    for (iter = hits.begin(); iter != hits.end(); ++iter) {
+        const IndexSequence& sequence = FT_Index.sequence(iter->Sequence);
+        for (uint32_t i = sequence.FirstElement; i < sequence.FirstElement + sequence.NumElements; ++i) {
+            const IndexElement& element = FT_Index.element(i);
+            if (FT_GroupsOnly) {
+                groups.insert(element.Group);
+                continue;
+            }
+            std::cout<<query<<'\t'
+                     <<FT_Index.groupName(element.Group)<<'\t'
+                     <<FT_Index.elementName(element)<<'\t'
+                     <<FT_TypeNames[(element.Type <= SI_FLANKER) ? element.Type : SI_FLANKER + 1]<<'\t'
+                     <<iter->Position + 1<<'\t'
+                     <<iter->Strand<<'\t'
+                     <<iter->Mismatches<<'\n';
+        }
+    }
+    std::set<uint32_t>::iterator group;
+    for (group = groups.begin(); group != groups.end(); ++group) {
+        std::cout<<query<<'\t'<<FT_Index.groupName(*group)<<'\n';
+    }
+}
+
+int findMain(int argc, char ** argv)
+{
+    try {
+        FindTool ft;
+        int opt_index = ft.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No index file provided");
+        } else if (opt_index + 1 >= argc) {
+            throw crispr::input_exception("No sequences to find");
+        }
+        ft.openIndex(argv[opt_index]);
+        for (int i = opt_index + 1; i < argc; ++i) {
+            ft.findSequence(argv[i]);
+        }
+        std::cout.flush();
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        findUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void findUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" find [-hl] [-m INT] file.crispr.idx SEQ [SEQ...]"<<std::endl;
+    std::cout<<"Find the spacers and repeats that contain each sequence, on either strand, using an index"<<std::endl;
+    std::cout<<"made by "<<PACKAGE_NAME<<" index.  Each hit is a tab separated line: query, group, element,"<<std::endl;
+    std::cout<<"type, position, strand, mismatches"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-l                  only list the groups that contain each sequence"<<std::endl;
+    std::cout<<"-m INT              the number of mismatches allowed, between 0 and "<<FT_MAX_MISMATCHES<<" [default: 0]"<<std::endl;
+}
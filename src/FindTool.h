@@ -0,0 +1,52 @@
+/*
+ * FindTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_FindTool_h
+#define crisprtools_FindTool_h
+
+#include <string>
+#include "SpacerIndex.h"
+
+#define FT_MAX_MISMATCHES 8         // limit on -m
+
+// Looks sequences up in an index made by 'crisprtools index'
+class FindTool {
+public:
+    FindTool()
+    {
+        FT_Mismatches = 0;
+        FT_GroupsOnly = false;
+    }
+
+    int processOptions(int argc, char ** argv);
+
+    void openIndex(const char * indexFile);
+
+    // print every element that contains the query
+    void findSequence(const char * query);
+
+private:
+    SpacerIndex FT_Index;
+    int FT_Mismatches;
+    bool FT_GroupsOnly;
+};
+
+int findMain(int argc, char ** argv);
+void findUsage(void);
+#endif
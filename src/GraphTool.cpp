@@ -0,0 +1,293 @@
+// GraphTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "GraphTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/reader.h>
+#include <fstream>
+#include <algorithm>
+#include <getopt.h>
+#include <cstring>
+
+GraphTool::~GraphTool()
+{
+    std::vector<AssemblyGraph *>::iterator iter;
+    for (iter = GT_Batch.begin(); iter != GT_Batch.end(); ++iter) {
+        delete *iter;
+    }
+}
+
+int GraphTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"header", no_argument, NULL, 'H'},
+        {"groups", required_argument, NULL, 'g'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"separator", required_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 't'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hHg:o:s:t:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                graphUsage();
+                exit(1);
+                break;
+            }
+            case 'H':
+            {
+                GT_WithHeader = true;
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(GT_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, GT_Groups);
+                }
+                GT_Subset = true;
+                break;
+            }
+            case 'o':
+            {
+                GT_OutputFile = optarg;
+                break;
+            }
+            case 's':
+            {
+                GT_Separator = optarg;
+                break;
+            }
+            case 't':
+            {
+                GT_NumThreads = parseThreadCount(optarg);
+                break;
+            }
+            default:
+            {
+                graphUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    return optind;
+}
+
+void GraphTool::analyseGraph(const AssemblyGraph& graph, GraphStats& stats)
+{
+    stats.nodes = graph.nodeCount();
+    stats.edges = graph.edgeCount();
+    stats.spacers = 0;
+    stats.flankers = 0;
+    stats.maxInDegree = 0;
+    stats.maxOutDegree = 0;
+    for (int i = 0; i < stats.nodes; ++i) {
+        if (graph.nodeType(i) == AssemblyGraph::SPACER) {
+            ++stats.spacers;
+        } else {
+            ++stats.flankers;
+        }
+        stats.maxInDegree = std::max(stats.maxInDegree, graph.inDegree(i));
+        stats.maxOutDegree = std::max(stats.maxOutDegree, graph.outDegree(i));
+    }
+    stats.components = graph.countComponents();
+    stats.branchPoints = graph.countBranchPoints();
+    stats.longestPath = graph.longestSpacerPath();
+    stats.cycles = graph.countCycles();
+}
+
+// the graphs and the slots for their results, shared by the worker threads
+typedef struct __GraphBatch {
+    std::vector<AssemblyGraph *> * graphs;
+    std::vector<GraphStats> * stats;
+} GraphBatch;
+
+static void analyseBatchItem(int index, void * arg)
+{
+    GraphBatch * batch = static_cast<GraphBatch *>(arg);
+    TraceSpan span;
+    if (TR_Enabled) {
+        span.startGroup("analyse", (*batch->graphs)[index]->getName(), (*batch->graphs)[index]->nodeCount());
+    }
+    GraphTool::analyseGraph(*((*batch->graphs)[index]), (*batch->stats)[index]);
+}
+
+void GraphTool::flushBatch(std::ostream& out)
+{
+    std::vector<GraphStats> stats(GT_Batch.size());
+    GraphBatch batch;
+    batch.graphs = &GT_Batch;
+    batch.stats = &stats;
+    parallelFor(static_cast<int>(GT_Batch.size()), GT_NumThreads, analyseBatchItem, &batch);
+
+    // print in the order the groups appear in the file
+    for (size_t i = 0; i < GT_Batch.size(); ++i) {
+        printStats(out, GT_Batch[i]->getName(), stats[i]);
+        delete GT_Batch[i];
+    }
+    GT_Batch.clear();
+}
+
+void GraphTool::printHeader(std::ostream& out)
+{
+    out<<"GID"<<GT_Separator
+       <<"Nodes"<<GT_Separator
+       <<"Edges"<<GT_Separator
+       <<"Spacers"<<GT_Separator
+       <<"Flankers"<<GT_Separator
+       <<"Components"<<GT_Separator
+       <<"BranchPoints"<<GT_Separator
+       <<"LongestPath"<<GT_Separator
+       <<"MaxIn"<<GT_Separator
+       <<"MaxOut"<<GT_Separator
+       <<"Cycles"<<std::endl;
+}
+
+void GraphTool::printStats(std::ostream& out, const std::string& gid, const GraphStats& stats)
+{
+    out<<gid<<GT_Separator
+       <<stats.nodes<<GT_Separator
+       <<stats.edges<<GT_Separator
+       <<stats.spacers<<GT_Separator
+       <<stats.flankers<<GT_Separator
+       <<stats.components<<GT_Separator
+       <<stats.branchPoints<<GT_Separator
+       <<stats.longestPath<<GT_Separator
+       <<stats.maxInDegree<<GT_Separator
+       <<stats.maxOutDegree<<GT_Separator
+       <<stats.cycles<<"\n";
+}
+
+int GraphTool::processInputFile(const char * inputFile)
+{
+    try {
+        crispr::xml::reader xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        std::ofstream out_file_stream;
+        if (!GT_OutputFile.empty()) {
+            out_file_stream.open(GT_OutputFile.c_str());
+            if (!out_file_stream.good()) {
+                throw crispr::input_exception("cannot open output file");
+            }
+        }
+        std::ostream& out = (GT_OutputFile.empty()) ? std::cout : out_file_stream;
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        if (GT_WithHeader) {
+            printHeader(out);
+        }
+
+        //-----
+        // The DOM can only be walked by one thread, so the graphs are
+        // loaded here a batch at a time and only the analysis is spread
+        // over the threads.  Memory stays bounded by the batch size
+        //
+        int num_groups_to_process = static_cast<int>(GT_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (GT_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (GT_Subset) {
+                if (GT_Groups.find(group_id.substr(1)) == GT_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+
+            AssemblyGraph * graph = new AssemblyGraph(group_id);
+            GT_Batch.push_back(graph);
+            graph->loadAssembly(currentElement, xml_parser);
+            if (GT_Batch.size() >= GT_BATCH_SIZE) {
+                flushBatch(out);
+            }
+        }
+        flushBatch(out);
+        out.flush();
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int graphMain(int argc, char ** argv)
+{
+    try {
+        GraphTool gt;
+        int opt_index = gt.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        } else {
+            return gt.processInputFile(argv[opt_index]);
+        }
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        graphUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void graphUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" graph [-hH] [-g INT[,n]] [-o FILE] [-s STRING] [-t INT] file.crispr"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-H                  print out column headers"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to analyse"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: print to screen]"<<std::endl;
+    std::cout<<"-s STRING           separator string for the output [default: '\\t']"<<std::endl;
+    std::cout<<"-t INT              number of threads, 0 uses every processor [default: "<<PL_DEFAULT_THREADS<<"]"<<std::endl;
+}
@@ -0,0 +1,82 @@
+/*
+ * GraphTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_GraphTool_h
+#define crisprtools_GraphTool_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <iostream>
+#include <libcrispr/base.h>
+#include "AssemblyGraph.h"
+#include "Parallel.h"
+
+#define GT_BATCH_SIZE 1024          // groups held in memory before they are analysed and printed
+
+// the numbers printed for one group
+typedef struct __GraphStats {
+    int nodes;
+    int edges;
+    int spacers;
+    int flankers;
+    int components;
+    int branchPoints;
+    int longestPath;
+    int maxInDegree;
+    int maxOutDegree;
+    int cycles;
+} GraphStats;
+
+class GraphTool {
+public:
+    GraphTool()
+    {
+        GT_Subset = false;
+        GT_WithHeader = false;
+        GT_Separator = "\t";
+        GT_NumThreads = PL_DEFAULT_THREADS;
+    }
+    ~GraphTool();
+
+    int processOptions(int argc, char ** argv);
+    int processInputFile(const char * inputFile);
+
+    // fill in stats for one finalised graph
+    static void analyseGraph(const AssemblyGraph& graph, GraphStats& stats);
+
+private:
+    // analyse the graphs that have been loaded, print them and free them
+    void flushBatch(std::ostream& out);
+    void printHeader(std::ostream& out);
+    void printStats(std::ostream& out, const std::string& gid, const GraphStats& stats);
+
+    std::set<std::string> GT_Groups;
+    bool GT_Subset;
+    bool GT_WithHeader;
+    std::string GT_Separator;
+    std::string GT_OutputFile;
+    int GT_NumThreads;
+
+    std::vector<AssemblyGraph *> GT_Batch;
+};
+
+int graphMain(int argc, char ** argv);
+void graphUsage(void);
+#endif
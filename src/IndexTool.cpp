@@ -0,0 +1,241 @@
+// IndexTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "IndexTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/reader.h>
+#include <libcrispr/StlExt.h>
+#include <fstream>
+#include <cstring>
+#include <getopt.h>
+
+int IndexTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups", required_argument, NULL, 'g'},
+        {"kmer", required_argument, NULL, 'k'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"spacers", no_argument, NULL, 's'},
+        {"direct-repeats", no_argument, NULL, 'd'},
+        {"flankers", no_argument, NULL, 'f'},
+        {"sequences", no_argument, NULL, 0},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hg:k:o:sdf", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                indexUsage();
+                exit(1);
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(IT_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, IT_Groups);
+                }
+                IT_Subset = true;
+                break;
+            }
+            case 'k':
+            {
+                if (!from_string<int>(IT_K, optarg, std::dec) || IT_K < SI_MIN_K || IT_K > SI_MAX_K) {
+                    throw crispr::input_exception("The k-mer length must be between 4 and 16");
+                }
+                break;
+            }
+            case 'o':
+            {
+                IT_OutputFile = optarg;
+                break;
+            }
+            case 's':
+            {
+                IT_Spacers = true;
+                break;
+            }
+            case 'd':
+            {
+                IT_Repeats = true;
+                break;
+            }
+            case 'f':
+            {
+                IT_Flankers = true;
+                break;
+            }
+            case 0:
+            {
+                if (!strcmp("sequences", long_options[index].name)) {
+                    IT_Spacers = true;
+                    IT_Repeats = true;
+                }
+                break;
+            }
+            default:
+            {
+                indexUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    // the spacers and the direct repeats unless something else was asked for
+    if (!IT_Spacers && !IT_Repeats && !IT_Flankers) {
+        IT_Spacers = true;
+        IT_Repeats = true;
+    }
+    return optind;
+}
+
+void IndexTool::parseElements(xercesc::DOMElement * parentNode, 
+                              crispr::xml::base& xmlParser, 
+                              IndexElementType type, 
+                              const XMLCh * idAttribute, 
+                              SpacerIndexBuilder& builder)
+{
+    for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        char * c_id = tc(currentElement->getAttribute(idAttribute));
+        char * c_seq = tc(currentElement->getAttribute(xmlParser.attr_Seq()));
+        builder.addElement(type, c_id, c_seq);
+        xr(&c_id);
+        xr(&c_seq);
+    }
+}
+
+void IndexTool::parseData(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, SpacerIndexBuilder& builder)
+{
+    for (xercesc::DOMElement * currentElement = parentNode->getFirstElementChild();
+         currentElement != NULL;
+         currentElement = currentElement->getNextElementSibling()) {
+        if (IT_Repeats && xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Drs())) {
+            parseElements(currentElement, xmlParser, SI_DIRECT_REPEAT, xmlParser.attr_Drid(), builder);
+        } else if (IT_Spacers && xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacers())) {
+            parseElements(currentElement, xmlParser, SI_SPACER, xmlParser.attr_Spid(), builder);
+        } else if (IT_Flankers && xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Flankers())) {
+            parseElements(currentElement, xmlParser, SI_FLANKER, xmlParser.attr_Flid(), builder);
+        }
+    }
+}
+
+int IndexTool::processInputFile(const char * inputFile)
+{
+    try {
+        crispr::xml::reader xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        SpacerIndexBuilder builder(IT_K);
+        int num_groups_to_process = static_cast<int>(IT_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (IT_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (IT_Subset) {
+                if (IT_Groups.find(group_id.substr(1)) == IT_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+
+            builder.addGroup(group_id);
+            for (xercesc::DOMElement * groupChild = currentElement->getFirstElementChild();
+                 groupChild != NULL;
+                 groupChild = groupChild->getNextElementSibling()) {
+                if (xercesc::XMLString::equals(groupChild->getTagName(), xml_parser.tag_Data())) {
+                    parseData(groupChild, xml_parser, builder);
+                }
+            }
+        }
+        builder.write((IT_OutputFile.empty()) ? std::string(inputFile) + IT_EXTENSION : IT_OutputFile);
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int indexMain(int argc, char ** argv)
+{
+    try {
+        IndexTool it;
+        int opt_index = it.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        } else {
+            return it.processInputFile(argv[opt_index]);
+        }
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        indexUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void indexUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" index [-hsdf] [--sequences] [-g INT[,n]] [-k INT] [-o FILE] file.crispr"<<std::endl;
+    std::cout<<"Write an index of the sequences in the file for "<<PACKAGE_NAME<<" find"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs that you would like to index"<<std::endl;
+    std::cout<<"-k INT              length of the indexed k-mers, between "<<SI_MIN_K<<" and "<<SI_MAX_K<<" [default: "<<SI_DEFAULT_K<<"]"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: file.crispr"<<IT_EXTENSION<<"]"<<std::endl;
+    std::cout<<"-s                  index the spacers"<<std::endl;
+    std::cout<<"-d                  index the direct repeats"<<std::endl;
+    std::cout<<"-f                  index the flanking sequences"<<std::endl;
+    std::cout<<"--sequences         index the spacers and the direct repeats (the default)"<<std::endl;
+}
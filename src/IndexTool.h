@@ -0,0 +1,65 @@
+/*
+ * IndexTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_IndexTool_h
+#define crisprtools_IndexTool_h
+
+#include <string>
+#include <set>
+#include <libcrispr/base.h>
+#include "SpacerIndex.h"
+
+#define IT_EXTENSION ".idx"         // added to the input file name for the default output
+
+// Writes a k-mer index of the spacers, direct repeats and flankers of a
+// .crispr file that 'crisprtools find' can search without the XML
+class IndexTool {
+public:
+    IndexTool()
+    {
+        IT_Subset = false;
+        IT_K = SI_DEFAULT_K;
+        IT_Spacers = false;
+        IT_Repeats = false;
+        IT_Flankers = false;
+    }
+
+    int processOptions(int argc, char ** argv);
+    int processInputFile(const char * inputFile);
+
+private:
+    void parseData(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, SpacerIndexBuilder& builder);
+    void parseElements(xercesc::DOMElement * parentNode, 
+                       crispr::xml::base& xmlParser, 
+                       IndexElementType type, 
+                       const XMLCh * idAttribute, 
+                       SpacerIndexBuilder& builder);
+
+    std::set<std::string> IT_Groups;
+    bool IT_Subset;
+    std::string IT_OutputFile;
+    int IT_K;
+    bool IT_Spacers;
+    bool IT_Repeats;
+    bool IT_Flankers;
+};
+
+int indexMain(int argc, char ** argv);
+void indexUsage(void);
+#endif
@@ -0,0 +1,203 @@
+// LayeredLayout.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "LayeredLayout.h"
+#include <algorithm>
+#include <utility>
+
+// order nodes in a rank by their barycenter, keeping the old order for ties
+typedef std::pair<double, int> baryNode;
+
+static bool compareBary(const baryNode& a, const baryNode& b)
+{
+    return a.first < b.first;
+}
+
+void LayeredLayout::rankNodes(const SpacerGraph& graph,
+                              std::vector<int>& topologicalPosition)
+{
+    //-----
+    // An iterative DFS that starts from the sources first so that chains
+    // are walked in the direction of their links.  The reverse post-order
+    // puts the tail of every edge before its head except for back edges,
+    // which are the ones that close a cycle and are ignored when ranking
+    //
+    int num_nodes = graph.nodeCount();
+    std::vector<int> post_order;
+    post_order.reserve(num_nodes);
+    std::vector<char> state(num_nodes, 0);
+    std::vector<std::pair<int, size_t> > stack;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int start = 0; start < num_nodes; ++start) {
+            if (state[start]) {
+                continue;
+            }
+            // on the first pass only start from nodes without any incoming links
+            if (pass == 0 && !graph.predecessors(start).empty()) {
+                continue;
+            }
+            state[start] = 1;
+            stack.push_back(std::pair<int, size_t>(start, 0));
+            while (!stack.empty()) {
+                int current = stack.back().first;
+                const SpacerGraph::adjacencyList& out = graph.successors(current);
+                if (stack.back().second < out.size()) {
+                    int next = out[stack.back().second++];
+                    if (!state[next]) {
+                        state[next] = 1;
+                        stack.push_back(std::pair<int, size_t>(next, 0));
+                    }
+                } else {
+                    state[current] = 2;
+                    post_order.push_back(current);
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+
+    topologicalPosition.assign(num_nodes, 0);
+    for (int i = 0; i < num_nodes; ++i) {
+        topologicalPosition[post_order[num_nodes - 1 - i]] = i;
+    }
+
+    // longest path ranking, walking the nodes in topological order
+    LL_Layer.assign(num_nodes, 0);
+    LL_LayerCount = (num_nodes > 0) ? 1 : 0;
+    for (int i = num_nodes - 1; i >= 0; --i) {
+        int current = post_order[i];
+        const SpacerGraph::adjacencyList& out = graph.successors(current);
+        SpacerGraph::adjacencyList::const_iterator iter;
+        for (iter = out.begin(); iter != out.end(); ++iter) {
+            if (topologicalPosition[current] < topologicalPosition[*iter] &&
+                LL_Layer[*iter] <= LL_Layer[current]) {
+                LL_Layer[*iter] = LL_Layer[current] + 1;
+                if (LL_Layer[*iter] + 1 > LL_LayerCount) {
+                    LL_LayerCount = LL_Layer[*iter] + 1;
+                }
+            }
+        }
+    }
+}
+
+void LayeredLayout::sweep(const SpacerGraph& graph,
+                          std::vector<int>& layer,
+                          bool useSuccessors)
+{
+    std::vector<baryNode> bary;
+    bary.reserve(layer.size());
+    std::vector<int>::iterator iter;
+    for (iter = layer.begin(); iter != layer.end(); ++iter) {
+        const SpacerGraph::adjacencyList& neighbours = (useSuccessors) ? graph.successors(*iter) : graph.predecessors(*iter);
+        double sum = 0;
+        int count = 0;
+        SpacerGraph::adjacencyList::const_iterator n_iter;
+        for (n_iter = neighbours.begin(); n_iter != neighbours.end(); ++n_iter) {
+            if (LL_Layer[*n_iter] != LL_Layer[*iter]) {
+                sum += LL_Order[*n_iter];
+                ++count;
+            }
+        }
+        bary.push_back(baryNode((count) ? sum / count : LL_Order[*iter], *iter));
+    }
+    std::stable_sort(bary.begin(), bary.end(), compareBary);
+    for (size_t i = 0; i < bary.size(); ++i) {
+        layer[i] = bary[i].second;
+        LL_Order[layer[i]] = static_cast<int>(i);
+    }
+}
+
+void LayeredLayout::orderLayers(const SpacerGraph& graph,
+                                std::vector<std::vector<int> >& layers)
+{
+    for (int i = 0; i < LL_SWEEPS; ++i) {
+        if (i % 2 == 0) {
+            for (int l = 1; l < LL_LayerCount; ++l) {
+                sweep(graph, layers[l], false);
+            }
+        } else {
+            for (int l = LL_LayerCount - 2; l >= 0; --l) {
+                sweep(graph, layers[l], true);
+            }
+        }
+    }
+}
+
+void LayeredLayout::layout(const SpacerGraph& graph)
+{
+    int num_nodes = graph.nodeCount();
+    std::vector<int> topological_position;
+    rankNodes(graph, topological_position);
+
+    // initial order in each rank follows the DFS so that branches stay together
+    std::vector<int> by_position(num_nodes);
+    for (int i = 0; i < num_nodes; ++i) {
+        by_position[topological_position[i]] = i;
+    }
+    std::vector<std::vector<int> > layers(LL_LayerCount);
+    LL_Order.assign(num_nodes, 0);
+    for (int i = 0; i < num_nodes; ++i) {
+        int current = by_position[i];
+        LL_Order[current] = static_cast<int>(layers[LL_Layer[current]].size());
+        layers[LL_Layer[current]].push_back(current);
+    }
+
+    orderLayers(graph, layers);
+
+    size_t widest_layer = 0;
+    std::vector<std::vector<int> >::iterator iter;
+    for (iter = layers.begin(); iter != layers.end(); ++iter) {
+        widest_layer = std::max(widest_layer, iter->size());
+    }
+
+    LL_X.resize(num_nodes);
+    LL_Y.resize(num_nodes);
+    for (int i = 0; i < num_nodes; ++i) {
+        LL_X[i] = LL_Margin + LL_Layer[i] * LL_LayerSpacing;
+        LL_Y[i] = LL_Margin + LL_Order[i] * LL_NodeSpacing;
+    }
+    LL_Width = 2 * LL_Margin + ((LL_LayerCount > 1) ? (LL_LayerCount - 1) * LL_LayerSpacing : 0);
+    LL_Height = 2 * LL_Margin + ((widest_layer > 1) ? (widest_layer - 1) * LL_NodeSpacing : 0);
+}
+
+void LayeredLayout::write(std::ostream& out, int nodeCount) const
+{
+    std::streamsize old_precision = out.precision(15);
+    out << nodeCount << ' ' << LL_LayerCount << ' ' << LL_Width << ' ' << LL_Height << '\n';
+    for (int i = 0; i < nodeCount; ++i) {
+        out << LL_X[i] << ' ' << LL_Y[i] << ' ' << LL_Layer[i] << '\n';
+    }
+    out.precision(old_precision);
+}
+
+bool LayeredLayout::read(std::istream& in, int nodeCount)
+{
+    int num_nodes;
+    if (!(in >> num_nodes >> LL_LayerCount >> LL_Width >> LL_Height) || num_nodes != nodeCount) {
+        return false;
+    }
+    LL_X.resize(num_nodes);
+    LL_Y.resize(num_nodes);
+    LL_Layer.resize(num_nodes);
+    for (int i = 0; i < num_nodes; ++i) {
+        if (!(in >> LL_X[i] >> LL_Y[i] >> LL_Layer[i])) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * LayeredLayout.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_LayeredLayout_h
+#define crisprtools_LayeredLayout_h
+
+#include <vector>
+#include <iostream>
+#include "SpacerGraph.h"
+
+#define LL_LAYER_SPACING 70.0       // horizontal distance between ranks
+#define LL_NODE_SPACING 50.0        // vertical distance between nodes in a rank
+#define LL_MARGIN 30.0              // blank space around the drawing
+#define LL_SWEEPS 4                 // number of barycenter passes (down + up)
+
+// A left to right layered layout suited to CRISPR arrays.  Most spacer
+// graphs are long chains with a few branches, so each node is ranked by
+// the longest path reaching it (cycles are broken at DFS back edges) and
+// then nodes within a rank are ordered with a few barycenter sweeps.
+// Apart from sorting each rank everything is linear in nodes + edges
+class LayeredLayout {
+public:
+    LayeredLayout()
+    {
+        LL_LayerSpacing = LL_LAYER_SPACING;
+        LL_NodeSpacing = LL_NODE_SPACING;
+        LL_Margin = LL_MARGIN;
+        LL_Width = LL_Height = 0;
+        LL_LayerCount = 0;
+    }
+
+    void layout(const SpacerGraph& graph);
+
+    // save and restore the node positions so that a layout can be reused,
+    // read returns false if the stream doesn't hold a layout for nodeCount nodes
+    void write(std::ostream& out, int nodeCount) const;
+    bool read(std::istream& in, int nodeCount);
+
+    inline void setLayerSpacing(double d){LL_LayerSpacing = d;}
+    inline void setNodeSpacing(double d){LL_NodeSpacing = d;}
+
+    inline double getX(int id) const {return LL_X[id];}
+    inline double getY(int id) const {return LL_Y[id];}
+    inline int getLayer(int id) const {return LL_Layer[id];}
+    inline int getLayerCount(void) const {return LL_LayerCount;}
+    inline double getWidth(void) const {return LL_Width;}
+    inline double getHeight(void) const {return LL_Height;}
+
+private:
+    void rankNodes(const SpacerGraph& graph, std::vector<int>& topologicalPosition);
+    void orderLayers(const SpacerGraph& graph, std::vector<std::vector<int> >& layers);
+    void sweep(const SpacerGraph& graph, std::vector<int>& layer, bool useSuccessors);
+
+    std::vector<double> LL_X;
+    std::vector<double> LL_Y;
+    std::vector<int> LL_Layer;
+    std::vector<int> LL_Order;
+    int LL_LayerCount;
+    double LL_LayerSpacing;
+    double LL_NodeSpacing;
+    double LL_Margin;
+    double LL_Width;
+    double LL_Height;
+};
+
+#endif
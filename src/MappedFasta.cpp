@@ -0,0 +1,165 @@
+// MappedFasta.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedFasta.h"
+#include "SeqKernels.h"
+#include <libcrispr/Exception.h>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFasta::MappedFasta()
+{
+    MF_Data = NULL;
+    MF_Size = 0;
+}
+
+MappedFasta::~MappedFasta()
+{
+    close();
+}
+
+void MappedFasta::open(const std::string& fileName)
+{
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        std::stringstream msg;
+        msg<<"failed to open reference file: "<<fileName<<": "<<strerror(errno);
+        if (fd != -1) {
+            ::close(fd);
+        }
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+    MF_FileName = fileName;
+    MF_Size = static_cast<size_t>(info.st_size);
+    if (MF_Size) {
+        void * data = mmap(NULL, MF_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            std::stringstream msg;
+            msg<<"failed to map reference file: "<<fileName<<": "<<strerror(errno);
+            ::close(fd);
+            MF_Size = 0;
+            throw crispr::runtime_exception(__FILE__,
+                                            __LINE__,
+                                            __PRETTY_FUNCTION__,
+                                            msg);
+        }
+        MF_Data = static_cast<const char *>(data);
+#ifdef MADV_WILLNEED
+        // the whole file is going to be read, start on it now
+        madvise(data, MF_Size, MADV_WILLNEED);
+#endif
+    }
+    // the mapping holds its own reference to the file
+    ::close(fd);
+    findRecords();
+}
+
+void MappedFasta::close(void)
+{
+    if (MF_Data != NULL) {
+        munmap(const_cast<char *>(MF_Data), MF_Size);
+    }
+    MF_Data = NULL;
+    MF_Size = 0;
+    MF_Records.clear();
+}
+
+void MappedFasta::findRecords(void)
+{
+    if (!MF_Size) {
+        return;
+    }
+    if (MF_Data[0] != '>') {
+        std::stringstream msg;
+        msg<<MF_FileName<<" is not a FASTA file";
+        close();
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+
+    // '>' can only start a header, so memchr jumps from one record to the next
+    const char * end = MF_Data + MF_Size;
+    const char * header = MF_Data;
+    while (header != NULL) {
+        const char * line_end = static_cast<const char *>(memchr(header, '\n', end - header));
+        const char * sequence = (line_end == NULL) ? end : line_end + 1;
+        const char * name_end = header + 1;
+        while (name_end < sequence && !isspace(static_cast<unsigned char>(*name_end))) {
+            ++name_end;
+        }
+
+        const char * next = sequence;
+        while (next < end) {
+            next = static_cast<const char *>(memchr(next, '>', end - next));
+            if (next == NULL || next[-1] == '\n') {
+                break;
+            }
+            ++next;
+        }
+        if (next >= end) {
+            next = NULL;
+        }
+
+        FastaRecord record;
+        record.Name.assign(header + 1, name_end);
+        record.SequenceStart = sequence - MF_Data;
+        record.SequenceEnd = ((next == NULL) ? end : next) - MF_Data;
+        MF_Records.push_back(record);
+        header = next;
+    }
+}
+
+size_t MappedFasta::encodeRange(size_t start, size_t end, size_t maxBases, std::vector<unsigned char>& codes) const
+{
+    size_t appended = 0;
+    const char * cursor = MF_Data + start;
+    const char * stop = MF_Data + end;
+    while (cursor < stop && appended < maxBases) {
+        const char * line_end = static_cast<const char *>(memchr(cursor, '\n', stop - cursor));
+        if (line_end == NULL) {
+            line_end = stop;
+        }
+        size_t length = line_end - cursor;
+        if (length && cursor[length - 1] == '\r') {
+            --length;
+        }
+        if (length > maxBases - appended) {
+            length = maxBases - appended;
+        }
+        if (length) {
+            size_t offset = codes.size();
+            codes.resize(offset + length);
+            encodeBases(cursor, length, &codes[0] + offset);
+            appended += length;
+        }
+        cursor = line_end + 1;
+    }
+    return appended;
+}
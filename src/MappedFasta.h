@@ -0,0 +1,69 @@
+/*
+ * MappedFasta.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_MappedFasta_h
+#define crisprtools_MappedFasta_h
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// a record of a mapped FASTA file, the offsets are bytes into the file
+typedef struct __FastaRecord {
+    std::string Name;               // the header up to the first space
+    size_t SequenceStart;           // first byte after the header line
+    size_t SequenceEnd;             // the '>' of the next record or the end of the file
+} FastaRecord;
+
+// A FASTA file mapped into memory rather than read, so that any number
+// of threads can work on different parts of it without copying.  Only the
+// headers are found when the file is opened, the sequence lines are left
+// to the kernel to page in as they are used
+class MappedFasta {
+public:
+    MappedFasta();
+    ~MappedFasta();
+
+    // throws crispr::runtime_exception if the file can't be mapped or
+    // doesn't look like FASTA
+    void open(const std::string& fileName);
+    void close(void);
+
+    inline const std::string& getFileName(void) const {return MF_FileName;}
+    inline const std::vector<FastaRecord>& records(void) const {return MF_Records;}
+    inline size_t size(void) const {return MF_Size;}
+
+    // append the codes (see encodeBases) of the bases between two offsets
+    // of the same record to codes, skipping line breaks, and stop after
+    // maxBases.  Returns the number of bases appended
+    size_t encodeRange(size_t start, size_t end, size_t maxBases, std::vector<unsigned char>& codes) const;
+
+private:
+    MappedFasta(const MappedFasta&);
+    MappedFasta& operator=(const MappedFasta&);
+
+    void findRecords(void);
+
+    std::string MF_FileName;
+    const char * MF_Data;
+    size_t MF_Size;
+    std::vector<FastaRecord> MF_Records;
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include <libcrispr/writer.h>
 #include <libcrispr/reader.h>
 #include "config.h"
+#include "Profile.h"
 #include <getopt.h>
 #include <sstream>
 
@@ -89,7 +90,7 @@ int mergeMain (int argc, char ** argv)
                     
                     // create a file parser
                     crispr::xml::reader input_file;                    
-                    xercesc::DOMDocument * input_doc = input_file.setFileParser(argv[opt_index]);
+                    xercesc::DOMDocument * input_doc = profiledParse(input_file, argv[opt_index]);
                     // Get the top-level element: 
                     xercesc::DOMElement* elementRoot = input_doc->getDocumentElement();
                     
@@ -97,11 +98,14 @@ int mergeMain (int argc, char ** argv)
                                                                    __LINE__,
                                                                    __PRETTY_FUNCTION__,
                                                                    "empty XML document" ));
+
+                    ProfileTimer walk_timer(PF_WALK);
                     
                     // get the children
                     for (xercesc::DOMElement * currentElement = elementRoot->getFirstElementChild(); 
                          currentElement != NULL; 
                          currentElement = currentElement->getNextElementSibling()) {
+                        TraceSpan group_span(currentElement);
 
                         if( xercesc::XMLString::equals(currentElement->getTagName(), input_file.tag_Group())) {
                             
@@ -128,13 +132,14 @@ int mergeMain (int argc, char ** argv)
                                     mt.insert(gid);
                                 }
                             }
+                            ProfileTimer import_timer(PF_IMPORT);
                             master_root_elem->appendChild(master_doc->importNode(currentElement, true));
                         }
                         
                     }
                     opt_index++;
                 }   
-                master_DOM.printDOMToFile(mt.getFileName());
+                profiledWrite(master_DOM, mt.getFileName());
             } else {
                 throw crispr::xml_exception(__FILE__, 
                                             __LINE__,
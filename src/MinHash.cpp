@@ -0,0 +1,112 @@
+// MinHash.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "MinHash.h"
+#include "SeqKernels.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// the finishing step of MurmurHash3, spreads every input bit over the
+// whole value
+static inline uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= MH_MIX_FIRST;
+    x ^= x >> 33;
+    x *= MH_MIX_SECOND;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t fnvHash(const char * sequence, size_t length)
+{
+    uint64_t hash = MH_FNV_OFFSET;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(sequence[i]);
+        hash *= MH_FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t canonicalSequenceHash(const char * sequence, size_t length)
+{
+    std::vector<char> forward(length + 1);
+    std::vector<char> reverse(length + 1);
+    for (size_t i = 0; i < length; ++i) {
+        char c = sequence[i];
+        forward[i] = (c >= 'a' && c <= 'z') ? c - 0x20 : c;
+    }
+    reverseComplement(&forward[0], length, &reverse[0]);
+    const char * smaller = (memcmp(&reverse[0], &forward[0], length) < 0) ? &reverse[0] : &forward[0];
+    return mix(fnvHash(smaller, length));
+}
+
+void minHashSketch(const uint64_t * hashes, size_t count, int sketchSize, uint64_t * sketch)
+{
+    // the hash functions are the mix of the value xor a seed, the seeds
+    // are fixed so that sketches of different runs can be compared
+    std::vector<uint64_t> seeds(sketchSize);
+    for (int i = 0; i < sketchSize; ++i) {
+        seeds[i] = mix(MH_FNV_OFFSET + static_cast<uint64_t>(i));
+        sketch[i] = ~static_cast<uint64_t>(0);
+    }
+    for (size_t j = 0; j < count; ++j) {
+        uint64_t value = hashes[j];
+        for (int i = 0; i < sketchSize; ++i) {
+            uint64_t h = mix(value ^ seeds[i]);
+            if (h < sketch[i]) {
+                sketch[i] = h;
+            }
+        }
+    }
+}
+
+double lshCandidateProbability(double jaccard, int rows, int bands)
+{
+    return 1.0 - std::pow(1.0 - std::pow(jaccard, rows), bands);
+}
+
+int lshRowsForThreshold(int sketchSize, double threshold)
+{
+    int best = 1;
+    for (int rows = 2; rows <= sketchSize; ++rows) {
+        if (lshCandidateProbability(threshold, rows, sketchSize / rows) >= MH_MIN_RECALL) {
+            best = rows;
+        }
+    }
+    return best;
+}
+
+size_t sortedIntersectionSize(const uint64_t * a, size_t aCount, const uint64_t * b, size_t bCount)
+{
+    size_t shared = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < aCount && j < bCount) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            ++shared;
+            ++i;
+            ++j;
+        }
+    }
+    return shared;
+}
@@ -0,0 +1,64 @@
+/*
+ * MinHash.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_MinHash_h
+#define crisprtools_MinHash_h
+
+#include <cstddef>
+#include <stdint.h>
+
+// 64 bit constants are built from 32 bit halves since long long literals
+// aren't allowed in C++98
+#define MH_FNV_OFFSET ((static_cast<uint64_t>(0xcbf29ce4) << 32) | 0x84222325)
+#define MH_FNV_PRIME ((static_cast<uint64_t>(0x00000100) << 32) | 0x000001b3)
+#define MH_MIX_FIRST ((static_cast<uint64_t>(0xff51afd7) << 32) | 0xed558ccd)
+#define MH_MIX_SECOND ((static_cast<uint64_t>(0xc4ceb9fe) << 32) | 0x1a85ec53)
+#define MH_DEFAULT_SKETCH_SIZE 128  // minimums kept for each set
+#define MH_MAX_SKETCH_SIZE 4096
+#define MH_MIN_RECALL 0.99          // chance that a pair right on the threshold is a candidate
+
+// MinHash sketches of sets of spacers and the locality sensitive hashing
+// used to find sets that are likely to be similar.  Two sets agree on each
+// minimum with a probability equal to their Jaccard index, so cutting a
+// sketch into bands of r minimums and calling two sets candidates when
+// any band is the same makes pairs above a threshold candidates while
+// almost all unrelated pairs never meet
+
+// a hash of a sequence that ignores case and is the same for the
+// reverse complement, so that both strands are the same spacer
+uint64_t canonicalSequenceHash(const char * sequence, size_t length);
+
+// the smallest value of each of sketchSize hash functions over count hashes,
+// or all ones for an empty set
+void minHashSketch(const uint64_t * hashes, size_t count, int sketchSize, uint64_t * sketch);
+
+// the chance that two sets with this Jaccard index agree on every minimum
+// of at least one of bands bands of rows minimums
+double lshCandidateProbability(double jaccard, int rows, int bands);
+
+// the most minimums per band, with as many bands as fit in the sketch,
+// that still make a pair right on the threshold a candidate with a
+// probability of at least MH_MIN_RECALL.  More rows means fewer
+// candidates below the threshold to check
+int lshRowsForThreshold(int sketchSize, double threshold);
+
+// the number of values in both of two sorted arrays without repeats
+size_t sortedIntersectionSize(const uint64_t * a, size_t aCount, const uint64_t * b, size_t bCount);
+
+#endif
@@ -0,0 +1,660 @@
+// NativeRenderer.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "NativeRenderer.h"
+#include <libcrispr/Exception.h>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+
+#define NR_WHITE 0xffffff
+#define NR_BLACK 0x000000
+
+// A chain that leads back to its own start is drawn as a small loop
+// sitting on top of the node, sized in node radii
+#define NR_LOOP_RADIUS 0.5
+#define NR_LOOP_CENTRE 1.1          // distance from the middle of the node to the middle of the loop
+#define NR_LOOP_SEGMENTS 24         // straight lines making up a loop in a PNG
+
+//
+// 3x5 pixel font used for PNG labels, one octal digit per row
+//
+static const char * font_characters = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_-.";
+static const unsigned short font_glyphs[] = {
+    075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, 075757, 075717,
+    025755, 065656, 034443, 065556, 074647, 074644, 034553, 055755, 072227, 011152,
+    055655, 044447, 057755, 065555, 025552, 065644, 025563, 065655, 034216, 072222,
+    055557, 055552, 055775, 055255, 055222, 071247, 000007, 000700, 000002
+};
+
+static std::string escapePdf(const std::string& str)
+{
+    std::string escaped;
+    escaped.reserve(str.length());
+    for (size_t i = 0; i < str.length(); ++i) {
+        if (str[i] == '(' || str[i] == ')' || str[i] == '\\') {
+            escaped += '\\';
+        }
+        escaped += str[i];
+    }
+    return escaped;
+}
+
+static void pdfColour(std::ostream& out, int rgb, const char * op)
+{
+    out << ((rgb >> 16) & 0xff) / 255.0 << ' ' << ((rgb >> 8) & 0xff) / 255.0 << ' ' << (rgb & 0xff) / 255.0 << ' ' << op << '\n';
+}
+
+// where a self loop crosses the node outline, at (x + h, y - a) and
+// (x - h, y - a) with y going down the page, in node radii.  The loop
+// leaves from the right and comes back in on the left
+static void loopEnds(double& h, double& a)
+{
+    a = (1 - NR_LOOP_RADIUS * NR_LOOP_RADIUS + NR_LOOP_CENTRE * NR_LOOP_CENTRE) / (2 * NR_LOOP_CENTRE);
+    h = std::sqrt(1 - a * a);
+}
+
+static std::string escapeXml(const std::string& str)
+{
+    std::string escaped;
+    escaped.reserve(str.length());
+    for (size_t i = 0; i < str.length(); ++i) {
+        switch (str[i]) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += str[i]; break;
+        }
+    }
+    return escaped;
+}
+
+//
+// PNG support.  The image data is deflated with fixed Huffman codes and
+// only run length matches (distance of one pixel) which is plenty for the
+// large flat areas of a graph drawing
+//
+class PngBitWriter {
+public:
+    PngBitWriter(std::vector<unsigned char>& out) : BW_Out(out)
+    {
+        BW_Buffer = 0;
+        BW_Count = 0;
+    }
+
+    void put(unsigned int bits, int length)
+    {
+        BW_Buffer |= bits << BW_Count;
+        BW_Count += length;
+        while (BW_Count >= 8) {
+            BW_Out.push_back(static_cast<unsigned char>(BW_Buffer & 0xff));
+            BW_Buffer >>= 8;
+            BW_Count -= 8;
+        }
+    }
+
+    // huffman codes are packed starting from the most significant bit
+    void putCode(unsigned int code, int length)
+    {
+        unsigned int reversed = 0;
+        for (int i = 0; i < length; ++i) {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        put(reversed, length);
+    }
+
+    void flush(void)
+    {
+        if (BW_Count > 0) {
+            BW_Out.push_back(static_cast<unsigned char>(BW_Buffer & 0xff));
+        }
+        BW_Buffer = 0;
+        BW_Count = 0;
+    }
+
+private:
+    std::vector<unsigned char>& BW_Out;
+    unsigned int BW_Buffer;
+    int BW_Count;
+};
+
+static const int length_base[] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const int length_extra[] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+
+static void putLiteral(PngBitWriter& writer, int literal)
+{
+    if (literal <= 143) {
+        writer.putCode(0x30 + literal, 8);
+    } else {
+        writer.putCode(0x190 + literal - 144, 9);
+    }
+}
+
+static void putSymbol(PngBitWriter& writer, int symbol)
+{
+    if (symbol <= 279) {
+        writer.putCode(symbol - 256, 7);
+    } else {
+        writer.putCode(0xc0 + symbol - 280, 8);
+    }
+}
+
+static void putRun(PngBitWriter& writer, int length, int distanceCode)
+{
+    int index = 28;
+    while (length_base[index] > length) {
+        --index;
+    }
+    putSymbol(writer, 257 + index);
+    writer.put(length - length_base[index], length_extra[index]);
+    writer.putCode(distanceCode, 5);
+}
+
+static void deflateRuns(const std::vector<unsigned char>& raw, std::vector<unsigned char>& compressed)
+{
+    // zlib header: deflate, 32K window, no dictionary
+    compressed.push_back(0x78);
+    compressed.push_back(0x01);
+
+    PngBitWriter writer(compressed);
+    writer.put(1, 1);   // final block
+    writer.put(1, 2);   // fixed huffman codes
+
+    size_t i = 0;
+    size_t raw_length = raw.size();
+    while (i < raw_length) {
+        // distance code 2 is a distance of 3 bytes, ie. the previous pixel
+        size_t run = 0;
+        if (i >= 3) {
+            while (i + run < raw_length && run < 258 && raw[i + run] == raw[i + run - 3]) {
+                ++run;
+            }
+        }
+        if (run >= 3) {
+            putRun(writer, static_cast<int>(run), 2);
+            i += run;
+        } else {
+            putLiteral(writer, raw[i]);
+            ++i;
+        }
+    }
+    putSymbol(writer, 256);
+    writer.flush();
+
+    unsigned long a = 1, b = 0;
+    for (i = 0; i < raw_length; ++i) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    unsigned long adler = (b << 16) | a;
+    compressed.push_back(static_cast<unsigned char>((adler >> 24) & 0xff));
+    compressed.push_back(static_cast<unsigned char>((adler >> 16) & 0xff));
+    compressed.push_back(static_cast<unsigned char>((adler >> 8) & 0xff));
+    compressed.push_back(static_cast<unsigned char>(adler & 0xff));
+}
+
+static unsigned long crc32(const unsigned char * data, size_t length, unsigned long crc)
+{
+    static unsigned long table[256];
+    static bool table_made = false;
+    if (!table_made) {
+        for (unsigned long n = 0; n < 256; ++n) {
+            unsigned long c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        table_made = true;
+    }
+    crc ^= 0xffffffffUL;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffUL;
+}
+
+static void putUint32(std::vector<unsigned char>& buffer, unsigned long i)
+{
+    buffer.push_back(static_cast<unsigned char>((i >> 24) & 0xff));
+    buffer.push_back(static_cast<unsigned char>((i >> 16) & 0xff));
+    buffer.push_back(static_cast<unsigned char>((i >> 8) & 0xff));
+    buffer.push_back(static_cast<unsigned char>(i & 0xff));
+}
+
+static void writeChunk(std::ostream& out, const char * type, const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> chunk;
+    chunk.reserve(data.size() + 12);
+    putUint32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putUint32(chunk, crc32(&chunk[4], data.size() + 4, 0));
+    out.write(reinterpret_cast<const char *>(&chunk[0]), chunk.size());
+}
+
+RasterImage::RasterImage(int width, int height)
+{
+    RI_Width = (width > 0) ? width : 1;
+    RI_Height = (height > 0) ? height : 1;
+    RI_Pixels.assign(static_cast<size_t>(RI_Width) * RI_Height * 3, 0xff);
+}
+
+void RasterImage::setPixel(int x, int y, int rgb)
+{
+    if (x < 0 || y < 0 || x >= RI_Width || y >= RI_Height) {
+        return;
+    }
+    size_t offset = (static_cast<size_t>(y) * RI_Width + x) * 3;
+    RI_Pixels[offset] = (rgb >> 16) & 0xff;
+    RI_Pixels[offset + 1] = (rgb >> 8) & 0xff;
+    RI_Pixels[offset + 2] = rgb & 0xff;
+}
+
+void RasterImage::drawLine(double x0, double y0, double x1, double y1, int rgb)
+{
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    int steps = static_cast<int>(std::max(std::fabs(dx), std::fabs(dy))) + 1;
+    for (int i = 0; i <= steps; ++i) {
+        double t = static_cast<double>(i) / steps;
+        setPixel(static_cast<int>(x0 + dx * t + 0.5), static_cast<int>(y0 + dy * t + 0.5), rgb);
+    }
+}
+
+void RasterImage::fillCircle(double cx, double cy, double r, int fill, int outline)
+{
+    int min_y = static_cast<int>(cy - r - 1), max_y = static_cast<int>(cy + r + 1);
+    int min_x = static_cast<int>(cx - r - 1), max_x = static_cast<int>(cx + r + 1);
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            double d = std::sqrt((x - cx) * (x - cx) + (y - cy) * (y - cy));
+            if (d <= r - 1) {
+                setPixel(x, y, fill);
+            } else if (d <= r) {
+                setPixel(x, y, outline);
+            }
+        }
+    }
+}
+
+void RasterImage::fillDiamond(double cx, double cy, double r, int fill, int outline)
+{
+    int min_y = static_cast<int>(cy - r - 1), max_y = static_cast<int>(cy + r + 1);
+    int min_x = static_cast<int>(cx - r - 1), max_x = static_cast<int>(cx + r + 1);
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            double d = std::fabs(x - cx) + std::fabs(y - cy);
+            if (d <= r - 1.5) {
+                setPixel(x, y, fill);
+            } else if (d <= r) {
+                setPixel(x, y, outline);
+            }
+        }
+    }
+}
+
+void RasterImage::drawText(double cx, double cy, const std::string& text, int scale, int rgb)
+{
+    // each glyph is 3 pixels wide with a 1 pixel gap
+    int text_width = (static_cast<int>(text.length()) * 4 - 1) * scale;
+    int left = static_cast<int>(cx) - text_width / 2;
+    int top = static_cast<int>(cy) - (5 * scale) / 2;
+    for (size_t i = 0; i < text.length(); ++i) {
+        const char * found = strchr(font_characters, toupper(text[i]));
+        if (found == NULL || *found == '\0') {
+            continue;
+        }
+        unsigned short glyph = font_glyphs[found - font_characters];
+        for (int row = 0; row < 5; ++row) {
+            int bits = (glyph >> (3 * (4 - row))) & 7;
+            for (int col = 0; col < 3; ++col) {
+                if (bits & (4 >> col)) {
+                    for (int sy = 0; sy < scale; ++sy) {
+                        for (int sx = 0; sx < scale; ++sx) {
+                            setPixel(left + (static_cast<int>(i) * 4 + col) * scale + sx, top + row * scale + sy, rgb);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void RasterImage::writePng(std::ostream& out)
+{
+    static const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.write(reinterpret_cast<const char *>(signature), 8);
+
+    std::vector<unsigned char> header;
+    putUint32(header, RI_Width);
+    putUint32(header, RI_Height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // truecolour
+    header.push_back(0);    // deflate
+    header.push_back(0);    // adaptive filtering
+    header.push_back(0);    // no interlace
+    writeChunk(out, "IHDR", header);
+
+    // every scanline starts with the filter type, we never filter
+    size_t row_length = static_cast<size_t>(RI_Width) * 3;
+    std::vector<unsigned char> raw;
+    raw.reserve((row_length + 1) * RI_Height);
+    for (int y = 0; y < RI_Height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), RI_Pixels.begin() + y * row_length, RI_Pixels.begin() + (y + 1) * row_length);
+    }
+    std::vector<unsigned char> compressed;
+    deflateRuns(raw, compressed);
+    writeChunk(out, "IDAT", compressed);
+    writeChunk(out, "IEND", std::vector<unsigned char>());
+}
+
+bool NativeRenderer::isSupportedFormat(const char * format)
+{
+    return (!strcmp(format, "svg") || !strcmp(format, "png"));
+}
+
+int NativeRenderer::nodeColour(const SpacerGraph::SGNode& node)
+{
+    if (node.hasCoverage) {
+        return NR_Rainbow->getRGB(node.coverage);
+    }
+    return NR_WHITE;
+}
+
+void NativeRenderer::renderToFile(const SpacerGraph& graph,
+                                  const LayeredLayout& layout,
+                                  const char * format,
+                                  std::string fileName)
+{
+    std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!out) {
+        std::stringstream msg;
+        msg << "failed to open output file: " << fileName;
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+    render(graph, layout, format, out);
+}
+
+void NativeRenderer::render(const SpacerGraph& graph,
+                            const LayeredLayout& layout,
+                            const char * format,
+                            std::ostream& out)
+{
+    if (!strcmp(format, "png")) {
+        renderPng(graph, layout, out);
+    } else {
+        renderSvg(graph, layout, out);
+    }
+}
+
+void NativeRenderer::renderSvg(const SpacerGraph& graph,
+                               const LayeredLayout& layout,
+                               std::ostream& out)
+{
+    double width = layout.getWidth();
+    double height = layout.getHeight();
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height;
+    out << "\" viewBox=\"0 0 " << width << ' ' << height << "\">\n";
+    out << "<title>" << escapeXml(graph.getName()) << "</title>\n";
+    renderSvgDefs(out);
+    renderSvgBody(graph, layout, out);
+    out << "</svg>\n";
+}
+
+void NativeRenderer::renderSvgDefs(std::ostream& out)
+{
+    out << "<defs><marker id=\"arrow\" viewBox=\"0 0 10 10\" refX=\"10\" refY=\"5\" markerWidth=\"6\" markerHeight=\"6\" orient=\"auto\">";
+    out << "<path d=\"M0,0 L10,5 L0,10 z\"/></marker></defs>\n";
+}
+
+void NativeRenderer::renderSvgBody(const SpacerGraph& graph,
+                                   const LayeredLayout& layout,
+                                   std::ostream& out)
+{
+    // edges go underneath the nodes, shortened so that the arrows touch the node outline
+    out << "<g stroke=\"black\" stroke-width=\"1\" marker-end=\"url(#arrow)\">\n";
+    double loop_h, loop_a;
+    loopEnds(loop_h, loop_a);
+    for (int tail = 0; tail < graph.nodeCount(); ++tail) {
+        const SpacerGraph::adjacencyList& out_edges = graph.successors(tail);
+        SpacerGraph::adjacencyList::const_iterator iter;
+        for (iter = out_edges.begin(); iter != out_edges.end(); ++iter) {
+            if (*iter == tail) {
+                double x = layout.getX(tail), y = layout.getY(tail);
+                out << "<path d=\"M" << x + loop_h * NR_NodeRadius << ',' << y - loop_a * NR_NodeRadius;
+                out << " A" << NR_LOOP_RADIUS * NR_NodeRadius << ',' << NR_LOOP_RADIUS * NR_NodeRadius << " 0 1 0 ";
+                out << x - loop_h * NR_NodeRadius << ',' << y - loop_a * NR_NodeRadius << "\" fill=\"none\"/>\n";
+                continue;
+            }
+            double x0 = layout.getX(tail), y0 = layout.getY(tail);
+            double x1 = layout.getX(*iter), y1 = layout.getY(*iter);
+            double length = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+            if (length <= 2 * NR_NodeRadius) {
+                continue;
+            }
+            double ux = (x1 - x0) / length, uy = (y1 - y0) / length;
+            out << "<line x1=\"" << x0 + ux * NR_NodeRadius << "\" y1=\"" << y0 + uy * NR_NodeRadius;
+            out << "\" x2=\"" << x1 - ux * NR_NodeRadius << "\" y2=\"" << y1 - uy * NR_NodeRadius << "\"/>\n";
+        }
+    }
+    out << "</g>\n";
+
+    out << "<g stroke=\"black\" font-family=\"Helvetica,Arial,sans-serif\" font-size=\"" << NR_FONT_SIZE << "\" text-anchor=\"middle\">\n";
+    char fill[RB_COLOUR_LENGTH];
+    for (int i = 0; i < graph.nodeCount(); ++i) {
+        const SpacerGraph::SGNode& node = graph.node(i);
+        double x = layout.getX(i), y = layout.getY(i);
+        Rainbow::packed2Hex(nodeColour(node), fill);
+        if (node.type == SpacerGraph::FLANKER) {
+            out << "<polygon points=\"" << x - NR_NodeRadius << ',' << y << ' ' << x << ',' << y - NR_NodeRadius << ' ';
+            out << x + NR_NodeRadius << ',' << y << ' ' << x << ',' << y + NR_NodeRadius << "\" fill=\"#" << fill << "\"/>\n";
+        } else {
+            out << "<circle cx=\"" << x << "\" cy=\"" << y << "\" r=\"" << NR_NodeRadius << "\" fill=\"#" << fill << "\"/>\n";
+        }
+        out << "<text x=\"" << x << "\" y=\"" << y + NR_FONT_SIZE / 3 << "\" stroke=\"none\">" << escapeXml(graph.label(i));
+        if (node.length > 1) {
+            // the details of a collapsed chain show up as a tooltip
+            out << "<title>" << node.length << " spacers";
+            if (node.hasCoverage) {
+                out << ", coverage " << node.minCoverage << '-' << node.maxCoverage;
+            }
+            out << "</title>";
+        }
+        out << "</text>\n";
+    }
+    out << "</g>\n";
+}
+
+void NativeRenderer::renderPdfPage(const SpacerGraph& graph,
+                                   const LayeredLayout& layout,
+                                   std::ostream& out)
+{
+    //-----
+    // PDF puts the origin in the bottom left so every y is flipped.  The
+    // caller is expected to make the page getPdfScale() times the layout
+    // size, which keeps huge groups inside the page size limits of readers
+    //
+    double height = layout.getHeight();
+    double scale = getPdfScale(layout);
+
+    // PDF doesn't understand exponents so every number is written out in full
+    std::ios_base::fmtflags old_flags = out.flags();
+    std::streamsize old_precision = out.precision(3);
+    out.setf(std::ios::fixed, std::ios::floatfield);
+    if (scale < 1.0) {
+        out << scale << " 0 0 " << scale << " 0 0 cm\n";
+    }
+    out << "1 w 0 0 0 RG 0 0 0 rg\n";
+
+    // circles are four bezier curves
+    double r = NR_NodeRadius;
+    double k = r * 0.5523;
+    double loop_h, loop_a;
+    loopEnds(loop_h, loop_a);
+    for (int tail = 0; tail < graph.nodeCount(); ++tail) {
+        const SpacerGraph::adjacencyList& out_edges = graph.successors(tail);
+        SpacerGraph::adjacencyList::const_iterator iter;
+        for (iter = out_edges.begin(); iter != out_edges.end(); ++iter) {
+            if (*iter == tail) {
+                // the whole loop is drawn, the node covers the part inside it
+                double lr = NR_LOOP_RADIUS * r, lk = NR_LOOP_RADIUS * k;
+                double x = layout.getX(tail), y = height - layout.getY(tail) + NR_LOOP_CENTRE * r;
+                out << x + lr << ' ' << y << " m ";
+                out << x + lr << ' ' << y + lk << ' ' << x + lk << ' ' << y + lr << ' ' << x << ' ' << y + lr << " c ";
+                out << x - lk << ' ' << y + lr << ' ' << x - lr << ' ' << y + lk << ' ' << x - lr << ' ' << y << " c ";
+                out << x - lr << ' ' << y - lk << ' ' << x - lk << ' ' << y - lr << ' ' << x << ' ' << y - lr << " c ";
+                out << x + lk << ' ' << y - lr << ' ' << x + lr << ' ' << y - lk << ' ' << x + lr << ' ' << y << " c S\n";
+                double hx = layout.getX(tail) - loop_h * r, hy = height - layout.getY(tail) + loop_a * r;
+                double ux = (NR_LOOP_CENTRE - loop_a) / NR_LOOP_RADIUS, uy = -loop_h / NR_LOOP_RADIUS;
+                double head = r / 3;
+                out << hx << ' ' << hy << " m ";
+                out << hx - ux * head - uy * head / 2 << ' ' << hy - uy * head + ux * head / 2 << " l ";
+                out << hx - ux * head + uy * head / 2 << ' ' << hy - uy * head - ux * head / 2 << " l f\n";
+                continue;
+            }
+            double x0 = layout.getX(tail), y0 = height - layout.getY(tail);
+            double x1 = layout.getX(*iter), y1 = height - layout.getY(*iter);
+            double length = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+            if (length <= 2 * NR_NodeRadius) {
+                continue;
+            }
+            double ux = (x1 - x0) / length, uy = (y1 - y0) / length;
+            double hx = x1 - ux * NR_NodeRadius, hy = y1 - uy * NR_NodeRadius;
+            double head = NR_NodeRadius / 3;
+            out << x0 + ux * NR_NodeRadius << ' ' << y0 + uy * NR_NodeRadius << " m " << hx << ' ' << hy << " l S\n";
+            out << hx << ' ' << hy << " m ";
+            out << hx - ux * head - uy * head / 2 << ' ' << hy - uy * head + ux * head / 2 << " l ";
+            out << hx - ux * head + uy * head / 2 << ' ' << hy - uy * head - ux * head / 2 << " l f\n";
+        }
+    }
+
+    for (int i = 0; i < graph.nodeCount(); ++i) {
+        const SpacerGraph::SGNode& node = graph.node(i);
+        double x = layout.getX(i), y = height - layout.getY(i);
+        pdfColour(out, nodeColour(node), "rg");
+        if (node.type == SpacerGraph::FLANKER) {
+            out << x - r << ' ' << y << " m " << x << ' ' << y + r << " l " << x + r << ' ' << y << " l ";
+            out << x << ' ' << y - r << " l h B\n";
+        } else {
+            out << x + r << ' ' << y << " m ";
+            out << x + r << ' ' << y + k << ' ' << x + k << ' ' << y + r << ' ' << x << ' ' << y + r << " c ";
+            out << x - k << ' ' << y + r << ' ' << x - r << ' ' << y + k << ' ' << x - r << ' ' << y << " c ";
+            out << x - r << ' ' << y - k << ' ' << x - k << ' ' << y - r << ' ' << x << ' ' << y - r << " c ";
+            out << x + k << ' ' << y - r << ' ' << x + r << ' ' << y - k << ' ' << x + r << ' ' << y << " c B\n";
+        }
+        // Helvetica averages a little over half the font size per character
+        std::string label = graph.label(i);
+        out << "0 0 0 rg BT /F1 " << NR_FONT_SIZE << " Tf ";
+        out << x - label.length() * NR_FONT_SIZE * 0.28 << ' ' << y - NR_FONT_SIZE / 3 << " Td (" << escapePdf(label) << ") Tj ET\n";
+    }
+    out.flags(old_flags);
+    out.precision(old_precision);
+}
+
+double NativeRenderer::getPdfScale(const LayeredLayout& layout)
+{
+    double largest = std::max(layout.getWidth(), layout.getHeight());
+    if (largest > NR_MAX_PDF_PAGE) {
+        return NR_MAX_PDF_PAGE / largest;
+    }
+    return 1.0;
+}
+
+void NativeRenderer::renderPng(const SpacerGraph& graph,
+                               const LayeredLayout& layout,
+                               std::ostream& out)
+{
+    // huge graphs get scaled down rather than making an enormous image
+    double width = layout.getWidth();
+    double height = layout.getHeight();
+    double scale = 1.0;
+    if (width * height > NR_MAX_PIXELS) {
+        scale = std::sqrt(NR_MAX_PIXELS / (width * height));
+    }
+    if (width * scale > NR_MAX_DIMENSION) {
+        scale = NR_MAX_DIMENSION / width;
+    }
+    if (height * scale > NR_MAX_DIMENSION) {
+        scale = NR_MAX_DIMENSION / height;
+    }
+    RasterImage image(static_cast<int>(width * scale + 0.5), static_cast<int>(height * scale + 0.5));
+    double radius = std::max(2.0, NR_NodeRadius * scale);
+    double loop_h, loop_a;
+    loopEnds(loop_h, loop_a);
+
+    for (int tail = 0; tail < graph.nodeCount(); ++tail) {
+        const SpacerGraph::adjacencyList& out_edges = graph.successors(tail);
+        SpacerGraph::adjacencyList::const_iterator iter;
+        for (iter = out_edges.begin(); iter != out_edges.end(); ++iter) {
+            if (*iter == tail) {
+                // the whole loop is drawn, the node covers the part inside it
+                double x = layout.getX(tail) * scale, y = layout.getY(tail) * scale;
+                double lr = NR_LOOP_RADIUS * radius, ly = y - NR_LOOP_CENTRE * radius;
+                for (int i = 0; i < NR_LOOP_SEGMENTS; ++i) {
+                    double t0 = 2 * PI * i / NR_LOOP_SEGMENTS, t1 = 2 * PI * (i + 1) / NR_LOOP_SEGMENTS;
+                    image.drawLine(x + lr * std::cos(t0), ly + lr * std::sin(t0), x + lr * std::cos(t1), ly + lr * std::sin(t1), NR_BLACK);
+                }
+                double hx = x - loop_h * radius, hy = y - loop_a * radius;
+                double ux = (NR_LOOP_CENTRE - loop_a) / NR_LOOP_RADIUS, uy = loop_h / NR_LOOP_RADIUS;
+                double head = std::max(2.0, radius / 3);
+                image.drawLine(hx, hy, hx - ux * head - uy * head / 2, hy - uy * head + ux * head / 2, NR_BLACK);
+                image.drawLine(hx, hy, hx - ux * head + uy * head / 2, hy - uy * head - ux * head / 2, NR_BLACK);
+                continue;
+            }
+            double x0 = layout.getX(tail) * scale, y0 = layout.getY(tail) * scale;
+            double x1 = layout.getX(*iter) * scale, y1 = layout.getY(*iter) * scale;
+            double length = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+            if (length <= 2 * radius) {
+                continue;
+            }
+            double ux = (x1 - x0) / length, uy = (y1 - y0) / length;
+            double hx = x1 - ux * radius, hy = y1 - uy * radius;
+            image.drawLine(x0 + ux * radius, y0 + uy * radius, hx, hy, NR_BLACK);
+            // a small arrow head
+            double head = std::max(2.0, radius / 3);
+            image.drawLine(hx, hy, hx - ux * head - uy * head / 2, hy - uy * head + ux * head / 2, NR_BLACK);
+            image.drawLine(hx, hy, hx - ux * head + uy * head / 2, hy - uy * head - ux * head / 2, NR_BLACK);
+        }
+    }
+
+    int text_scale = static_cast<int>(scale + 0.5);
+    for (int i = 0; i < graph.nodeCount(); ++i) {
+        const SpacerGraph::SGNode& node = graph.node(i);
+        double x = layout.getX(i) * scale, y = layout.getY(i) * scale;
+        int fill = nodeColour(node);
+        if (node.type == SpacerGraph::FLANKER) {
+            image.fillDiamond(x, y, radius, fill, NR_BLACK);
+        } else {
+            image.fillCircle(x, y, radius, fill, NR_BLACK);
+        }
+        if (text_scale > 0) {
+            image.drawText(x, y, graph.label(i), text_scale, NR_BLACK);
+        }
+    }
+    image.writePng(out);
+}
@@ -0,0 +1,92 @@
+/*
+ * NativeRenderer.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_NativeRenderer_h
+#define crisprtools_NativeRenderer_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "SpacerGraph.h"
+#include "LayeredLayout.h"
+#include "Rainbow.h"
+
+#define NR_NODE_RADIUS 18.0         // radius of a spacer node, flankers use the same size
+#define NR_FONT_SIZE 9              // font size of the labels in SVG output
+#define NR_MAX_PIXELS 16777216      // largest PNG we will make before scaling the picture down
+#define NR_MAX_DIMENSION 32768      // largest width or height of a PNG
+#define NR_MAX_PDF_PAGE 14400.0     // largest page size in points that PDF readers accept
+
+// Simple RGB raster with just enough primitives to draw a spacer graph
+// and write it out as a PNG without needing any external libraries
+class RasterImage {
+public:
+    RasterImage(int width, int height);
+
+    inline int getWidth(void){return RI_Width;}
+    inline int getHeight(void){return RI_Height;}
+
+    void setPixel(int x, int y, int rgb);
+    void drawLine(double x0, double y0, double x1, double y1, int rgb);
+    void fillCircle(double cx, double cy, double r, int fill, int outline);
+    void fillDiamond(double cx, double cy, double r, int fill, int outline);
+    void drawText(double cx, double cy, const std::string& text, int scale, int rgb);
+    void writePng(std::ostream& out);
+
+private:
+    int RI_Width;
+    int RI_Height;
+    std::vector<unsigned char> RI_Pixels;
+};
+
+// Renders a laid out spacer graph straight to SVG, PNG or PDF.  This is used
+// by draw instead of Graphviz when the native layout is selected
+class NativeRenderer {
+public:
+    NativeRenderer(Rainbow * rainbow)
+    {
+        NR_Rainbow = rainbow;
+        NR_NodeRadius = NR_NODE_RADIUS;
+    }
+
+    static bool isSupportedFormat(const char * format);
+
+    void renderToFile(const SpacerGraph& graph, const LayeredLayout& layout, const char * format, std::string fileName);
+    void render(const SpacerGraph& graph, const LayeredLayout& layout, const char * format, std::ostream& out);
+    void renderSvg(const SpacerGraph& graph, const LayeredLayout& layout, std::ostream& out);
+    void renderPng(const SpacerGraph& graph, const LayeredLayout& layout, std::ostream& out);
+
+    // pieces of an SVG so that several groups can share one document,
+    // the body needs the arrow marker from the defs
+    void renderSvgDefs(std::ostream& out);
+    void renderSvgBody(const SpacerGraph& graph, const LayeredLayout& layout, std::ostream& out);
+
+    // the content stream of one PDF page, using the font resource /F1
+    void renderPdfPage(const SpacerGraph& graph, const LayeredLayout& layout, std::ostream& out);
+    static double getPdfScale(const LayeredLayout& layout);
+
+private:
+    // packed 0xRRGGBB fill colour of a node
+    int nodeColour(const SpacerGraph::SGNode& node);
+
+    Rainbow * NR_Rainbow;
+    double NR_NodeRadius;
+};
+
+#endif
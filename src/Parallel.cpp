@@ -0,0 +1,114 @@
+// Parallel.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "Parallel.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/StlExt.h>
+#include <vector>
+#include <unistd.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if HAVE_PTHREAD
+typedef struct __WorkQueue {
+    parallelTask task;
+    void * arg;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+} WorkQueue;
+
+static void * worker(void * data)
+{
+    WorkQueue * queue = static_cast<WorkQueue *>(data);
+    while (true) {
+        pthread_mutex_lock(&(queue->lock));
+        int index = queue->next++;
+        pthread_mutex_unlock(&(queue->lock));
+        if (index >= queue->count) {
+            break;
+        }
+        TraceSpan span("task", "item", index);
+        queue->task(index, queue->arg);
+    }
+    return NULL;
+}
+#endif
+
+void parallelFor(int count, int numThreads, parallelTask task, void * arg)
+{
+    ProfileTimer timer(PF_COMPUTE);
+    if (numThreads > count) {
+        numThreads = count;
+    }
+#if HAVE_PTHREAD
+    if (numThreads > 1) {
+        WorkQueue queue;
+        queue.task = task;
+        queue.arg = arg;
+        queue.count = count;
+        queue.next = 0;
+        pthread_mutex_init(&(queue.lock), NULL);
+
+        // the calling thread does its share of the work as well
+        std::vector<pthread_t> threads(numThreads - 1);
+        int started = 0;
+        for (int i = 0; i < numThreads - 1; ++i) {
+            if (0 != pthread_create(&threads[started], NULL, worker, &queue)) {
+                break;
+            }
+            ++started;
+        }
+        worker(&queue);
+        for (int i = 0; i < started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&(queue.lock));
+        return;
+    }
+#endif
+    for (int i = 0; i < count; ++i) {
+        TraceSpan span("task", "item", i);
+        task(i, arg);
+    }
+}
+
+int availableProcessors(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) {
+        return static_cast<int>(n);
+    }
+#endif
+    return 1;
+}
+
+int parseThreadCount(const char * str)
+{
+    int threads;
+    if (!from_string<int>(threads, str, std::dec) || threads < 0 || threads > PL_MAX_THREADS) {
+        throw crispr::input_exception("The number of threads must be a number between 0 and 256");
+    }
+    // zero means use everything we've got
+    if (threads == 0) {
+        threads = availableProcessors();
+    }
+    return threads;
+}
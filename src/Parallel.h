@@ -0,0 +1,43 @@
+/*
+ * Parallel.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_Parallel_h
+#define crisprtools_Parallel_h
+
+#include "config.h"
+
+#define PL_DEFAULT_THREADS 1        // number of threads unless -t is given
+#define PL_MAX_THREADS 256          // sanity limit on -t
+
+// the work done for one item, index is in [0, count) and arg is passed
+// through untouched.  Must be safe to call from several threads at once
+typedef void (*parallelTask)(int index, void * arg);
+
+// call task for every index from 0 to count - 1 using up to numThreads
+// threads.  Items are handed out one at a time so uneven work balances
+// itself.  Without pthreads, or with one thread, it's a plain loop
+void parallelFor(int count, int numThreads, parallelTask task, void * arg);
+
+// the number of processors online, or 1 if that can't be found
+int availableProcessors(void);
+
+// parse the argument of a -t option, throws crispr::input_exception if it's no good
+int parseThreadCount(const char * str);
+
+#endif
@@ -0,0 +1,265 @@
+// Profile.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "Profile.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+bool PF_Enabled = false;
+uint64_t PF_Counters[PF_NUM_COUNTERS];
+
+const char * const PF_PhaseNames[PF_NUM_PHASES] = {
+    "parse",
+    "walk",
+    "import",
+    "write",
+    "compute",
+    "read_count",
+    "layout",
+    "render",
+    "profile"
+};
+
+static const char * PF_CounterNames[PF_NUM_COUNTERS] = {
+    "groups",
+    "elements",
+    "bytes_read",
+    "bytes_written"
+};
+
+static double PF_Seconds[PF_NUM_PHASES];
+static uint64_t PF_Calls[PF_NUM_PHASES];
+static int PF_Current = -1;             // -1 when no phase is running
+static double PF_PhaseStart;
+static double PF_StartTime;
+static std::string PF_Command;
+static XMLCh * PF_GroupTag = NULL;
+static ProfileFormat PF_Format = PF_TSV;
+#if HAVE_PTHREAD
+static pthread_t PF_MainThread;
+#endif
+
+// returned by profileEnter for timers that have to be left alone
+#define PF_IGNORED -2
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double seconds(const struct timeval& tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void addFileSize(ProfileCounter counter, const char * fileName)
+{
+    struct stat file_stats;
+    if (0 == stat(fileName, &file_stats)) {
+        profileCount(counter, static_cast<uint64_t>(file_stats.st_size));
+    }
+}
+
+static void writeTsv(std::ostream& out, double wall, const struct rusage& usage)
+{
+    out<<"type\tname\tvalue\tcalls"<<std::endl;
+    double timed = 0;
+    for (int i = 0; i < PF_NUM_PHASES; ++i) {
+        if (PF_Calls[i]) {
+            out<<"phase\t"<<PF_PhaseNames[i]<<'\t'<<PF_Seconds[i]<<'\t'<<PF_Calls[i]<<std::endl;
+            timed += PF_Seconds[i];
+        }
+    }
+    out<<"phase\tother\t"<<((wall > timed) ? wall - timed : 0)<<'\t'<<std::endl;
+    for (int i = 0; i < PF_NUM_COUNTERS; ++i) {
+        out<<"counter\t"<<PF_CounterNames[i]<<'\t'<<PF_Counters[i]<<'\t'<<std::endl;
+    }
+    out<<"resource\twall_seconds\t"<<wall<<'\t'<<std::endl;
+    out<<"resource\tuser_seconds\t"<<seconds(usage.ru_utime)<<'\t'<<std::endl;
+    out<<"resource\tsystem_seconds\t"<<seconds(usage.ru_stime)<<'\t'<<std::endl;
+    out<<"resource\tpeak_rss_kib\t"<<usage.ru_maxrss<<'\t'<<std::endl;
+}
+
+static void writeJson(std::ostream& out, double wall, const struct rusage& usage)
+{
+    out<<"{\"command\": ";
+    writeJsonString(out, PF_Command.c_str());
+    out<<", ";
+    out<<"\"wall_seconds\": "<<wall<<", ";
+    out<<"\"user_seconds\": "<<seconds(usage.ru_utime)<<", ";
+    out<<"\"system_seconds\": "<<seconds(usage.ru_stime)<<", ";
+    out<<"\"peak_rss_kib\": "<<usage.ru_maxrss<<", ";
+    out<<"\"phases\": {";
+    double timed = 0;
+    for (int i = 0; i < PF_NUM_PHASES; ++i) {
+        if (PF_Calls[i]) {
+            out<<"\""<<PF_PhaseNames[i]<<"\": {\"seconds\": "<<PF_Seconds[i]<<", \"calls\": "<<PF_Calls[i]<<"}, ";
+            timed += PF_Seconds[i];
+        }
+    }
+    out<<"\"other\": {\"seconds\": "<<((wall > timed) ? wall - timed : 0)<<"}}, ";
+    out<<"\"counters\": {";
+    for (int i = 0; i < PF_NUM_COUNTERS; ++i) {
+        out<<((i) ? ", " : "")<<"\""<<PF_CounterNames[i]<<"\": "<<PF_Counters[i];
+    }
+    out<<"}}"<<std::endl;
+}
+
+static void profileReport(void)
+{
+    double end = now();
+    if (PF_Current >= 0) {
+        // exit was called from inside a phase
+        PF_Seconds[PF_Current] += end - PF_PhaseStart;
+        PF_Current = -1;
+    }
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    getrusage(RUSAGE_SELF, &usage);
+
+    // the whole report goes out in one write so it isn't mixed up with
+    // anything else on stderr
+    std::stringstream report;
+    report<<std::fixed<<std::setprecision(6);
+    if (PF_Format == PF_JSON) {
+        writeJson(report, end - PF_StartTime, usage);
+    } else {
+        writeTsv(report, end - PF_StartTime, usage);
+    }
+    std::cerr<<report.str()<<std::flush;
+}
+
+void profileStart(const char * command, ProfileFormat format)
+{
+    PF_Command = command;
+    PF_Format = format;
+#if HAVE_PTHREAD
+    PF_MainThread = pthread_self();
+#endif
+    PF_StartTime = now();
+    PF_Enabled = true;
+    atexit(profileReport);
+}
+
+bool parseProfileFormat(const char * str, ProfileFormat& format)
+{
+    if (!strcmp(str, "tsv")) {
+        format = PF_TSV;
+    } else if (!strcmp(str, "json")) {
+        format = PF_JSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int profileEnter(ProfilePhase phase)
+{
+#if HAVE_PTHREAD
+    if (!pthread_equal(pthread_self(), PF_MainThread)) {
+        return PF_IGNORED;
+    }
+#endif
+    double t = now();
+    if (PF_Current >= 0) {
+        PF_Seconds[PF_Current] += t - PF_PhaseStart;
+    }
+    int previous = PF_Current;
+    PF_Current = phase;
+    ++PF_Calls[phase];
+    PF_PhaseStart = t;
+    return previous;
+}
+
+void profileLeave(int previous)
+{
+    if (previous == PF_IGNORED) {
+        return;
+    }
+    double t = now();
+    PF_Seconds[PF_Current] += t - PF_PhaseStart;
+    PF_Current = previous;
+    PF_PhaseStart = t;
+}
+
+xercesc::DOMDocument * profiledParse(crispr::xml::reader& reader, const char * fileName)
+{
+    xercesc::DOMDocument * document;
+    {
+        ProfileTimer timer(PF_PARSE);
+        document = reader.setFileParser(fileName);
+    }
+    if (PF_Enabled && document != NULL) {
+        ProfileTimer timer(PF_PROFILE);
+        addFileSize(PF_BYTES_READ, fileName);
+        xercesc::DOMElement * root_elem = document->getDocumentElement();
+        if (root_elem != NULL) {
+            if (PF_GroupTag == NULL) {
+                PF_GroupTag = xercesc::XMLString::transcode("group");
+            }
+            uint64_t groups = 0;
+            for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+                 currentElement != NULL;
+                 currentElement = currentElement->getNextElementSibling()) {
+                if (xercesc::XMLString::equals(currentElement->getTagName(), PF_GroupTag)) {
+                    ++groups;
+                }
+            }
+            profileCount(PF_GROUPS, groups);
+            profileCount(PF_ELEMENTS, countElements(root_elem));
+        }
+    }
+    return document;
+}
+
+bool profiledWrite(crispr::xml::writer& writer, const std::string& fileName, xercesc::DOMDocument * document)
+{
+    bool ok;
+    {
+        ProfileTimer timer(PF_WRITE);
+        ok = writer.printDOMToFile(fileName, document);
+    }
+    if (PF_Enabled) {
+        addFileSize(PF_BYTES_WRITTEN, fileName.c_str());
+    }
+    return ok;
+}
+
+bool profiledWrite(crispr::xml::writer& writer, const std::string& fileName)
+{
+    bool ok;
+    {
+        ProfileTimer timer(PF_WRITE);
+        ok = writer.printDOMToFile(fileName);
+    }
+    if (PF_Enabled) {
+        addFileSize(PF_BYTES_WRITTEN, fileName.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,115 @@
+/*
+ * Profile.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_Profile_h
+#define crisprtools_Profile_h
+
+#include <string>
+#include <stdint.h>
+#include <libcrispr/reader.h>
+#include <libcrispr/writer.h>
+#include "Trace.h"
+
+// Timings for crisprtools --profile.  The phases are timed on the calling
+// thread only and each one gets the time spent in it minus the time spent
+// in phases nested inside it, so the phases add up to the time measured
+// and whatever is left over is reported as "other".  With --trace every
+// timer, on any thread, is also a span named after its phase.  When
+// profiling and tracing are off a timer is a test of two flags
+enum ProfilePhase {
+    PF_PARSE,               // setFileParser
+    PF_WALK,                // going through the groups of a parsed document
+    PF_IMPORT,              // importNode into another document
+    PF_WRITE,               // printDOMToFile
+    PF_COMPUTE,             // everything handed to parallelFor
+    PF_READ_COUNT,          // StatTool::calculateReads
+    PF_LAYOUT,              // graphviz or native layout
+    PF_RENDER,              // graphviz or native rendering
+    PF_PROFILE,             // counting elements for the report
+    PF_NUM_PHASES
+};
+
+enum ProfileCounter {
+    PF_GROUPS,
+    PF_ELEMENTS,
+    PF_BYTES_READ,
+    PF_BYTES_WRITTEN,
+    PF_NUM_COUNTERS
+};
+
+enum ProfileFormat {
+    PF_TSV,
+    PF_JSON
+};
+
+extern bool PF_Enabled;
+extern const char * const PF_PhaseNames[PF_NUM_PHASES];
+extern uint64_t PF_Counters[PF_NUM_COUNTERS];
+
+// turn profiling on for the named subcommand, the report is written to
+// stderr when the program exits
+void profileStart(const char * command, ProfileFormat format);
+
+// the argument of --profile=, false if it isn't tsv or json
+bool parseProfileFormat(const char * str, ProfileFormat& format);
+
+// used by ProfileTimer, enter returns the phase that was running before.
+// Timers on any thread but the one that called profileStart are ignored
+int profileEnter(ProfilePhase phase);
+void profileLeave(int previous);
+
+class ProfileTimer {
+public:
+    explicit ProfileTimer(ProfilePhase phase) : PT_Span(PF_PhaseNames[phase]), PT_Previous(-1), PT_Active(PF_Enabled) {
+        if (PT_Active) {
+            PT_Previous = profileEnter(phase);
+        }
+    }
+    ~ProfileTimer() {
+        if (PT_Active) {
+            profileLeave(PT_Previous);
+        }
+    }
+
+private:
+    ProfileTimer(const ProfileTimer&);
+    ProfileTimer& operator=(const ProfileTimer&);
+
+    TraceSpan PT_Span;
+    int PT_Previous;
+    bool PT_Active;
+};
+
+// safe to call from any thread
+inline void profileCount(ProfileCounter counter, uint64_t amount)
+{
+    if (PF_Enabled) {
+        __sync_fetch_and_add(&PF_Counters[counter], amount);
+    }
+}
+
+// setFileParser with the parse timed and, when profiling, the size of the
+// file, its groups and its elements counted
+xercesc::DOMDocument * profiledParse(crispr::xml::reader& reader, const char * fileName);
+
+// printDOMToFile with the write timed and the size of the file counted
+bool profiledWrite(crispr::xml::writer& writer, const std::string& fileName, xercesc::DOMDocument * document);
+bool profiledWrite(crispr::xml::writer& writer, const std::string& fileName);
+
+#endif
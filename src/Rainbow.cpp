@@ -50,6 +50,17 @@
 
 // crude rounding function
 
+// Evenly spaced samples of the viridis and cividis colour maps, low to high.
+// These are perceptually uniform and still readable for colour blind people
+static const int RB_viridis[] = {
+    0x440154, 0x482878, 0x3e4a89, 0x31688e, 0x26828e,
+    0x1f9e89, 0x35b779, 0x6dcd59, 0xb4de2c, 0xfde725
+};
+static const int RB_cividis[] = {
+    0x00204d, 0x00336f, 0x39486b, 0x575c6d, 0x707173,
+    0x8a8779, 0xa69d75, 0xc4b56c, 0xe4cf5b, 0xffea46
+};
+
 // setting initial limits
 void Rainbow::setLimits(double lb, double ub, int res)
 {
@@ -63,6 +74,83 @@ void Rainbow::setLimits(double lb, double ub, int res)
     // set the shortcut constants
     mScaleMultiplier = (mUpperScale - mLowerScale)/(mUpperBound - mLowerBound);
     mTickSize = (mUpperBound - mLowerBound)/(mResolution - 1);
+    mHaveLimits = true;
+    mTableStale = true;
+}
+
+int Rainbow::channel(double scaledValue, double offset, bool ignore)
+{
+    if(ignore)
+        return 0;
+    int c = (int)round(getValue(scaledValue - offset) * 255);
+    return (0 >= c) ? 0 : c;
+}
+
+int Rainbow::interpolate(double fraction)
+{
+    //-----
+    // linear interpolation between the two nearest anchor colours
+    //
+    if(!(fraction > 0))
+        return mAnchors[0];
+    if(fraction >= 1)
+        return mAnchors[mAnchorCount - 1];
+    double position = fraction * (mAnchorCount - 1);
+    int lower = (int)position;
+    double weight = position - lower;
+    int rgb = 0;
+    for(int shift = 16; shift >= 0; shift -= 8)
+    {
+        int a = (mAnchors[lower] >> shift) & 0xff;
+        int b = (mAnchors[lower + 1] >> shift) & 0xff;
+        rgb |= (int)round(a + (b - a) * weight) << shift;
+    }
+    return rgb;
+}
+
+void Rainbow::buildTable(void)
+{
+    //-----
+    // Work out the colour of every tick between the bounds.  Values are
+    // snapped to the nearest multiple of the tick size before they are
+    // coloured so the table is indexed by that multiple
+    //
+    mTableStale = false;
+    mColourTable.clear();
+    if(-1 == mResolution || mUpperBound < mLowerBound)
+        return;
+    
+    if(!(mTickSize > 0) || isinf(mTickSize))
+    {
+        // only one tick so everything gets the lowest colour
+        mTableOffset = 0;
+        mMaxTick = 0;
+        mTickSize = 1;
+        if(NULL != mAnchors)
+            mColourTable.push_back(mAnchors[0]);
+        else
+            mColourTable.push_back((channel(mLowerScale, mRedOffset, mIgnoreRed) << 16) |
+                                   (channel(mLowerScale, mGreenOffset, mIgnoreGreen) << 8) |
+                                   channel(mLowerScale, mBlueOffset, mIgnoreBlue));
+        return;
+    }
+    
+    mTableOffset = round(mLowerBound/mTickSize);
+    mMaxTick = round(mUpperBound/mTickSize) - mTableOffset;
+    mColourTable.reserve((size_t)mMaxTick + 1);
+    for(double tick = mTableOffset; tick <= mTableOffset + mMaxTick; tick += 1)
+    {
+        // map the normalised value onto the horizontal scale
+        double scaled_value = (tick * mTickSize - mLowerBound) * mScaleMultiplier + mLowerScale;
+        if(NULL != mAnchors)
+        {
+            mColourTable.push_back(interpolate(scaled_value));
+            continue;
+        }
+        mColourTable.push_back((channel(scaled_value, mRedOffset, mIgnoreRed) << 16) |
+                               (channel(scaled_value, mGreenOffset, mIgnoreGreen) << 8) |
+                               channel(scaled_value, mBlueOffset, mIgnoreBlue));
+    }
 }
 
 void Rainbow::setType(RB_TYPE type)
@@ -71,9 +159,24 @@ void Rainbow::setType(RB_TYPE type)
     // set the offsets based on type
     //
     mType = type;
+    mAnchors = NULL;
+    mAnchorCount = 0;
     
     switch(type)
     {
+        case VIRIDIS:
+        case CIVIDIS:
+        {
+            mAnchors = (VIRIDIS == type) ? RB_viridis : RB_cividis;
+            mAnchorCount = sizeof(RB_viridis) / sizeof(RB_viridis[0]);
+            
+            // the scale is just the fraction of the way between the bounds
+            mRedOffset = mGreenOffset = mBlueOffset = 0;
+            mIgnoreRed = mIgnoreGreen = mIgnoreBlue = false;
+            mLowerScale = 0;
+            mUpperScale = 1;
+            break;
+        }
         case RED_BLUE:
         {
             mRedOffset = 0;
@@ -135,6 +238,9 @@ void Rainbow::setType(RB_TYPE type)
     
     // reset this
     mScaleMultiplier = (mUpperScale - mLowerScale)/(mUpperBound - mLowerBound);
+    
+    // the colours have changed
+    mTableStale = mHaveLimits;
 }
 
 void Rainbow::setDefaults(void)
@@ -153,37 +259,70 @@ std::string Rainbow::getColour(double value)
     // Return a colour for the given value.
     // If nothing makes sense. return black
     //
+    char colour[RB_COLOUR_LENGTH];
+    return std::string(getColour(value, colour));
+}
 
-    // check to see that everything makes sense    
-    if(-1 == mResolution)
-        return RB_ERROR_COLOUR;
-    if(value > mUpperBound || value < mLowerBound)
-        return RB_ERROR_COLOUR;
-    
-    // normalise the value to suit the ticks
-    double normalised_value = round(value/mTickSize) * mTickSize;
+char * Rainbow::getColour(double value, char * colour)
+{
+    return packed2Hex(getRGB(value), colour);
+}
 
-    // map the normalised value onto the horizontal scale
-    double scaled_value = (normalised_value - mLowerBound) * mScaleMultiplier + mLowerScale;
+void Rainbow::getRGB(const double * values, size_t count, int * rgb)
+{
+    //-----
+    // Two passes over each batch so that the first, which is all arithmetic,
+    // can be vectorised by the compiler.  The second is just a gather from
+    // the table
+    //
+    if(mTableStale)
+        buildTable();
+    if(mColourTable.empty())
+    {
+        for(size_t i = 0; i < count; ++i)
+            rgb[i] = RB_ERROR_RGB;
+        return;
+    }
+    
+    double ticks[RB_BATCH];
+    for(size_t start = 0; start < count; start += RB_BATCH)
+    {
+        size_t n = (count - start < RB_BATCH) ? count - start : RB_BATCH;
+        const double * batch = values + start;
+        for(size_t i = 0; i < n; ++i)
+        {
+            double tick = round(batch[i] / mTickSize) - mTableOffset;
+            tick = (tick > 0) ? tick : 0;
+            ticks[i] = (tick > mMaxTick) ? mMaxTick : tick;
+        }
         
-    // now construct the colour    
-    std::stringstream ss;
-    if(mIgnoreRed)    
-        ss << "00";
-    else
-        ss << int2RGB(round(getValue(scaled_value - mRedOffset) * 255));
-
-    if(mIgnoreGreen)    
-        ss << "00";
-    else
-        ss << int2RGB(round(getValue(scaled_value - mGreenOffset) * 255));
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(batch[i] > mUpperBound || batch[i] < mLowerBound)
+                rgb[start + i] = RB_ERROR_RGB;
+            else
+                rgb[start + i] = mColourTable[(size_t)ticks[i]];
+        }
+    }
+}
 
-    if(mIgnoreBlue)    
-        ss << "00";
-    else
-        ss << int2RGB(round(getValue(scaled_value - mBlueOffset) * 255));
+void Rainbow::getRGB(const std::vector<double>& values, std::vector<int>& rgb)
+{
+    rgb.resize(values.size());
+    if(!values.empty())
+        getRGB(&values[0], values.size(), &rgb[0]);
+}
 
-    return ss.str();
+char * Rainbow::packed2Hex(int rgb, char * colour)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    for(int i = 5; i >= 0; --i)
+    {
+        colour[i] = hex_digits[rgb & 0xf];
+        rgb >>= 4;
+    }
+    colour[6] = '\0';
+    return colour;
 }
 
 std::string Rainbow::int2RGB(int rgb)
@@ -205,4 +344,3 @@ std::string Rainbow::int2RGB(int rgb)
         return ss.str();
     }
 }
-
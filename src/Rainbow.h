@@ -40,6 +40,8 @@
 
 // system includes
 #include <iostream>
+#include <string>
+#include <vector>
 #include <math.h>
 
 // local includes
@@ -50,6 +52,10 @@
 #define RB_LB 0                     // default upper bound
 #define RB_UB 1                     // default lowe bound
 #define RB_TICKS 10                 // default ticks
+#define RB_MAX_TICKS 1024           // most ticks worked out from the limits alone
+#define RB_BATCH 256                // values coloured at a time by the array getRGB
+#define RB_ERROR_RGB 0x000000       // packed version of the error colour
+#define RB_COLOUR_LENGTH 7          // six hex digits and a null, the size of buffer getColour needs
 
 // some math constants we need (I know!)
 #define PI (3.1415927)
@@ -60,37 +66,88 @@ enum RB_TYPE
     RED_BLUE,
     BLUE_RED,
     RED_BLUE_GREEN,
-    GREEN_BLUE_RED
+    GREEN_BLUE_RED,
+    VIRIDIS,
+    CIVIDIS
 };
 
 class Rainbow 
 {
     public:
-        Rainbow() { setDefaults(); } 
+        Rainbow() { mHaveLimits = false; mTableStale = false; setDefaults(); } 
         ~Rainbow() {}  
         void setDefaults(void);
         
         // set the limits we need!
+        // the colour of every tick is worked out the first time a colour is
+        // asked for, so getColour is just a lookup.  Without a resolution
+        // there is a tick for each whole number, up to RB_MAX_TICKS
         void setLimits(double lb, double ub, int res);
-        void setLimits(double lb, double ub) { setLimits(lb, ub, (int)(ub-lb)+1); }
+        void setLimits(double lb, double ub) { setLimits(lb, ub, defaultResolution(lb, ub)); }
         void setType(RB_TYPE type);
     
-        void setUpperBound(double ub){setLimits(mLowerBound, ub, (int)(ub - mLowerBound)+1); }
-        void setLowerBound(double lb){setLimits(lb, mUpperBound, (int)(mUpperBound - lb)+1); }
+        void setUpperBound(double ub){setLimits(mLowerBound, ub, defaultResolution(mLowerBound, ub)); }
+        void setLowerBound(double lb){setLimits(lb, mUpperBound, defaultResolution(lb, mUpperBound)); }
 
         // get a colour!
         std::string getColour(double value);
+        
+        // write the colour as six hex digits into a buffer of at least
+        // RB_COLOUR_LENGTH chars, returns the buffer. No memory is allocated
+        char * getColour(double value, char * colour);
+        
+        // the colour packed as 0xRRGGBB
+        inline int getRGB(double value)
+        {
+            if(mTableStale)
+                buildTable();
+            if(value > mUpperBound || value < mLowerBound || mColourTable.empty())
+                return RB_ERROR_RGB;
+            return mColourTable[tickIndex(value)];
+        }
+        
+        // colour a whole array of values at once, rgb must have room for count ints
+        void getRGB(const double * values, size_t count, int * rgb);
+        void getRGB(const std::vector<double>& values, std::vector<int>& rgb);
+        
         std::string int2RGB(int rgb);
         
+        // convert a packed colour to six hex digits, colour needs RB_COLOUR_LENGTH chars
+        static char * packed2Hex(int rgb, char * colour);
+        
         // get the limits
         double getUpperLimit(void) { return mUpperBound; }
         double getLowerLimit(void) { return mLowerBound; }
         
     private:
+        // fill in mColourTable for the current type and limits
+        void buildTable(void);
+        static inline int defaultResolution(double lb, double ub)
+        {
+            double ticks = ub - lb + 1;
+            return (ticks < RB_MAX_TICKS) ? (int)ticks : RB_MAX_TICKS;
+        }
+        int channel(double scaledValue, double offset, bool ignore);
+        int interpolate(double fraction);
+        
+        // position of a value in the colour table, clamped so that rounding
+        // at the very ends of the range can't step outside the table
+        inline size_t tickIndex(double value)
+        {
+            double tick = round(value / mTickSize) - mTableOffset;
+            if(!(tick > 0))
+                return 0;
+            if(tick >= mMaxTick)
+                return (size_t)mMaxTick;
+            return (size_t)tick;
+        }
+        
         // members
         double mLowerBound;        // lowest number we'll colour`
         double mUpperBound;        // highest
         int mResolution;           // number of steps between low and high (inclusive)
+        bool mHaveLimits;          // has setLimits been called yet
+        bool mTableStale;          // the table has to be built before it is used
         
         RB_TYPE mType;          // type of the heatmap 
         
@@ -99,6 +156,11 @@ class Rainbow
         double mGreenOffset;
         double mBlueOffset;
         
+        // perceptual maps are interpolated from a list of anchor colours
+        // rather than worked out from the cos graphs, NULL for the others
+        const int * mAnchors;
+        int mAnchorCount;
+        
         // should we ignore any colour
         bool mIgnoreRed;
         bool mIgnoreGreen;
@@ -116,6 +178,11 @@ class Rainbow
         //
         double mScaleMultiplier;
         double mTickSize;          // size of a tick
+        
+        // the lookup table, one packed colour for each tick between the bounds
+        std::vector<int> mColourTable;
+        double mTableOffset;       // tick number of the first entry in the table
+        double mMaxTick;           // index of the last entry in the table
 };
 
 #endif //Rainbow_h
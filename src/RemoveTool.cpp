@@ -41,6 +41,7 @@
 #include <libcrispr/parser.h>
 #include "config.h"
 #include "Utils.h"
+#include "Profile.h"
 
 int removeMain(int argc, char ** argv)
 {
@@ -57,7 +58,7 @@ int removeMain(int argc, char ** argv)
         
         crispr::xml::parser xml_obj;
 
-        xercesc::DOMDocument * xml_doc = xml_obj.setFileParser(argv[opt_index]);
+        xercesc::DOMDocument * xml_doc = profiledParse(xml_obj, argv[opt_index]);
         
         xercesc::DOMElement * root_elem = xml_doc->getDocumentElement();
         
@@ -66,11 +67,14 @@ int removeMain(int argc, char ** argv)
                                                      __PRETTY_FUNCTION__, 
                                                      "empty XML document" ));
 
+        ProfileTimer walk_timer(PF_WALK);
+
         // get the children
         std::vector<xercesc::DOMElement * > bad_children;
         for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild(); 
              currentElement != NULL; 
              currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
             if (xercesc::XMLString::equals(currentElement->getTagName(), xml_obj.tag_Group())) {
                 // new group
                 char * c_group_id = tc(currentElement->getAttribute(xml_obj.attr_Gid()));
@@ -91,9 +95,9 @@ int removeMain(int argc, char ** argv)
         }
         
         if (output_file.empty()) {
-            xml_obj.printDOMToFile(argv[opt_index],xml_doc);
+            profiledWrite(xml_obj, argv[opt_index], xml_doc);
         } else {
-            xml_obj.printDOMToFile(output_file);
+            profiledWrite(xml_obj, output_file);
         }
         
     } catch( xercesc::XMLException& e ) {
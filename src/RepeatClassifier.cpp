@@ -0,0 +1,214 @@
+// RepeatClassifier.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "RepeatClassifier.h"
+#include "MappedFasta.h"
+#include "SeqKernels.h"
+#include <libcrispr/Exception.h>
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+RepeatClassifier::RepeatClassifier(int k)
+{
+    RC_K = k;
+    RC_Starts.push_back(0);
+}
+
+void RepeatClassifier::distinctKmers(const unsigned char * codes, size_t length, std::vector<uint32_t>& kmers) const
+{
+    kmers.clear();
+    uint32_t mask = (RC_K == 16) ? 0xffffffff : ((static_cast<uint32_t>(1) << (2 * RC_K)) - 1);
+    uint32_t kmer = 0;
+    int run = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (codes[i] >= SK_OTHER) {
+            run = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | codes[i]) & mask;
+        if (++run >= RC_K) {
+            kmers.push_back(kmer);
+        }
+    }
+    std::sort(kmers.begin(), kmers.end());
+    kmers.erase(std::unique(kmers.begin(), kmers.end()), kmers.end());
+}
+
+void RepeatClassifier::load(const std::string& fileName)
+{
+    MappedFasta fasta;
+    fasta.open(fileName);
+
+    std::vector< std::pair<uint32_t, int> > occurrences;
+    std::vector<uint32_t> kmers;
+    const std::vector<FastaRecord>& records = fasta.records();
+    for (size_t r = 0; r < records.size(); ++r) {
+        int reference = static_cast<int>(RC_Names.size());
+        size_t start = RC_Codes.size();
+        fasta.encodeRange(records[r].SequenceStart, records[r].SequenceEnd, static_cast<size_t>(-1), RC_Codes);
+        RC_Names.push_back(records[r].Name);
+        RC_Starts.push_back(RC_Codes.size());
+
+        if (RC_Codes.size() == start) {
+            continue;
+        }
+        distinctKmers(&RC_Codes[0] + start, RC_Codes.size() - start, kmers);
+        for (size_t i = 0; i < kmers.size(); ++i) {
+            occurrences.push_back(std::make_pair(kmers[i], reference));
+        }
+    }
+    if (RC_Names.empty()) {
+        std::stringstream msg;
+        msg<<"there are no repeats in "<<fileName;
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+
+    // sorted by k-mer and then reference, so the postings of each k-mer
+    // are in file order
+    std::sort(occurrences.begin(), occurrences.end());
+    RC_Postings.reserve(occurrences.size());
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        if (i == 0 || occurrences[i].first != occurrences[i - 1].first) {
+            RC_Kmers.push_back(occurrences[i].first);
+            RC_KmerStarts.push_back(i);
+        }
+        RC_Postings.push_back(occurrences[i].second);
+    }
+    RC_KmerStarts.push_back(occurrences.size());
+}
+
+void RepeatClassifier::searchStrand(const std::vector<unsigned char>& codes, char strand, int maxEdits, RepeatSearch& search, RepeatMatch& match) const
+{
+    std::vector<int>& counts = search.Counts;
+    std::vector<int>& touched = search.Touched;
+    touched.clear();
+    distinctKmers(&codes[0], codes.size(), search.Kmers);
+    for (size_t i = 0; i < search.Kmers.size(); ++i) {
+        std::vector<uint32_t>::const_iterator found = std::lower_bound(RC_Kmers.begin(), RC_Kmers.end(), search.Kmers[i]);
+        if (found == RC_Kmers.end() || *found != search.Kmers[i]) {
+            continue;
+        }
+        size_t k = found - RC_Kmers.begin();
+        for (size_t p = RC_KmerStarts[k]; p < RC_KmerStarts[k + 1]; ++p) {
+            if (counts[RC_Postings[p]]++ == 0) {
+                touched.push_back(RC_Postings[p]);
+            }
+        }
+    }
+
+    // q-gram lemma: an edit can only destroy k of the k-mers of the
+    // repeat.  When the repeat is too short for the lemma to rule anything
+    // out every reference is a candidate, even those sharing no k-mers.
+    // The candidates are put in order of shared k-mers, most first, with a
+    // counting sort since there are few possible counts
+    long most = static_cast<long>(search.Kmers.size());
+    long needed = most - static_cast<long>(RC_K) * maxEdits;
+    bool full_scan = (needed <= 0);
+    if (full_scan) {
+        needed = 0;
+    }
+    std::vector<size_t>& buckets = search.Buckets;
+    buckets.assign(most + 1, 0);
+    for (size_t i = 0; i < touched.size(); ++i) {
+        ++buckets[counts[touched[i]]];
+    }
+    if (full_scan) {
+        buckets[0] = RC_Names.size() - touched.size();
+    }
+    size_t num_candidates = 0;
+    for (long count = most; count >= needed; --count) {
+        size_t in_bucket = buckets[count];
+        buckets[count] = num_candidates;
+        num_candidates += in_bucket;
+    }
+    std::vector<int>& candidates = search.Candidates;
+    candidates.resize(num_candidates);
+    for (size_t i = 0; i < touched.size(); ++i) {
+        if (counts[touched[i]] >= needed) {
+            candidates[buckets[counts[touched[i]]]++] = touched[i];
+        }
+    }
+    if (full_scan) {
+        for (int reference = 0; reference < static_cast<int>(RC_Names.size()); ++reference) {
+            if (counts[reference] == 0) {
+                candidates[buckets[0]++] = reference;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num_candidates; ++i) {
+        int reference = candidates[i];
+        int shared = counts[reference];
+        bool more_shared = (shared != match.SharedKmers) ? shared > match.SharedKmers : reference < match.Reference;
+
+        // once there is an exact match only the candidates that share as
+        // many k-mers are worth a look
+        if (match.Reference != -1 && match.Edits == 0 && shared < match.SharedKmers) {
+            break;
+        }
+
+        // the candidates share fewer and fewer k-mers, so once the best
+        // match is close the lemma rules out the rest
+        int limit = (match.Reference == -1) ? maxEdits : match.Edits;
+        if (shared < static_cast<long>(search.Kmers.size()) - static_cast<long>(RC_K) * limit) {
+            break;
+        }
+        int edits = editDistance(&codes[0], codes.size(), &RC_Codes[0] + RC_Starts[reference], RC_Starts[reference + 1] - RC_Starts[reference], limit);
+        if (edits > limit) {
+            continue;
+        }
+        if (match.Reference == -1 || edits < match.Edits || more_shared) {
+            match.Reference = reference;
+            match.Edits = edits;
+            match.SharedKmers = shared;
+            match.Strand = strand;
+        }
+    }
+    for (size_t i = 0; i < touched.size(); ++i) {
+        counts[touched[i]] = 0;
+    }
+}
+
+bool RepeatClassifier::classify(const std::string& repeat, int maxEdits, RepeatSearch& search, RepeatMatch& match) const
+{
+    match.Reference = -1;
+    match.Edits = maxEdits + 1;
+    match.SharedKmers = 0;
+    match.Strand = '+';
+    if (repeat.empty()) {
+        return false;
+    }
+    search.Counts.resize(RC_Names.size(), 0);
+    search.Codes.resize(repeat.length());
+    encodeBases(repeat.data(), repeat.length(), &search.Codes[0]);
+    searchStrand(search.Codes, '+', maxEdits, search, match);
+
+    for (size_t i = 0, j = repeat.length() - 1; i < j; ++i, --j) {
+        std::swap(search.Codes[i], search.Codes[j]);
+    }
+    for (size_t i = 0; i < repeat.length(); ++i) {
+        if (search.Codes[i] < SK_OTHER) {
+            search.Codes[i] = static_cast<unsigned char>(3 - search.Codes[i]);
+        }
+    }
+    searchStrand(search.Codes, '-', maxEdits, search, match);
+    return match.Reference != -1;
+}
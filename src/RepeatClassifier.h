@@ -0,0 +1,93 @@
+/*
+ * RepeatClassifier.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_RepeatClassifier_h
+#define crisprtools_RepeatClassifier_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#define RC_DEFAULT_K 7              // length of the indexed k-mers
+#define RC_MIN_K 4
+#define RC_MAX_K 16                 // k-mers are packed into 32 bits
+
+// the closest reference to a repeat
+typedef struct __RepeatMatch {
+    int Reference;
+    int Edits;
+    int SharedKmers;
+    char Strand;                    // '-' when the reverse complement of the repeat matched
+} RepeatMatch;
+
+// memory used while classifying, one for each thread
+typedef struct __RepeatSearch {
+    std::vector<int> Counts;        // shared k-mers of each reference
+    std::vector<int> Touched;       // references with a count
+    std::vector<size_t> Buckets;
+    std::vector<int> Candidates;
+    std::vector<unsigned char> Codes;
+    std::vector<uint32_t> Kmers;
+} RepeatSearch;
+
+// The direct repeats of known families, read from a FASTA file, with a
+// table of the k-mers in each one.  A repeat is classified by counting
+// the k-mers each reference shares with it, on both strands, and working
+// out the edit distance to the references that share the most.  A
+// reference within e edits of a repeat of length L shares at least
+// L - k + 1 - k * e of its k-mers, references that share fewer aren't
+// aligned at all.  The filter is exact: a repeat too short for the bound
+// to rule anything out is aligned to every reference
+class RepeatClassifier {
+public:
+    RepeatClassifier(int k = RC_DEFAULT_K);
+
+    // the name of each record, up to the first space, is its family and
+    // more than one record can have the same name.  Throws
+    // crispr::runtime_exception if the file can't be read
+    void load(const std::string& fileName);
+
+    inline int referenceCount(void) const {return static_cast<int>(RC_Names.size());}
+    inline const std::string& referenceName(int reference) const {return RC_Names[reference];}
+
+    // the closest reference with at most maxEdits edits, ties going to the
+    // one sharing the most k-mers and then the first in the file.  Returns
+    // false if there isn't one
+    bool classify(const std::string& repeat, int maxEdits, RepeatSearch& search, RepeatMatch& match) const;
+
+private:
+    // the distinct k-mers of codes, sorted
+    void distinctKmers(const unsigned char * codes, size_t length, std::vector<uint32_t>& kmers) const;
+    void searchStrand(const std::vector<unsigned char>& codes, char strand, int maxEdits, RepeatSearch& search, RepeatMatch& match) const;
+
+    int RC_K;
+    std::vector<std::string> RC_Names;
+
+    // the bases of reference i are from RC_Starts[i] to RC_Starts[i + 1]
+    std::vector<size_t> RC_Starts;
+    std::vector<unsigned char> RC_Codes;
+
+    // every k-mer in the references, sorted, the references that have
+    // k-mer i are from RC_KmerStarts[i] to RC_KmerStarts[i + 1]
+    std::vector<uint32_t> RC_Kmers;
+    std::vector<size_t> RC_KmerStarts;
+    std::vector<int> RC_Postings;
+};
+
+#endif
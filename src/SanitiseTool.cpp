@@ -20,6 +20,7 @@
 #include <libcrispr/Exception.h>
 #include <libcrispr/parser.h>
 #include "config.h"
+#include "Profile.h"
 
 #include <iostream>
 int SanitiseTool::processOptions (int argc, char ** argv)
@@ -96,7 +97,7 @@ int SanitiseTool::processInputFile(const char * inputFile)
 {
     try {
         crispr::xml::parser xml_parser;
-        xercesc::DOMDocument * input_doc_obj = xml_parser.setFileParser(inputFile);
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
         xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
         if (!root_elem) {
             throw crispr::xml_exception(__FILE__, 
@@ -104,6 +105,8 @@ int SanitiseTool::processInputFile(const char * inputFile)
                                         __PRETTY_FUNCTION__, 
                                         "problem when parsing xml file");
         }
+
+        ProfileTimer walk_timer(PF_WALK);
         if (ST_OutputFile.empty()) {
             ST_OutputFile = inputFile;
         }
@@ -111,6 +114,7 @@ int SanitiseTool::processInputFile(const char * inputFile)
         for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild(); 
              currentElement != NULL; 
              currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
 
                 
                 // is this a group element
@@ -131,7 +135,7 @@ int SanitiseTool::processInputFile(const char * inputFile)
             setNextRepeat(1);
             setNextSpacer(1);
         }
-        xml_parser.printDOMToFile(ST_OutputFile, input_doc_obj);
+        profiledWrite(xml_parser, ST_OutputFile, input_doc_obj);
     } catch (crispr::xml_exception& e) {
         std::cerr<<e.what()<<std::endl;
         return 1;
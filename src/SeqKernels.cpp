@@ -0,0 +1,659 @@
+// SeqKernels.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "SeqKernels.h"
+#include "config.h"
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#if HAVE_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+// The lookup tables are built by the compiler.  Each macro below is an
+// expression of a character code and SK_TABLE expands it for all 256 codes
+
+#define SK_ROW(M, i) M((i) + 0), M((i) + 1), M((i) + 2), M((i) + 3), \
+    M((i) + 4), M((i) + 5), M((i) + 6), M((i) + 7), \
+    M((i) + 8), M((i) + 9), M((i) + 10), M((i) + 11), \
+    M((i) + 12), M((i) + 13), M((i) + 14), M((i) + 15)
+#define SK_TABLE(M) SK_ROW(M, 0x00), SK_ROW(M, 0x10), SK_ROW(M, 0x20), SK_ROW(M, 0x30), \
+    SK_ROW(M, 0x40), SK_ROW(M, 0x50), SK_ROW(M, 0x60), SK_ROW(M, 0x70), \
+    SK_ROW(M, 0x80), SK_ROW(M, 0x90), SK_ROW(M, 0xA0), SK_ROW(M, 0xB0), \
+    SK_ROW(M, 0xC0), SK_ROW(M, 0xD0), SK_ROW(M, 0xE0), SK_ROW(M, 0xF0)
+
+#define SK_UPPER(c) (((c) >= 'a' && (c) <= 'z') ? (c) - 0x20 : (c))
+#define SK_IS_ACGT(u) ((u) == 'A' || (u) == 'C' || (u) == 'G' || (u) == 'T')
+#define SK_IS_IUPAC(u) (SK_IS_ACGT(u) || (u) == 'N' || (u) == 'U' || (u) == 'R' || (u) == 'Y' || \
+    (u) == 'S' || (u) == 'W' || (u) == 'K' || (u) == 'M' || (u) == 'B' || (u) == 'D' || \
+    (u) == 'H' || (u) == 'V')
+
+// one bit for each alphabet, in the order of SeqAlphabet
+#define SK_CLASS(c) ((SK_IS_ACGT(SK_UPPER(c)) ? 1 : 0) | \
+    ((SK_IS_ACGT(SK_UPPER(c)) || SK_UPPER(c) == 'N') ? 2 : 0) | \
+    (SK_IS_IUPAC(SK_UPPER(c)) ? 4 : 0))
+
+#define SK_COMPLEMENT_UPPER(u) ((u) == 'A' ? 'T' : (u) == 'T' ? 'A' : (u) == 'U' ? 'A' : \
+    (u) == 'C' ? 'G' : (u) == 'G' ? 'C' : (u) == 'R' ? 'Y' : (u) == 'Y' ? 'R' : \
+    (u) == 'K' ? 'M' : (u) == 'M' ? 'K' : (u) == 'B' ? 'V' : (u) == 'V' ? 'B' : \
+    (u) == 'D' ? 'H' : (u) == 'H' ? 'D' : (u) == 'S' ? 'S' : (u) == 'W' ? 'W' : \
+    (u) == 'N' ? 'N' : 0)
+#define SK_COMPLEMENT(c) (SK_COMPLEMENT_UPPER(SK_UPPER(c)) ? \
+    (SK_COMPLEMENT_UPPER(SK_UPPER(c)) | ((c) & 0x20)) : (c))
+
+#define SK_CODE(c) (SK_UPPER(c) == 'A' ? 0 : SK_UPPER(c) == 'C' ? 1 : \
+    SK_UPPER(c) == 'G' ? 2 : SK_UPPER(c) == 'T' ? 3 : SK_OTHER)
+
+// 0 for A or T, 1 for G or C, 2 for N and 3 for anything else
+#define SK_KIND(c) ((SK_UPPER(c) == 'A' || SK_UPPER(c) == 'T') ? 0 : \
+    (SK_UPPER(c) == 'G' || SK_UPPER(c) == 'C') ? 1 : SK_UPPER(c) == 'N' ? 2 : 3)
+
+// the four bases of a packed byte
+#define SK_BASE(x) ((x) == 0 ? 'A' : (x) == 1 ? 'C' : (x) == 2 ? 'G' : 'T')
+#define SK_UNPACK(i) {SK_BASE(((i) >> 6) & 3), SK_BASE(((i) >> 4) & 3), SK_BASE(((i) >> 2) & 3), SK_BASE((i) & 3)}
+
+static const unsigned char SK_Classes[256] = {SK_TABLE(SK_CLASS)};
+static const unsigned char SK_Complements[256] = {SK_TABLE(SK_COMPLEMENT)};
+static const unsigned char SK_Codes[256] = {SK_TABLE(SK_CODE)};
+static const unsigned char SK_Kinds[256] = {SK_TABLE(SK_KIND)};
+static const char SK_UnpackTable[256][4] = {SK_TABLE(SK_UNPACK)};
+
+// scalar versions, which also finish off whatever the vector versions
+// leave at the end of a sequence
+
+static size_t validateScalar(const char * sequence, size_t length, SeqAlphabet alphabet)
+{
+    unsigned char bit = static_cast<unsigned char>(1 << alphabet);
+    for (size_t i = 0; i < length; ++i) {
+        if (!(SK_Classes[static_cast<unsigned char>(sequence[i])] & bit)) {
+            return i;
+        }
+    }
+    return length;
+}
+
+static void reverseComplementScalar(const char * sequence, size_t length, char * out)
+{
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = static_cast<char>(SK_Complements[static_cast<unsigned char>(sequence[length - 1 - i])]);
+    }
+}
+
+// pack the words from firstWord on
+static bool packTail(const char * sequence, size_t length, unsigned int * words, size_t firstWord)
+{
+    size_t num_words = packedWords(length);
+    for (size_t w = firstWord; w < num_words; ++w) {
+        unsigned int word = 0;
+        for (size_t i = w * SK_BASES_PER_WORD; i < (w + 1) * SK_BASES_PER_WORD; ++i) {
+            unsigned int code = 0;
+            if (i < length) {
+                code = SK_Codes[static_cast<unsigned char>(sequence[i])];
+                if (code > 3) {
+                    return false;
+                }
+            }
+            word = (word << 2) | code;
+        }
+        words[w] = word;
+    }
+    return true;
+}
+
+static bool packScalar(const char * sequence, size_t length, unsigned int * words)
+{
+    return packTail(sequence, length, words, 0);
+}
+
+static void countScalar(const char * sequence, size_t length, BaseCounts& counts)
+{
+    size_t kinds[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < length; ++i) {
+        ++kinds[SK_Kinds[static_cast<unsigned char>(sequence[i])]];
+    }
+    counts.AT = kinds[0];
+    counts.GC = kinds[1];
+    counts.N = kinds[2];
+    counts.Other = kinds[3];
+}
+
+#if HAVE_SIMD_DISPATCH
+
+// membership of each alphabet split by nibble: entry l has bit h set when
+// the character (h << 4) | l is in the alphabet.  A vector of characters
+// is checked with two byte shuffles, one for each nibble
+#define SK_NIBBLE_BIT(bit, l, h) ((SK_CLASS(((h) << 4) | (l)) & (bit)) ? (1 << (h)) : 0)
+#define SK_NIBBLE(bit, l) (SK_NIBBLE_BIT(bit, l, 0) | SK_NIBBLE_BIT(bit, l, 1) | \
+    SK_NIBBLE_BIT(bit, l, 2) | SK_NIBBLE_BIT(bit, l, 3) | SK_NIBBLE_BIT(bit, l, 4) | \
+    SK_NIBBLE_BIT(bit, l, 5) | SK_NIBBLE_BIT(bit, l, 6) | SK_NIBBLE_BIT(bit, l, 7))
+#define SK_NIBBLE_ROW(bit) {SK_NIBBLE(bit, 0), SK_NIBBLE(bit, 1), SK_NIBBLE(bit, 2), SK_NIBBLE(bit, 3), \
+    SK_NIBBLE(bit, 4), SK_NIBBLE(bit, 5), SK_NIBBLE(bit, 6), SK_NIBBLE(bit, 7), \
+    SK_NIBBLE(bit, 8), SK_NIBBLE(bit, 9), SK_NIBBLE(bit, 10), SK_NIBBLE(bit, 11), \
+    SK_NIBBLE(bit, 12), SK_NIBBLE(bit, 13), SK_NIBBLE(bit, 14), SK_NIBBLE(bit, 15)}
+
+static const unsigned char SK_NibbleTables[3][16] = {SK_NIBBLE_ROW(1), SK_NIBBLE_ROW(2), SK_NIBBLE_ROW(4)};
+
+// complements of the characters from 0x40 to 0x5F by their low 5 bits,
+// which works for both cases
+#define SK_LETTER_COMPLEMENT(i) (SK_COMPLEMENT(0x40 | (i)) & 0x1F)
+static const unsigned char SK_LetterComplements[32] = {SK_ROW(SK_LETTER_COMPLEMENT, 0), SK_ROW(SK_LETTER_COMPLEMENT, 16)};
+
+#define SK_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SK_TARGET_AVX2 __attribute__((target("avx2")))
+#define SK_BYTE(x) static_cast<char>(x)
+
+SK_TARGET_SSE41
+static inline __m128i validBytesSse41(__m128i bytes, __m128i lowTable)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i high_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, SK_BYTE(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i low = _mm_and_si128(bytes, nibble);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+    __m128i hits = _mm_and_si128(_mm_shuffle_epi8(lowTable, low), _mm_shuffle_epi8(high_bits, high));
+    return _mm_cmpeq_epi8(hits, _mm_setzero_si128());
+}
+
+SK_TARGET_SSE41
+static size_t validateSse41(const char * sequence, size_t length, SeqAlphabet alphabet)
+{
+    const __m128i low_table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_NibbleTables[alphabet]));
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence + i));
+        int bad = _mm_movemask_epi8(validBytesSse41(bytes, low_table));
+        if (bad) {
+            return i + __builtin_ctz(bad);
+        }
+    }
+    return i + validateScalar(sequence + i, length - i, alphabet);
+}
+
+SK_TARGET_SSE41
+static void reverseComplementSse41(const char * sequence, size_t length, char * out)
+{
+    const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i low_half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_LetterComplements));
+    const __m128i high_half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_LetterComplements + 16));
+    const __m128i letter_mask = _mm_set1_epi8(SK_BYTE(0xC0));
+    const __m128i letter_bits = _mm_set1_epi8(0x40);
+    const __m128i index_mask = _mm_set1_epi8(0x1F);
+    const __m128i high_index = _mm_set1_epi8(0x10);
+    const __m128i case_mask = _mm_set1_epi8(SK_BYTE(0xE0));
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence + length - i - 16));
+        bytes = _mm_shuffle_epi8(bytes, reverse);
+        // only blocks of letters can use the 32 entry table
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, letter_mask), letter_bits)) != 0xFFFF) {
+            reverseComplementScalar(sequence + length - i - 16, 16, out + i);
+            continue;
+        }
+        __m128i index = _mm_and_si128(bytes, index_mask);
+        __m128i upper = _mm_cmpeq_epi8(_mm_and_si128(bytes, high_index), high_index);
+        __m128i complement = _mm_blendv_epi8(_mm_shuffle_epi8(low_half, index),
+                                             _mm_shuffle_epi8(high_half, index),
+                                             upper);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_or_si128(_mm_and_si128(bytes, case_mask), complement));
+    }
+    reverseComplementScalar(sequence, length - i, out + i);
+}
+
+SK_TARGET_SSE41
+static bool packSse41(const char * sequence, size_t length, unsigned int * words)
+{
+    const __m128i acgt = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_NibbleTables[SK_ACGT]));
+    // A C G T by their low nibble, which is the same in both cases
+    const __m128i codes = _mm_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i pairs = _mm_set1_epi16(0x0104);
+    const __m128i quads = _mm_set1_epi32(0x00010010);
+    const __m128i gather = _mm_setr_epi8(12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t w = 0;
+    for (; (w + 1) * SK_BASES_PER_WORD <= length; ++w) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence + w * SK_BASES_PER_WORD));
+        if (_mm_movemask_epi8(validBytesSse41(bytes, acgt))) {
+            return false;
+        }
+        // 2 bit codes, joined in pairs then fours, then one byte from each
+        // group of four with the first base at the top
+        __m128i packed = _mm_shuffle_epi8(codes, _mm_and_si128(bytes, nibble));
+        packed = _mm_madd_epi16(_mm_maddubs_epi16(packed, pairs), quads);
+        words[w] = static_cast<unsigned int>(_mm_cvtsi128_si32(_mm_shuffle_epi8(packed, gather)));
+    }
+    return packTail(sequence, length, words, w);
+}
+
+SK_TARGET_SSE41
+static size_t sumBytesSse41(__m128i counts)
+{
+    __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+    return static_cast<size_t>(_mm_cvtsi128_si32(sums)) + static_cast<size_t>(_mm_extract_epi32(sums, 2));
+}
+
+SK_TARGET_SSE41
+static void countSse41(const char * sequence, size_t length, BaseCounts& counts)
+{
+    const __m128i case_mask = _mm_set1_epi8(SK_BYTE(0xDF));
+    size_t at = 0, gc = 0, n = 0;
+    size_t i = 0;
+    while (i + 16 <= length) {
+        // byte counters, emptied before they can overflow
+        __m128i at_counts = _mm_setzero_si128();
+        __m128i gc_counts = _mm_setzero_si128();
+        __m128i n_counts = _mm_setzero_si128();
+        for (int block = 0; block < 255 && i + 16 <= length; ++block, i += 16) {
+            __m128i bytes = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence + i)), case_mask);
+            at_counts = _mm_sub_epi8(at_counts, _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('A')),
+                                                             _mm_cmpeq_epi8(bytes, _mm_set1_epi8('T'))));
+            gc_counts = _mm_sub_epi8(gc_counts, _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('G')),
+                                                             _mm_cmpeq_epi8(bytes, _mm_set1_epi8('C'))));
+            n_counts = _mm_sub_epi8(n_counts, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('N')));
+        }
+        at += sumBytesSse41(at_counts);
+        gc += sumBytesSse41(gc_counts);
+        n += sumBytesSse41(n_counts);
+    }
+    countScalar(sequence + i, length - i, counts);
+    counts.AT += at;
+    counts.GC += gc;
+    counts.N += n;
+    counts.Other = length - counts.AT - counts.GC - counts.N;
+}
+
+SK_TARGET_AVX2
+static inline __m256i validBytesAvx2(__m256i bytes, __m256i lowTable)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i high_bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, SK_BYTE(0x80), 0, 0, 0, 0, 0, 0, 0, 0,
+                                               1, 2, 4, 8, 16, 32, 64, SK_BYTE(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i low = _mm256_and_si256(bytes, nibble);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+    __m256i hits = _mm256_and_si256(_mm256_shuffle_epi8(lowTable, low), _mm256_shuffle_epi8(high_bits, high));
+    return _mm256_cmpeq_epi8(hits, _mm256_setzero_si256());
+}
+
+SK_TARGET_AVX2
+static size_t validateAvx2(const char * sequence, size_t length, SeqAlphabet alphabet)
+{
+    const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_NibbleTables[alphabet])));
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sequence + i));
+        unsigned int bad = static_cast<unsigned int>(_mm256_movemask_epi8(validBytesAvx2(bytes, low_table)));
+        if (bad) {
+            return i + __builtin_ctz(bad);
+        }
+    }
+    return i + validateSse41(sequence + i, length - i, alphabet);
+}
+
+SK_TARGET_AVX2
+static void reverseComplementAvx2(const char * sequence, size_t length, char * out)
+{
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                             15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i low_half = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_LetterComplements)));
+    const __m256i high_half = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_LetterComplements + 16)));
+    const __m256i letter_mask = _mm256_set1_epi8(SK_BYTE(0xC0));
+    const __m256i letter_bits = _mm256_set1_epi8(0x40);
+    const __m256i index_mask = _mm256_set1_epi8(0x1F);
+    const __m256i high_index = _mm256_set1_epi8(0x10);
+    const __m256i case_mask = _mm256_set1_epi8(SK_BYTE(0xE0));
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sequence + length - i - 32));
+        // reverse each half then swap the halves
+        bytes = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(bytes, reverse), 0x4E);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(bytes, letter_mask), letter_bits)) != -1) {
+            reverseComplementScalar(sequence + length - i - 32, 32, out + i);
+            continue;
+        }
+        __m256i index = _mm256_and_si256(bytes, index_mask);
+        __m256i upper = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, high_index), high_index);
+        __m256i complement = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_half, index),
+                                                _mm256_shuffle_epi8(high_half, index),
+                                                upper);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_or_si256(_mm256_and_si256(bytes, case_mask), complement));
+    }
+    reverseComplementSse41(sequence, length - i, out + i);
+}
+
+SK_TARGET_AVX2
+static bool packAvx2(const char * sequence, size_t length, unsigned int * words)
+{
+    const __m256i acgt = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(SK_NibbleTables[SK_ACGT])));
+    const __m256i codes = _mm256_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+                                           0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i pairs = _mm256_set1_epi16(0x0104);
+    const __m256i quads = _mm256_set1_epi32(0x00010010);
+    const __m256i gather = _mm256_setr_epi8(12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t w = 0;
+    for (; (w + 2) * SK_BASES_PER_WORD <= length; w += 2) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sequence + w * SK_BASES_PER_WORD));
+        if (_mm256_movemask_epi8(validBytesAvx2(bytes, acgt))) {
+            return false;
+        }
+        // each half makes one word
+        __m256i packed = _mm256_shuffle_epi8(codes, _mm256_and_si256(bytes, nibble));
+        packed = _mm256_madd_epi16(_mm256_maddubs_epi16(packed, pairs), quads);
+        packed = _mm256_shuffle_epi8(packed, gather);
+        words[w] = static_cast<unsigned int>(_mm_cvtsi128_si32(_mm256_castsi256_si128(packed)));
+        words[w + 1] = static_cast<unsigned int>(_mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1)));
+    }
+    return packTail(sequence, length, words, w);
+}
+
+SK_TARGET_AVX2
+static size_t sumBytesAvx2(__m256i counts)
+{
+    __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return static_cast<size_t>(_mm_cvtsi128_si32(halves)) + static_cast<size_t>(_mm_extract_epi32(halves, 2));
+}
+
+SK_TARGET_AVX2
+static void countAvx2(const char * sequence, size_t length, BaseCounts& counts)
+{
+    const __m256i case_mask = _mm256_set1_epi8(SK_BYTE(0xDF));
+    size_t at = 0, gc = 0, n = 0;
+    size_t i = 0;
+    while (i + 32 <= length) {
+        __m256i at_counts = _mm256_setzero_si256();
+        __m256i gc_counts = _mm256_setzero_si256();
+        __m256i n_counts = _mm256_setzero_si256();
+        for (int block = 0; block < 255 && i + 32 <= length; ++block, i += 32) {
+            __m256i bytes = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(sequence + i)), case_mask);
+            at_counts = _mm256_sub_epi8(at_counts, _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('A')),
+                                                                   _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('T'))));
+            gc_counts = _mm256_sub_epi8(gc_counts, _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('G')),
+                                                                   _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('C'))));
+            n_counts = _mm256_sub_epi8(n_counts, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('N')));
+        }
+        at += sumBytesAvx2(at_counts);
+        gc += sumBytesAvx2(gc_counts);
+        n += sumBytesAvx2(n_counts);
+    }
+    countSse41(sequence + i, length - i, counts);
+    counts.AT += at;
+    counts.GC += gc;
+    counts.N += n;
+    counts.Other = length - counts.AT - counts.GC - counts.N;
+}
+
+#endif
+
+struct SeqKernelSet {
+    size_t (*validate)(const char *, size_t, SeqAlphabet);
+    void (*reverseComplement)(const char *, size_t, char *);
+    bool (*pack)(const char *, size_t, unsigned int *);
+    void (*count)(const char *, size_t, BaseCounts&);
+};
+
+static const SeqKernelSet SK_KernelSets[3] = {
+    {validateScalar, reverseComplementScalar, packScalar, countScalar},
+#if HAVE_SIMD_DISPATCH
+    {validateSse41, reverseComplementSse41, packSse41, countSse41},
+    {validateAvx2, reverseComplementAvx2, packAvx2, countAvx2}
+#else
+    {validateScalar, reverseComplementScalar, packScalar, countScalar},
+    {validateScalar, reverseComplementScalar, packScalar, countScalar}
+#endif
+};
+
+static bool levelSupported(SeqKernelLevel level)
+{
+    switch (level) {
+        case SK_SCALAR:
+            return true;
+#if HAVE_SIMD_DISPATCH
+        case SK_SSE41:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1");
+        case SK_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static SeqKernelLevel bestLevel(void)
+{
+    if (levelSupported(SK_AVX2)) {
+        return SK_AVX2;
+    }
+    if (levelSupported(SK_SSE41)) {
+        return SK_SSE41;
+    }
+    return SK_SCALAR;
+}
+
+// chosen while the program starts, before any threads
+static SeqKernelLevel SK_Level = bestLevel();
+
+size_t validateBases(const char * sequence, size_t length, SeqAlphabet alphabet)
+{
+    return SK_KernelSets[SK_Level].validate(sequence, length, alphabet);
+}
+
+void reverseComplement(const char * sequence, size_t length, char * out)
+{
+    SK_KernelSets[SK_Level].reverseComplement(sequence, length, out);
+}
+
+std::string reverseComplement(const std::string& sequence)
+{
+    std::string out(sequence.length(), '\0');
+    if (!sequence.empty()) {
+        reverseComplement(sequence.data(), sequence.length(), &out[0]);
+    }
+    return out;
+}
+
+bool packBases(const char * sequence, size_t length, unsigned int * words)
+{
+    return SK_KernelSets[SK_Level].pack(sequence, length, words);
+}
+
+void countBases(const char * sequence, size_t length, BaseCounts& counts)
+{
+    SK_KernelSets[SK_Level].count(sequence, length, counts);
+}
+
+void encodeBases(const char * sequence, size_t length, unsigned char * codes)
+{
+    for (size_t i = 0; i < length; ++i) {
+        codes[i] = SK_Codes[static_cast<unsigned char>(sequence[i])];
+    }
+}
+
+double dustScore(const char * sequence, size_t length)
+{
+    unsigned int counts[64];
+    memset(counts, 0, sizeof(counts));
+    unsigned int triplet = 0;
+    size_t run = 0;
+    size_t triplets = 0;
+    size_t pairs = 0;
+    for (size_t i = 0; i < length; ++i) {
+        unsigned int code = SK_Codes[static_cast<unsigned char>(sequence[i])];
+        if (code > 3) {
+            run = 0;
+            continue;
+        }
+        triplet = ((triplet << 2) | code) & 63;
+        if (++run >= 3) {
+            // each new triplet pairs with every earlier copy of itself
+            pairs += counts[triplet]++;
+            ++triplets;
+        }
+    }
+    return (triplets > 1) ? static_cast<double>(pairs) / (triplets - 1) : 0.0;
+}
+
+static int editDistanceBitVector(const unsigned char * a, size_t aLength, const unsigned char * b, size_t bLength, int limit)
+{
+    // the bits of a word are the rows of a column, set in Peq where that
+    // base of a matches the base of b.  Pv and Mv hold the rows where the
+    // score goes up or down by one from the row above
+    uint64_t peq[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < aLength; ++i) {
+        if (a[i] < SK_OTHER) {
+            peq[a[i]] |= static_cast<uint64_t>(1) << i;
+        }
+    }
+    uint64_t last_row = static_cast<uint64_t>(1) << (aLength - 1);
+    uint64_t pv = (last_row << 1) - 1;
+    uint64_t mv = 0;
+    int score = static_cast<int>(aLength);
+    for (size_t j = 0; j < bLength; ++j) {
+        uint64_t eq = (b[j] < SK_OTHER) ? peq[b[j]] : 0;
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last_row) {
+            ++score;
+        } else if (mh & last_row) {
+            --score;
+        }
+
+        // the top row goes up by one in every column for a global alignment
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        // each of the columns left can lower the score by one at most
+        if (score - static_cast<int>(bLength - 1 - j) > limit) {
+            return limit + 1;
+        }
+    }
+    return (score > limit) ? limit + 1 : score;
+}
+
+static int editDistanceBanded(const unsigned char * a, size_t aLength, const unsigned char * b, size_t bLength, int limit)
+{
+    // row i only holds the cells of columns i - limit to i + limit, cell d
+    // of a row is column i - limit + d
+    int width = 2 * limit + 1;
+    int too_far = limit + 1;
+    std::vector<int> previous(width + 2, too_far);
+    std::vector<int> current(width + 2, too_far);
+    for (int d = limit; d < width && d - limit <= static_cast<int>(bLength); ++d) {
+        previous[d + 1] = d - limit;
+    }
+    for (size_t i = 1; i <= aLength; ++i) {
+        int best = too_far;
+        for (int d = 0; d < width; ++d) {
+            long column = static_cast<long>(i) - limit + d;
+            int cell = too_far;
+            if (column == 0) {
+                cell = static_cast<int>(i);
+            } else if (column > 0 && column <= static_cast<long>(bLength)) {
+                bool match = a[i - 1] < SK_OTHER && a[i - 1] == b[column - 1];
+                cell = previous[d + 1] + (match ? 0 : 1);
+                cell = std::min(cell, previous[d + 2] + 1);
+                cell = std::min(cell, current[d] + 1);
+            }
+            current[d + 1] = std::min(cell, too_far);
+            best = std::min(best, current[d + 1]);
+        }
+        if (best > limit) {
+            return limit + 1;
+        }
+        previous.swap(current);
+    }
+    return previous[static_cast<long>(bLength) - static_cast<long>(aLength) + limit + 1];
+}
+
+int editDistance(const unsigned char * a, size_t aLength, const unsigned char * b, size_t bLength, int limit)
+{
+    size_t difference = (aLength > bLength) ? aLength - bLength : bLength - aLength;
+    if (limit < 0 || difference > static_cast<size_t>(limit)) {
+        return limit + 1;
+    }
+    if (aLength == 0 || bLength == 0) {
+        return static_cast<int>(difference);
+    }
+    if (aLength <= SK_MAX_BITVECTOR) {
+        return editDistanceBitVector(a, aLength, b, bLength, limit);
+    }
+    return editDistanceBanded(a, aLength, b, bLength, limit);
+}
+
+void reverseComplementPacked(const unsigned int * words, size_t length, unsigned int * out)
+{
+    size_t num_words = packedWords(length);
+    for (size_t i = 0; i < num_words; ++i) {
+        // complement the codes and reverse their order in the word
+        unsigned int word = ~words[num_words - 1 - i];
+        word = ((word >> 2) & 0x33333333u) | ((word & 0x33333333u) << 2);
+        word = ((word >> 4) & 0x0F0F0F0Fu) | ((word & 0x0F0F0F0Fu) << 4);
+        word = ((word >> 8) & 0x00FF00FFu) | ((word & 0x00FF00FFu) << 8);
+        out[i] = (word >> 16) | (word << 16);
+    }
+    // the padding of the last word is now at the front, shift it back out
+    unsigned int shift = static_cast<unsigned int>(2 * (num_words * SK_BASES_PER_WORD - length));
+    if (shift) {
+        for (size_t i = 0; i < num_words; ++i) {
+            out[i] <<= shift;
+            if (i + 1 < num_words) {
+                out[i] |= out[i + 1] >> (32 - shift);
+            }
+        }
+    }
+}
+
+void unpackBases(const unsigned int * words, size_t length, char * out)
+{
+    size_t i = 0;
+    for (size_t w = 0; i < length; ++w) {
+        for (int byte = 3; byte >= 0 && i < length; --byte) {
+            size_t count = (length - i < 4) ? length - i : 4;
+            memcpy(out + i, SK_UnpackTable[(words[w] >> (8 * byte)) & 0xFF], count);
+            i += count;
+        }
+    }
+}
+
+SeqKernelLevel seqKernelLevel(void)
+{
+    return SK_Level;
+}
+
+bool setSeqKernelLevel(SeqKernelLevel level)
+{
+    if (!levelSupported(level)) {
+        return false;
+    }
+    SK_Level = level;
+    return true;
+}
+
+const char * seqKernelName(SeqKernelLevel level)
+{
+    switch (level) {
+        case SK_SSE41: return "sse4.1";
+        case SK_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * SeqKernels.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_SeqKernels_h
+#define crisprtools_SeqKernels_h
+
+#include <string>
+#include <cstddef>
+
+// Basic operations on nucleotide sequences.  Each one has a plain C++
+// version and, when HAVE_SIMD_DISPATCH is set, SSE4.1 and AVX2 versions
+// chosen when the program starts from what the processor supports.  All
+// of the versions give the same results
+
+#define SK_BASES_PER_WORD 16        // 2 bits per base in an unsigned int
+
+enum SeqAlphabet {
+    SK_ACGT,                        // A C G T
+    SK_ACGTN,                       // A C G T N
+    SK_IUPAC                        // A C G T U R Y S W K M B D H V N
+};
+
+enum SeqKernelLevel {
+    SK_SCALAR,
+    SK_SSE41,
+    SK_AVX2
+};
+
+struct BaseCounts {
+    size_t AT;                      // A T
+    size_t GC;                      // G C
+    size_t N;                       // N
+    size_t Other;                   // everything else, including IUPAC codes
+};
+
+// the number of words needed to pack length bases
+inline size_t packedWords(size_t length) {return (length + SK_BASES_PER_WORD - 1) / SK_BASES_PER_WORD;}
+
+// position of the first character that isn't in the alphabet, in either
+// case, or length if they all are
+size_t validateBases(const char * sequence, size_t length, SeqAlphabet alphabet);
+
+// write the reverse complement of sequence into out, which must not overlap
+// it.  IUPAC codes are complemented and keep their case, anything else is
+// copied as it is
+void reverseComplement(const char * sequence, size_t length, char * out);
+std::string reverseComplement(const std::string& sequence);
+
+// pack 2 bits per base, A=0 C=1 G=2 T=3, with the first base in the top
+// bits of the first word.  The unused bits of the last word are zero so
+// comparing the words compares the sequences.  Returns false, leaving
+// words undefined, if there is anything other than ACGT in the sequence
+bool packBases(const char * sequence, size_t length, unsigned int * words);
+
+// the packed reverse complement of packed bases
+void reverseComplementPacked(const unsigned int * words, size_t length, unsigned int * out);
+
+// the upper case sequence of packed bases
+void unpackBases(const unsigned int * words, size_t length, char * out);
+
+void countBases(const char * sequence, size_t length, BaseCounts& counts);
+
+// the 2 bit code of each base, A=0 C=1 G=2 T=3 in either case, and
+// SK_OTHER for anything else
+#define SK_OTHER 4
+void encodeBases(const char * sequence, size_t length, unsigned char * codes);
+
+// symmetric DUST score of the whole sequence: the number of pairs of
+// identical triplets divided by one less than the number of triplets.
+// Triplets with bases other than ACGT are skipped.  Close to 0 for random
+// sequence, a 30 base homopolymer scores 14
+double dustScore(const char * sequence, size_t length);
+
+// the edit distance between two sequences of codes, or limit + 1 if it's
+// more than limit.  SK_OTHER doesn't match anything, not even itself.
+// When a is no longer than SK_MAX_BITVECTOR bases each column of the
+// alignment is worked out at once in a 64 bit word (Myers' bit-vector
+// algorithm), longer sequences use a band of 2 * limit + 1 diagonals
+#define SK_MAX_BITVECTOR 64
+int editDistance(const unsigned char * a, size_t aLength, const unsigned char * b, size_t bLength, int limit);
+
+// the kernels in use, which can be lowered to compare the versions.
+// Returns false if the processor doesn't support the level asked for
+SeqKernelLevel seqKernelLevel(void);
+bool setSeqKernelLevel(SeqKernelLevel level);
+const char * seqKernelName(SeqKernelLevel level);
+
+#endif
@@ -0,0 +1,197 @@
+// SeqKernelsBench.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Microbenchmarks for the sequence kernels.  Every level the processor
+// supports is first checked against the scalar kernels on random
+// sequences of many lengths, then timed on a large buffer.
+// Build with 'make seqkernels_bench', usage: seqkernels_bench [MiB]
+
+#include "SeqKernels.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#define SB_DEFAULT_SIZE 64          // MiB of sequence timed by default
+#define SB_CHECK_LENGTHS 300        // every length below this is checked
+#define SB_REPEATS 5                // best of this many runs is reported
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static std::string randomSequence(size_t length, const char * alphabet)
+{
+    size_t size = strlen(alphabet);
+    std::string sequence(length, 'A');
+    for (size_t i = 0; i < length; ++i) {
+        sequence[i] = alphabet[rand() % size];
+    }
+    return sequence;
+}
+
+struct Results {
+    size_t Valid[3];
+    std::string Reverse;
+    bool Packed;
+    std::vector<unsigned int> Words;
+    BaseCounts Counts;
+};
+
+static void runKernels(const std::string& sequence, Results& results)
+{
+    const char * data = sequence.data();
+    size_t length = sequence.length();
+    results.Valid[0] = validateBases(data, length, SK_ACGT);
+    results.Valid[1] = validateBases(data, length, SK_ACGTN);
+    results.Valid[2] = validateBases(data, length, SK_IUPAC);
+    results.Reverse = reverseComplement(sequence);
+    results.Words.assign(packedWords(length) + 1, 0);
+    results.Packed = packBases(data, length, &results.Words[0]);
+    if (!results.Packed) {
+        results.Words.assign(packedWords(length) + 1, 0);
+    }
+    countBases(data, length, results.Counts);
+}
+
+static bool sameResults(const Results& a, const Results& b)
+{
+    return a.Valid[0] == b.Valid[0] && a.Valid[1] == b.Valid[1] && a.Valid[2] == b.Valid[2] &&
+        a.Reverse == b.Reverse && a.Packed == b.Packed && a.Words == b.Words &&
+        a.Counts.AT == b.Counts.AT && a.Counts.GC == b.Counts.GC &&
+        a.Counts.N == b.Counts.N && a.Counts.Other == b.Counts.Other;
+}
+
+// compare a level with the scalar kernels, returns the number of failures
+static int checkLevel(SeqKernelLevel level)
+{
+    static const char * alphabets[] = {"ACGT", "acgtACGT", "ACGTN", "ACGTRYKMSWBDHVNacgtn", "ACGT-.*x\x80\xff"};
+    int failures = 0;
+    for (size_t length = 0; length < SB_CHECK_LENGTHS; ++length) {
+        for (int a = 0; a < 5; ++a) {
+            std::string sequence = randomSequence(length, alphabets[a]);
+            Results expected, found;
+            setSeqKernelLevel(SK_SCALAR);
+            runKernels(sequence, expected);
+            setSeqKernelLevel(level);
+            runKernels(sequence, found);
+            if (!sameResults(expected, found)) {
+                printf("  %s differs from scalar on length %lu alphabet %s\n",
+                       seqKernelName(level), static_cast<unsigned long>(length), alphabets[a]);
+                ++failures;
+            }
+
+            // round trips on the packed form
+            if (expected.Packed && length) {
+                std::vector<unsigned int> reverse(packedWords(length));
+                reverseComplementPacked(&expected.Words[0], length, &reverse[0]);
+                std::string unpacked(length, ' ');
+                unpackBases(&reverse[0], length, &unpacked[0]);
+                std::string upper = expected.Reverse;
+                for (size_t i = 0; i < length; ++i) {
+                    upper[i] &= ~0x20;
+                }
+                if (unpacked != upper) {
+                    printf("  packed reverse complement is wrong on length %lu\n", static_cast<unsigned long>(length));
+                    ++failures;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+static void report(const char * name, SeqKernelLevel level, size_t bytes, double seconds)
+{
+    printf("%-20s %-8s %10.1f MiB/s\n", name, seqKernelName(level), bytes / seconds / 1048576.0);
+}
+
+static void timeLevel(SeqKernelLevel level, const std::string& sequence)
+{
+    setSeqKernelLevel(level);
+    const char * data = sequence.data();
+    size_t length = sequence.length();
+    std::vector<char> reverse(length);
+    std::vector<unsigned int> words(packedWords(length));
+    BaseCounts counts;
+    double best[4] = {1e30, 1e30, 1e30, 1e30};
+    size_t sink = 0;
+    for (int r = 0; r < SB_REPEATS; ++r) {
+        double start = now();
+        sink += validateBases(data, length, SK_IUPAC);
+        double t = now() - start;
+        best[0] = (t < best[0]) ? t : best[0];
+
+        start = now();
+        reverseComplement(data, length, &reverse[0]);
+        t = now() - start;
+        best[1] = (t < best[1]) ? t : best[1];
+
+        start = now();
+        sink += packBases(data, length, &words[0]);
+        t = now() - start;
+        best[2] = (t < best[2]) ? t : best[2];
+
+        start = now();
+        countBases(data, length, counts);
+        sink += counts.GC;
+        t = now() - start;
+        best[3] = (t < best[3]) ? t : best[3];
+    }
+    report("validate (IUPAC)", level, length, best[0]);
+    report("reverse complement", level, length, best[1]);
+    report("pack", level, length, best[2]);
+    report("count bases", level, length, best[3]);
+    if (sink == 0) {
+        printf("\n");
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    size_t mib = SB_DEFAULT_SIZE;
+    if (argc > 1) {
+        mib = static_cast<size_t>(atoi(argv[1]));
+        if (mib == 0) {
+            fprintf(stderr, "usage: %s [MiB]\n", argv[0]);
+            return 1;
+        }
+    }
+    SeqKernelLevel best = seqKernelLevel();
+    printf("kernels in use: %s\n", seqKernelName(best));
+
+    srand(1);
+    int failures = 0;
+    for (int level = SK_SCALAR; level <= best; ++level) {
+        failures += checkLevel(static_cast<SeqKernelLevel>(level));
+    }
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    std::string sequence = randomSequence(mib * 1048576, "ACGT");
+    for (int level = SK_SCALAR; level <= best; ++level) {
+        timeLevel(static_cast<SeqKernelLevel>(level), sequence);
+    }
+    return 0;
+}
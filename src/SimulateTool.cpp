@@ -0,0 +1,494 @@
+// SimulateTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "SimulateTool.h"
+#include "config.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/StlExt.h>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <getopt.h>
+
+static const char SM_BASES[] = "ACGT";
+
+SimulateRandom::SimulateRandom(uint64_t seed)
+{
+    // splitmix64 spreads the seed over all of the bits, so that seeds of
+    // 1, 2, 3... don't start out looking alike
+    uint64_t z = seed + SM_SPLITMIX_INCREMENT;
+    z = (z ^ (z >> 30)) * SM_SPLITMIX_FIRST;
+    z = (z ^ (z >> 27)) * SM_SPLITMIX_SECOND;
+    SR_State = z ^ (z >> 31);
+    if (!SR_State) {
+        // the one state xorshift can't leave
+        SR_State = SM_SPLITMIX_INCREMENT;
+    }
+}
+
+// str as it has to be written in an attribute value.  False if it has
+// control characters, which XML can't hold
+static bool escapeAttribute(const char * str, std::string& escaped)
+{
+    escaped.clear();
+    for (; *str; ++str) {
+        switch (*str) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            default:
+                if (static_cast<unsigned char>(*str) < 0x20) {
+                    return false;
+                }
+                escaped += *str;
+                break;
+        }
+    }
+    return true;
+}
+
+// a number of bytes with an optional K, M, G or T on the end
+static bool parseSize(const char * str, uint64_t& bytes)
+{
+    char * end;
+    double value = strtod(str, &end);
+    if (end == str || value <= 0) {
+        return false;
+    }
+    double scale = 1;
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': scale = 1024.0; ++end; break;
+        case 'm': case 'M': scale = 1024.0 * 1024.0; ++end; break;
+        case 'g': case 'G': scale = 1024.0 * 1024.0 * 1024.0; ++end; break;
+        case 't': case 'T': scale = 1024.0 * 1024.0 * 1024.0 * 1024.0; ++end; break;
+        default: return false;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    bytes = static_cast<uint64_t>(value * scale);
+    return true;
+}
+
+int SimulateTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"num-groups", required_argument, NULL, 'n'},
+        {"size", required_argument, NULL, 'z'},
+        {"spacers", required_argument, NULL, 's'},
+        {"coverage", required_argument, NULL, 'c'},
+        {"coverage-model", required_argument, NULL, 'd'},
+        {"flankers", required_argument, NULL, 'f'},
+        {"branching", required_argument, NULL, 'b'},
+        {"shared", required_argument, NULL, 'p'},
+        {"metadata", required_argument, NULL, 'm'},
+        {"seed", required_argument, NULL, 'r'},
+        {"outfile", required_argument, NULL, 'o'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hn:z:s:c:d:f:b:p:m:r:o:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                simulateUsage();
+                exit(1);
+                break;
+            }
+            case 'n':
+            {
+                if (!from_string<long>(SM_NumGroups, optarg, std::dec) || SM_NumGroups < 1) {
+                    throw crispr::input_exception("The number of groups must be at least 1");
+                }
+                break;
+            }
+            case 'z':
+            {
+                if (!parseSize(optarg, SM_TargetBytes)) {
+                    throw crispr::input_exception("The size must be a number of bytes, with an optional K, M, G or T");
+                }
+                break;
+            }
+            case 's':
+            {
+                if (!from_string<int>(SM_Spacers, optarg, std::dec) || SM_Spacers < 1) {
+                    throw crispr::input_exception("The number of spacers must be at least 1");
+                }
+                break;
+            }
+            case 'c':
+            {
+                if (!from_string<int>(SM_Coverage, optarg, std::dec) || SM_Coverage < 1) {
+                    throw crispr::input_exception("The coverage must be at least 1");
+                }
+                break;
+            }
+            case 'd':
+            {
+                if (!strcmp(optarg, "fixed")) {
+                    SM_Model = SM_FIXED;
+                } else if (!strcmp(optarg, "uniform")) {
+                    SM_Model = SM_UNIFORM;
+                } else if (!strcmp(optarg, "exponential")) {
+                    SM_Model = SM_EXPONENTIAL;
+                } else {
+                    throw crispr::input_exception("The coverage model must be fixed, uniform or exponential");
+                }
+                break;
+            }
+            case 'f':
+            {
+                if (!from_string<int>(SM_Flankers, optarg, std::dec) || SM_Flankers < 0) {
+                    throw crispr::input_exception("The number of flankers can't be negative");
+                }
+                break;
+            }
+            case 'b':
+            {
+                if (!from_string<double>(SM_Branching, optarg, std::dec) || SM_Branching < 0) {
+                    throw crispr::input_exception("The branching factor can't be negative");
+                }
+                break;
+            }
+            case 'p':
+            {
+                if (!from_string<double>(SM_Shared, optarg, std::dec) || SM_Shared < 0 || SM_Shared > 1) {
+                    throw crispr::input_exception("The shared spacer fraction must be between 0 and 1");
+                }
+                break;
+            }
+            case 'm':
+            {
+                // escaped once here as it is written in every group
+                if (!escapeAttribute(optarg, SM_MetadataPrefix)) {
+                    throw crispr::input_exception("The metadata prefix can't contain control characters");
+                }
+                break;
+            }
+            case 'r':
+            {
+                if (!from_string<unsigned long>(SM_Seed, optarg, std::dec)) {
+                    throw crispr::input_exception("The seed must be a whole number");
+                }
+                break;
+            }
+            case 'o':
+            {
+                SM_OutputFile = optarg;
+                break;
+            }
+            default:
+            {
+                simulateUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    SM_Random = SimulateRandom(SM_Seed);
+    return optind;
+}
+
+void SimulateTool::randomBases(std::string& sequence, int length)
+{
+    sequence.resize(length);
+    uint64_t bits = 0;
+    for (int i = 0; i < length; ++i) {
+        // 32 bases from each number
+        if (!(i & 31)) {
+            bits = SM_Random.next();
+        }
+        sequence[i] = SM_BASES[bits & 3];
+        bits >>= 2;
+    }
+}
+
+void SimulateTool::makeFamilies(void)
+{
+    SM_Families.resize(SM_REPEAT_FAMILIES);
+    for (int i = 0; i < SM_REPEAT_FAMILIES; ++i) {
+        randomBases(SM_Families[i], SM_Random.range(SM_MIN_REPEAT, SM_MAX_REPEAT));
+    }
+}
+
+void SimulateTool::makeRepeat(std::string& repeat)
+{
+    repeat = SM_Families[SM_Random.range(0, SM_REPEAT_FAMILIES - 1)];
+    int changes = SM_Random.range(0, SM_MAX_REPEAT_CHANGES);
+    for (int i = 0; i < changes; ++i) {
+        repeat[SM_Random.range(0, static_cast<int>(repeat.length()) - 1)] = SM_BASES[SM_Random.next() >> 62];
+    }
+}
+
+void SimulateTool::makeSpacer(std::string& spacer)
+{
+    if (!SM_Pool.empty() && SM_Random.real() < SM_Shared) {
+        spacer = SM_Pool[SM_Random.range(0, static_cast<int>(SM_Pool.size()) - 1)];
+        return;
+    }
+    randomBases(spacer, SM_Random.range(SM_MIN_SPACER, SM_MAX_SPACER));
+
+    // the pool keeps the most recent new spacers
+    if (SM_Pool.size() < SM_SHARED_POOL) {
+        SM_Pool.push_back(spacer);
+    } else {
+        SM_Pool[SM_PoolNext] = spacer;
+        SM_PoolNext = (SM_PoolNext + 1) % SM_SHARED_POOL;
+    }
+}
+
+int SimulateTool::pickCoverage(void)
+{
+    switch (SM_Model) {
+        case SM_FIXED:
+            return SM_Coverage;
+        case SM_UNIFORM:
+            return SM_Random.range(1, 2 * SM_Coverage - 1);
+        case SM_EXPONENTIAL:
+        default:
+            // 1 plus an exponential with a mean of coverage - 1, rounded
+            return 1 + static_cast<int>(-(SM_Coverage - 1) * log(1.0 - SM_Random.real()) + 0.5);
+    }
+}
+
+void SimulateTool::makeLinks(int numSpacers)
+{
+    // each spacer leads to the next, and on average the branching factor
+    // more links go from a spacer to one further along
+    SM_Links.clear();
+    int whole = static_cast<int>(SM_Branching);
+    double part = SM_Branching - whole;
+    for (int i = 0; i + 1 < numSpacers; ++i) {
+        SM_Links.push_back(std::make_pair(i, i + 1));
+        if (i + 2 >= numSpacers) {
+            continue;
+        }
+        int extra = whole + (SM_Random.real() < part ? 1 : 0);
+        for (int j = 0; j < extra; ++j) {
+            SM_Links.push_back(std::make_pair(i, SM_Random.range(i + 2, numSpacers - 1)));
+        }
+    }
+    std::sort(SM_Links.begin(), SM_Links.end());
+    SM_Links.erase(std::unique(SM_Links.begin(), SM_Links.end()), SM_Links.end());
+
+    // the same links from the other end
+    SM_BackLinks.resize(SM_Links.size());
+    for (size_t i = 0; i < SM_Links.size(); ++i) {
+        SM_BackLinks[i] = std::make_pair(SM_Links[i].second, SM_Links[i].first);
+    }
+    std::sort(SM_BackLinks.begin(), SM_BackLinks.end());
+}
+
+void SimulateTool::writeNumber(long number)
+{
+    char buffer[24];
+    int length = snprintf(buffer, sizeof(buffer), "%ld", number);
+    SM_Output.write(buffer, length);
+}
+
+void SimulateTool::writeAttribute(const char * name, const std::string& value)
+{
+    SM_Output.put(' ');
+    writeText(name);
+    writeText("=\"");
+    SM_Output.write(value);
+    SM_Output.put('"');
+}
+
+void SimulateTool::writeAttribute(const char * name, const char * prefix, long number)
+{
+    SM_Output.put(' ');
+    writeText(name);
+    writeText("=\"");
+    writeText(prefix);
+    writeNumber(number);
+    SM_Output.put('"');
+}
+
+void SimulateTool::writeGroup(long group)
+{
+    // the sequences and links are each written in more than one place
+    makeRepeat(SM_Repeat);
+    int num_spacers = SM_Random.range((SM_Spacers + 1) / 2, SM_Spacers + SM_Spacers / 2);
+    SM_SpacerSeqs.resize(num_spacers);
+    for (int i = 0; i < num_spacers; ++i) {
+        makeSpacer(SM_SpacerSeqs[i]);
+    }
+    SM_FlankerSeqs.resize(SM_Flankers);
+    for (int i = 0; i < SM_Flankers; ++i) {
+        randomBases(SM_FlankerSeqs[i], SM_Random.range(SM_MIN_FLANKER, SM_MAX_FLANKER));
+    }
+    makeLinks(num_spacers);
+
+    writeText("\t<group");
+    writeAttribute("gid", "G", group);
+    writeAttribute("drseq", SM_Repeat);
+    writeText(">\n");
+
+    if (!SM_MetadataPrefix.empty()) {
+        writeText("\t\t<metadata>\n\t\t\t<file type=\"sequence\" url=\"");
+        SM_Output.write(SM_MetadataPrefix);
+        SM_Output.put('G');
+        writeNumber(group);
+        writeText(".fa\"/>\n\t\t</metadata>\n");
+    }
+
+    writeText("\t\t<data>\n\t\t\t<drs>\n\t\t\t\t<dr");
+    writeAttribute("seq", SM_Repeat);
+    writeText(" drid=\"DR1\"/>\n\t\t\t</drs>\n\t\t\t<spacers>\n");
+    for (int i = 0; i < num_spacers; ++i) {
+        writeText("\t\t\t\t<spacer");
+        writeAttribute("seq", SM_SpacerSeqs[i]);
+        writeAttribute("spid", "SP", i + 1);
+        writeAttribute("cov", "", pickCoverage());
+        writeText("/>\n");
+    }
+    writeText("\t\t\t</spacers>\n");
+    if (SM_Flankers) {
+        writeText("\t\t\t<flankers>\n");
+        for (int i = 0; i < SM_Flankers; ++i) {
+            writeText("\t\t\t\t<flanker");
+            writeAttribute("seq", SM_FlankerSeqs[i]);
+            writeAttribute("flid", "FL", i + 1);
+            writeText("/>\n");
+        }
+        writeText("\t\t\t</flankers>\n");
+    }
+    writeText("\t\t</data>\n");
+
+    //-----
+    // One contig of every spacer.  The flankers alternate between the
+    // leader end, before the first spacer, and the trailer end
+    //
+    writeText("\t\t<assembly>\n\t\t\t<contig cid=\"C1\">\n");
+    size_t forward = 0;
+    size_t backward = 0;
+    for (int i = 0; i < num_spacers; ++i) {
+        writeText("\t\t\t\t<cspacer");
+        writeAttribute("spid", "SP", i + 1);
+        writeText(">\n");
+        if (backward < SM_BackLinks.size() && SM_BackLinks[backward].first == i) {
+            writeText("\t\t\t\t\t<bspacers>\n");
+            for (; backward < SM_BackLinks.size() && SM_BackLinks[backward].first == i; ++backward) {
+                writeText("\t\t\t\t\t\t<bs");
+                writeAttribute("spid", "SP", SM_BackLinks[backward].second + 1);
+                writeText(" drid=\"DR1\" drconf=\"0\"/>\n");
+            }
+            writeText("\t\t\t\t\t</bspacers>\n");
+        }
+        if (forward < SM_Links.size() && SM_Links[forward].first == i) {
+            writeText("\t\t\t\t\t<fspacers>\n");
+            for (; forward < SM_Links.size() && SM_Links[forward].first == i; ++forward) {
+                writeText("\t\t\t\t\t\t<fs");
+                writeAttribute("spid", "SP", SM_Links[forward].second + 1);
+                writeText(" drid=\"DR1\" drconf=\"0\"/>\n");
+            }
+            writeText("\t\t\t\t\t</fspacers>\n");
+        }
+        if (i == 0 && SM_Flankers > 0) {
+            writeText("\t\t\t\t\t<bflankers>\n");
+            for (int f = 0; f < SM_Flankers; f += 2) {
+                writeText("\t\t\t\t\t\t<bf");
+                writeAttribute("flid", "FL", f + 1);
+                writeText(" drid=\"DR1\" directjoin=\"0\"/>\n");
+            }
+            writeText("\t\t\t\t\t</bflankers>\n");
+        }
+        if (i == num_spacers - 1 && SM_Flankers > 1) {
+            writeText("\t\t\t\t\t<fflankers>\n");
+            for (int f = 1; f < SM_Flankers; f += 2) {
+                writeText("\t\t\t\t\t\t<ff");
+                writeAttribute("flid", "FL", f + 1);
+                writeText(" drid=\"DR1\" directjoin=\"0\"/>\n");
+            }
+            writeText("\t\t\t\t\t</fflankers>\n");
+        }
+        writeText("\t\t\t\t</cspacer>\n");
+    }
+    writeText("\t\t\t</contig>\n\t\t</assembly>\n\t</group>\n");
+}
+
+void SimulateTool::simulate(void)
+{
+    if (SM_OutputFile.empty()) {
+        SM_Output.openStdout();
+    } else {
+        SM_Output.open(SM_OutputFile);
+    }
+    makeFamilies();
+
+    writeText("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<crispr version=\"1.1\">\n");
+    if (SM_TargetBytes) {
+        // whole groups until the file is big enough
+        for (long group = 1; static_cast<uint64_t>(SM_Output.offset()) < SM_TargetBytes; ++group) {
+            writeGroup(group);
+        }
+    } else {
+        for (long group = 1; group <= SM_NumGroups; ++group) {
+            writeGroup(group);
+        }
+    }
+    writeText("</crispr>\n");
+    SM_Output.close();
+}
+
+int simulateMain(int argc, char ** argv)
+{
+    try {
+        SimulateTool st;
+        int opt_index = st.processOptions(argc, argv);
+        if (opt_index < argc) {
+            throw crispr::input_exception("simulate doesn't take an input file");
+        }
+        st.simulate();
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        simulateUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void simulateUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" simulate [-h] [-n INT | -z SIZE] [-s INT] [-c INT] [-d MODEL] [-f INT] [-b NUM] [-p NUM] [-m PREFIX] [-r INT] [-o FILE]"<<std::endl;
+    std::cout<<"Write a made up .crispr file, for testing and benchmarking.  The same options always give the same file"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-n INT              number of groups [default: "<<SM_DEFAULT_GROUPS<<"]"<<std::endl;
+    std::cout<<"-z SIZE             keep adding groups until the file is this big, instead of -n.  Takes a K, M, G or T suffix"<<std::endl;
+    std::cout<<"-s INT              average number of spacers in a group, each group has from half to one and a half times"<<std::endl;
+    std::cout<<"                    this many [default: "<<SM_DEFAULT_SPACERS<<"]"<<std::endl;
+    std::cout<<"-c INT              average coverage of a spacer [default: "<<SM_DEFAULT_COVERAGE<<"]"<<std::endl;
+    std::cout<<"-d MODEL            how the coverage varies: fixed, uniform or exponential [default: exponential]"<<std::endl;
+    std::cout<<"-f INT              flankers in each group [default: "<<SM_DEFAULT_FLANKERS<<"]"<<std::endl;
+    std::cout<<"-b NUM              average number of extra links from each spacer to ones further along its contig,"<<std::endl;
+    std::cout<<"                    which makes the assembly graph branch [default: 0]"<<std::endl;
+    std::cout<<"-p NUM              chance of a spacer being copied from an earlier group, between 0 and 1 [default: "<<SM_DEFAULT_SHARED<<"]"<<std::endl;
+    std::cout<<"-m PREFIX           link each group to the sequence file PREFIX followed by the group ID and .fa in its metadata"<<std::endl;
+    std::cout<<"-r INT              seed for the random numbers [default: "<<SM_DEFAULT_SEED<<"]"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: print to screen]"<<std::endl;
+}
@@ -0,0 +1,158 @@
+/*
+ * SimulateTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_SimulateTool_h
+#define crisprtools_SimulateTool_h
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <stdint.h>
+#include "FastaSink.h"
+
+#define SM_DEFAULT_GROUPS 1000
+#define SM_DEFAULT_SPACERS 20       // average spacers in a group
+#define SM_DEFAULT_COVERAGE 10      // average coverage of a spacer
+#define SM_DEFAULT_FLANKERS 2
+#define SM_DEFAULT_SHARED 0.05      // chance of a spacer being copied from another group
+#define SM_DEFAULT_SEED 1
+#define SM_MIN_REPEAT 23            // lengths of the generated sequences
+#define SM_MAX_REPEAT 47
+#define SM_MIN_SPACER 26
+#define SM_MAX_SPACER 50
+#define SM_MIN_FLANKER 50
+#define SM_MAX_FLANKER 150
+#define SM_REPEAT_FAMILIES 64       // repeats that the direct repeats are variations of
+#define SM_MAX_REPEAT_CHANGES 2     // substitutions made to a family repeat
+#define SM_SHARED_POOL 4096         // recent spacers that can be copied into a group
+// xorshift64* multiplier and the splitmix64 constants used for seeding,
+// built from 32 bit halves since long long literals aren't allowed in C++98
+#define SM_XORSHIFT_MULTIPLIER ((static_cast<uint64_t>(0x2545f491) << 32) | 0x4f6cdd1d)
+#define SM_SPLITMIX_INCREMENT ((static_cast<uint64_t>(0x9e3779b9) << 32) | 0x7f4a7c15)
+#define SM_SPLITMIX_FIRST ((static_cast<uint64_t>(0xbf58476d) << 32) | 0x1ce4e5b9)
+#define SM_SPLITMIX_SECOND ((static_cast<uint64_t>(0x94d049bb) << 32) | 0x133111eb)
+
+enum CoverageModel {
+    SM_FIXED,                       // every spacer has the average coverage
+    SM_UNIFORM,                     // anywhere from 1 to twice the average
+    SM_EXPONENTIAL                  // mostly low with a long tail, like real samples
+};
+
+// xorshift64*, quick and good enough for made up sequences.  The same
+// seed always gives the same numbers on every platform
+class SimulateRandom {
+public:
+    SimulateRandom(uint64_t seed = SM_DEFAULT_SEED);
+
+    inline uint64_t next(void)
+    {
+        SR_State ^= SR_State >> 12;
+        SR_State ^= SR_State << 25;
+        SR_State ^= SR_State >> 27;
+        return SR_State * SM_XORSHIFT_MULTIPLIER;
+    }
+
+    // a number from lo to hi, both included
+    inline int range(int lo, int hi)
+    {
+        return lo + static_cast<int>((next() >> 32) % static_cast<uint64_t>(hi - lo + 1));
+    }
+
+    // a number in [0, 1)
+    inline double real(void)
+    {
+        return static_cast<double>(next() >> 11) / 9007199254740992.0;
+    }
+
+private:
+    uint64_t SR_State;
+};
+
+// Writes a made up .crispr file for testing and benchmarking the other
+// tools.  The XML is written straight to the output as text, without
+// building a DOM, so large files are made about as fast as the disk takes
+// them.  Everything comes from one seeded random number stream so the
+// same options always give the same file.  Direct repeats are variations
+// of a fixed set of family repeats, a few spacers are copied between
+// groups and the spacers of each group are laid out in one contig, in
+// order, with extra forward links to make branches
+class SimulateTool {
+public:
+    SimulateTool()
+    {
+        SM_NumGroups = SM_DEFAULT_GROUPS;
+        SM_TargetBytes = 0;
+        SM_Spacers = SM_DEFAULT_SPACERS;
+        SM_Coverage = SM_DEFAULT_COVERAGE;
+        SM_Model = SM_EXPONENTIAL;
+        SM_Flankers = SM_DEFAULT_FLANKERS;
+        SM_Branching = 0;
+        SM_Shared = SM_DEFAULT_SHARED;
+        SM_Seed = SM_DEFAULT_SEED;
+        SM_PoolNext = 0;
+    }
+
+    int processOptions(int argc, char ** argv);
+    void simulate(void);
+
+private:
+    void makeFamilies(void);
+    void randomBases(std::string& sequence, int length);
+    void makeRepeat(std::string& repeat);
+    void makeSpacer(std::string& spacer);
+    int pickCoverage(void);
+    void makeLinks(int numSpacers);
+    void writeGroup(long group);
+    inline void writeText(const char * text) {SM_Output.write(text, strlen(text));}
+    void writeNumber(long number);
+    void writeAttribute(const char * name, const std::string& value);
+    void writeAttribute(const char * name, const char * prefix, long number);
+
+    long SM_NumGroups;
+    uint64_t SM_TargetBytes;
+    int SM_Spacers;
+    int SM_Coverage;
+    CoverageModel SM_Model;
+    int SM_Flankers;
+    double SM_Branching;
+    double SM_Shared;
+    std::string SM_MetadataPrefix;
+    unsigned long SM_Seed;
+    std::string SM_OutputFile;
+
+    SimulateRandom SM_Random;
+    std::vector<std::string> SM_Families;
+    std::vector<std::string> SM_Pool;
+    size_t SM_PoolNext;
+
+    // the sequences and forward links of the group being written, reused
+    // between groups to save allocating
+    std::string SM_Repeat;
+    std::vector<std::string> SM_SpacerSeqs;
+    std::vector<std::string> SM_FlankerSeqs;
+    std::vector< std::pair<int, int> > SM_Links;
+    std::vector< std::pair<int, int> > SM_BackLinks;
+
+    FastaSink SM_Output;
+};
+
+int simulateMain(int argc, char ** argv);
+void simulateUsage(void);
+#endif
@@ -0,0 +1,140 @@
+// SpacerAutomaton.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "SpacerAutomaton.h"
+#include <libcrispr/Exception.h>
+
+SpacerAutomaton::SpacerAutomaton()
+{
+    SA_Built = false;
+    newState();
+}
+
+int SpacerAutomaton::newState(void)
+{
+    int state = static_cast<int>(SA_OwnHead.size());
+    SA_Next.insert(SA_Next.end(), 4, -1);
+    SA_OwnHead.push_back(-1);
+    return state;
+}
+
+void SpacerAutomaton::addPattern(const unsigned char * codes, size_t length, int id)
+{
+    if (SA_Built) {
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "pattern added to an automaton that has been built");
+    }
+    int state = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (codes[i] >= SK_OTHER) {
+            throw crispr::runtime_exception(__FILE__,
+                                            __LINE__,
+                                            __PRETTY_FUNCTION__,
+                                            "patterns can only contain A, C, G and T");
+        }
+        size_t slot = (static_cast<size_t>(state) << 2) | codes[i];
+        if (SA_Next[slot] == -1) {
+            // newState can move SA_Next so don't hold on to a reference
+            int child = newState();
+            SA_Next[slot] = child;
+        }
+        state = SA_Next[slot];
+    }
+    SA_OwnIds.push_back(id);
+    SA_OwnNext.push_back(SA_OwnHead[state]);
+    SA_OwnHead[state] = static_cast<int>(SA_OwnIds.size()) - 1;
+}
+
+void SpacerAutomaton::build(void)
+{
+    if (SA_Built) {
+        return;
+    }
+    int num_states = stateCount();
+    std::vector<int> fail(num_states, 0);
+    std::vector<int> order;
+    order.reserve(num_states);
+
+    //-----
+    // Breadth first, so that the failure state of every state is finished
+    // before it's needed.  Missing transitions are filled in from the
+    // failure state, turning the trie into a complete automaton
+    //
+    order.push_back(0);
+    for (size_t head = 0; head < order.size(); ++head) {
+        int state = order[head];
+        for (int code = 0; code < 4; ++code) {
+            size_t slot = (static_cast<size_t>(state) << 2) | code;
+            int child = SA_Next[slot];
+            if (child == -1) {
+                SA_Next[slot] = (state == 0) ? 0 : SA_Next[(static_cast<size_t>(fail[state]) << 2) | code];
+            } else {
+                fail[child] = (state == 0) ? 0 : SA_Next[(static_cast<size_t>(fail[state]) << 2) | code];
+                order.push_back(child);
+            }
+        }
+    }
+
+    //-----
+    // Renumber the states in breadth first order.  Almost all of the time
+    // is spent in the few states near the root, this puts them next to
+    // each other instead of spread through the table in the order the
+    // patterns were added
+    //
+    std::vector<int> renumbered(num_states);
+    for (int i = 0; i < num_states; ++i) {
+        renumbered[order[i]] = i;
+    }
+    std::vector<int> next(SA_Next.size());
+    for (int i = 0; i < num_states; ++i) {
+        for (int code = 0; code < 4; ++code) {
+            next[(static_cast<size_t>(i) << 2) | code] = renumbered[SA_Next[(static_cast<size_t>(order[i]) << 2) | code]];
+        }
+    }
+    SA_Next.swap(next);
+
+    // a state matches its own patterns and everything its failure state
+    // matches, which comes before it in the new order
+    SA_MatchStart.assign(num_states + 1, 0);
+    for (int i = 1; i < num_states; ++i) {
+        int count = 0;
+        for (int own = SA_OwnHead[order[i]]; own != -1; own = SA_OwnNext[own]) {
+            ++count;
+        }
+        int failure = renumbered[fail[order[i]]];
+        SA_MatchStart[i + 1] = SA_MatchStart[i] + count + SA_MatchStart[failure + 1] - SA_MatchStart[failure];
+    }
+
+    // one spare so that matchBegin() is always a valid pointer
+    SA_Matches.assign(SA_MatchStart[num_states] + 1, -1);
+    for (int i = 1; i < num_states; ++i) {
+        int out = SA_MatchStart[i];
+        for (int own = SA_OwnHead[order[i]]; own != -1; own = SA_OwnNext[own]) {
+            SA_Matches[out++] = SA_OwnIds[own];
+        }
+        int failure = renumbered[fail[order[i]]];
+        for (int inherited = SA_MatchStart[failure]; inherited < SA_MatchStart[failure + 1]; ++inherited) {
+            SA_Matches[out++] = SA_Matches[inherited];
+        }
+    }
+
+    std::vector<int>().swap(SA_OwnIds);
+    std::vector<int>().swap(SA_OwnNext);
+    SA_Built = true;
+}
@@ -0,0 +1,72 @@
+/*
+ * SpacerAutomaton.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_SpacerAutomaton_h
+#define crisprtools_SpacerAutomaton_h
+
+#include <vector>
+#include <cstddef>
+#include "SeqKernels.h"
+
+// Aho-Corasick automaton over base codes (see encodeBases) that finds
+// every occurrence of many patterns in one pass over a sequence.  The
+// failure links are folded into a full transition table, four ints per
+// state, so each base costs one lookup.  Any code other than ACGT goes
+// back to the root.  Once built it is only read, so any number of threads
+// can scan with it at once
+class SpacerAutomaton {
+public:
+    SpacerAutomaton();
+
+    // patterns must be added before build(), id is reported for each match
+    void addPattern(const unsigned char * codes, size_t length, int id);
+    void build(void);
+
+    inline int root(void) const {return 0;}
+    inline int step(int state, unsigned char code) const
+    {
+        return (code < SK_OTHER) ? SA_Next[(static_cast<size_t>(state) << 2) | code] : 0;
+    }
+
+    // ids of the patterns that end at the last base stepped over
+    inline const int * matchBegin(int state) const {return &SA_Matches[0] + SA_MatchStart[state];}
+    inline const int * matchEnd(int state) const {return &SA_Matches[0] + SA_MatchStart[state + 1];}
+    inline bool hasMatch(int state) const {return SA_MatchStart[state] != SA_MatchStart[state + 1];}
+
+    inline int stateCount(void) const {return static_cast<int>(SA_OwnHead.size());}
+
+private:
+    int newState(void);
+
+    bool SA_Built;
+
+    // goto function while adding, the full transition table once built
+    std::vector<int> SA_Next;
+
+    // the patterns ending at each state while adding, newest first
+    std::vector<int> SA_OwnHead;
+    std::vector<int> SA_OwnIds;
+    std::vector<int> SA_OwnNext;
+
+    // every pattern ending at a state, own and through failure links
+    std::vector<int> SA_MatchStart;
+    std::vector<int> SA_Matches;
+};
+
+#endif
@@ -0,0 +1,161 @@
+// SpacerGraph.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "SpacerGraph.h"
+#include <algorithm>
+
+int SpacerGraph::addNode(const std::string& name, NODE_TYPE type)
+{
+    std::map<std::string, int>::iterator iter = SG_Index.find(name);
+    if (iter != SG_Index.end()) {
+        return iter->second;
+    }
+    int id = static_cast<int>(SG_Nodes.size());
+    SGNode n;
+    n.name = name;
+    n.type = type;
+    n.length = 1;
+    n.hasCoverage = false;
+    n.coverage = 0;
+    n.minCoverage = 0;
+    n.maxCoverage = 0;
+    SG_Nodes.push_back(n);
+    SG_OutEdges.push_back(adjacencyList());
+    SG_InEdges.push_back(adjacencyList());
+    SG_Index[name] = id;
+    return id;
+}
+
+int SpacerGraph::nodeWithName(const std::string& name) const
+{
+    std::map<std::string, int>::const_iterator iter = SG_Index.find(name);
+    if (iter != SG_Index.end()) {
+        return iter->second;
+    }
+    return -1;
+}
+
+bool SpacerGraph::findEdge(int tail, int head) const
+{
+    const adjacencyList& out = SG_OutEdges[tail];
+    return std::find(out.begin(), out.end(), head) != out.end();
+}
+
+void SpacerGraph::addEdge(int tail, int head)
+{
+    if (findEdge(tail, head)) {
+        return;
+    }
+    SG_OutEdges[tail].push_back(head);
+    SG_InEdges[head].push_back(tail);
+    ++SG_EdgeCount;
+}
+
+std::string SpacerGraph::label(int id) const
+{
+    const SGNode& n = SG_Nodes[id];
+    if (n.length > 1) {
+        return n.name + ".." + n.lastName;
+    }
+    return n.name;
+}
+
+bool SpacerGraph::isChainLink(int tail, int head) const
+{
+    // an edge can be merged away when it is the only way out of the tail
+    // and the only way into the head and both ends are spacers
+    return tail != head &&
+           SG_Nodes[tail].type == SPACER &&
+           SG_Nodes[head].type == SPACER &&
+           SG_OutEdges[tail].size() == 1 &&
+           SG_InEdges[head].size() == 1;
+}
+
+void SpacerGraph::compactChains(SpacerGraph& compacted) const
+{
+    int num_nodes = nodeCount();
+    std::vector<int> chain_of(num_nodes, -1);
+    std::vector<int> chain_start;
+
+    // start a chain from every node that can't be merged with its
+    // predecessor.  Anything left over afterwards is part of a cycle
+    // where every link is mergeable, those are cut at an arbitrary node
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int start = 0; start < num_nodes; ++start) {
+            if (chain_of[start] != -1) {
+                continue;
+            }
+            if (pass == 0 && SG_InEdges[start].size() == 1 &&
+                isChainLink(SG_InEdges[start].front(), start)) {
+                continue;
+            }
+
+            SGNode n = SG_Nodes[start];
+            n.length = 0;
+            n.hasCoverage = false;
+            double coverage_sum = 0;
+            int covered = 0;
+
+            int chain_id = static_cast<int>(compacted.SG_Nodes.size());
+            chain_start.push_back(start);
+            int current = start;
+            while (true) {
+                const SGNode& member = SG_Nodes[current];
+                chain_of[current] = chain_id;
+                n.lastName = member.name;
+                n.length += member.length;
+                if (member.hasCoverage) {
+                    if (!n.hasCoverage) {
+                        n.minCoverage = member.minCoverage;
+                        n.maxCoverage = member.maxCoverage;
+                        n.hasCoverage = true;
+                    } else {
+                        n.minCoverage = std::min(n.minCoverage, member.minCoverage);
+                        n.maxCoverage = std::max(n.maxCoverage, member.maxCoverage);
+                    }
+                    coverage_sum += member.coverage * member.length;
+                    covered += member.length;
+                }
+                if (SG_OutEdges[current].size() != 1) {
+                    break;
+                }
+                int next = SG_OutEdges[current].front();
+                if (!isChainLink(current, next) || chain_of[next] != -1) {
+                    break;
+                }
+                current = next;
+            }
+            n.coverage = (covered) ? coverage_sum / covered : 0;
+
+            compacted.SG_Nodes.push_back(n);
+            compacted.SG_OutEdges.push_back(adjacencyList());
+            compacted.SG_InEdges.push_back(adjacencyList());
+            compacted.SG_Index[n.name] = chain_id;
+        }
+    }
+
+    // only the edges between chains survive, plus any edge that loops
+    // back to the start of its own chain so that cycles are still visible
+    for (int tail = 0; tail < num_nodes; ++tail) {
+        adjacencyList::const_iterator iter;
+        for (iter = SG_OutEdges[tail].begin(); iter != SG_OutEdges[tail].end(); ++iter) {
+            if (chain_of[tail] != chain_of[*iter] || chain_start[chain_of[*iter]] == *iter) {
+                compacted.addEdge(chain_of[tail], chain_of[*iter]);
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * SpacerGraph.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_SpacerGraph_h
+#define crisprtools_SpacerGraph_h
+
+#include <string>
+#include <vector>
+#include <map>
+
+// In-memory adjacency representation of the spacer graph of a single
+// group.  Node names are interned as they are added, after that every
+// spacer or flanker is referred to by its integer id
+class SpacerGraph {
+public:
+    enum NODE_TYPE {
+        SPACER = 0,
+        FLANKER = 1
+    };
+
+    // a node can stand for a whole chain of spacers once the graph has
+    // been compacted, in that case name is the first spacer in the chain,
+    // lastName is the final one and length is the number of spacers
+    typedef struct __SGNode {
+        std::string name;
+        std::string lastName;
+        NODE_TYPE type;
+        int length;
+        bool hasCoverage;
+        double coverage;
+        double minCoverage;
+        double maxCoverage;
+    } SGNode;
+
+    typedef std::vector<int> adjacencyList;
+
+    SpacerGraph(std::string name)
+    {
+        SG_Name = name;
+        SG_EdgeCount = 0;
+    }
+
+    inline std::string getName(void) const {return SG_Name;}
+    inline int nodeCount(void) const {return static_cast<int>(SG_Nodes.size());}
+    inline int edgeCount(void) const {return SG_EdgeCount;}
+
+    // returns the id of the node, creating it if it hasn't been seen before
+    int addNode(const std::string& name, NODE_TYPE type);
+
+    // returns -1 if there is no node with that name
+    int nodeWithName(const std::string& name) const;
+
+    // add a directed edge, duplicate edges are ignored
+    void addEdge(int tail, int head);
+    bool findEdge(int tail, int head) const;
+
+    inline void setCoverage(int id, double coverage)
+    {
+        SG_Nodes[id].hasCoverage = true;
+        SG_Nodes[id].coverage = coverage;
+        SG_Nodes[id].minCoverage = coverage;
+        SG_Nodes[id].maxCoverage = coverage;
+    }
+
+    // the text to show for a node, chains are shown as first..last
+    std::string label(int id) const;
+
+    // collapse every maximal non-branching run of spacers into a single
+    // node and store the reduced graph in compacted.  Flankers and any
+    // spacer at a branch point are left alone, so the size of the result
+    // depends on the number of branches rather than the number of spacers
+    void compactChains(SpacerGraph& compacted) const;
+
+    inline const SGNode& node(int id) const {return SG_Nodes[id];}
+    inline const adjacencyList& successors(int id) const {return SG_OutEdges[id];}
+    inline const adjacencyList& predecessors(int id) const {return SG_InEdges[id];}
+
+private:
+    bool isChainLink(int tail, int head) const;
+
+    std::string SG_Name;
+    std::vector<SGNode> SG_Nodes;
+    std::map<std::string, int> SG_Index;
+    std::vector<adjacencyList> SG_OutEdges;
+    std::vector<adjacencyList> SG_InEdges;
+    int SG_EdgeCount;
+};
+
+#endif
@@ -0,0 +1,445 @@
+// SpacerIndex.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "SpacerIndex.h"
+#include "SeqKernels.h"
+#include <libcrispr/Exception.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SI_KMER_MASK(k) (((k) >= 16) ? 0xffffffffu : ((1u << (2 * (k))) - 1))
+
+// a k-mer occurrence while the index is built
+typedef struct __KmerPosting {
+    uint32_t Kmer;
+    uint32_t Sequence;
+    uint32_t Position;
+} KmerPosting;
+
+static bool operator<(const KmerPosting& a, const KmerPosting& b)
+{
+    if (a.Kmer != b.Kmer) {
+        return a.Kmer < b.Kmer;
+    }
+    return (a.Sequence != b.Sequence) ? a.Sequence < b.Sequence : a.Position < b.Position;
+}
+
+static bool hitOrder(const IndexHit& a, const IndexHit& b)
+{
+    if (a.Sequence != b.Sequence) {
+        return a.Sequence < b.Sequence;
+    }
+    return (a.Position != b.Position) ? a.Position < b.Position : a.Strand < b.Strand;
+}
+
+static void checkSize(size_t size, const char * what)
+{
+    if (size > 0xffffffffu) {
+        std::stringstream msg;
+        msg<<"too many "<<what<<" for the index";
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+}
+
+template <class T>
+static void writeArray(std::ofstream& out, const std::vector<T>& array)
+{
+    if (!array.empty()) {
+        out.write(reinterpret_cast<const char *>(&array[0]), array.size() * sizeof(T));
+    }
+}
+
+SpacerIndexBuilder::SpacerIndexBuilder(int k)
+{
+    IB_K = k;
+}
+
+void SpacerIndexBuilder::addGroup(const std::string& gid)
+{
+    IB_Groups.push_back(gid);
+}
+
+void SpacerIndexBuilder::addElement(IndexElementType type, const std::string& id, const char * sequence)
+{
+    if (IB_Groups.empty()) {
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "element added to the index before its group");
+    }
+    std::string upper = sequence;
+    for (size_t i = 0; i < upper.length(); ++i) {
+        upper[i] = static_cast<char>(toupper(upper[i]));
+    }
+    std::map<std::string, int>::iterator iter = IB_SequenceIndex.find(upper);
+    int sequence_id;
+    if (iter == IB_SequenceIndex.end()) {
+        sequence_id = static_cast<int>(IB_Sequences.size());
+        IB_SequenceIndex[upper] = sequence_id;
+        IB_Sequences.push_back(upper);
+    } else {
+        sequence_id = iter->second;
+    }
+
+    BuilderElement element;
+    element.Group = static_cast<int>(IB_Groups.size()) - 1;
+    element.Sequence = sequence_id;
+    element.Type = type;
+    element.Name = id;
+    IB_Elements.push_back(element);
+}
+
+void SpacerIndexBuilder::write(const std::string& fileName)
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, SI_MAGIC, sizeof(header.Magic));
+    header.Version = SI_VERSION;
+    header.K = IB_K;
+
+    std::string strings;
+    std::vector<uint32_t> groups(IB_Groups.size());
+    for (size_t i = 0; i < IB_Groups.size(); ++i) {
+        groups[i] = static_cast<uint32_t>(strings.length());
+        strings += IB_Groups[i];
+        strings += '\0';
+    }
+
+    // the elements of each sequence together, in the order they were added
+    size_t num_sequences = IB_Sequences.size();
+    std::vector<IndexSequence> sequences(num_sequences);
+    std::string bases;
+    for (size_t i = 0; i < num_sequences; ++i) {
+        checkSize(bases.length(), "bases");
+        sequences[i].Bases = static_cast<uint32_t>(bases.length());
+        sequences[i].Length = static_cast<uint32_t>(IB_Sequences[i].length());
+        sequences[i].FirstElement = 0;
+        sequences[i].NumElements = 0;
+        bases += IB_Sequences[i];
+    }
+    checkSize(bases.length(), "bases");
+    for (size_t i = 0; i < IB_Elements.size(); ++i) {
+        ++sequences[IB_Elements[i].Sequence].NumElements;
+    }
+    uint32_t first = 0;
+    for (size_t i = 0; i < num_sequences; ++i) {
+        sequences[i].FirstElement = first;
+        first += sequences[i].NumElements;
+    }
+    std::vector<uint32_t> filled(num_sequences, 0);
+    std::vector<IndexElement> elements(IB_Elements.size());
+    for (size_t i = 0; i < IB_Elements.size(); ++i) {
+        const BuilderElement& added = IB_Elements[i];
+        IndexElement& element = elements[sequences[added.Sequence].FirstElement + filled[added.Sequence]++];
+        element.Group = added.Group;
+        element.Sequence = added.Sequence;
+        element.Type = added.Type;
+        checkSize(strings.length(), "names");
+        element.Name = static_cast<uint32_t>(strings.length());
+        strings += added.Name;
+        strings += '\0';
+    }
+    checkSize(strings.length(), "names");
+
+    //-----
+    // Every k-mer of only ACGT in each distinct sequence, sorted so that a
+    // query k-mer can be found with a binary search
+    //
+    std::vector<KmerPosting> postings;
+    uint32_t mask = SI_KMER_MASK(IB_K);
+    for (size_t i = 0; i < num_sequences; ++i) {
+        const std::string& sequence = IB_Sequences[i];
+        std::vector<unsigned char> codes(sequence.length() + 1);
+        encodeBases(sequence.data(), sequence.length(), &codes[0]);
+        uint32_t kmer = 0;
+        int run = 0;
+        for (size_t j = 0; j < sequence.length(); ++j) {
+            if (codes[j] == SK_OTHER) {
+                run = 0;
+                continue;
+            }
+            kmer = ((kmer << 2) | codes[j]) & mask;
+            if (++run >= IB_K) {
+                KmerPosting posting;
+                posting.Kmer = kmer;
+                posting.Sequence = static_cast<uint32_t>(i);
+                posting.Position = static_cast<uint32_t>(j + 1 - IB_K);
+                postings.push_back(posting);
+            }
+        }
+    }
+    checkSize(postings.size(), "k-mers");
+    std::sort(postings.begin(), postings.end());
+
+    std::vector<uint32_t> kmers;
+    std::vector<uint32_t> kmer_starts;
+    std::vector<uint32_t> posting_sequences(postings.size());
+    std::vector<uint32_t> posting_positions(postings.size());
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (i == 0 || postings[i].Kmer != postings[i - 1].Kmer) {
+            kmers.push_back(postings[i].Kmer);
+            kmer_starts.push_back(static_cast<uint32_t>(i));
+        }
+        posting_sequences[i] = postings[i].Sequence;
+        posting_positions[i] = postings[i].Position;
+    }
+    kmer_starts.push_back(static_cast<uint32_t>(postings.size()));
+
+    header.NumGroups = static_cast<uint32_t>(groups.size());
+    header.NumElements = static_cast<uint32_t>(elements.size());
+    header.NumSequences = static_cast<uint32_t>(sequences.size());
+    header.NumKmers = static_cast<uint32_t>(kmers.size());
+    header.NumPostings = static_cast<uint32_t>(postings.size());
+    header.StringBytes = static_cast<uint32_t>(strings.length());
+    header.BaseBytes = static_cast<uint32_t>(bases.length());
+
+    std::ofstream out(fileName.c_str(), std::ios::binary);
+    if (out.good()) {
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writeArray(out, groups);
+        writeArray(out, elements);
+        writeArray(out, sequences);
+        writeArray(out, kmers);
+        writeArray(out, kmer_starts);
+        writeArray(out, posting_sequences);
+        writeArray(out, posting_positions);
+        out.write(strings.data(), strings.length());
+        out.write(bases.data(), bases.length());
+        out.close();
+    }
+    if (out.fail()) {
+        std::stringstream msg;
+        msg<<"failed to write index file: "<<fileName;
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+}
+
+SpacerIndex::SpacerIndex()
+{
+    SI_Data = NULL;
+    SI_Size = 0;
+    SI_Header = NULL;
+}
+
+SpacerIndex::~SpacerIndex()
+{
+    close();
+}
+
+void SpacerIndex::open(const std::string& fileName)
+{
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        std::stringstream msg;
+        msg<<"failed to open index file: "<<fileName<<": "<<strerror(errno);
+        if (fd != -1) {
+            ::close(fd);
+        }
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void * data = (size >= sizeof(IndexHeader)) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::stringstream msg;
+        msg<<fileName<<" is not an index file";
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+    SI_Data = static_cast<const char *>(data);
+    SI_Size = size;
+    SI_Header = reinterpret_cast<const IndexHeader *>(SI_Data);
+
+    // the sizes in the header have to add up to the size of the file
+    const IndexHeader& header = *SI_Header;
+    size_t expected = sizeof(IndexHeader) +
+        sizeof(uint32_t) * static_cast<size_t>(header.NumGroups) +
+        sizeof(IndexElement) * static_cast<size_t>(header.NumElements) +
+        sizeof(IndexSequence) * static_cast<size_t>(header.NumSequences) +
+        sizeof(uint32_t) * (2 * static_cast<size_t>(header.NumKmers) + 1) +
+        sizeof(uint32_t) * 2 * static_cast<size_t>(header.NumPostings) +
+        header.StringBytes + header.BaseBytes;
+    if (memcmp(header.Magic, SI_MAGIC, sizeof(header.Magic)) ||
+        header.Version != SI_VERSION ||
+        header.K < SI_MIN_K || header.K > SI_MAX_K ||
+        expected != size) {
+        std::stringstream msg;
+        msg<<fileName<<" is not an index file or was made by a different version";
+        close();
+        throw crispr::runtime_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        msg);
+    }
+
+    const char * cursor = SI_Data + sizeof(IndexHeader);
+    SI_Groups = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += sizeof(uint32_t) * header.NumGroups;
+    SI_Elements = reinterpret_cast<const IndexElement *>(cursor);
+    cursor += sizeof(IndexElement) * header.NumElements;
+    SI_Sequences = reinterpret_cast<const IndexSequence *>(cursor);
+    cursor += sizeof(IndexSequence) * header.NumSequences;
+    SI_Kmers = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += sizeof(uint32_t) * header.NumKmers;
+    SI_KmerStarts = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += sizeof(uint32_t) * (header.NumKmers + 1);
+    SI_PostingSequences = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += sizeof(uint32_t) * header.NumPostings;
+    SI_PostingPositions = reinterpret_cast<const uint32_t *>(cursor);
+    cursor += sizeof(uint32_t) * header.NumPostings;
+    SI_Strings = cursor;
+    cursor += header.StringBytes;
+    SI_Bases = cursor;
+}
+
+void SpacerIndex::close(void)
+{
+    if (SI_Data != NULL) {
+        munmap(const_cast<char *>(SI_Data), SI_Size);
+    }
+    SI_Data = NULL;
+    SI_Size = 0;
+    SI_Header = NULL;
+}
+
+void SpacerIndex::find(const std::string& query, int mismatches, std::vector<IndexHit>& hits) const
+{
+    hits.clear();
+    if (query.empty()) {
+        return;
+    }
+    std::string forward = query;
+    for (size_t i = 0; i < forward.length(); ++i) {
+        forward[i] = static_cast<char>(toupper(forward[i]));
+    }
+    std::string reverse = reverseComplement(forward);
+
+    // when every one of mismatches + 1 pieces of the query is at least a
+    // k-mer long one of them has to match exactly
+    bool seeded = forward.length() / (mismatches + 1) >= SI_Header->K;
+    if (seeded) {
+        findSeeded(forward, '+', mismatches, hits);
+    } else {
+        findScan(forward, '+', mismatches, hits);
+    }
+    if (reverse != forward) {
+        if (seeded) {
+            findSeeded(reverse, '-', mismatches, hits);
+        } else {
+            findScan(reverse, '-', mismatches, hits);
+        }
+    }
+    std::sort(hits.begin(), hits.end(), hitOrder);
+}
+
+int SpacerIndex::countMismatches(const std::string& query, uint32_t sequence, uint32_t position, int limit) const
+{
+    const char * bases = SI_Bases + SI_Sequences[sequence].Bases + position;
+    int mismatches = 0;
+    for (size_t i = 0; i < query.length(); ++i) {
+        if (bases[i] != query[i] && ++mismatches > limit) {
+            break;
+        }
+    }
+    return mismatches;
+}
+
+void SpacerIndex::findSeeded(const std::string& query, char strand, int mismatches, std::vector<IndexHit>& hits) const
+{
+    uint32_t k = SI_Header->K;
+    size_t length = query.length();
+    std::vector<unsigned char> codes(length);
+    encodeBases(query.data(), length, &codes[0]);
+
+    // several pieces can lead to the same place
+    std::set<std::pair<uint32_t, uint32_t> > checked;
+    int num_pieces = mismatches + 1;
+    for (int piece = 0; piece < num_pieces; ++piece) {
+        size_t offset = piece * length / num_pieces;
+        uint32_t kmer = 0;
+        for (uint32_t i = 0; i < k; ++i) {
+            kmer = (kmer << 2) | codes[offset + i];
+        }
+        const uint32_t * end = SI_Kmers + SI_Header->NumKmers;
+        const uint32_t * found = std::lower_bound(SI_Kmers, end, kmer);
+        if (found == end || *found != kmer) {
+            continue;
+        }
+        size_t index = found - SI_Kmers;
+        for (uint32_t p = SI_KmerStarts[index]; p < SI_KmerStarts[index + 1]; ++p) {
+            uint32_t sequence = SI_PostingSequences[p];
+            uint32_t position = SI_PostingPositions[p];
+            if (position < offset || position - offset + length > SI_Sequences[sequence].Length) {
+                continue;
+            }
+            uint32_t start = static_cast<uint32_t>(position - offset);
+            if (!checked.insert(std::make_pair(sequence, start)).second) {
+                continue;
+            }
+            int found_mismatches = countMismatches(query, sequence, start, mismatches);
+            if (found_mismatches <= mismatches) {
+                IndexHit hit;
+                hit.Sequence = sequence;
+                hit.Position = start;
+                hit.Mismatches = found_mismatches;
+                hit.Strand = strand;
+                hits.push_back(hit);
+            }
+        }
+    }
+}
+
+void SpacerIndex::findScan(const std::string& query, char strand, int mismatches, std::vector<IndexHit>& hits) const
+{
+    uint32_t length = static_cast<uint32_t>(query.length());
+    for (uint32_t sequence = 0; sequence < SI_Header->NumSequences; ++sequence) {
+        uint32_t sequence_length = SI_Sequences[sequence].Length;
+        for (uint32_t start = 0; start + length <= sequence_length; ++start) {
+            int found_mismatches = countMismatches(query, sequence, start, mismatches);
+            if (found_mismatches <= mismatches) {
+                IndexHit hit;
+                hit.Sequence = sequence;
+                hit.Position = start;
+                hit.Mismatches = found_mismatches;
+                hit.Strand = strand;
+                hits.push_back(hit);
+            }
+        }
+    }
+}
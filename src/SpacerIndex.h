@@ -0,0 +1,166 @@
+/*
+ * SpacerIndex.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_SpacerIndex_h
+#define crisprtools_SpacerIndex_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+#define SI_MAGIC "CRTIDX1"          // first 8 bytes of an index file, with the NUL
+#define SI_VERSION 1
+#define SI_DEFAULT_K 12             // length of the indexed k-mers
+#define SI_MIN_K 4
+#define SI_MAX_K 16                 // k-mers are packed into 32 bits
+
+enum IndexElementType {
+    SI_SPACER,
+    SI_DIRECT_REPEAT,
+    SI_FLANKER
+};
+
+// The index file is a header followed by arrays of native 32 bit integers
+// so that it can be used straight from a mapping:
+//
+//   groups     name of each group
+//   elements   group, name, sequence and type of each element, ordered
+//              by sequence so the elements of a sequence are together
+//   sequences  bases, length, first element and number of elements of
+//              each distinct sequence
+//   kmers      every k-mer in the sequences, sorted, and where the
+//              postings of each one start
+//   postings   sequence and position of each k-mer occurrence
+//   strings    the names, each ending in a NUL
+//   bases      the sequences in upper case, back to back
+typedef struct __IndexHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t K;
+    uint32_t NumGroups;
+    uint32_t NumElements;
+    uint32_t NumSequences;
+    uint32_t NumKmers;
+    uint32_t NumPostings;
+    uint32_t StringBytes;
+    uint32_t BaseBytes;
+} IndexHeader;
+
+typedef struct __IndexElement {
+    uint32_t Group;
+    uint32_t Name;
+    uint32_t Sequence;
+    uint32_t Type;
+} IndexElement;
+
+typedef struct __IndexSequence {
+    uint32_t Bases;
+    uint32_t Length;
+    uint32_t FirstElement;
+    uint32_t NumElements;
+} IndexSequence;
+
+// a place where a query was found, Position counts from 0
+typedef struct __IndexHit {
+    uint32_t Sequence;
+    uint32_t Position;
+    int Mismatches;
+    char Strand;
+} IndexHit;
+
+// Collects the elements of a .crispr file and writes the index.  The same
+// sequence in many groups is only indexed once
+class SpacerIndexBuilder {
+public:
+    SpacerIndexBuilder(int k = SI_DEFAULT_K);
+
+    // the elements added after this belong to the group
+    void addGroup(const std::string& gid);
+    void addElement(IndexElementType type, const std::string& id, const char * sequence);
+
+    // throws crispr::runtime_exception if the file can't be written or
+    // is too big for 32 bit offsets
+    void write(const std::string& fileName);
+
+private:
+    typedef struct __BuilderElement {
+        int Group;
+        int Sequence;
+        IndexElementType Type;
+        std::string Name;
+    } BuilderElement;
+
+    int IB_K;
+    std::vector<std::string> IB_Groups;
+    std::vector<BuilderElement> IB_Elements;
+    std::map<std::string, int> IB_SequenceIndex;
+    std::vector<std::string> IB_Sequences;
+};
+
+// A mapped index file
+class SpacerIndex {
+public:
+    SpacerIndex();
+    ~SpacerIndex();
+
+    // throws crispr::runtime_exception if the file can't be mapped or
+    // isn't an index
+    void open(const std::string& fileName);
+    void close(void);
+
+    inline int getK(void) const {return static_cast<int>(SI_Header->K);}
+    inline uint32_t sequenceCount(void) const {return SI_Header->NumSequences;}
+    inline const IndexSequence& sequence(uint32_t i) const {return SI_Sequences[i];}
+    inline const IndexElement& element(uint32_t i) const {return SI_Elements[i];}
+    inline const char * groupName(uint32_t group) const {return SI_Strings + SI_Groups[group];}
+    inline const char * elementName(const IndexElement& element) const {return SI_Strings + element.Name;}
+
+    // every place that query, or its reverse complement, is in an indexed
+    // sequence with at most the given number of mismatches, ordered by
+    // sequence and position.  The query can only contain A, C, G and T
+    void find(const std::string& query, int mismatches, std::vector<IndexHit>& hits) const;
+
+private:
+    SpacerIndex(const SpacerIndex&);
+    SpacerIndex& operator=(const SpacerIndex&);
+
+    // look up k-mers of the query when at least one is sure to match exactly
+    void findSeeded(const std::string& query, char strand, int mismatches, std::vector<IndexHit>& hits) const;
+
+    // check every position of every sequence, for short queries
+    void findScan(const std::string& query, char strand, int mismatches, std::vector<IndexHit>& hits) const;
+
+    int countMismatches(const std::string& query, uint32_t sequence, uint32_t position, int limit) const;
+
+    const char * SI_Data;
+    size_t SI_Size;
+    const IndexHeader * SI_Header;
+    const uint32_t * SI_Groups;
+    const IndexElement * SI_Elements;
+    const IndexSequence * SI_Sequences;
+    const uint32_t * SI_Kmers;
+    const uint32_t * SI_KmerStarts;
+    const uint32_t * SI_PostingSequences;
+    const uint32_t * SI_PostingPositions;
+    const char * SI_Strings;
+    const char * SI_Bases;
+};
+
+#endif
@@ -0,0 +1,312 @@
+// SpacerSet.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "SpacerSet.h"
+#include "Parallel.h"
+#include "SeqKernels.h"
+#include <libcrispr/StlExt.h>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+// finishing mix from MurmurHash3
+static inline unsigned int mixHash(unsigned int hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static void packItemsTask(int chunk, void * set)
+{
+    static_cast<SpacerSet *>(set)->packItems(chunk);
+}
+
+static void insertItemsTask(int chunk, void * set)
+{
+    static_cast<SpacerSet *>(set)->insertItems(chunk);
+}
+
+SpacerSet::SpacerSet()
+{
+    SS_NumThreads = 1;
+    SS_Table.assign(SS_INITIAL_SLOTS, 0);
+    SS_Mask = SS_INITIAL_SLOTS - 1;
+}
+
+SpacerSet::~SpacerSet()
+{}
+
+void SpacerSet::add(const std::string& gid, const char * spid, const char * sequence)
+{
+    if (SS_GroupIds.empty() || SS_GroupIds.back() != gid) {
+        SS_GroupIds.push_back(gid);
+    }
+    unsigned int length = static_cast<unsigned int>(strlen(sequence));
+    if (length == 0) {
+        return;
+    }
+    SS_BatchNames.push_back(static_cast<unsigned int>(SS_BatchText.size()));
+    SS_BatchText.insert(SS_BatchText.end(), gid.begin(), gid.end());
+    SS_BatchText.insert(SS_BatchText.end(), spid, spid + strlen(spid));
+    SS_BatchSequences.push_back(static_cast<unsigned int>(SS_BatchText.size()));
+    SS_BatchText.insert(SS_BatchText.end(), sequence, sequence + length);
+    SS_BatchLengths.push_back(length);
+    SS_BatchGroups.push_back(static_cast<int>(SS_GroupIds.size()) - 1);
+
+    // space for the packed key is laid out now so the threads don't have to
+    unsigned int offset = (SS_BatchKeyOffsets.empty()) ? 0 : SS_BatchKeyOffsets.back();
+    SS_BatchKeyOffsets.push_back(offset + static_cast<unsigned int>(packedWords(length)));
+
+    if (SS_BatchLengths.size() >= SS_BATCH_SIZE) {
+        insertBatch();
+    }
+}
+
+void SpacerSet::packItems(int chunk)
+{
+    int end = std::min(static_cast<int>(SS_BatchLengths.size()), (chunk + 1) * SS_CHUNK_SIZE);
+    std::vector<unsigned int> reverse;
+    for (int item = chunk * SS_CHUNK_SIZE; item < end; ++item) {
+        unsigned int length = SS_BatchLengths[item];
+        unsigned int words = static_cast<unsigned int>(packedWords(length));
+        unsigned int * key = &SS_BatchKeys[0] + ((item) ? SS_BatchKeyOffsets[item - 1] : 0);
+        const char * sequence = &SS_BatchText[0] + SS_BatchSequences[item];
+        if (!packBases(sequence, length, key)) {
+            SS_BatchLengths[item] = length | SS_AMBIGUOUS;
+            continue;
+        }
+
+        // keep whichever strand packs to the smaller words
+        reverse.resize(words);
+        reverseComplementPacked(key, length, &reverse[0]);
+        if (std::lexicographical_compare(reverse.begin(), reverse.end(), key, key + words)) {
+            std::copy(reverse.begin(), reverse.end(), key);
+        }
+        unsigned int hash = length * 0x9e3779b9u;
+        for (unsigned int w = 0; w < words; ++w) {
+            hash = mixHash(hash ^ key[w]);
+        }
+        SS_BatchHashes[item] = hash;
+    }
+}
+
+bool SpacerSet::itemMatches(unsigned int slotValue, int item) const
+{
+    unsigned int length = SS_BatchLengths[item];
+    const unsigned int * key = &SS_BatchKeys[0] + ((item) ? SS_BatchKeyOffsets[item - 1] : 0);
+    const unsigned int * other;
+    if (slotValue & SS_PENDING) {
+        int other_item = static_cast<int>(slotValue & ~SS_PENDING);
+        if (SS_BatchHashes[other_item] != SS_BatchHashes[item] || SS_BatchLengths[other_item] != length) {
+            return false;
+        }
+        other = &SS_BatchKeys[0] + ((other_item) ? SS_BatchKeyOffsets[other_item - 1] : 0);
+    } else {
+        int entry = static_cast<int>(slotValue) - 1;
+        if (SS_Hashes[entry] != SS_BatchHashes[item] || SS_Lengths[entry] != length) {
+            return false;
+        }
+        other = &SS_Keys[0] + SS_KeyOffsets[entry];
+    }
+    return 0 == memcmp(key, other, packedWords(length) * sizeof(unsigned int));
+}
+
+void SpacerSet::insertItems(int chunk)
+{
+    int end = std::min(static_cast<int>(SS_BatchLengths.size()), (chunk + 1) * SS_CHUNK_SIZE);
+    unsigned int * table = &SS_Table[0];
+    for (int item = chunk * SS_CHUNK_SIZE; item < end; ++item) {
+        if (SS_BatchLengths[item] & SS_AMBIGUOUS) {
+            continue;
+        }
+        // linear probing.  Every slot is read with a compare and swap that
+        // claims it if it's empty, whoever loses the race compares against
+        // the winner instead.  At most half full the probes are short
+        size_t slot = SS_BatchHashes[item] & SS_Mask;
+        unsigned int mine = SS_PENDING | static_cast<unsigned int>(item);
+        while (true) {
+            unsigned int value = __sync_val_compare_and_swap(&table[slot], 0u, mine);
+            if (value == 0 || itemMatches(value, item)) {
+                break;
+            }
+            slot = (slot + 1) & SS_Mask;
+        }
+        SS_BatchSlots[item] = static_cast<unsigned int>(slot);
+    }
+}
+
+void SpacerSet::growTable(size_t wanted)
+{
+    // keep the table at most half full
+    size_t slots = SS_Table.size();
+    while (slots < 2 * wanted) {
+        slots *= 2;
+    }
+    if (slots == SS_Table.size()) {
+        return;
+    }
+    SS_Table.assign(slots, 0);
+    SS_Mask = slots - 1;
+    for (size_t entry = 0; entry < SS_Hashes.size(); ++entry) {
+        if (SS_Lengths[entry] & SS_AMBIGUOUS) {
+            continue;
+        }
+        size_t slot = SS_Hashes[entry] & SS_Mask;
+        while (SS_Table[slot] != 0) {
+            slot = (slot + 1) & SS_Mask;
+        }
+        SS_Table[slot] = static_cast<unsigned int>(entry) + 1;
+    }
+}
+
+int SpacerSet::newEntry(int item)
+{
+    int entry = static_cast<int>(SS_Counts.size());
+    unsigned int length = SS_BatchLengths[item];
+    SS_KeyOffsets.push_back(static_cast<unsigned int>(SS_Keys.size()));
+    if (!(length & SS_AMBIGUOUS)) {
+        unsigned int begin = (item) ? SS_BatchKeyOffsets[item - 1] : 0;
+        SS_Keys.insert(SS_Keys.end(), SS_BatchKeys.begin() + begin, SS_BatchKeys.begin() + SS_BatchKeyOffsets[item]);
+    }
+    SS_Lengths.push_back(length);
+    SS_Hashes.push_back(SS_BatchHashes[item]);
+    SS_NameOffsets.push_back(static_cast<unsigned int>(SS_Names.size()));
+    SS_Names.insert(SS_Names.end(), SS_BatchText.begin() + SS_BatchNames[item], SS_BatchText.begin() + SS_BatchSequences[item]);
+    SS_Counts.push_back(0);
+    SS_GroupHeads.push_back(-1);
+    return entry;
+}
+
+void SpacerSet::addOccurrence(int entry, int group)
+{
+    ++SS_Counts[entry];
+    int head = SS_GroupHeads[entry];
+    if (head == -1 || SS_NodeGroups[head] != group) {
+        SS_NodeGroups.push_back(group);
+        SS_NodeNext.push_back(head);
+        SS_GroupHeads[entry] = static_cast<int>(SS_NodeGroups.size()) - 1;
+    }
+}
+
+void SpacerSet::insertBatch(void)
+{
+    int count = static_cast<int>(SS_BatchLengths.size());
+    if (count == 0) {
+        return;
+    }
+    int chunks = (count + SS_CHUNK_SIZE - 1) / SS_CHUNK_SIZE;
+    SS_BatchKeys.assign(SS_BatchKeyOffsets.back(), 0);
+    SS_BatchHashes.assign(count, 0);
+    SS_BatchSlots.assign(count, 0);
+    parallelFor(chunks, SS_NumThreads, packItemsTask, this);
+
+    growTable(SS_Counts.size() + count);
+    parallelFor(chunks, SS_NumThreads, insertItemsTask, this);
+
+    // new spacers get their entries in input order, whichever thread
+    // claimed the slot
+    for (int item = 0; item < count; ++item) {
+        int entry;
+        if (SS_BatchLengths[item] & SS_AMBIGUOUS) {
+            const char * sequence = &SS_BatchText[0] + SS_BatchSequences[item];
+            unsigned int length = SS_BatchLengths[item] & ~SS_AMBIGUOUS;
+            // only the lookup sees other bases as N, the first
+            // occurrence is written as it was given
+            std::string forward(length, 'N');
+            for (unsigned int i = 0; i < length; ++i) {
+                char base = static_cast<char>(toupper(sequence[i]));
+                if (base == 'A' || base == 'C' || base == 'G' || base == 'T') {
+                    forward[i] = base;
+                }
+            }
+            std::string reverse = reverseComplement(forward);
+            const std::string& canonical = (reverse < forward) ? reverse : forward;
+            std::map<std::string, int>::iterator iter = SS_AmbiguousIndex.find(canonical);
+            if (iter == SS_AmbiguousIndex.end()) {
+                entry = newEntry(item);
+                SS_KeyOffsets.back() = static_cast<unsigned int>(SS_AmbiguousSequences.size());
+                SS_AmbiguousSequences.push_back(std::string(sequence, length));
+                SS_AmbiguousIndex[canonical] = entry;
+            } else {
+                entry = iter->second;
+            }
+        } else {
+            unsigned int& slot = SS_Table[SS_BatchSlots[item]];
+            if (slot & SS_PENDING) {
+                entry = newEntry(item);
+                slot = static_cast<unsigned int>(entry) + 1;
+            } else {
+                entry = static_cast<int>(slot) - 1;
+            }
+        }
+        addOccurrence(entry, SS_BatchGroups[item]);
+    }
+
+    SS_BatchText.clear();
+    SS_BatchNames.clear();
+    SS_BatchSequences.clear();
+    SS_BatchLengths.clear();
+    SS_BatchGroups.clear();
+    SS_BatchKeyOffsets.clear();
+}
+
+void SpacerSet::unpack(int entry, std::string& sequence) const
+{
+    unsigned int length = SS_Lengths[entry];
+    if (length & SS_AMBIGUOUS) {
+        sequence = SS_AmbiguousSequences[SS_KeyOffsets[entry]];
+        return;
+    }
+    sequence.resize(length);
+    unpackBases(&SS_Keys[0] + SS_KeyOffsets[entry], length, &sequence[0]);
+}
+
+void SpacerSet::write(FastaSink& out, const std::string& headerPrefix)
+{
+    insertBatch();
+
+    std::string sequence;
+    std::vector<int> groups;
+    int num_entries = static_cast<int>(SS_Counts.size());
+    for (int entry = 0; entry < num_entries; ++entry) {
+        unsigned int name_end = (entry + 1 < num_entries) ? SS_NameOffsets[entry + 1] : static_cast<unsigned int>(SS_Names.size());
+        out.put('>');
+        out.write(headerPrefix);
+        out.write(&SS_Names[0] + SS_NameOffsets[entry], name_end - SS_NameOffsets[entry]);
+        out.write("_Count_");
+        out.write(to_string(SS_Counts[entry]));
+
+        // the list is newest first
+        groups.clear();
+        for (int node = SS_GroupHeads[entry]; node != -1; node = SS_NodeNext[node]) {
+            groups.push_back(SS_NodeGroups[node]);
+        }
+        std::vector<int>::reverse_iterator iter;
+        for (iter = groups.rbegin(); iter != groups.rend(); ++iter) {
+            out.put((iter == groups.rbegin()) ? ' ' : ',');
+            out.write(SS_GroupIds[*iter]);
+        }
+        out.put('\n');
+        unpack(entry, sequence);
+        out.write(sequence);
+        out.put('\n');
+    }
+}
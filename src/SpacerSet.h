@@ -0,0 +1,120 @@
+/*
+ * SpacerSet.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_SpacerSet_h
+#define crisprtools_SpacerSet_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include "FastaSink.h"
+
+#define SS_BATCH_SIZE 65536         // spacers read before they are packed and added to the set
+#define SS_CHUNK_SIZE 1024          // spacers handed to a thread at a time
+#define SS_INITIAL_SLOTS 65536      // starting size of the hash table, always a power of two
+#define SS_PENDING 0x80000000u      // marks a table slot that holds a spacer of the current batch
+#define SS_AMBIGUOUS 0x80000000u    // marks the length of a spacer that isn't only ACGT
+
+// The distinct spacers of a whole file.  A spacer and its reverse
+// complement are the same spacer, whichever is lexicographically smaller
+// is kept, packed 2 bits per base by the sequence kernels.  Spacers are
+// added in batches, the packing and the insertion into an open addressing
+// hash table are done on all of the threads with the slots claimed by
+// compare and swap.  The
+// new entries are then numbered in input order so that the output doesn't
+// depend on the number of threads.  The few spacers with bases other than
+// ACGT are kept as strings in a map, compared with those bases as N but
+// written as they were first seen
+class SpacerSet {
+public:
+    SpacerSet();
+    ~SpacerSet();
+
+    inline void setNumThreads(int numThreads) {SS_NumThreads = numThreads;}
+
+    // groups must be added one after another, a change of gid starts a new group
+    void add(const std::string& gid, const char * spid, const char * sequence);
+
+    // one record for each distinct spacer in the order they were first
+    // seen, named after that first occurrence.  The header ends with the
+    // number of times the spacer was seen and the groups it was found in:
+    // >prefix gid spid _Count_N G1,G5
+    void write(FastaSink& out, const std::string& headerPrefix);
+
+    inline int size(void) const {return static_cast<int>(SS_Counts.size());}
+
+    // called from the worker threads
+    void packItems(int chunk);
+    void insertItems(int chunk);
+
+private:
+    SpacerSet(const SpacerSet&);
+    SpacerSet& operator=(const SpacerSet&);
+
+    // pack and insert everything added since the last batch
+    void insertBatch(void);
+    void growTable(size_t wanted);
+    bool itemMatches(unsigned int slotValue, int item) const;
+    int newEntry(int item);
+    void addOccurrence(int entry, int group);
+    void unpack(int entry, std::string& sequence) const;
+
+    int SS_NumThreads;
+
+    // group ids in the order they were added
+    std::vector<std::string> SS_GroupIds;
+
+    // the batch: names and sequences are stored back to back in SS_BatchText
+    std::vector<char> SS_BatchText;
+    std::vector<unsigned int> SS_BatchNames;
+    std::vector<unsigned int> SS_BatchSequences;
+    std::vector<unsigned int> SS_BatchLengths;
+    std::vector<int> SS_BatchGroups;
+    std::vector<unsigned int> SS_BatchKeyOffsets;
+    std::vector<unsigned int> SS_BatchKeys;
+    std::vector<unsigned int> SS_BatchHashes;
+    std::vector<unsigned int> SS_BatchSlots;
+
+    // open addressing table of entry + 1, or SS_PENDING | batch item
+    std::vector<unsigned int> SS_Table;
+    size_t SS_Mask;
+
+    // the distinct spacers, each with its packed key, length, hash, the
+    // name of its first occurrence, count and a list of groups
+    std::vector<unsigned int> SS_Keys;
+    std::vector<unsigned int> SS_KeyOffsets;
+    std::vector<unsigned int> SS_Lengths;
+    std::vector<unsigned int> SS_Hashes;
+    std::vector<char> SS_Names;
+    std::vector<unsigned int> SS_NameOffsets;
+    std::vector<unsigned int> SS_Counts;
+
+    // linked lists of groups, newest first.  Groups come in order so a
+    // group is only added when it differs from the head of the list
+    std::vector<int> SS_GroupHeads;
+    std::vector<int> SS_NodeGroups;
+    std::vector<int> SS_NodeNext;
+
+    // spacers with ambiguous bases, canonical sequence with every other
+    // base as N to entry, and the first occurrence of each
+    std::map<std::string, int> SS_AmbiguousIndex;
+    std::vector<std::string> SS_AmbiguousSequences;
+};
+
+#endif
@@ -20,10 +20,13 @@
 #include <libcrispr/Exception.h>
 #include <libcrispr/reader.h>
 #include "Utils.h"
+#include "Profile.h"
 #include <iostream>
 #include <fstream>
 #include <getopt.h>
 #include <cstring>
+#include <sstream>
+#include <iomanip>
 
 StatTool::~StatTool()
 {
@@ -46,7 +49,9 @@ int StatTool::processOptions (int argc, char ** argv)
 	int c, index;
     struct option long_opts [] = { 
         {"header", no_argument, NULL, 'H'},
-        {"coverage", no_argument, NULL, 0}
+        {"coverage", no_argument, NULL, 0},
+        {"composition", no_argument, NULL, 0},
+        {0,0,0,0}
     };
 	while((c = getopt_long(argc, argv, "ahHg:pPs:o:", long_opts, &index)) != -1)
 	{
@@ -109,6 +114,8 @@ int StatTool::processOptions (int argc, char ** argv)
                 if (! strcmp("coverage", long_opts[index].name)) {
                     ST_DetailedCoverage = true;
                     ST_OutputStyle = coverage;
+                } else if (! strcmp("composition", long_opts[index].name)) {
+                    ST_Composition = true;
                 }
                 break;
             }
@@ -120,6 +127,10 @@ int StatTool::processOptions (int argc, char ** argv)
             }
 		}
 	}
+    if (ST_Composition && ST_OutputStyle != tabular) {
+        // the pretty and coverage outputs have nowhere to put the columns
+        throw crispr::input_exception("--composition can only be used with tabular output");
+    }
 	return optind;
 }
 
@@ -133,7 +144,7 @@ int StatTool::processInputFile(const char * inputFile)
         } else {
             throw crispr::input_exception("cannot open input file");
         }
-        xercesc::DOMDocument * input_doc_obj = xml_parser.setFileParser(inputFile);
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
         xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
         if (!root_elem) {
             throw crispr::xml_exception(__FILE__, 
@@ -141,11 +152,14 @@ int StatTool::processInputFile(const char * inputFile)
                                         __PRETTY_FUNCTION__, 
                                         "problem when parsing xml file");
         }
+
+        ProfileTimer walk_timer(PF_WALK);
         int num_groups_to_process = static_cast<int>(ST_Groups.size());
         //std::cout<<num_groups_to_process<<std::endl;
         for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
              currentElement != NULL; 
              currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
 
             if (ST_Subset && num_groups_to_process == 0) {
                 break;
@@ -179,6 +193,12 @@ int StatTool::processInputFile(const char * inputFile)
         agregate_stats.total_dr_length = 0;
         agregate_stats.total_flanker_length = 0;
         agregate_stats.total_reads = 0;
+        BaseCounts empty = {0, 0, 0, 0};
+        agregate_stats.total_spacer_bases = empty;
+        agregate_stats.total_dr_bases = empty;
+        agregate_stats.total_flanker_bases = empty;
+        agregate_stats.total_spacer_dust = 0;
+        agregate_stats.total_low_complexity = 0;
         // go through each of the groups and print out a pretty picture
         std::vector<StatManager *>::iterator iter = this->begin();
         int longest_consensus = 0;
@@ -292,6 +312,9 @@ void StatTool::parseDrs(xercesc::DOMElement * parentNode,
 
         xr(&c_repeat);
         statManager->addRepLenVec(static_cast<int>(repeat.length()));
+        if (ST_Composition) {
+            statManager->addRepeatComposition(repeat.data(), repeat.length());
+        }
         statManager->incrementRpeatCount();
     }
 }
@@ -308,6 +331,9 @@ void StatTool::parseSpacers(xercesc::DOMElement * parentNode,
         std::string spacer = c_spacer;
         xr(&c_spacer);
         statManager->addSpLenVec(static_cast<int>(spacer.length()));
+        if (ST_Composition) {
+            statManager->addSpacerComposition(spacer.data(), spacer.length());
+        }
         char * c_cov = tc(currentElement->getAttribute(xmlParser.attr_Cov()));
         std::string cov = c_cov;
         xr(&c_cov);
@@ -333,6 +359,9 @@ void StatTool::parseFlankers(xercesc::DOMElement * parentNode,
         std::string flanker = c_flanker;
         xr(&c_flanker);
         statManager->addFlLenVec(static_cast<int>(flanker.length()));
+        if (ST_Composition) {
+            statManager->addFlankerComposition(flanker.data(), flanker.length());
+        }
         statManager->incrementFlankerCount();
     }
 }
@@ -355,6 +384,7 @@ void StatTool::parseMetadata(xercesc::DOMElement * parentNode,
     }
 }
 int StatTool::calculateReads(const char * fileName) {
+    ProfileTimer timer(PF_READ_COUNT);
     std::fstream sequence_file;
     sequence_file.open(fileName);
     int sequence_counter = 0;
@@ -383,6 +413,18 @@ void StatTool::calculateAgregateSTats(AStats * agregateStats)
         agregateStats->total_flanker += (*iter)->getFlankerCount();
         agregateStats->total_flanker_length += ((*iter)->getFlLenVec().empty()) ? 0 : (*iter)->meanFlankerL();
         agregateStats->total_reads += (*iter)->getReadCount();
+        if (ST_Composition) {
+            const BaseCounts * group_bases[3] = {&(*iter)->getSpacerBases(), &(*iter)->getRepeatBases(), &(*iter)->getFlankerBases()};
+            BaseCounts * totals[3] = {&agregateStats->total_spacer_bases, &agregateStats->total_dr_bases, &agregateStats->total_flanker_bases};
+            for (int i = 0; i < 3; ++i) {
+                totals[i]->AT += group_bases[i]->AT;
+                totals[i]->GC += group_bases[i]->GC;
+                totals[i]->N += group_bases[i]->N;
+                totals[i]->Other += group_bases[i]->Other;
+            }
+            agregateStats->total_spacer_dust += (*iter)->getSpacerDust();
+            agregateStats->total_low_complexity += (*iter)->getLowComplexityCount();
+        }
     }
 }
 void StatTool::prettyPrint(StatManager * sm)
@@ -448,7 +490,18 @@ void StatTool::printHeader()
     std::cout<<"Ave. SP Cov"<<ST_Separator;
     std::cout<<"# Flankers"<<ST_Separator;
     std::cout<<"Ave. FL Length"<<ST_Separator;
-    std::cout<<"# Reads"<<std::endl;
+    std::cout<<"# Reads";
+    if (ST_Composition) {
+        std::cout<<ST_Separator<<"SP GC%"<<ST_Separator;
+        std::cout<<"SP N%"<<ST_Separator;
+        std::cout<<"Ave. SP DUST"<<ST_Separator;
+        std::cout<<"# Low Complexity SP"<<ST_Separator;
+        std::cout<<"DR GC%"<<ST_Separator;
+        std::cout<<"DR N%"<<ST_Separator;
+        std::cout<<"FL GC%"<<ST_Separator;
+        std::cout<<"FL N%";
+    }
+    std::cout<<std::endl;
     ST_WithHeader = false;
 }
 
@@ -478,7 +531,39 @@ void StatTool::printTabular(StatManager * sm)
     } else {
         std::cout<< sm->meanFlankerL()<<ST_Separator;
     }
-    std::cout<<sm->getReadCount()<<std::endl;
+    std::cout<<sm->getReadCount();
+    if (ST_Composition) {
+        printComposition(sm->getSpacerBases(), sm->getRepeatBases(), sm->getFlankerBases(), sm->getSpacerDust(), sm->getSpacerCount(), sm->getLowComplexityCount());
+    }
+    std::cout<<std::endl;
+}
+
+// two decimal places without changing the format of std::cout
+static std::string formatFraction(double numerator, double denominator, double scale)
+{
+    std::stringstream ss;
+    ss<<std::fixed<<std::setprecision(2)<<((denominator > 0) ? scale * numerator / denominator : 0.0);
+    return ss.str();
+}
+
+void StatTool::printComposition(const BaseCounts& spacers, 
+                                const BaseCounts& repeats, 
+                                const BaseCounts& flankers, 
+                                double spacerDust, 
+                                int numSpacers, 
+                                int lowComplexity)
+{
+    // GC is out of the unambiguous bases, N out of every base
+    const BaseCounts * bases[3] = {&spacers, &repeats, &flankers};
+    for (int i = 0; i < 3; ++i) {
+        double total = static_cast<double>(bases[i]->AT + bases[i]->GC + bases[i]->N + bases[i]->Other);
+        std::cout<<ST_Separator<<formatFraction(static_cast<double>(bases[i]->GC), static_cast<double>(bases[i]->AT + bases[i]->GC), 100);
+        std::cout<<ST_Separator<<formatFraction(static_cast<double>(bases[i]->N), total, 100);
+        if (i == 0) {
+            std::cout<<ST_Separator<<formatFraction(spacerDust, numSpacers, 1);
+            std::cout<<ST_Separator<<lowComplexity;
+        }
+    }
 }
 void StatTool::printAggregate( AStats * agregate_stats)
 {
@@ -514,10 +599,19 @@ void StatTool::printAggregate( AStats * agregate_stats)
         std::cout<<0<<ST_Separator;
     }
     if (agregate_stats->total_groups != 0) {
-        std::cout<<agregate_stats->total_reads/agregate_stats->total_groups<<std::endl;
+        std::cout<<agregate_stats->total_reads/agregate_stats->total_groups;
     } else {
-        std::cout<<0<<std::endl;
+        std::cout<<0;
     }
+    if (ST_Composition) {
+        printComposition(agregate_stats->total_spacer_bases, 
+                         agregate_stats->total_dr_bases, 
+                         agregate_stats->total_flanker_bases, 
+                         agregate_stats->total_spacer_dust, 
+                         agregate_stats->total_spacers, 
+                         agregate_stats->total_low_complexity);
+    }
+    std::cout<<std::endl;
 }
 
 void StatTool::printCoverage(StatManager * sm)
@@ -572,4 +666,7 @@ void statUsage(void)
     std::cout<<"-s                  separator string for tabular output [default: '\t']"<<std::endl;
     std::cout<<"-t                  tabular output"<<std::endl;
     std::cout<<"--coverage          Create a detailed report on the spacer coverage for each group"<<std::endl;
+    std::cout<<"--composition       Add the GC and N content of the spacers, direct repeats and flankers to the tabular"<<std::endl;
+    std::cout<<"                    output, along with the mean DUST score of the spacers and the number of low"<<std::endl;
+    std::cout<<"                    complexity spacers (DUST score above 2).  Can't be used with -p, -P or --coverage"<<std::endl;
 }
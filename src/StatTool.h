@@ -25,11 +25,13 @@
 #include <set>
 #include <libcrispr/base.h>
 #include <libcrispr/StlExt.h>
+#include "SeqKernels.h"
 
 
 #define SPACER_CHAR '+'
 #define FLANKER_CHAR '~'
 #define REPEAT_CHAR '-'
+#define ST_DUST_THRESHOLD 2.0       // spacers with a higher DUST score are low complexity
 typedef struct __AStats {
     
     int total_groups;
@@ -41,6 +43,11 @@ typedef struct __AStats {
     int total_dr_length;
     int total_flanker_length;
     int total_reads;
+    BaseCounts total_spacer_bases;
+    BaseCounts total_dr_bases;
+    BaseCounts total_flanker_bases;
+    double total_spacer_dust;
+    int total_low_complexity;
     } AStats;
 
 class StatManager {
@@ -54,6 +61,23 @@ class StatManager {
     int SM_ReadCount;
     std::string SM_ConsensusRepeat;
     std::string SM_Gid;
+
+    // composition, only filled in with --composition
+    BaseCounts SM_SpacerBases;
+    BaseCounts SM_RepeatBases;
+    BaseCounts SM_FlankerBases;
+    double SM_SpacerDust;
+    int SM_LowComplexityCount;
+
+    inline void addBases(BaseCounts& total, const char * seq, size_t length)
+    {
+        BaseCounts counts;
+        countBases(seq, length, counts);
+        total.AT += counts.AT;
+        total.GC += counts.GC;
+        total.N += counts.N;
+        total.Other += counts.Other;
+    }
     
 public:
     
@@ -62,6 +86,10 @@ public:
         SM_RepeatCount = 0;
         SM_SpacerCount = 0;
         SM_ReadCount = 0;
+        BaseCounts empty = {0, 0, 0, 0};
+        SM_SpacerBases = SM_RepeatBases = SM_FlankerBases = empty;
+        SM_SpacerDust = 0;
+        SM_LowComplexityCount = 0;
     }
     
     inline std::string getConcensus(void){return SM_ConsensusRepeat;}
@@ -116,6 +144,26 @@ public:
     inline void addSpCovVec(int i ){return SM_SpacerCoverage.push_back(i);}
     inline void addRepLenVec(int i ){return SM_RepeatLength.push_back(i);}
     inline void addFlLenVec(int i ){return SM_FlankerLength.push_back(i);}
+
+    // composition
+    
+    inline void addSpacerComposition(const char * seq, size_t length)
+    {
+        addBases(SM_SpacerBases, seq, length);
+        double dust = dustScore(seq, length);
+        SM_SpacerDust += dust;
+        if (dust > ST_DUST_THRESHOLD) {
+            ++SM_LowComplexityCount;
+        }
+    }
+    inline void addRepeatComposition(const char * seq, size_t length){addBases(SM_RepeatBases, seq, length);}
+    inline void addFlankerComposition(const char * seq, size_t length){addBases(SM_FlankerBases, seq, length);}
+
+    inline const BaseCounts& getSpacerBases(void) {return SM_SpacerBases;}
+    inline const BaseCounts& getRepeatBases(void) {return SM_RepeatBases;}
+    inline const BaseCounts& getFlankerBases(void) {return SM_FlankerBases;}
+    inline double getSpacerDust(void) {return SM_SpacerDust;}
+    inline int getLowComplexityCount(void) {return SM_LowComplexityCount;}
     
 };
 
@@ -134,6 +182,7 @@ class StatTool {
     bool ST_WithHeader;
     bool ST_AggregateStats;
     bool ST_DetailedCoverage;
+    bool ST_Composition;
     //bool ST_Tabular;
     std::string ST_Separator;
     OUTPUT_STYLE ST_OutputStyle;
@@ -147,6 +196,7 @@ public:
         ST_WithHeader = false;
         ST_AggregateStats = false;
         ST_DetailedCoverage = false;
+        ST_Composition = false;
         //ST_Tabular = true;
         ST_Separator = "\t";
         ST_OutputStyle = tabular;
@@ -177,6 +227,7 @@ public:
     void printTabular(StatManager * sm);
     void printCoverage(StatManager * sm);
     void printAggregate(AStats * agregateStats);
+    void printComposition(const BaseCounts& spacers, const BaseCounts& repeats, const BaseCounts& flankers, double spacerDust, int numSpacers, int lowComplexity);
     std::vector<StatManager *>::iterator begin(){return ST_StatsVec.begin();}
     std::vector<StatManager *>::iterator end(){return ST_StatsVec.end();}
 
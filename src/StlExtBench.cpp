@@ -0,0 +1,337 @@
+// StlExtBench.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Microbenchmarks for the statistics templates in StlExt.h and the colour
+// mapping in Rainbow.  Every kernel is run on inputs of several sizes and
+// distributions made from a fixed seed, and the time per element and the
+// number of allocations per call are printed so that implementations can
+// be compared.  Allocations are counted by replacing the global operator
+// new.  Build with 'make stlext_bench', usage: stlext_bench [elements]
+
+#include "StlExt.h"
+#include "Rainbow.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#define SB_DEFAULT_SIZE 1048576     // largest input timed by default
+#define SB_MIN_SIZE 16              // smallest input, the sizes go up by 16 times
+#define SB_WORK 1048576             // elements handled in each timed batch
+#define SB_REPEATS 3                // best of this many batches is reported
+#define SB_FEW_DISTINCT 8           // values in the "few" distribution
+#define SB_MAX_VALUE 1000           // of the values coloured by Rainbow
+
+#if __cplusplus >= 201103L
+#define SB_THROWS_BAD_ALLOC
+#define SB_THROWS_NOTHING noexcept
+#else
+#define SB_THROWS_BAD_ALLOC throw(std::bad_alloc)
+#define SB_THROWS_NOTHING throw()
+#endif
+
+// kept out of line so the compiler can't see malloc and free being paired
+// with new and delete
+#ifdef __GNUC__
+#define SB_NOINLINE __attribute__((noinline))
+#else
+#define SB_NOINLINE
+#endif
+
+static size_t SB_Allocations = 0;
+
+SB_NOINLINE void * operator new(size_t size) SB_THROWS_BAD_ALLOC
+{
+    ++SB_Allocations;
+    void * p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+SB_NOINLINE void * operator new[](size_t size) SB_THROWS_BAD_ALLOC
+{
+    return operator new(size);
+}
+
+SB_NOINLINE void operator delete(void * p) SB_THROWS_NOTHING
+{
+    free(p);
+}
+
+SB_NOINLINE void operator delete[](void * p) SB_THROWS_NOTHING
+{
+    free(p);
+}
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+enum Distribution {
+    SB_UNIFORM,
+    SB_SORTED,
+    SB_REVERSED,
+    SB_FEW,                         // lots of repeats, like spacer lengths
+    SB_SKEWED,                      // mostly small with a long tail, like coverage
+    SB_NUM_DISTRIBUTIONS
+};
+
+static const char * SB_DISTRIBUTION_NAMES[] = {"uniform", "sorted", "reversed", "few", "skewed"};
+
+// Everything a kernel might use, all made from the same values.  The
+// values are always less than the number of them, which mode needs
+struct Input {
+    std::vector<int> Values;
+    std::vector<int> Work;          // copy of Values for the kernels that reorder it
+    std::vector<double> Doubles;    // Values scaled to 0 - SB_MAX_VALUE for Rainbow
+    std::vector<int> Colours;
+    std::string Joined;             // Values separated by commas
+    Rainbow Colour;
+    double Sink;                    // results go here so they aren't optimised away
+};
+
+static void makeInput(Distribution distribution, size_t size, Input& input)
+{
+    input.Values.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        int value;
+        switch (distribution) {
+            case SB_SORTED: value = static_cast<int>(i); break;
+            case SB_REVERSED: value = static_cast<int>(size - 1 - i); break;
+            case SB_FEW: value = rand() % SB_FEW_DISTINCT; break;
+            case SB_SKEWED:
+            {
+                // the smallest of three is skewed towards 0
+                int a = rand(), b = rand(), c = rand();
+                value = std::min(a, std::min(b, c));
+                break;
+            }
+            case SB_UNIFORM:
+            default: value = rand(); break;
+        }
+        input.Values[i] = value % static_cast<int>(size);
+    }
+    input.Work = input.Values;
+    input.Doubles.resize(size);
+    input.Colours.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        input.Doubles[i] = static_cast<double>(input.Values[i]) * SB_MAX_VALUE / size;
+    }
+    input.Joined.clear();
+    char buffer[16];
+    for (size_t i = 0; i < size; ++i) {
+        snprintf(buffer, sizeof(buffer), (i ? ",%d" : "%d"), input.Values[i]);
+        input.Joined += buffer;
+    }
+    input.Colour.setType(BLUE_RED);
+    input.Colour.setLimits(0, SB_MAX_VALUE);
+    input.Sink = 0;
+}
+
+// one call of a kernel on the whole input, returns the number of calls
+// made to the template being measured
+typedef size_t (*benchKernel)(Input& input);
+
+static size_t copyValues(Input& input)
+{
+    std::copy(input.Values.begin(), input.Values.end(), input.Work.begin());
+    return 1;
+}
+
+static size_t benchMean(Input& input)
+{
+    input.Sink += mean(input.Values);
+    return 1;
+}
+
+static size_t benchMedian(Input& input)
+{
+    copyValues(input);
+    input.Sink += median(input.Work);
+    return 1;
+}
+
+static size_t benchPercentile(Input& input)
+{
+    copyValues(input);
+    input.Sink += percentile(input.Work, 0.9);
+    return 1;
+}
+
+static size_t benchMode(Input& input)
+{
+    input.Sink += mode(input.Values);
+    return 1;
+}
+
+static size_t benchStandardDeviation(Input& input)
+{
+    input.Sink += standardDeviation(input.Values);
+    return 1;
+}
+
+static size_t benchAddOrIncrement(Input& input)
+{
+    // a histogram as stat --coverage makes them
+    std::map<int, int> histogram;
+    for (size_t i = 0; i < input.Values.size(); ++i) {
+        addOrIncrement(histogram, input.Values[i]);
+    }
+    input.Sink += histogram.size();
+    return input.Values.size();
+}
+
+static size_t benchTokenize(Input& input)
+{
+    std::vector<std::string> tokens;
+    tokenize(input.Joined, tokens, ",");
+    input.Sink += tokens.size();
+    return 1;
+}
+
+static size_t benchSplit(Input& input)
+{
+    std::set<std::string> tokens;
+    split(input.Joined, tokens, ",");
+    input.Sink += tokens.size();
+    return 1;
+}
+
+static size_t benchColourString(Input& input)
+{
+    for (size_t i = 0; i < input.Doubles.size(); ++i) {
+        input.Sink += input.Colour.getColour(input.Doubles[i]).length();
+    }
+    return input.Doubles.size();
+}
+
+static size_t benchColourBuffer(Input& input)
+{
+    char colour[RB_COLOUR_LENGTH];
+    for (size_t i = 0; i < input.Doubles.size(); ++i) {
+        input.Sink += input.Colour.getColour(input.Doubles[i], colour)[0];
+    }
+    return input.Doubles.size();
+}
+
+static size_t benchRGB(Input& input)
+{
+    for (size_t i = 0; i < input.Doubles.size(); ++i) {
+        input.Sink += input.Colour.getRGB(input.Doubles[i]);
+    }
+    return input.Doubles.size();
+}
+
+static size_t benchRGBArray(Input& input)
+{
+    input.Colour.getRGB(&input.Doubles[0], input.Doubles.size(), &input.Colours[0]);
+    input.Sink += input.Colours[0];
+    return 1;
+}
+
+struct Kernel {
+    const char * Name;
+    benchKernel Run;
+    bool Copies;                    // the time of copyValues is taken off
+};
+
+static const Kernel SB_KERNELS[] = {
+    {"mean", benchMean, false},
+    {"median", benchMedian, true},
+    {"percentile", benchPercentile, true},
+    {"mode", benchMode, false},
+    {"standardDeviation", benchStandardDeviation, false},
+    {"addOrIncrement", benchAddOrIncrement, false},
+    {"tokenize", benchTokenize, false},
+    {"split", benchSplit, false},
+    {"getColour (string)", benchColourString, false},
+    {"getColour (buffer)", benchColourBuffer, false},
+    {"getRGB", benchRGB, false},
+    {"getRGB (array)", benchRGBArray, false}
+};
+#define SB_NUM_KERNELS (sizeof(SB_KERNELS) / sizeof(SB_KERNELS[0]))
+
+// seconds for the best batch of runs, and the allocations and calls in it
+static double timeKernel(benchKernel kernel, Input& input, size_t runs, size_t& allocations, size_t& calls)
+{
+    double best = 1e30;
+    for (int r = 0; r < SB_REPEATS; ++r) {
+        size_t before = SB_Allocations;
+        size_t batch_calls = 0;
+        double start = now();
+        for (size_t i = 0; i < runs; ++i) {
+            batch_calls += kernel(input);
+        }
+        double t = now() - start;
+        if (t < best) {
+            best = t;
+        }
+        allocations = SB_Allocations - before;
+        calls = batch_calls;
+    }
+    return best;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t max_size = SB_DEFAULT_SIZE;
+    if (argc > 1) {
+        max_size = static_cast<size_t>(atol(argv[1]));
+        if (max_size < SB_MIN_SIZE) {
+            fprintf(stderr, "usage: %s [elements]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%-20s %-9s %9s %12s %12s\n", "kernel", "input", "elements", "ns/element", "allocs/call");
+    double sink = 0;
+    for (size_t k = 0; k < SB_NUM_KERNELS; ++k) {
+        for (int d = 0; d < SB_NUM_DISTRIBUTIONS; ++d) {
+            // the same inputs for every kernel
+            srand(1 + d);
+            for (size_t size = SB_MIN_SIZE; size <= max_size; size *= 16) {
+                Input input;
+                makeInput(static_cast<Distribution>(d), size, input);
+                size_t runs = std::max(static_cast<size_t>(1), static_cast<size_t>(SB_WORK) / size);
+                size_t allocations, calls;
+                double seconds = timeKernel(SB_KERNELS[k].Run, input, runs, allocations, calls);
+                if (SB_KERNELS[k].Copies) {
+                    size_t copy_allocations, copy_calls;
+                    seconds -= timeKernel(copyValues, input, runs, copy_allocations, copy_calls);
+                    seconds = std::max(seconds, 0.0);
+                }
+                sink += input.Sink;
+                printf("%-20s %-9s %9lu %12.2f %12.2f\n", SB_KERNELS[k].Name, SB_DISTRIBUTION_NAMES[d],
+                       static_cast<unsigned long>(size), seconds * 1e9 / (static_cast<double>(runs) * size),
+                       static_cast<double>(allocations) / calls);
+            }
+        }
+    }
+    if (sink == 0) {
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,492 @@
+// TargetTool.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "TargetTool.h"
+#include "config.h"
+#include "Utils.h"
+#include "SeqKernels.h"
+#include "Profile.h"
+#include <libcrispr/Exception.h>
+#include <libcrispr/reader.h>
+#include <libcrispr/StlExt.h>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <getopt.h>
+
+int TargetTool::processOptions(int argc, char ** argv)
+{
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"groups", required_argument, NULL, 'g'},
+        {"mismatches", required_argument, NULL, 'm'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"threads", required_argument, NULL, 't'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hg:m:o:t:", long_options, &index)) != -1) {
+        switch (c) {
+            case 'h':
+            {
+                targetUsage();
+                exit(1);
+                break;
+            }
+            case 'g':
+            {
+                if (fileOrString(optarg)) {
+                    parseFileForGroups(TG_Groups, optarg);
+                } else {
+                    generateGroupsFromString(optarg, TG_Groups);
+                }
+                TG_Subset = true;
+                break;
+            }
+            case 'm':
+            {
+                if (!from_string<int>(TG_Mismatches, optarg, std::dec) || TG_Mismatches < 0 || TG_Mismatches > TG_MAX_MISMATCHES) {
+                    throw crispr::input_exception("The number of mismatches must be between 0 and 8");
+                }
+                break;
+            }
+            case 'o':
+            {
+                TG_OutputFile = optarg;
+                break;
+            }
+            case 't':
+            {
+                TG_NumThreads = parseThreadCount(optarg);
+                break;
+            }
+            default:
+            {
+                targetUsage();
+                exit(1);
+                break;
+            }
+        }
+    }
+    return optind;
+}
+
+int TargetTool::processInputFile(const char * inputFile)
+{
+    try {
+        crispr::xml::reader xml_parser;
+        std::ifstream in_file_stream(inputFile);
+        if (in_file_stream.good()) {
+            in_file_stream.close();
+        } else {
+            throw crispr::input_exception("cannot open input file");
+        }
+
+        xercesc::DOMDocument * input_doc_obj = profiledParse(xml_parser, inputFile);
+        xercesc::DOMElement * root_elem = input_doc_obj->getDocumentElement();
+        if (!root_elem) {
+            throw crispr::xml_exception(__FILE__,
+                                        __LINE__,
+                                        __PRETTY_FUNCTION__,
+                                        "problem when parsing xml file");
+        }
+
+        ProfileTimer walk_timer(PF_WALK);
+
+        int num_groups_to_process = static_cast<int>(TG_Groups.size());
+        for (xercesc::DOMElement * currentElement = root_elem->getFirstElementChild();
+             currentElement != NULL;
+             currentElement = currentElement->getNextElementSibling()) {
+            TraceSpan group_span(currentElement);
+
+            if (TG_Subset && num_groups_to_process == 0) {
+                break;
+            }
+            if (!xercesc::XMLString::equals(currentElement->getTagName(), xml_parser.tag_Group())) {
+                continue;
+            }
+            char * c_gid = tc(currentElement->getAttribute(xml_parser.attr_Gid()));
+            std::string group_id = c_gid;
+            xr(&c_gid);
+            if (TG_Subset) {
+                if (TG_Groups.find(group_id.substr(1)) == TG_Groups.end()) {
+                    continue;
+                }
+                num_groups_to_process--;
+            }
+            parseGroup(currentElement, xml_parser, group_id);
+        }
+    } catch (crispr::xml_exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+
+    if (TG_SkippedSpacers) {
+        std::cerr<<"[WARNING]: "<<TG_SkippedSpacers<<" spacers with bases other than A, C, G and T, or too short for "
+                 <<TG_Mismatches<<" mismatches, were not searched for"<<std::endl;
+    }
+    buildAutomaton();
+    return 0;
+}
+
+void TargetTool::parseGroup(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, const std::string& groupId)
+{
+    for (xercesc::DOMElement * dataElement = parentNode->getFirstElementChild();
+         dataElement != NULL;
+         dataElement = dataElement->getNextElementSibling()) {
+        if (!xercesc::XMLString::equals(dataElement->getTagName(), xmlParser.tag_Data())) {
+            continue;
+        }
+        for (xercesc::DOMElement * spacers = dataElement->getFirstElementChild();
+             spacers != NULL;
+             spacers = spacers->getNextElementSibling()) {
+            if (!xercesc::XMLString::equals(spacers->getTagName(), xmlParser.tag_Spacers())) {
+                continue;
+            }
+            for (xercesc::DOMElement * currentElement = spacers->getFirstElementChild();
+                 currentElement != NULL;
+                 currentElement = currentElement->getNextElementSibling()) {
+                if (xercesc::XMLString::equals(currentElement->getTagName(), xmlParser.tag_Spacer())) {
+                    char * c_spid = tc(currentElement->getAttribute(xmlParser.attr_Spid()));
+                    char * c_seq = tc(currentElement->getAttribute(xmlParser.attr_Seq()));
+                    addSpacer(groupId, c_spid, c_seq);
+                    xr(&c_spid);
+                    xr(&c_seq);
+                }
+            }
+        }
+    }
+}
+
+void TargetTool::addSpacer(const std::string& groupId, const std::string& spacerId, const std::string& sequence)
+{
+    size_t length = sequence.length();
+    std::vector<unsigned char> codes(length + 1);
+    encodeBases(sequence.data(), length, &codes[0]);
+    codes.resize(length);
+
+    // every seed needs at least one base
+    if (length <= static_cast<size_t>(TG_Mismatches) ||
+        std::find(codes.begin(), codes.end(), SK_OTHER) != codes.end()) {
+        ++TG_SkippedSpacers;
+        return;
+    }
+    int spacer = static_cast<int>(TG_SpacerNames.size());
+    TG_SpacerNames.push_back(groupId + '\t' + spacerId);
+
+    std::vector<unsigned char> reverse(length);
+    for (size_t i = 0; i < length; ++i) {
+        reverse[i] = static_cast<unsigned char>(3 - codes[length - 1 - i]);
+    }
+    TG_PatternSpacers[addPattern(codes, '+')].push_back(spacer);
+
+    // a palindrome would give every hit twice
+    if (reverse != codes) {
+        TG_PatternSpacers[addPattern(reverse, '-')].push_back(spacer);
+    }
+}
+
+int TargetTool::addPattern(const std::vector<unsigned char>& codes, char strand)
+{
+    std::string key(codes.begin(), codes.end());
+    key += strand;
+    std::map<std::string, int>::iterator iter = TG_PatternIndex.find(key);
+    if (iter != TG_PatternIndex.end()) {
+        return iter->second;
+    }
+    int pattern = static_cast<int>(TG_Patterns.size());
+    TG_PatternIndex[key] = pattern;
+    TargetPattern added;
+    added.CodeOffset = TG_Codes.size();
+    added.Length = static_cast<int>(codes.size());
+    added.NumSeeds = TG_Mismatches + 1;
+    added.Strand = strand;
+    TG_Patterns.push_back(added);
+    TG_PatternSpacers.push_back(std::vector<int>());
+    TG_Codes.insert(TG_Codes.end(), codes.begin(), codes.end());
+
+    // k + 1 seeds of (nearly) equal length, k mismatches can't touch them all
+    for (int i = 0; i < added.NumSeeds; ++i) {
+        TargetSeed seed;
+        seed.Pattern = pattern;
+        seed.Index = i;
+        seed.Offset = i * added.Length / added.NumSeeds;
+        seed.Length = (i + 1) * added.Length / added.NumSeeds - seed.Offset;
+        seed.CodeOffset = added.CodeOffset;
+        seed.PatternLength = added.Length;
+        TG_Seeds.push_back(seed);
+    }
+    if (codes.size() > TG_MaxLength) {
+        TG_MaxLength = codes.size();
+    }
+    return pattern;
+}
+
+void TargetTool::buildAutomaton(void)
+{
+    for (size_t i = 0; i < TG_Seeds.size(); ++i) {
+        const TargetSeed& seed = TG_Seeds[i];
+        TG_Automaton.addPattern(&TG_Codes[seed.CodeOffset + seed.Offset], seed.Length, static_cast<int>(i));
+    }
+    TG_Automaton.build();
+
+    // the keys are only needed while patterns are added
+    std::map<std::string, int>().swap(TG_PatternIndex);
+}
+
+void TargetTool::checkSeed(const std::vector<unsigned char>& codes,
+                           size_t end,
+                           size_t ownBases,
+                           int seedId,
+                           std::vector<TargetHit>& hits) const
+{
+    const TargetSeed& seed = TG_Seeds[seedId];
+    size_t seed_start = end - seed.Length;
+    if (seed_start < static_cast<size_t>(seed.Offset)) {
+        return;
+    }
+
+    // matches starting in the next chunk belong to it
+    size_t start = seed_start - seed.Offset;
+    if (start >= ownBases || start + seed.PatternLength > codes.size()) {
+        return;
+    }
+
+    // the bases before and after the seed, stopping as soon as there are
+    // too many mismatches
+    const unsigned char * reference = &codes[0] + start;
+    const unsigned char * query = &TG_Codes[seed.CodeOffset];
+    int positions[TG_MAX_MISMATCHES];
+    int mismatches = 0;
+    for (int j = 0; j < seed.Offset; ++j) {
+        if (reference[j] != query[j]) {
+            if (mismatches == TG_Mismatches) {
+                return;
+            }
+            positions[mismatches++] = j;
+        }
+    }
+    for (int j = seed.Offset + seed.Length; j < seed.PatternLength; ++j) {
+        if (reference[j] != query[j]) {
+            if (mismatches == TG_Mismatches) {
+                return;
+            }
+            positions[mismatches++] = j;
+        }
+    }
+
+    // if an earlier seed matches exactly it finds this hit as well, so
+    // only the first exact seed reports it
+    int num_seeds = TG_Mismatches + 1;
+    for (int i = 0, m = 0; i < seed.Index; ++i) {
+        int seed_end = (i + 1) * seed.PatternLength / num_seeds;
+        if (m == mismatches || positions[m] >= seed_end) {
+            return;
+        }
+        while (m < mismatches && positions[m] < seed_end) {
+            ++m;
+        }
+    }
+
+    TargetHit hit;
+    hit.Start = start;
+    hit.Pattern = seed.Pattern;
+    hit.Mismatches = mismatches;
+    hits.push_back(hit);
+}
+
+static bool compareHits(const TargetHit& a, const TargetHit& b)
+{
+    return (a.Start != b.Start) ? a.Start < b.Start : a.Pattern < b.Pattern;
+}
+
+void TargetTool::scanChunk(int chunk)
+{
+    TargetChunk& current = TG_Chunks[chunk];
+    const FastaRecord& record = TG_Reference->records()[current.Record];
+    std::vector<TargetHit>& hits = TG_ChunkHits[chunk];
+    hits.clear();
+
+    // the chunk and enough of what follows it to finish any match that
+    // starts in it
+    std::vector<unsigned char> codes;
+    codes.reserve(current.End - current.Start + TG_MaxLength);
+    current.Bases = TG_Reference->encodeRange(current.Start, current.End, static_cast<size_t>(-1), codes);
+    if (TG_MaxLength > 1) {
+        TG_Reference->encodeRange(current.End, record.SequenceEnd, TG_MaxLength - 1, codes);
+    }
+
+    int state = TG_Automaton.root();
+    size_t num_codes = codes.size();
+    for (size_t i = 0; i < num_codes; ++i) {
+        state = TG_Automaton.step(state, codes[i]);
+        if (TG_Automaton.hasMatch(state)) {
+            for (const int * seed = TG_Automaton.matchBegin(state); seed != TG_Automaton.matchEnd(state); ++seed) {
+                checkSeed(codes, i + 1, current.Bases, *seed, hits);
+            }
+        }
+    }
+    std::sort(hits.begin(), hits.end(), compareHits);
+}
+
+static void scanChunkTask(int index, void * arg)
+{
+    static_cast<TargetTool *>(arg)->scanChunk(index);
+}
+
+static inline void appendNumber(std::string& out, unsigned long value)
+{
+    char buffer[24];
+    int length = sprintf(buffer, "%lu", value);
+    out.append(buffer, length);
+}
+
+void TargetTool::scanBatch(void)
+{
+    TG_ChunkHits.resize(TG_Chunks.size());
+    parallelFor(static_cast<int>(TG_Chunks.size()), TG_NumThreads, scanChunkTask, this);
+
+    // chunks are in file order, so positions carry on from the last chunk
+    // of the same record
+    std::string line;
+    for (size_t i = 0; i < TG_Chunks.size(); ++i) {
+        TargetChunk& chunk = TG_Chunks[i];
+        chunk.BaseOffset = (chunk.Record == TG_LastRecord) ? TG_RecordBases : 0;
+        TG_LastRecord = chunk.Record;
+        TG_RecordBases = chunk.BaseOffset + chunk.Bases;
+
+        const std::string& record_name = TG_Reference->records()[chunk.Record].Name;
+        std::vector<TargetHit>::iterator iter;
+        for (iter = TG_ChunkHits[i].begin(); iter != TG_ChunkHits[i].end(); ++iter) {
+            const TargetPattern& pattern = TG_Patterns[iter->Pattern];
+            size_t start = chunk.BaseOffset + iter->Start;
+            std::vector<int>::const_iterator spacer;
+            const std::vector<int>& spacers = TG_PatternSpacers[iter->Pattern];
+            for (spacer = spacers.begin(); spacer != spacers.end(); ++spacer) {
+                line = TG_SpacerNames[*spacer];
+                line += '\t';
+                line += record_name;
+                line += '\t';
+                appendNumber(line, start + 1);
+                line += '\t';
+                appendNumber(line, start + pattern.Length);
+                line += '\t';
+                line += pattern.Strand;
+                line += '\t';
+                appendNumber(line, iter->Mismatches);
+                line += '\n';
+                TG_Output.write(line);
+            }
+        }
+        TG_ChunkHits[i].clear();
+    }
+    TG_Chunks.clear();
+}
+
+void TargetTool::searchReference(const char * referenceFile)
+{
+    if (!TG_Output.isOpen()) {
+        if (TG_OutputFile.empty()) {
+            TG_Output.openStdout();
+        } else {
+            TG_Output.open(TG_OutputFile);
+        }
+    }
+    if (TG_Patterns.empty()) {
+        return;
+    }
+
+    MappedFasta reference;
+    reference.open(referenceFile);
+    TG_Reference = &reference;
+    TG_LastRecord = -1;
+    TG_RecordBases = 0;
+
+    //-----
+    // Records are cut into chunks of about the same number of bytes, a
+    // batch of chunks is scanned on all of the threads and then its hits
+    // are written in order, so the output is the same with any number of
+    // threads
+    //
+    size_t batch_size = static_cast<size_t>(TG_NumThreads) * TG_CHUNKS_PER_THREAD;
+    const std::vector<FastaRecord>& records = reference.records();
+    for (size_t r = 0; r < records.size(); ++r) {
+        for (size_t start = records[r].SequenceStart; start < records[r].SequenceEnd; start += TG_CHUNK_SIZE) {
+            TargetChunk chunk;
+            chunk.Record = static_cast<int>(r);
+            chunk.Start = start;
+            chunk.End = std::min(start + TG_CHUNK_SIZE, records[r].SequenceEnd);
+            chunk.Bases = 0;
+            chunk.BaseOffset = 0;
+            TG_Chunks.push_back(chunk);
+            if (TG_Chunks.size() >= batch_size) {
+                scanBatch();
+            }
+        }
+    }
+    scanBatch();
+    TG_Reference = NULL;
+}
+
+void TargetTool::closeOutput(void)
+{
+    TG_Output.close();
+}
+
+int targetMain(int argc, char ** argv)
+{
+    try {
+        TargetTool tt;
+        int opt_index = tt.processOptions(argc, argv);
+        if (opt_index >= argc) {
+            throw crispr::input_exception("No input file provided");
+        } else if (opt_index + 1 >= argc) {
+            throw crispr::input_exception("No reference files provided");
+        }
+        int ret = tt.processInputFile(argv[opt_index]);
+        if (ret) {
+            return ret;
+        }
+        for (int i = opt_index + 1; i < argc; ++i) {
+            tt.searchReference(argv[i]);
+        }
+        tt.closeOutput();
+    } catch (crispr::input_exception& re) {
+        std::cerr<<re.what()<<std::endl;
+        targetUsage();
+        return 1;
+    } catch (crispr::exception& ce) {
+        std::cerr<<ce.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void targetUsage(void)
+{
+    std::cout<<PACKAGE_NAME<<" target [-h] [-g INT[,n]] [-m INT] [-o FILE] [-t INT] file.crispr reference.fa [...]"<<std::endl;
+    std::cout<<"Find the protospacers of the spacers in reference sequences.  Each hit is a tab separated"<<std::endl;
+    std::cout<<"line: group, spacer, reference, start, end, strand, mismatches"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-g INT[,n]          a comma separated list of group IDs whose spacers are searched for"<<std::endl;
+    std::cout<<"-m INT              the number of mismatches allowed, between 0 and "<<TG_MAX_MISMATCHES<<" [default: 0]"<<std::endl;
+    std::cout<<"-o FILE             output file name [default: print to screen]"<<std::endl;
+    std::cout<<"-t INT              number of threads, 0 uses every processor [default: "<<PL_DEFAULT_THREADS<<"]"<<std::endl;
+}
@@ -0,0 +1,140 @@
+/*
+ * TargetTool.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_TargetTool_h
+#define crisprtools_TargetTool_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <libcrispr/base.h>
+#include "SpacerAutomaton.h"
+#include "MappedFasta.h"
+#include "FastaSink.h"
+#include "Parallel.h"
+
+#define TG_CHUNK_SIZE 4194304       // bytes of reference scanned by a thread at a time
+#define TG_CHUNKS_PER_THREAD 4      // chunks in a batch for each thread
+#define TG_MAX_MISMATCHES 8         // limit on -m
+
+// a spacer in one orientation, its bases are in TG_Codes
+typedef struct __TargetPattern {
+    size_t CodeOffset;
+    int Length;
+    int NumSeeds;
+    char Strand;                    // '+' or '-' for the reverse complement
+} TargetPattern;
+
+// a piece of a pattern added to the automaton, with a copy of what is
+// needed to check a match so that only one table is looked up
+typedef struct __TargetSeed {
+    int Pattern;
+    int Index;                      // of the seed in its pattern
+    int Offset;
+    int Length;
+    size_t CodeOffset;              // of the pattern
+    int PatternLength;
+} TargetSeed;
+
+// a part of one reference record scanned by one thread
+typedef struct __TargetChunk {
+    int Record;
+    size_t Start;                   // byte offsets into the file
+    size_t End;
+    size_t Bases;                   // bases between Start and End, found by the scan
+    size_t BaseOffset;              // position of the first base in the record
+} TargetChunk;
+
+typedef struct __TargetHit {
+    size_t Start;                   // from the start of the chunk, then the record
+    int Pattern;
+    int Mismatches;
+} TargetHit;
+
+// Finds the protospacers of the spacers in a .crispr file in reference
+// FASTA files.  Every spacer goes into an Aho-Corasick automaton in both
+// orientations.  To allow up to k mismatches each one is cut into k + 1
+// seeds, at least one of which has to match exactly, and every seed match
+// is checked base by base against the whole spacer.  The references are
+// mapped into memory and cut into chunks that are scanned on all of the
+// threads, each chunk running on into the next one far enough to catch
+// matches that cross the boundary
+class TargetTool {
+public:
+    TargetTool()
+    {
+        TG_Subset = false;
+        TG_NumThreads = PL_DEFAULT_THREADS;
+        TG_Mismatches = 0;
+        TG_MaxLength = 0;
+        TG_SkippedSpacers = 0;
+        TG_Reference = NULL;
+        TG_LastRecord = -1;
+        TG_RecordBases = 0;
+    }
+
+    int processOptions(int argc, char ** argv);
+    int processInputFile(const char * inputFile);
+    void searchReference(const char * referenceFile);
+    void closeOutput(void);
+
+    // called from the worker threads
+    void scanChunk(int chunk);
+
+private:
+    void parseGroup(xercesc::DOMElement * parentNode, crispr::xml::base& xmlParser, const std::string& groupId);
+    void addSpacer(const std::string& groupId, const std::string& spacerId, const std::string& sequence);
+    int addPattern(const std::vector<unsigned char>& codes, char strand);
+    void buildAutomaton(void);
+    void checkSeed(const std::vector<unsigned char>& codes, size_t end, size_t ownBases, int seed, std::vector<TargetHit>& hits) const;
+    void scanBatch(void);
+
+    std::set<std::string> TG_Groups;
+    bool TG_Subset;
+    std::string TG_OutputFile;
+    int TG_NumThreads;
+    int TG_Mismatches;
+
+    // "gid\tspid" of each spacer
+    std::vector<std::string> TG_SpacerNames;
+
+    // sequence and strand to pattern
+    std::map<std::string, int> TG_PatternIndex;
+    std::vector<TargetPattern> TG_Patterns;
+    std::vector<unsigned char> TG_Codes;
+    std::vector< std::vector<int> > TG_PatternSpacers;
+    std::vector<TargetSeed> TG_Seeds;
+    size_t TG_MaxLength;
+    int TG_SkippedSpacers;
+    SpacerAutomaton TG_Automaton;
+
+    // the reference being searched and the current batch of chunks
+    MappedFasta * TG_Reference;
+    std::vector<TargetChunk> TG_Chunks;
+    std::vector< std::vector<TargetHit> > TG_ChunkHits;
+    int TG_LastRecord;
+    size_t TG_RecordBases;
+
+    FastaSink TG_Output;
+};
+
+int targetMain(int argc, char ** argv);
+void targetUsage(void);
+#endif
@@ -0,0 +1,502 @@
+// ToolBench.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmarks of the subcommands.  For each size an input is made with
+// simulate, then every subcommand is run on it in a child process that
+// calls the subcommand's main function directly, so that the wall time,
+// CPU time and peak memory of each run are its own.  Results are written
+// as JSON and can be compared with an earlier run to catch regressions.
+// Build and run with 'make bench', usage: crisprtools_bench -h
+
+#include "config.h"
+#include "Utils.h"
+#include "Parallel.h"
+#include "SeqKernels.h"
+#include "StatTool.h"
+#include "ExtractTool.h"
+#include "FilterTool.h"
+#include "SanitiseTool.h"
+#include "MergeTool.h"
+#include "RemoveTool.h"
+#include "DrawTool.h"
+#include "GraphTool.h"
+#include "ExportTool.h"
+#include "TargetTool.h"
+#include "IndexTool.h"
+#include "FindTool.h"
+#include "CompareTool.h"
+#include "ClassifyTool.h"
+#include "ClusterTool.h"
+#include "SimulateTool.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define TB_DEFAULT_SIZES "1000,10000"   // groups in each input
+#define TB_DEFAULT_REPEATS 3            // best of this many runs is reported
+#define TB_DEFAULT_DIR "crisprtools_bench.tmp"
+#define TB_DEFAULT_OUTPUT "bench.json"
+#define TB_DEFAULT_TOLERANCE 10         // percent slower or bigger than the baseline that is a regression
+#define TB_MIN_SECONDS 0.05             // smaller differences in time are noise
+#define TB_MIN_KIB 1024                 // and in peak memory
+
+typedef int (*benchMain)(int argc, char ** argv);
+
+// A subcommand and its arguments.  In the arguments {in} is the simulated
+// input, {out} an output file for the command and {dir} the work directory.
+// Needs names a command whose output is used, which is run first if it
+// hasn't been
+struct BenchCommand {
+    const char * Name;
+    benchMain Main;
+    const char * Arguments;
+    const char * Needs;
+};
+
+static const BenchCommand TB_COMMANDS[] = {
+    {"simulate", simulateMain, "simulate -n {groups} -o {in}", NULL},
+    {"stat", statMain, "stat {in}", NULL},
+    {"stat-composition", statMain, "stat --composition {in}", NULL},
+    {"extract", extractMain, "extract -o {dir} --spacer=spacers.fa --direct-repeat=repeats.fa --flanker=flankers.fa {in}", NULL},
+    {"filter", filterMain, "filter -s 10 -o {out} {in}", NULL},
+    {"sanitise", sanitiseMain, "sanitise -a -o {out} {in}", NULL},
+    {"merge", mergeMain, "merge -s -o {out} {in} {in}", NULL},
+    {"rm", removeMain, "rm -g 1,2,3 -o {out} {in}", NULL},
+    {"draw", drawMain, "draw -a native -f svg -p {out}.svg {in}", NULL},
+    {"graph", graphMain, "graph -o {out} {in}", NULL},
+    {"export", exportMain, "export --gfa -o {out} {in}", NULL},
+    {"index", indexMain, "index -o {dir}/bench.idx {in}", NULL},
+    {"find", findMain, "find {dir}/bench.idx ACGTACGTACGTACGTACGT", "index"},
+    {"compare", compareMain, "compare -o {out} {in}", NULL},
+    {"cluster", clusterMain, "cluster -o {out} {in}", NULL},
+    {"classify", classifyMain, "classify -r {dir}/repeats.fa -o {out} {in}", "extract"},
+    {"target", targetMain, "target -o {out} {in} {dir}/spacers.fa", "extract"}
+};
+#define TB_NUM_COMMANDS (sizeof(TB_COMMANDS) / sizeof(TB_COMMANDS[0]))
+
+struct BenchRun {
+    int Status;                     // exit status, or -1 if it didn't exit
+    double Wall;                    // seconds
+    double Cpu;
+    long PeakKiB;
+};
+
+struct BenchResult {
+    std::string Command;
+    long Groups;
+    off_t Bytes;
+    BenchRun Best;
+};
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void usage(void)
+{
+    std::cout<<"crisprtools_bench [-hk] [-s INT[,n]] [-c NAME[,n]] [-r INT] [-d DIR] [-o FILE] [-b FILE] [-x INT]"<<std::endl;
+    std::cout<<"Time every subcommand on simulated inputs of several sizes"<<std::endl;
+    std::cout<<"Options:"<<std::endl;
+    std::cout<<"-h                  print this handy help message"<<std::endl;
+    std::cout<<"-s INT[,n]          number of groups in each input [default: "<<TB_DEFAULT_SIZES<<"]"<<std::endl;
+    std::cout<<"-c NAME[,n]         the benchmarks to run [default: all of them]:"<<std::endl;
+    std::cout<<"                   ";
+    for (size_t i = 0; i < TB_NUM_COMMANDS; ++i) {
+        std::cout<<' '<<TB_COMMANDS[i].Name;
+    }
+    std::cout<<std::endl;
+    std::cout<<"-r INT              runs of each benchmark, the fastest is reported [default: "<<TB_DEFAULT_REPEATS<<"]"<<std::endl;
+    std::cout<<"-d DIR              directory for the inputs and outputs [default: "<<TB_DEFAULT_DIR<<"]"<<std::endl;
+    std::cout<<"-k                  keep the directory afterwards"<<std::endl;
+    std::cout<<"-o FILE             write the results to this JSON file [default: "<<TB_DEFAULT_OUTPUT<<"]"<<std::endl;
+    std::cout<<"-b FILE             compare with the results of an earlier run, exits with 1 if anything regressed"<<std::endl;
+    std::cout<<"-x INT              percent slower, or bigger, than the baseline that counts as a regression [default: "<<TB_DEFAULT_TOLERANCE<<"]"<<std::endl;
+}
+
+static void splitList(const char * str, std::vector<std::string>& items)
+{
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+}
+
+static void replaceAll(std::string& str, const char * from, const std::string& to)
+{
+    size_t length = strlen(from);
+    for (size_t pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos + to.length())) {
+        str.replace(pos, length, to);
+    }
+}
+
+static off_t fileSize(const std::string& fileName)
+{
+    struct stat file_stats;
+    if (stat(fileName.c_str(), &file_stats)) {
+        return 0;
+    }
+    return file_stats.st_size;
+}
+
+// run a subcommand in a child process with its output going to a log
+static BenchRun runCommand(const BenchCommand& command, const std::string& dir, const std::string& input, long groups)
+{
+    std::stringstream group_count;
+    group_count << groups;
+    std::string output = dir + "/" + command.Name + ".out";
+    std::vector<std::string> words;
+    std::stringstream ss(command.Arguments);
+    std::string word;
+    while (ss >> word) {
+        replaceAll(word, "{in}", input);
+        replaceAll(word, "{out}", output);
+        replaceAll(word, "{dir}", dir);
+        replaceAll(word, "{groups}", group_count.str());
+        words.push_back(word);
+    }
+    std::string log = dir + "/" + command.Name + ".log";
+
+    BenchRun run = {-1, 0, 0, 0};
+    double start = now();
+    pid_t child = fork();
+    if (child == -1) {
+        perror("fork");
+        return run;
+    }
+    if (child == 0) {
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd != -1) {
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        std::vector<char *> argv;
+        for (size_t i = 0; i < words.size(); ++i) {
+            argv.push_back(const_cast<char *>(words[i].c_str()));
+        }
+        argv.push_back(NULL);
+
+        // the option parsing of this program has moved getopt on
+        optind = 0;
+        int ret = command.Main(static_cast<int>(words.size()), &argv[0]);
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(NULL);
+        _exit(ret);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) == -1) {
+        perror("wait4");
+        return run;
+    }
+    run.Wall = now() - start;
+    run.Cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    // kilobytes on Linux
+    run.PeakKiB = usage.ru_maxrss;
+    run.Status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return run;
+}
+
+static void removeDirectory(const std::string& dir)
+{
+    DIR * d = opendir(dir.c_str());
+    if (!d) {
+        return;
+    }
+    struct dirent * entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+            unlink((dir + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+static void writeJson(const std::string& fileName, const std::vector<BenchResult>& results, int repeats)
+{
+    std::ofstream out(fileName.c_str());
+    if (!out.good()) {
+        fprintf(stderr, "cannot write %s\n", fileName.c_str());
+        return;
+    }
+    char line[512];
+    out<<"{"<<std::endl;
+    out<<"  \"version\": \""<<PACKAGE_VERSION<<"\","<<std::endl;
+    out<<"  \"timestamp\": "<<static_cast<long>(time(NULL))<<","<<std::endl;
+    out<<"  \"processors\": "<<availableProcessors()<<","<<std::endl;
+    out<<"  \"kernels\": \""<<seqKernelName(seqKernelLevel())<<"\","<<std::endl;
+    out<<"  \"repeats\": "<<repeats<<","<<std::endl;
+    out<<"  \"results\": ["<<std::endl;
+    // one result on each line, which is all that readBaseline needs
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double seconds = (r.Best.Wall > 0) ? r.Best.Wall : 1e-9;
+        snprintf(line, sizeof(line),
+                 "    {\"command\": \"%s\", \"groups\": %ld, \"bytes\": %.0f, \"status\": %d, \"wall\": %.6f, \"cpu\": %.6f, "
+                 "\"groups_per_second\": %.1f, \"mb_per_second\": %.3f, \"peak_rss_kib\": %ld}%s",
+                 r.Command.c_str(), r.Groups, static_cast<double>(r.Bytes), r.Best.Status, r.Best.Wall, r.Best.Cpu,
+                 r.Groups / seconds, r.Bytes / seconds / 1e6, r.Best.PeakKiB,
+                 (i + 1 < results.size()) ? "," : "");
+        out<<line<<std::endl;
+    }
+    out<<"  ]"<<std::endl;
+    out<<"}"<<std::endl;
+}
+
+// the value after "name": on a line of writeJson output
+static bool jsonField(const std::string& line, const char * name, std::string& value)
+{
+    std::string key = std::string("\"") + name + "\": ";
+    size_t pos = line.find(key);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos += key.length();
+    size_t end = line.find_first_of(",}", pos);
+    value = line.substr(pos, end - pos);
+    if (value.length() >= 2 && value[0] == '"') {
+        value = value.substr(1, value.length() - 2);
+    }
+    return true;
+}
+
+// the results of an earlier run keyed by command and size
+static bool readBaseline(const char * fileName, std::map<std::pair<std::string, long>, BenchRun>& baseline)
+{
+    std::ifstream in(fileName);
+    if (!in.good()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string command, groups, wall, cpu, peak;
+        if (!jsonField(line, "command", command) || !jsonField(line, "groups", groups) ||
+            !jsonField(line, "wall", wall) || !jsonField(line, "cpu", cpu) || !jsonField(line, "peak_rss_kib", peak)) {
+            continue;
+        }
+        BenchRun run = {0, atof(wall.c_str()), atof(cpu.c_str()), atol(peak.c_str())};
+        baseline[std::make_pair(command, atol(groups.c_str()))] = run;
+    }
+    return true;
+}
+
+static double change(double value, double base)
+{
+    return (base > 0) ? (value - base) * 100.0 / base : 0;
+}
+
+// print each result next to its baseline, returns the number of regressions
+static int compareBaseline(const std::vector<BenchResult>& results, const std::map<std::pair<std::string, long>, BenchRun>& baseline, int tolerance)
+{
+    int regressions = 0;
+    printf("\n%-18s %10s %10s %10s %8s %10s %10s %8s\n", "compared", "groups", "wall", "baseline", "change", "peak KiB", "baseline", "change");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        std::map<std::pair<std::string, long>, BenchRun>::const_iterator found = baseline.find(std::make_pair(r.Command, r.Groups));
+        if (found == baseline.end() || r.Best.Status) {
+            continue;
+        }
+        const BenchRun& base = found->second;
+        bool slower = r.Best.Wall > base.Wall * (1 + tolerance / 100.0) && r.Best.Wall - base.Wall > TB_MIN_SECONDS;
+        bool bigger = r.Best.PeakKiB > base.PeakKiB * (1 + tolerance / 100.0) && r.Best.PeakKiB - base.PeakKiB > TB_MIN_KIB;
+        printf("%-18s %10ld %10.3f %10.3f %+7.1f%% %10ld %10ld %+7.1f%%%s%s\n",
+               r.Command.c_str(), r.Groups, r.Best.Wall, base.Wall, change(r.Best.Wall, base.Wall),
+               r.Best.PeakKiB, base.PeakKiB, change(r.Best.PeakKiB, base.PeakKiB),
+               slower ? "  SLOWER" : "", bigger ? "  BIGGER" : "");
+        if (slower || bigger) {
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char ** argv)
+{
+    std::vector<std::string> size_list;
+    std::set<std::string> chosen;
+    int repeats = TB_DEFAULT_REPEATS;
+    std::string dir = TB_DEFAULT_DIR;
+    std::string output = TB_DEFAULT_OUTPUT;
+    const char * baseline_file = NULL;
+    int tolerance = TB_DEFAULT_TOLERANCE;
+    bool keep = false;
+
+    int c;
+    int index;
+    static struct option long_options [] = {
+        {"help", no_argument, NULL, 'h'},
+        {"sizes", required_argument, NULL, 's'},
+        {"commands", required_argument, NULL, 'c'},
+        {"repeats", required_argument, NULL, 'r'},
+        {"dir", required_argument, NULL, 'd'},
+        {"keep", no_argument, NULL, 'k'},
+        {"outfile", required_argument, NULL, 'o'},
+        {"baseline", required_argument, NULL, 'b'},
+        {"tolerance", required_argument, NULL, 'x'},
+        {0,0,0,0}
+    };
+    while ((c = getopt_long(argc, argv, "hs:c:r:d:ko:b:x:", long_options, &index)) != -1) {
+        switch (c) {
+            case 's': splitList(optarg, size_list); break;
+            case 'c':
+            {
+                std::vector<std::string> names;
+                splitList(optarg, names);
+                chosen.insert(names.begin(), names.end());
+                break;
+            }
+            case 'r': repeats = atoi(optarg); break;
+            case 'd': dir = optarg; break;
+            case 'k': keep = true; break;
+            case 'o': output = optarg; break;
+            case 'b': baseline_file = optarg; break;
+            case 'x': tolerance = atoi(optarg); break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (size_list.empty()) {
+        splitList(TB_DEFAULT_SIZES, size_list);
+    }
+    std::vector<long> sizes;
+    for (size_t i = 0; i < size_list.size(); ++i) {
+        long groups = atol(size_list[i].c_str());
+        if (groups < 1) {
+            fprintf(stderr, "bad size: %s\n", size_list[i].c_str());
+            return 1;
+        }
+        sizes.push_back(groups);
+    }
+    for (std::set<std::string>::iterator iter = chosen.begin(); iter != chosen.end(); ++iter) {
+        size_t i = 0;
+        while (i < TB_NUM_COMMANDS && *iter != TB_COMMANDS[i].Name) {
+            ++i;
+        }
+        if (i == TB_NUM_COMMANDS) {
+            fprintf(stderr, "unknown benchmark: %s\n", iter->c_str());
+            return 1;
+        }
+    }
+    if (repeats < 1 || tolerance < 0) {
+        usage();
+        return 1;
+    }
+    std::map<std::pair<std::string, long>, BenchRun> baseline;
+    if (baseline_file && !readBaseline(baseline_file, baseline)) {
+        fprintf(stderr, "cannot read %s\n", baseline_file);
+        return 1;
+    }
+    recursiveMkdir(dir);
+
+    std::vector<BenchResult> results;
+    int failures = 0;
+    printf("%-18s %10s %12s %10s %10s %12s %10s %10s\n", "benchmark", "groups", "bytes", "wall", "cpu", "groups/s", "MB/s", "peak KiB");
+    for (size_t s = 0; s < sizes.size(); ++s) {
+        std::stringstream ss;
+        ss << dir << "/bench_" << sizes[s] << ".crispr";
+        std::string input = ss.str();
+        std::set<std::string> done;
+        for (size_t i = 0; i < TB_NUM_COMMANDS; ++i) {
+            const BenchCommand& command = TB_COMMANDS[i];
+            bool wanted = chosen.empty() || chosen.count(command.Name);
+
+            // the input is always needed, as is the output of anything
+            // this command reads
+            if (!wanted && i != 0) {
+                continue;
+            }
+            if (command.Needs && !done.count(command.Needs)) {
+                for (size_t n = 0; n < TB_NUM_COMMANDS; ++n) {
+                    if (!strcmp(TB_COMMANDS[n].Name, command.Needs)) {
+                        runCommand(TB_COMMANDS[n], dir, input, sizes[s]);
+                    }
+                }
+                done.insert(command.Needs);
+            }
+
+            BenchResult result;
+            result.Command = command.Name;
+            result.Groups = sizes[s];
+            for (int r = 0; r < (wanted ? repeats : 1); ++r) {
+                BenchRun run = runCommand(command, dir, input, sizes[s]);
+                if (r == 0 || run.Status || run.Wall < result.Best.Wall) {
+                    long peak = (r == 0) ? run.PeakKiB : std::max(run.PeakKiB, result.Best.PeakKiB);
+                    result.Best = run;
+                    result.Best.PeakKiB = peak;
+                } else {
+                    result.Best.PeakKiB = std::max(run.PeakKiB, result.Best.PeakKiB);
+                }
+                if (run.Status) {
+                    break;
+                }
+            }
+            done.insert(command.Name);
+            result.Bytes = fileSize(input);
+            if (!wanted) {
+                continue;
+            }
+            if (result.Best.Status) {
+                printf("%-18s %10ld  failed with status %d, see %s/%s.log\n", command.Name, sizes[s], result.Best.Status, dir.c_str(), command.Name);
+                ++failures;
+            } else {
+                double seconds = (result.Best.Wall > 0) ? result.Best.Wall : 1e-9;
+                printf("%-18s %10ld %12.0f %10.3f %10.3f %12.0f %10.2f %10ld\n", command.Name, sizes[s], static_cast<double>(result.Bytes),
+                       result.Best.Wall, result.Best.Cpu, sizes[s] / seconds, result.Bytes / seconds / 1e6, result.Best.PeakKiB);
+            }
+            fflush(stdout);
+            results.push_back(result);
+        }
+    }
+    writeJson(output, results, repeats);
+
+    int regressions = 0;
+    if (baseline_file) {
+        regressions = compareBaseline(results, baseline, tolerance);
+        printf("%d regressions against %s\n", regressions, baseline_file);
+    }
+    if (!keep) {
+        removeDirectory(dir);
+    }
+    return (failures || regressions) ? 1 : 0;
+}
@@ -0,0 +1,280 @@
+// Trace.cpp
+//
+// Copyright (C) 2012 - Connor Skennerton
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+#include <unistd.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+bool TR_Enabled = false;
+
+// the events of one thread.  Only the thread using the buffer writes to
+// it, so recording an event is a plain store
+typedef struct __TraceBuffer {
+    std::vector<TraceEvent *> Chunks;
+    uint64_t Count;                 // events recorded, including overwritten ones
+    int Tid;
+} TraceBuffer;
+
+static std::string TR_Command;
+static std::string TR_FileName;
+static uint64_t TR_StartTime;
+static std::vector<TraceBuffer *> TR_Buffers;
+static std::vector<TraceBuffer *> TR_FreeBuffers;
+static XMLCh * TR_GroupTag = NULL;
+static XMLCh * TR_GidAttr = NULL;
+static XMLCh * TR_DataTag = NULL;
+static XMLCh * TR_SpacersTag = NULL;
+#if HAVE_PTHREAD
+// only taken when a thread gets or gives back its buffer
+static pthread_mutex_t TR_Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t TR_Key;
+#else
+static TraceBuffer * TR_Buffer = NULL;
+#endif
+
+static uint64_t now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<uint64_t>(tv.tv_sec) * 1000000 + static_cast<uint64_t>(tv.tv_usec);
+}
+
+// must be called with TR_Lock held
+static TraceBuffer * takeBuffer(void)
+{
+    if (!TR_FreeBuffers.empty()) {
+        TraceBuffer * buffer = TR_FreeBuffers.back();
+        TR_FreeBuffers.pop_back();
+        return buffer;
+    }
+    TraceBuffer * buffer = new TraceBuffer;
+    buffer->Count = 0;
+    buffer->Tid = static_cast<int>(TR_Buffers.size()) + 1;
+    TR_Buffers.push_back(buffer);
+    return buffer;
+}
+
+#if HAVE_PTHREAD
+static void giveBackBuffer(void * data)
+{
+    pthread_mutex_lock(&TR_Lock);
+    TR_FreeBuffers.push_back(static_cast<TraceBuffer *>(data));
+    pthread_mutex_unlock(&TR_Lock);
+}
+#endif
+
+static TraceBuffer * threadBuffer(void)
+{
+#if HAVE_PTHREAD
+    TraceBuffer * buffer = static_cast<TraceBuffer *>(pthread_getspecific(TR_Key));
+    if (buffer == NULL) {
+        pthread_mutex_lock(&TR_Lock);
+        buffer = takeBuffer();
+        pthread_mutex_unlock(&TR_Lock);
+        pthread_setspecific(TR_Key, buffer);
+    }
+    return buffer;
+#else
+    if (TR_Buffer == NULL) {
+        TR_Buffer = takeBuffer();
+    }
+    return TR_Buffer;
+#endif
+}
+
+static void record(const TraceEvent& event)
+{
+    TraceBuffer * buffer = threadBuffer();
+    size_t slot = static_cast<size_t>(buffer->Count % (TR_MAX_CHUNKS * TR_CHUNK_EVENTS));
+    size_t chunk = slot / TR_CHUNK_EVENTS;
+    if (chunk == buffer->Chunks.size()) {
+        buffer->Chunks.push_back(new TraceEvent[TR_CHUNK_EVENTS]);
+    }
+    buffer->Chunks[chunk][slot % TR_CHUNK_EVENTS] = event;
+    ++buffer->Count;
+}
+
+static void writeEvent(std::ostream& out, const TraceEvent& event, int pid, int tid)
+{
+    out<<",\n{\"name\": ";
+    writeJsonString(out, event.Name);
+    out<<", \"ph\": \"X\", \"pid\": "<<pid<<", \"tid\": "<<tid;
+    out<<", \"ts\": "<<event.Start<<", \"dur\": "<<event.Duration;
+    if (event.ArgName != NULL || event.Gid[0] != '\0') {
+        out<<", \"args\": {";
+        if (event.Gid[0] != '\0') {
+            out<<"\"gid\": ";
+            writeJsonString(out, event.Gid);
+            if (event.ArgName != NULL) {
+                out<<", ";
+            }
+        }
+        if (event.ArgName != NULL) {
+            writeJsonString(out, event.ArgName);
+            out<<": "<<event.ArgValue;
+        }
+        out<<"}";
+    }
+    out<<"}";
+}
+
+static void traceFlush(void)
+{
+    std::ofstream out(TR_FileName.c_str());
+    if (!out) {
+        std::cerr<<"cannot write the trace to "<<TR_FileName<<std::endl;
+        return;
+    }
+    int pid = static_cast<int>(getpid());
+    uint64_t dropped = 0;
+    out<<"{\"traceEvents\": [\n";
+    out<<"{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": "<<pid<<", \"args\": {\"name\": ";
+    writeJsonString(out, ("crisprtools " + TR_Command).c_str());
+    out<<"}}";
+    const uint64_t capacity = TR_MAX_CHUNKS * TR_CHUNK_EVENTS;
+    for (size_t i = 0; i < TR_Buffers.size(); ++i) {
+        TraceBuffer * buffer = TR_Buffers[i];
+        out<<",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": "<<pid<<", \"tid\": "<<buffer->Tid;
+        out<<", \"args\": {\"name\": \""<<((buffer->Tid == 1) ? "main" : "worker")<<' '<<buffer->Tid<<"\"}}";
+
+        // once the ring has wrapped the oldest event is the next to be overwritten
+        uint64_t first = (buffer->Count > capacity) ? buffer->Count - capacity : 0;
+        dropped += first;
+        for (uint64_t n = first; n < buffer->Count; ++n) {
+            size_t slot = static_cast<size_t>(n % capacity);
+            writeEvent(out, buffer->Chunks[slot / TR_CHUNK_EVENTS][slot % TR_CHUNK_EVENTS], pid, buffer->Tid);
+        }
+    }
+    out<<"\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"command\": ";
+    writeJsonString(out, TR_Command.c_str());
+    out<<", \"dropped_events\": "<<dropped<<"}}"<<std::endl;
+    if (dropped) {
+        std::cerr<<"the trace buffers filled up, the first "<<dropped<<" events were dropped"<<std::endl;
+    }
+}
+
+void traceStart(const char * command, const char * fileName)
+{
+    TR_Command = command;
+    TR_FileName = fileName;
+#if HAVE_PTHREAD
+    pthread_key_create(&TR_Key, giveBackBuffer);
+#endif
+    // the main thread gets the first lane
+    threadBuffer();
+    TR_StartTime = now();
+    TR_Enabled = true;
+    atexit(traceFlush);
+}
+
+void traceBegin(TraceEvent& event, const char * name, const char * argName, int argValue)
+{
+    event.Name = name;
+    event.ArgName = argName;
+    event.ArgValue = argValue;
+    event.Gid[0] = '\0';
+    event.Start = now() - TR_StartTime;
+}
+
+void traceBeginGroup(TraceEvent& event, const char * name, const std::string& gid, int elements)
+{
+    size_t length = gid.copy(event.Gid, TR_GID_LENGTH - 1);
+    event.Gid[length] = '\0';
+    event.Name = name;
+    event.ArgName = "elements";
+    event.ArgValue = elements;
+    event.Start = now() - TR_StartTime;
+}
+
+bool traceBeginGroup(TraceEvent& event, xercesc::DOMElement * group)
+{
+    // made here rather than in traceStart as xerces has to be set up first
+    if (TR_GroupTag == NULL) {
+        TR_GroupTag = xercesc::XMLString::transcode("group");
+        TR_GidAttr = xercesc::XMLString::transcode("gid");
+        TR_DataTag = xercesc::XMLString::transcode("data");
+        TR_SpacersTag = xercesc::XMLString::transcode("spacers");
+    }
+    if (!xercesc::XMLString::equals(group->getTagName(), TR_GroupTag)) {
+        return false;
+    }
+
+    // the spacers are counted rather than every element of the group so
+    // that the span doesn't time a walk over the whole group
+    int spacers = 0;
+    for (xercesc::DOMElement * child = group->getFirstElementChild();
+         child != NULL;
+         child = child->getNextElementSibling()) {
+        if (!xercesc::XMLString::equals(child->getTagName(), TR_DataTag)) {
+            continue;
+        }
+        for (xercesc::DOMElement * data = child->getFirstElementChild();
+             data != NULL;
+             data = data->getNextElementSibling()) {
+            if (xercesc::XMLString::equals(data->getTagName(), TR_SpacersTag)) {
+                spacers = static_cast<int>(data->getChildElementCount());
+            }
+        }
+    }
+    char * c_gid = xercesc::XMLString::transcode(group->getAttribute(TR_GidAttr));
+    traceBeginGroup(event, "group", c_gid, spacers);
+    event.ArgName = "spacers";
+    xercesc::XMLString::release(&c_gid);
+    return true;
+}
+
+void traceEnd(TraceEvent& event)
+{
+    event.Duration = now() - TR_StartTime - event.Start;
+    record(event);
+}
+
+uint64_t countElements(xercesc::DOMElement * element)
+{
+    uint64_t count = 1;
+    for (xercesc::DOMElement * child = element->getFirstElementChild();
+         child != NULL;
+         child = child->getNextElementSibling()) {
+        count += countElements(child);
+    }
+    return count;
+}
+
+void writeJsonString(std::ostream& out, const char * str)
+{
+    out<<'"';
+    for (; *str; ++str) {
+        unsigned char c = static_cast<unsigned char>(*str);
+        if (c == '"' || c == '\\') {
+            out<<'\\'<<*str;
+        } else if (c < 0x20) {
+            out<<' ';
+        } else {
+            out<<*str;
+        }
+    }
+    out<<'"';
+}
@@ -0,0 +1,106 @@
+/*
+ * Trace.h
+ *
+ * Copyright (C) 2012 - Connor Skennerton
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef crisprtools_Trace_h
+#define crisprtools_Trace_h
+
+#include <string>
+#include <ostream>
+#include <stdint.h>
+#include <libcrispr/base.h>
+
+#define TR_GID_LENGTH 24            // longer gids are cut short
+#define TR_CHUNK_EVENTS 65536       // events are stored in chunks of this many
+#define TR_MAX_CHUNKS 16            // per thread, then the oldest events are overwritten
+
+// Timelines for crisprtools --trace, written as Chrome trace event JSON
+// that chrome://tracing and Perfetto can load.  Every thread records its
+// spans in a ring buffer of its own without taking a lock, the buffers
+// are only read when the program exits.  Worker threads hand their buffer
+// back when they finish so that the next one carries on in the same lane
+typedef struct __TraceEvent {
+    const char * Name;
+    const char * ArgName;           // name of ArgValue, NULL if there isn't one
+    uint64_t Start;                 // microseconds
+    uint64_t Duration;
+    int ArgValue;
+    char Gid[TR_GID_LENGTH];        // empty if the span isn't for a group
+} TraceEvent;
+
+extern bool TR_Enabled;
+
+// turn tracing on, the trace is written to fileName when the program exits
+void traceStart(const char * command, const char * fileName);
+
+// used by TraceSpan
+void traceBegin(TraceEvent& event, const char * name, const char * argName, int argValue);
+void traceBeginGroup(TraceEvent& event, const char * name, const std::string& gid, int elements);
+bool traceBeginGroup(TraceEvent& event, xercesc::DOMElement * group);
+void traceEnd(TraceEvent& event);
+
+// the number of elements in element, counting itself
+uint64_t countElements(xercesc::DOMElement * element);
+
+// str as a quoted JSON string
+void writeJsonString(std::ostream& out, const char * str);
+
+class TraceSpan {
+public:
+    // nothing is recorded unless startGroup is called
+    TraceSpan() : TS_Active(false) {}
+    explicit TraceSpan(const char * name) : TS_Active(TR_Enabled) {
+        if (TS_Active) {
+            traceBegin(TS_Event, name, NULL, 0);
+        }
+    }
+    TraceSpan(const char * name, const char * argName, int argValue) : TS_Active(TR_Enabled) {
+        if (TS_Active) {
+            traceBegin(TS_Event, name, argName, argValue);
+        }
+    }
+    // a span called "group" with the gid and number of spacers of the
+    // group as arguments, nothing is recorded for other elements
+    explicit TraceSpan(xercesc::DOMElement * group) : TS_Active(TR_Enabled) {
+        if (TS_Active) {
+            TS_Active = traceBeginGroup(TS_Event, group);
+        }
+    }
+    ~TraceSpan() {
+        if (TS_Active) {
+            traceEnd(TS_Event);
+        }
+    }
+
+    // for work on a group away from the DOM, elements can be anything that
+    // gives an idea of the size of the group.  Only call it when TR_Enabled
+    // is set so that the gid isn't worked out for nothing
+    void startGroup(const char * name, const std::string& gid, int elements) {
+        TS_Active = true;
+        traceBeginGroup(TS_Event, name, gid, elements);
+    }
+
+private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+    bool TS_Active;
+    TraceEvent TS_Event;
+};
+
+#endif
@@ -28,31 +28,83 @@
 #include "ExtractTool.h"
 #include "FilterTool.h"
 #include "SanitiseTool.h"
-#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
 #include "DrawTool.h"
-#endif
 #include "StatTool.h"
 #include "RemoveTool.h"
+#include "GraphTool.h"
+#include "ExportTool.h"
+#include "TargetTool.h"
+#include "IndexTool.h"
+#include "FindTool.h"
+#include "CompareTool.h"
+#include "ClassifyTool.h"
+#include "ClusterTool.h"
+#include "SimulateTool.h"
+#include "Profile.h"
 void usage (void)
 {
 	std::cout<<PACKAGE_NAME<<" ("<<PACKAGE_VERSION<<")"<<std::endl;
 	std::cout<<PACKAGE_NAME<<" is a set of smal utilities for manipulating .crispr files"<<std::endl;
 	std::cout<<"The .crispr file specification is a standard xml based format for describing CRISPRs"<<std::endl;
 	std::cout<<"Type "<<PACKAGE_NAME<<" <subcommand> -h for help on each utility"<<std::endl;
-	std::cout<<"Usage:\t"<<PACKAGE_NAME<<" <subcommand> [options]"<<std::endl<<std::endl;
+	std::cout<<"Usage:\t"<<PACKAGE_NAME<<" [--profile[=tsv|json]] [--trace FILE] <subcommand> [options]"<<std::endl<<std::endl;
+    std::cout<<"--profile    print the time spent in each phase, what was read and written"<<std::endl;
+    std::cout<<"             and the peak memory to stderr when the subcommand finishes"<<std::endl;
+    std::cout<<"--trace      write a timeline of every thread to FILE as Chrome trace JSON"<<std::endl<<std::endl;
     std::cout<<"subcommand:  merge       combine multiple files"<<std::endl;
 	std::cout<<"             extract     extract sequences in fasta"<<std::endl;
 	std::cout<<"             filter      make new files based on parameters"<<std::endl;
 	std::cout<<"             sanitise    change the IDs of elements"<<std::endl;
-#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
-    std::cout<<"             draw        create a rendered image of the CRISPR with Graphviz"<<std::endl;
-#endif
+    std::cout<<"             draw        create a rendered image of the CRISPR"<<std::endl;
 	std::cout<<"             stat        show statistics on some or all CRISPRs"<<std::endl;
     std::cout<<"             rm          remove a group from a .crispr file"<<std::endl;
+    std::cout<<"             graph       analyse the spacer graphs of the CRISPRs"<<std::endl;
+    std::cout<<"             export      write the spacer graphs in other formats"<<std::endl;
+    std::cout<<"             target      find the protospacers of the spacers in reference sequences"<<std::endl;
+    std::cout<<"             index       write an index of the sequences for find"<<std::endl;
+    std::cout<<"             find        list the groups that contain a sequence"<<std::endl;
+    std::cout<<"             compare     list the pairs of groups that share spacers"<<std::endl;
+    std::cout<<"             classify    assign the direct repeats to known repeat families"<<std::endl;
+    std::cout<<"             cluster     group together direct repeats that differ by a few bases"<<std::endl;
+    std::cout<<"             simulate    write a made up .crispr file for testing"<<std::endl;
 }
 
 int main(int argc, char ** argv)
 {
+    // the global options come before the subcommand
+    bool profile = false;
+    ProfileFormat profile_format = PF_TSV;
+    const char * trace_file = NULL;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
+            usage();
+            return 0;
+        } else if (!strcmp(argv[1], "--profile")) {
+            profile = true;
+        } else if (!strncmp(argv[1], "--profile=", 10) && parseProfileFormat(argv[1] + 10, profile_format)) {
+            profile = true;
+        } else if (!strcmp(argv[1], "--trace") && argc > 2) {
+            trace_file = argv[2];
+            --argc;
+            ++argv;
+        } else if (!strncmp(argv[1], "--trace=", 8) && argv[1][8] != '\0') {
+            trace_file = argv[1] + 8;
+        } else {
+            std::cerr<<"Unknown option: "<<argv[1]<<std::endl;
+            usage();
+            return 1;
+        }
+        --argc;
+        ++argv;
+    }
+    if (argc > 1) {
+        if (profile) {
+            profileStart(argv[1], profile_format);
+        }
+        if (trace_file != NULL) {
+            traceStart(argv[1], trace_file);
+        }
+    }
 	if(argc == 1)
 	{
 		usage();
@@ -63,11 +115,18 @@ int main(int argc, char ** argv)
 	else if(!strcmp(argv[1], "extract")) return extractMain(argc - 1 , argv + 1);
 	else if(!strcmp(argv[1],"filter")) return filterMain(argc - 1, argv + 1);
 	else if(!strcmp(argv[1], "sanitise")) return sanitiseMain(argc - 1 , argv + 1);
-#if RENDERING && HAVE_LIBCDT && HAVE_LIBGRAPH && HAVE_LIBGVC
 	else if(!strcmp(argv[1], "draw")) return drawMain(argc - 1, argv + 1);
-#endif
 	else if(!strcmp(argv[1], "stat")) return statMain(argc - 1, argv + 1);
 	else if (!strcmp(argv[1], "rm")) return removeMain(argc -1 , argv + 1);
+    else if (!strcmp(argv[1], "graph")) return graphMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "export")) return exportMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "target")) return targetMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "index")) return indexMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "find")) return findMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "compare")) return compareMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "classify")) return classifyMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "cluster")) return clusterMain(argc - 1, argv + 1);
+    else if (!strcmp(argv[1], "simulate")) return simulateMain(argc - 1, argv + 1);
 	else
 	{
 		std::cerr<<"Unknown option: "<<argv[1]<<std::endl;